@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "nautilus-media-cache.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+
+#define CACHE_FILE_HEADER "nautilus-media-cache 2"
+/* Entries of files which were deleted are never removed one by one, so the
+ * whole cache starts over once it grows this large. */
+#define MAX_CACHE_ENTRIES 200000
+
+typedef struct
+{
+    guint64 device;
+    guint64 inode;
+    gint64 mtime;
+    guint64 size;
+    NautilusMediaInfo info;
+} CacheEntry;
+
+struct _NautilusMediaCache
+{
+    char *path;
+
+    GMutex mutex;
+    GHashTable *entries; /* CacheEntry set */
+    gboolean loaded;
+    gboolean dirty;
+
+    /* Held while writing, so that saves don't race each other */
+    GMutex save_mutex;
+};
+
+static guint
+cache_entry_hash (gconstpointer key)
+{
+    const CacheEntry *entry = key;
+
+    return (guint) (entry->device ^ entry->inode ^ (entry->inode >> 32) ^ entry->mtime ^ entry->size);
+}
+
+static gboolean
+cache_entry_equal (gconstpointer a,
+                   gconstpointer b)
+{
+    const CacheEntry *entry_a = a;
+    const CacheEntry *entry_b = b;
+
+    return entry_a->device == entry_b->device &&
+           entry_a->inode == entry_b->inode &&
+           entry_a->mtime == entry_b->mtime &&
+           entry_a->size == entry_b->size;
+}
+
+NautilusMediaCache *
+nautilus_media_cache_new (const char *path)
+{
+    NautilusMediaCache *cache = g_new0 (NautilusMediaCache, 1);
+
+    cache->path = g_strdup (path);
+    g_mutex_init (&cache->mutex);
+    g_mutex_init (&cache->save_mutex);
+    cache->entries = g_hash_table_new_full (cache_entry_hash, cache_entry_equal, g_free, NULL);
+
+    return cache;
+}
+
+void
+nautilus_media_cache_free (NautilusMediaCache *cache)
+{
+    g_hash_table_destroy (cache->entries);
+    g_mutex_clear (&cache->mutex);
+    g_mutex_clear (&cache->save_mutex);
+    g_free (cache->path);
+    g_free (cache);
+}
+
+/* Called with the mutex held. The file is only read on first use, which
+ * always happens on a worker thread. */
+static void
+ensure_loaded (NautilusMediaCache *cache)
+{
+    g_autofree char *contents = NULL;
+    g_auto (GStrv) lines = NULL;
+
+    if (cache->loaded)
+    {
+        return;
+    }
+    cache->loaded = TRUE;
+
+    if (!g_file_get_contents (cache->path, &contents, NULL, NULL))
+    {
+        return;
+    }
+
+    lines = g_strsplit (contents, "\n", -1);
+    if (lines[0] == NULL || g_strcmp0 (lines[0], CACHE_FILE_HEADER) != 0)
+    {
+        return;
+    }
+
+    for (int i = 1; lines[i] != NULL; i++)
+    {
+        CacheEntry entry = { 0 };
+        guint width;
+        guint height;
+
+        if (sscanf (lines[i], "%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GINT64_FORMAT " %" G_GUINT64_FORMAT " %u %u %" G_GUINT64_FORMAT,
+                    &entry.device, &entry.inode, &entry.mtime, &entry.size,
+                    &width, &height, &entry.info.duration_ms) != 7)
+        {
+            continue;
+        }
+        entry.info.width = width;
+        entry.info.height = height;
+
+        g_hash_table_add (cache->entries, g_memdup2 (&entry, sizeof (CacheEntry)));
+    }
+}
+
+gboolean
+nautilus_media_cache_lookup (NautilusMediaCache *cache,
+                             guint64             device,
+                             guint64             inode,
+                             gint64              mtime,
+                             guint64             size,
+                             NautilusMediaInfo  *info)
+{
+    CacheEntry key = { .device = device, .inode = inode, .mtime = mtime, .size = size };
+    CacheEntry *entry;
+
+    g_mutex_lock (&cache->mutex);
+
+    ensure_loaded (cache);
+    entry = g_hash_table_lookup (cache->entries, &key);
+    if (entry != NULL)
+    {
+        *info = entry->info;
+    }
+
+    g_mutex_unlock (&cache->mutex);
+
+    return entry != NULL;
+}
+
+void
+nautilus_media_cache_insert (NautilusMediaCache      *cache,
+                             guint64                  device,
+                             guint64                  inode,
+                             gint64                   mtime,
+                             guint64                  size,
+                             const NautilusMediaInfo *info)
+{
+    CacheEntry *entry = g_new0 (CacheEntry, 1);
+
+    entry->device = device;
+    entry->inode = inode;
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->info = *info;
+
+    g_mutex_lock (&cache->mutex);
+
+    ensure_loaded (cache);
+    if (g_hash_table_size (cache->entries) >= MAX_CACHE_ENTRIES)
+    {
+        g_hash_table_remove_all (cache->entries);
+    }
+    g_hash_table_add (cache->entries, entry);
+    cache->dirty = TRUE;
+
+    g_mutex_unlock (&cache->mutex);
+}
+
+void
+nautilus_media_cache_save (NautilusMediaCache *cache)
+{
+    g_autoptr (GString) contents = NULL;
+    g_autoptr (GError) error = NULL;
+    g_autofree char *dirname = NULL;
+    GHashTableIter iter;
+    CacheEntry *entry;
+
+    g_mutex_lock (&cache->save_mutex);
+    g_mutex_lock (&cache->mutex);
+
+    if (!cache->dirty)
+    {
+        g_mutex_unlock (&cache->mutex);
+        g_mutex_unlock (&cache->save_mutex);
+        return;
+    }
+    cache->dirty = FALSE;
+
+    contents = g_string_new (CACHE_FILE_HEADER "\n");
+    g_hash_table_iter_init (&iter, cache->entries);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &entry, NULL))
+    {
+        g_string_append_printf (contents,
+                                "%" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GINT64_FORMAT " %" G_GUINT64_FORMAT " %u %u %" G_GUINT64_FORMAT "\n",
+                                entry->device, entry->inode, entry->mtime, entry->size,
+                                entry->info.width, entry->info.height, entry->info.duration_ms);
+    }
+
+    g_mutex_unlock (&cache->mutex);
+
+    dirname = g_path_get_dirname (cache->path);
+    g_mkdir_with_parents (dirname, 0700);
+
+    if (!g_file_set_contents_full (cache->path, contents->str, contents->len,
+                                   G_FILE_SET_CONTENTS_CONSISTENT, 0600, &error))
+    {
+        g_warning ("Could not save media information cache: %s", error->message);
+    }
+
+    g_mutex_unlock (&cache->save_mutex);
+}
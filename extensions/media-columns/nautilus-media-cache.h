@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "nautilus-media-header-parser.h"
+
+/* A persistent store of parsed media headers, keyed by device, inode,
+ * modification time and size, so that files which didn't change are never
+ * read again.
+ * Lookups and insertions are thread-safe. */
+typedef struct _NautilusMediaCache NautilusMediaCache;
+
+NautilusMediaCache *nautilus_media_cache_new    (const char         *path);
+void                nautilus_media_cache_free   (NautilusMediaCache *cache);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusMediaCache, nautilus_media_cache_free)
+
+gboolean            nautilus_media_cache_lookup (NautilusMediaCache *cache,
+                                                 guint64             device,
+                                                 guint64             inode,
+                                                 gint64              mtime,
+                                                 guint64             size,
+                                                 NautilusMediaInfo  *info);
+void                nautilus_media_cache_insert (NautilusMediaCache      *cache,
+                                                 guint64                  device,
+                                                 guint64                  inode,
+                                                 gint64                   mtime,
+                                                 guint64                  size,
+                                                 const NautilusMediaInfo *info);
+
+/* Writes the cache out if it changed; the file is replaced atomically. */
+void                nautilus_media_cache_save   (NautilusMediaCache *cache);
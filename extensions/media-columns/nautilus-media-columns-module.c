@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <config.h>
+
+#include "nautilus-media-columns-provider.h"
+
+#include <glib/gi18n-lib.h>
+
+#include <nautilus-extension.h>
+
+void
+nautilus_module_initialize (GTypeModule *module)
+{
+    bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
+    bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+
+    nautilus_media_columns_provider_load (module);
+}
+
+void
+nautilus_module_shutdown (void)
+{
+    nautilus_media_columns_provider_unload ();
+}
+
+void
+nautilus_module_list_types (const GType **types,
+                            int          *num_types)
+{
+    static GType type_list[1] = { 0 };
+
+    g_assert (types != NULL);
+    g_assert (num_types != NULL);
+
+    type_list[0] = NAUTILUS_TYPE_MEDIA_COLUMNS_PROVIDER;
+
+    *types = type_list;
+    *num_types = G_N_ELEMENTS (type_list);
+}
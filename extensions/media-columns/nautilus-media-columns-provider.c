@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <config.h>
+
+#include "nautilus-media-columns-provider.h"
+
+#include "nautilus-media-cache.h"
+#include "nautilus-media-header-parser.h"
+
+#include <fcntl.h>
+#include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+#include <nautilus-extension.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DIMENSIONS_ATTRIBUTE "media_dimensions"
+#define DURATION_ATTRIBUTE "media_duration"
+/* Zero-padded numbers, which sort by value with strcmp() */
+#define DIMENSIONS_SORT_ATTRIBUTE "media_dimensions_sort_key"
+#define DURATION_SORT_ATTRIBUTE "media_duration_sort_key"
+
+/* Reading headers is mostly waiting for the disk, so a few threads are
+ * enough to keep it busy without competing with thumbnailing. */
+#define MAX_WORKER_THREADS 4
+#define SAVE_DELAY_SECONDS 5
+
+struct _NautilusMediaColumnsProvider
+{
+    GObject parent_instance;
+};
+
+static void column_provider_iface_init (NautilusColumnProviderInterface *iface);
+static void info_provider_iface_init (NautilusInfoProviderInterface *iface);
+
+G_DEFINE_DYNAMIC_TYPE_EXTENDED (NautilusMediaColumnsProvider,
+                                nautilus_media_columns_provider,
+                                G_TYPE_OBJECT,
+                                0,
+                                G_IMPLEMENT_INTERFACE_DYNAMIC (NAUTILUS_TYPE_COLUMN_PROVIDER,
+                                                               column_provider_iface_init)
+                                G_IMPLEMENT_INTERFACE_DYNAMIC (NAUTILUS_TYPE_INFO_PROVIDER,
+                                                               info_provider_iface_init))
+
+static GThreadPool *worker_pool = NULL;
+/* A single thread, so that saves never overlap and unloading can wait for
+ * the last one. */
+static GThreadPool *save_pool = NULL;
+static NautilusMediaCache *cache = NULL;
+static guint save_timeout_id = 0;
+
+typedef struct
+{
+    gatomicrefcount ref_count;
+
+    NautilusInfoProvider *provider;
+    GCancellable *cancellable;
+    NautilusInfoProviderFileDoneFunc file_done;
+    gpointer user_data;
+} MediaBatch;
+
+typedef struct
+{
+    MediaBatch *batch;
+    NautilusFileInfo *file;
+    char *path;
+    char *mime_type;
+    NautilusMediaInfo info;
+} MediaRequest;
+
+static MediaBatch *
+media_batch_ref (MediaBatch *batch)
+{
+    g_atomic_ref_count_inc (&batch->ref_count);
+
+    return batch;
+}
+
+static void
+media_batch_unref (MediaBatch *batch)
+{
+    if (g_atomic_ref_count_dec (&batch->ref_count))
+    {
+        g_object_unref (batch->provider);
+        g_clear_object (&batch->cancellable);
+        g_free (batch);
+    }
+}
+
+static gboolean
+media_batch_is_cancelled (MediaBatch *batch)
+{
+    return batch->cancellable != NULL && g_cancellable_is_cancelled (batch->cancellable);
+}
+
+static void
+media_request_free (MediaRequest *request)
+{
+    media_batch_unref (request->batch);
+    g_object_unref (request->file);
+    g_free (request->path);
+    g_free (request->mime_type);
+    g_free (request);
+}
+
+static void
+save_cache (gpointer data,
+            gpointer user_data)
+{
+    nautilus_media_cache_save (data);
+}
+
+static gboolean
+save_timeout_cb (gpointer user_data)
+{
+    save_timeout_id = 0;
+
+    g_thread_pool_push (save_pool, cache, NULL);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+set_attributes (NautilusFileInfo        *file,
+                const NautilusMediaInfo *info)
+{
+    g_autofree char *dimensions = NULL;
+    g_autofree char *dimensions_key = NULL;
+    g_autofree char *duration = NULL;
+    g_autofree char *duration_key = NULL;
+
+    if (info->width != 0 && info->height != 0)
+    {
+        dimensions = g_strdup_printf ("%u × %u", info->width, info->height);
+        /* By number of pixels, then by width */
+        dimensions_key = g_strdup_printf ("%020" G_GUINT64_FORMAT " %010u",
+                                          (guint64) info->width * info->height,
+                                          info->width);
+    }
+
+    if (info->duration_ms != 0)
+    {
+        guint64 seconds = info->duration_ms / 1000;
+
+        duration = g_strdup_printf ("%" G_GUINT64_FORMAT ":%02u:%02u",
+                                    seconds / 3600,
+                                    (guint) (seconds / 60 % 60),
+                                    (guint) (seconds % 60));
+        duration_key = g_strdup_printf ("%020" G_GUINT64_FORMAT, info->duration_ms);
+    }
+
+    nautilus_file_info_add_string_attribute (file, DIMENSIONS_ATTRIBUTE,
+                                             dimensions != NULL ? dimensions : "");
+    nautilus_file_info_add_string_attribute (file, DIMENSIONS_SORT_ATTRIBUTE,
+                                             dimensions_key != NULL ? dimensions_key : "");
+    nautilus_file_info_add_string_attribute (file, DURATION_ATTRIBUTE,
+                                             duration != NULL ? duration : "");
+    nautilus_file_info_add_string_attribute (file, DURATION_SORT_ATTRIBUTE,
+                                             duration_key != NULL ? duration_key : "");
+}
+
+static gboolean
+media_request_complete (gpointer user_data)
+{
+    MediaRequest *request = user_data;
+    MediaBatch *batch = request->batch;
+
+    if (!media_batch_is_cancelled (batch))
+    {
+        set_attributes (request->file, &request->info);
+        batch->file_done (batch->provider, request->file,
+                          NAUTILUS_OPERATION_COMPLETE, batch->user_data);
+    }
+
+    media_request_free (request);
+
+    if (cache != NULL && save_timeout_id == 0)
+    {
+        save_timeout_id = g_timeout_add_seconds (SAVE_DELAY_SECONDS, save_timeout_cb, NULL);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+media_request_run (gpointer data,
+                   gpointer user_data)
+{
+    MediaRequest *request = data;
+    GStatBuf statbuf;
+
+    if (!media_batch_is_cancelled (request->batch) &&
+        g_stat (request->path, &statbuf) == 0 &&
+        !nautilus_media_cache_lookup (cache, statbuf.st_dev, statbuf.st_ino, statbuf.st_mtime,
+                                      statbuf.st_size, &request->info))
+    {
+        int fd = g_open (request->path, O_RDONLY | O_CLOEXEC, 0);
+
+        if (fd >= 0)
+        {
+            /* Files that can't be parsed are cached too, with no info. */
+            nautilus_media_header_parse (fd, request->mime_type, &request->info);
+            nautilus_media_cache_insert (cache, statbuf.st_dev, statbuf.st_ino, statbuf.st_mtime,
+                                         statbuf.st_size, &request->info);
+            close (fd);
+        }
+    }
+
+    g_idle_add (media_request_complete, request);
+}
+
+static void
+update_file_info_batch (NautilusInfoProvider             *provider,
+                        GList                            *files,
+                        GCancellable                     *cancellable,
+                        NautilusInfoProviderFileDoneFunc  file_done,
+                        gpointer                          user_data)
+{
+    MediaBatch *batch;
+
+    batch = g_new0 (MediaBatch, 1);
+    g_atomic_ref_count_init (&batch->ref_count);
+    batch->provider = g_object_ref (provider);
+    batch->cancellable = cancellable != NULL ? g_object_ref (cancellable) : NULL;
+    batch->file_done = file_done;
+    batch->user_data = user_data;
+
+    for (GList *l = files; l != NULL && !media_batch_is_cancelled (batch); l = l->next)
+    {
+        NautilusFileInfo *file = l->data;
+        g_autofree char *mime_type = nautilus_file_info_get_mime_type (file);
+        g_autoptr (GFile) location = NULL;
+        g_autofree char *path = NULL;
+        MediaRequest *request;
+
+        if (nautilus_media_header_is_supported (mime_type))
+        {
+            location = nautilus_file_info_get_location (file);
+            path = g_file_get_path (location);
+        }
+
+        if (path == NULL)
+        {
+            /* Only local media files are read. */
+            const NautilusMediaInfo no_info = { 0 };
+
+            set_attributes (file, &no_info);
+            file_done (provider, file, NAUTILUS_OPERATION_COMPLETE, user_data);
+            continue;
+        }
+
+        request = g_new0 (MediaRequest, 1);
+        request->batch = media_batch_ref (batch);
+        request->file = g_object_ref (file);
+        request->path = g_steal_pointer (&path);
+        request->mime_type = g_steal_pointer (&mime_type);
+
+        g_thread_pool_push (worker_pool, request, NULL);
+    }
+
+    media_batch_unref (batch);
+}
+
+static void
+info_provider_iface_init (NautilusInfoProviderInterface *iface)
+{
+    iface->update_file_info_batch = update_file_info_batch;
+}
+
+static GList *
+get_columns (NautilusColumnProvider *provider)
+{
+    GList *columns = NULL;
+    NautilusColumn *column;
+
+    column = nautilus_column_new ("NautilusMediaColumns::dimensions",
+                                  DIMENSIONS_ATTRIBUTE,
+                                  _("Dimensions"),
+                                  _("Width and height of images and videos"));
+    g_object_set (column, "sort-attribute", DIMENSIONS_SORT_ATTRIBUTE, NULL);
+    columns = g_list_append (columns, column);
+
+    column = nautilus_column_new ("NautilusMediaColumns::duration",
+                                  DURATION_ATTRIBUTE,
+                                  _("Duration"),
+                                  _("Length of audio and video files"));
+    g_object_set (column, "sort-attribute", DURATION_SORT_ATTRIBUTE, NULL);
+    columns = g_list_append (columns, column);
+
+    return columns;
+}
+
+static void
+column_provider_iface_init (NautilusColumnProviderInterface *iface)
+{
+    iface->get_columns = get_columns;
+}
+
+static void
+nautilus_media_columns_provider_init (NautilusMediaColumnsProvider *self)
+{
+    (void) self;
+}
+
+static void
+nautilus_media_columns_provider_class_init (NautilusMediaColumnsProviderClass *klass)
+{
+    (void) klass;
+}
+
+static void
+nautilus_media_columns_provider_class_finalize (NautilusMediaColumnsProviderClass *klass)
+{
+    (void) klass;
+}
+
+void
+nautilus_media_columns_provider_load (GTypeModule *module)
+{
+    g_autofree char *cache_path = NULL;
+
+    nautilus_media_columns_provider_register_type (module);
+
+    cache_path = g_build_filename (g_get_user_cache_dir (), "nautilus", "media-info", NULL);
+    cache = nautilus_media_cache_new (cache_path);
+    worker_pool = g_thread_pool_new (media_request_run, NULL,
+                                     MIN (g_get_num_processors (), MAX_WORKER_THREADS),
+                                     FALSE, NULL);
+    save_pool = g_thread_pool_new (save_cache, NULL, 1, FALSE, NULL);
+}
+
+void
+nautilus_media_columns_provider_unload (void)
+{
+    g_clear_handle_id (&save_timeout_id, g_source_remove);
+
+    /* Lets queued requests finish; their completions never run. */
+    g_thread_pool_free (g_steal_pointer (&worker_pool), FALSE, TRUE);
+    /* Waits for a save which is still writing, before the last one. */
+    g_thread_pool_free (g_steal_pointer (&save_pool), FALSE, TRUE);
+
+    nautilus_media_cache_save (cache);
+    g_clear_pointer (&cache, nautilus_media_cache_free);
+}
@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define NAUTILUS_TYPE_MEDIA_COLUMNS_PROVIDER (nautilus_media_columns_provider_get_type ())
+
+G_DECLARE_FINAL_TYPE (NautilusMediaColumnsProvider,
+                      nautilus_media_columns_provider,
+                      NAUTILUS, MEDIA_COLUMNS_PROVIDER,
+                      GObject)
+
+void nautilus_media_columns_provider_load   (GTypeModule *module);
+void nautilus_media_columns_provider_unload (void);
@@ -0,0 +1,778 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "nautilus-media-header-parser.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* JPEG markers before the frame header are usually metadata, which can be
+ * large, but we stop looking after this many of them. */
+#define MAX_JPEG_MARKERS 64
+/* Matroska puts its Info and Tracks elements before the first Cluster, in
+ * practice within the first few kilobytes. */
+#define MATROSKA_HEADER_SIZE (256 * 1024)
+#define MAX_BOX_DEPTH 8
+
+typedef struct
+{
+    int fd;
+    goffset size;
+} Reader;
+
+static gboolean
+read_at (Reader  *reader,
+         goffset  offset,
+         void    *buffer,
+         gsize    length)
+{
+    gsize done = 0;
+
+    if (offset < 0 || offset + (goffset) length > reader->size)
+    {
+        return FALSE;
+    }
+
+    while (done < length)
+    {
+        gssize n = pread (reader->fd, (guint8 *) buffer + done, length - done, offset + done);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return FALSE;
+        }
+        done += n;
+    }
+
+    return TRUE;
+}
+
+static guint16
+get_be16 (const guint8 *p)
+{
+    return (guint16) (p[0] << 8 | p[1]);
+}
+
+static guint32
+get_be32 (const guint8 *p)
+{
+    return (guint32) p[0] << 24 | (guint32) p[1] << 16 | (guint32) p[2] << 8 | p[3];
+}
+
+static guint64
+get_be64 (const guint8 *p)
+{
+    return (guint64) get_be32 (p) << 32 | get_be32 (p + 4);
+}
+
+static guint16
+get_le16 (const guint8 *p)
+{
+    return (guint16) (p[0] | p[1] << 8);
+}
+
+static guint32
+get_le24 (const guint8 *p)
+{
+    return (guint32) p[0] | (guint32) p[1] << 8 | (guint32) p[2] << 16;
+}
+
+static guint32
+get_le32 (const guint8 *p)
+{
+    return get_le24 (p) | (guint32) p[3] << 24;
+}
+
+static gboolean
+parse_png (Reader            *reader,
+           NautilusMediaInfo *info)
+{
+    static const guint8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    guint8 header[24];
+
+    /* Signature, then the IHDR chunk, which must come first. */
+    if (!read_at (reader, 0, header, sizeof (header)) ||
+        memcmp (header, signature, sizeof (signature)) != 0 ||
+        memcmp (header + 12, "IHDR", 4) != 0)
+    {
+        return FALSE;
+    }
+
+    info->width = get_be32 (header + 16);
+    info->height = get_be32 (header + 20);
+
+    return TRUE;
+}
+
+#define EXIF_TAG_ORIENTATION 0x0112
+
+/* Returns the orientation in the first image directory of the TIFF
+ * structure in an Exif segment, or 0 if there is none. */
+static guint
+parse_exif_orientation (const guint8 *data,
+                        gsize         length)
+{
+    const guint8 *tiff;
+    gsize tiff_length;
+    gboolean big_endian;
+    guint32 ifd_offset;
+    guint n_entries;
+
+    if (length < 6 + 8 || memcmp (data, "Exif\0\0", 6) != 0)
+    {
+        return 0;
+    }
+
+    tiff = data + 6;
+    tiff_length = length - 6;
+    if (memcmp (tiff, "MM", 2) == 0)
+    {
+        big_endian = TRUE;
+    }
+    else if (memcmp (tiff, "II", 2) == 0)
+    {
+        big_endian = FALSE;
+    }
+    else
+    {
+        return 0;
+    }
+
+#define GET16(p) (big_endian ? get_be16 (p) : get_le16 (p))
+#define GET32(p) (big_endian ? get_be32 (p) : get_le32 (p))
+
+    ifd_offset = GET32 (tiff + 4);
+    if (ifd_offset > tiff_length - 2)
+    {
+        return 0;
+    }
+
+    n_entries = GET16 (tiff + ifd_offset);
+    for (guint i = 0; i < n_entries; i++)
+    {
+        gsize entry_offset = ifd_offset + 2 + (gsize) i * 12;
+        const guint8 *entry;
+
+        if (entry_offset + 12 > tiff_length)
+        {
+            break;
+        }
+
+        entry = tiff + entry_offset;
+
+        if (GET16 (entry) == EXIF_TAG_ORIENTATION)
+        {
+            /* A single SHORT, at the start of the value field */
+            guint orientation = GET16 (entry + 8);
+
+            return orientation <= 8 ? orientation : 0;
+        }
+    }
+
+#undef GET16
+#undef GET32
+
+    return 0;
+}
+
+static gboolean
+parse_jpeg (Reader            *reader,
+            NautilusMediaInfo *info)
+{
+    guint8 buffer[9];
+    goffset offset = 2;
+    guint orientation = 0;
+
+    if (!read_at (reader, 0, buffer, 2) || buffer[0] != 0xff || buffer[1] != 0xd8)
+    {
+        return FALSE;
+    }
+
+    for (int i = 0; i < MAX_JPEG_MARKERS; i++)
+    {
+        guint8 marker;
+
+        if (!read_at (reader, offset, buffer, 2) || buffer[0] != 0xff)
+        {
+            return FALSE;
+        }
+
+        marker = buffer[1];
+        if (marker == 0xff)
+        {
+            /* Fill byte */
+            offset++;
+            continue;
+        }
+
+        if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd9))
+        {
+            /* Markers without a payload */
+            offset += 2;
+            continue;
+        }
+
+        if (!read_at (reader, offset + 2, buffer, 2))
+        {
+            return FALSE;
+        }
+
+        /* Start of frame, except for DHT, JPG and DAC which share the range. */
+        if (marker >= 0xc0 && marker <= 0xcf &&
+            marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+        {
+            if (!read_at (reader, offset + 4, buffer, 5))
+            {
+                return FALSE;
+            }
+
+            info->height = get_be16 (buffer + 1);
+            info->width = get_be16 (buffer + 3);
+
+            /* Orientations 5 to 8 rotate the image by a quarter turn, so
+             * it is shown with its width and height swapped. */
+            if (orientation >= 5)
+            {
+                guint32 width = info->width;
+
+                info->width = info->height;
+                info->height = width;
+            }
+
+            return TRUE;
+        }
+
+        if (marker == 0xe1 && orientation == 0 && get_be16 (buffer) > 2)
+        {
+            gsize length = get_be16 (buffer) - 2;
+            g_autofree guint8 *segment = g_malloc (length);
+
+            /* APP1, which holds the Exif data of camera pictures */
+            if (read_at (reader, offset + 4, segment, length))
+            {
+                orientation = parse_exif_orientation (segment, length);
+            }
+        }
+
+        offset += 2 + get_be16 (buffer);
+    }
+
+    return FALSE;
+}
+
+static gboolean
+parse_webp (Reader            *reader,
+            NautilusMediaInfo *info)
+{
+    guint8 header[30];
+
+    if (!read_at (reader, 0, header, sizeof (header)) ||
+        memcmp (header, "RIFF", 4) != 0 ||
+        memcmp (header + 8, "WEBP", 4) != 0)
+    {
+        return FALSE;
+    }
+
+    if (memcmp (header + 12, "VP8X", 4) == 0)
+    {
+        /* Extended format: canvas size minus one, 24 bits each. */
+        info->width = get_le24 (header + 24) + 1;
+        info->height = get_le24 (header + 27) + 1;
+    }
+    else if (memcmp (header + 12, "VP8L", 4) == 0)
+    {
+        guint32 bits;
+
+        /* Lossless: a signature byte, then 14 bits each of size minus one. */
+        if (header[20] != 0x2f)
+        {
+            return FALSE;
+        }
+        bits = get_le24 (header + 21) | (guint32) header[24] << 24;
+        info->width = (bits & 0x3fff) + 1;
+        info->height = ((bits >> 14) & 0x3fff) + 1;
+    }
+    else if (memcmp (header + 12, "VP8 ", 4) == 0)
+    {
+        /* Lossy: a key frame tag, its start code, then 14 bits each of size. */
+        if (header[23] != 0x9d || header[24] != 0x01 || header[25] != 0x2a)
+        {
+            return FALSE;
+        }
+        info->width = (header[26] | header[27] << 8) & 0x3fff;
+        info->height = (header[28] | header[29] << 8) & 0x3fff;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Reads the header of the ISO base media box at @offset, leaving its type
+ * in @type and the range of its payload in @payload and @end. */
+static gboolean
+read_box_header (Reader  *reader,
+                 goffset  offset,
+                 goffset  parent_end,
+                 char     type[4],
+                 goffset *payload,
+                 goffset *end)
+{
+    guint8 header[16];
+    guint64 size;
+
+    if (offset + 8 > parent_end || !read_at (reader, offset, header, 8))
+    {
+        return FALSE;
+    }
+
+    memcpy (type, header + 4, 4);
+    size = get_be32 (header);
+    *payload = offset + 8;
+
+    if (size == 1)
+    {
+        if (!read_at (reader, offset + 8, header + 8, 8))
+        {
+            return FALSE;
+        }
+        size = get_be64 (header + 8);
+        *payload = offset + 16;
+    }
+    else if (size == 0)
+    {
+        /* Extends to the end of the file. */
+        size = parent_end - offset;
+    }
+
+    if (size < (guint64) (*payload - offset) || size > (guint64) (parent_end - offset))
+    {
+        return FALSE;
+    }
+
+    *end = offset + size;
+
+    return TRUE;
+}
+
+static void
+parse_mvhd (Reader            *reader,
+            goffset            payload,
+            goffset            end,
+            NautilusMediaInfo *info)
+{
+    guint8 data[32];
+    guint32 timescale;
+    guint64 duration;
+
+    /* Version 0 has 32 bit times and duration, version 1 64 bit ones. */
+    if (end - payload < 20 ||
+        !read_at (reader, payload, data, MIN ((goffset) sizeof (data), end - payload)))
+    {
+        return;
+    }
+
+    if (data[0] == 1)
+    {
+        if (end - payload < (goffset) sizeof (data))
+        {
+            return;
+        }
+        timescale = get_be32 (data + 20);
+        duration = get_be64 (data + 24);
+    }
+    else
+    {
+        timescale = get_be32 (data + 12);
+        duration = get_be32 (data + 16);
+    }
+
+    /* All ones means unknown. Durations too long to be real, which would
+     * overflow in milliseconds, are left unknown too. */
+    if (timescale != 0 && duration != G_MAXUINT64 && duration != G_MAXUINT32 &&
+        duration / timescale <= G_MAXUINT64 / 1000 - 1)
+    {
+        info->duration_ms = duration / timescale * 1000 + duration % timescale * 1000 / timescale;
+    }
+}
+
+static void
+parse_tkhd (Reader            *reader,
+            goffset            payload,
+            goffset            end,
+            NautilusMediaInfo *info)
+{
+    guint8 version;
+    guint8 size[8];
+    goffset size_offset;
+
+    if (info->width != 0 || !read_at (reader, payload, &version, 1))
+    {
+        return;
+    }
+
+    /* Width and height come after the version dependent times, the
+     * reserved fields, the layer, group and volume, and the matrix. */
+    size_offset = payload + (version == 1 ? 88 : 76);
+    if (size_offset + 8 > end || !read_at (reader, size_offset, size, sizeof (size)))
+    {
+        return;
+    }
+
+    /* 16.16 fixed point; audio tracks have a zero size. */
+    info->width = get_be32 (size) >> 16;
+    info->height = get_be32 (size + 4) >> 16;
+}
+
+static void
+parse_boxes (Reader            *reader,
+             goffset            offset,
+             goffset            end,
+             int                depth,
+             NautilusMediaInfo *info)
+{
+    char type[4];
+    goffset payload;
+    goffset box_end;
+
+    if (depth > MAX_BOX_DEPTH)
+    {
+        return;
+    }
+
+    while (read_box_header (reader, offset, end, type, &payload, &box_end))
+    {
+        if (memcmp (type, "moov", 4) == 0 || memcmp (type, "trak", 4) == 0)
+        {
+            parse_boxes (reader, payload, box_end, depth + 1, info);
+
+            if (depth == 0)
+            {
+                /* There is only one movie box. */
+                return;
+            }
+        }
+        else if (memcmp (type, "mvhd", 4) == 0)
+        {
+            parse_mvhd (reader, payload, box_end, info);
+        }
+        else if (memcmp (type, "tkhd", 4) == 0)
+        {
+            parse_tkhd (reader, payload, box_end, info);
+        }
+
+        offset = box_end;
+    }
+}
+
+static gboolean
+parse_mp4 (Reader            *reader,
+           NautilusMediaInfo *info)
+{
+    /* The movie box may come after the media data, but walking the top
+     * level boxes only reads their headers. */
+    parse_boxes (reader, 0, reader->size, 0, info);
+
+    return info->width != 0 || info->duration_ms != 0;
+}
+
+#define EBML_ID_HEADER 0x1a45dfa3
+#define EBML_ID_SEGMENT 0x18538067
+#define EBML_ID_INFO 0x1549a966
+#define EBML_ID_TIMECODE_SCALE 0x2ad7b1
+#define EBML_ID_DURATION 0x4489
+#define EBML_ID_TRACKS 0x1654ae6b
+#define EBML_ID_TRACK_ENTRY 0xae
+#define EBML_ID_VIDEO 0xe0
+#define EBML_ID_PIXEL_WIDTH 0xb0
+#define EBML_ID_PIXEL_HEIGHT 0xba
+#define EBML_ID_CLUSTER 0x1f43b675
+
+#define EBML_UNKNOWN_SIZE G_MAXUINT64
+
+typedef struct
+{
+    const guint8 *data;
+    gsize length;
+    guint64 timecode_scale;
+    double duration;
+} MatroskaParser;
+
+/* Reads a variable length integer; element IDs keep their length marker,
+ * sizes don't. */
+static gboolean
+read_vint (const guint8 *data,
+           gsize         length,
+           gsize        *offset,
+           gboolean      keep_marker,
+           guint64      *value)
+{
+    guint8 first;
+    guint n_bytes = 1;
+    guint64 result;
+    gboolean all_ones;
+
+    if (*offset >= length)
+    {
+        return FALSE;
+    }
+
+    first = data[*offset];
+    if (first == 0)
+    {
+        return FALSE;
+    }
+
+    while (!(first & (0x80 >> (n_bytes - 1))))
+    {
+        n_bytes++;
+    }
+
+    if (*offset + n_bytes > length)
+    {
+        return FALSE;
+    }
+
+    result = keep_marker ? first : first & (0xff >> n_bytes);
+    all_ones = result == (guint64) (0xff >> n_bytes);
+    for (guint i = 1; i < n_bytes; i++)
+    {
+        result = result << 8 | data[*offset + i];
+        all_ones = all_ones && data[*offset + i] == 0xff;
+    }
+
+    *offset += n_bytes;
+    *value = !keep_marker && all_ones ? EBML_UNKNOWN_SIZE : result;
+
+    return TRUE;
+}
+
+static guint64
+read_uint (const guint8 *data,
+           guint64       size)
+{
+    guint64 value = 0;
+
+    for (guint64 i = 0; i < size && i < 8; i++)
+    {
+        value = value << 8 | data[i];
+    }
+
+    return value;
+}
+
+static double
+read_float (const guint8 *data,
+            guint64       size)
+{
+    if (size == 4)
+    {
+        union { guint32 i; float f; } u = { get_be32 (data) };
+
+        return u.f;
+    }
+    else if (size == 8)
+    {
+        union { guint64 i; double d; } u = { get_be64 (data) };
+
+        return u.d;
+    }
+
+    return 0;
+}
+
+static void
+parse_ebml_elements (MatroskaParser    *parser,
+                     gsize              offset,
+                     gsize              end,
+                     int                depth,
+                     NautilusMediaInfo *info)
+{
+    while (offset < end && depth <= MAX_BOX_DEPTH)
+    {
+        guint64 id;
+        guint64 size;
+        gsize element_end;
+
+        if (!read_vint (parser->data, end, &offset, TRUE, &id) ||
+            !read_vint (parser->data, end, &offset, FALSE, &size))
+        {
+            return;
+        }
+
+        if (id == EBML_ID_CLUSTER)
+        {
+            /* Media data; all headers we care about come before it. */
+            return;
+        }
+
+        element_end = size == EBML_UNKNOWN_SIZE || size > end - offset ? end : offset + size;
+
+        switch (id)
+        {
+            case EBML_ID_SEGMENT:
+            case EBML_ID_INFO:
+            case EBML_ID_TRACKS:
+            case EBML_ID_TRACK_ENTRY:
+            case EBML_ID_VIDEO:
+            {
+                parse_ebml_elements (parser, offset, element_end, depth + 1, info);
+            }
+            break;
+
+            case EBML_ID_TIMECODE_SCALE:
+            {
+                parser->timecode_scale = read_uint (parser->data + offset, element_end - offset);
+            }
+            break;
+
+            case EBML_ID_DURATION:
+            {
+                parser->duration = read_float (parser->data + offset, element_end - offset);
+            }
+            break;
+
+            case EBML_ID_PIXEL_WIDTH:
+            {
+                if (info->width == 0)
+                {
+                    info->width = read_uint (parser->data + offset, element_end - offset);
+                }
+            }
+            break;
+
+            case EBML_ID_PIXEL_HEIGHT:
+            {
+                if (info->height == 0)
+                {
+                    info->height = read_uint (parser->data + offset, element_end - offset);
+                }
+            }
+            break;
+
+            default:
+            {
+            }
+            break;
+        }
+
+        offset = element_end;
+    }
+}
+
+static gboolean
+parse_matroska (Reader            *reader,
+                NautilusMediaInfo *info)
+{
+    g_autofree guint8 *data = NULL;
+    gsize length;
+    MatroskaParser parser = { 0 };
+
+    length = MIN (reader->size, MATROSKA_HEADER_SIZE);
+    data = g_malloc (length);
+    if (length < 4 || !read_at (reader, 0, data, length) ||
+        get_be32 (data) != EBML_ID_HEADER)
+    {
+        return FALSE;
+    }
+
+    parser.data = data;
+    parser.length = length;
+    parser.timecode_scale = 1000000;
+    parse_ebml_elements (&parser, 0, length, 0, info);
+
+    /* The duration is a float, in units of the timecode scale (ns). */
+    if (parser.duration > 0)
+    {
+        double duration_ms = parser.duration * parser.timecode_scale / 1000000;
+
+        if (duration_ms < (double) G_MAXINT64)
+        {
+            info->duration_ms = duration_ms;
+        }
+    }
+
+    return info->width != 0 || info->duration_ms != 0;
+}
+
+typedef gboolean (*ParseFunc) (Reader            *reader,
+                               NautilusMediaInfo *info);
+
+static const struct
+{
+    const char *mime_type;
+    ParseFunc parse;
+} parsers[] =
+{
+    { "image/png", parse_png },
+    { "image/jpeg", parse_jpeg },
+    { "image/webp", parse_webp },
+    { "video/mp4", parse_mp4 },
+    { "video/quicktime", parse_mp4 },
+    { "video/3gpp", parse_mp4 },
+    { "audio/mp4", parse_mp4 },
+    { "audio/x-m4a", parse_mp4 },
+    { "video/x-matroska", parse_matroska },
+    { "video/webm", parse_matroska },
+    { "audio/x-matroska", parse_matroska },
+    { "audio/webm", parse_matroska },
+};
+
+static ParseFunc
+get_parser (const char *mime_type)
+{
+    for (gsize i = 0; mime_type != NULL && i < G_N_ELEMENTS (parsers); i++)
+    {
+        if (strcmp (parsers[i].mime_type, mime_type) == 0)
+        {
+            return parsers[i].parse;
+        }
+    }
+
+    return NULL;
+}
+
+gboolean
+nautilus_media_header_is_supported (const char *mime_type)
+{
+    return get_parser (mime_type) != NULL;
+}
+
+gboolean
+nautilus_media_header_parse (int                fd,
+                             const char        *mime_type,
+                             NautilusMediaInfo *info)
+{
+    ParseFunc parse = get_parser (mime_type);
+    struct stat statbuf;
+    Reader reader;
+
+    memset (info, 0, sizeof (NautilusMediaInfo));
+
+    if (parse == NULL || fstat (fd, &statbuf) != 0)
+    {
+        return FALSE;
+    }
+
+    reader.fd = fd;
+    reader.size = statbuf.st_size;
+
+    if (!parse (&reader, info))
+    {
+        memset (info, 0, sizeof (NautilusMediaInfo));
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+/* Zero means unknown. */
+typedef struct
+{
+    guint32 width;
+    guint32 height;
+    guint64 duration_ms;
+} NautilusMediaInfo;
+
+gboolean nautilus_media_header_is_supported (const char *mime_type);
+
+/* Reads only as much of the file as is needed to find its dimensions and
+ * duration; never decodes any image or media data. */
+gboolean nautilus_media_header_parse        (int                fd,
+                                             const char        *mime_type,
+                                             NautilusMediaInfo *info);
@@ -29,6 +29,7 @@ enum
     PROP_NAME,
     PROP_ATTRIBUTE,
     PROP_ATTRIBUTE_Q,
+    PROP_SORT_ATTRIBUTE,
     PROP_LABEL,
     PROP_DESCRIPTION,
     PROP_XALIGN,
@@ -43,6 +44,7 @@ struct _NautilusColumn
 
     char *name;
     GQuark attribute;
+    GQuark sort_attribute;
     char *label;
     char *description;
     float xalign;
@@ -105,6 +107,12 @@ nautilus_column_get_property (GObject    *object,
         }
         break;
 
+        case PROP_SORT_ATTRIBUTE:
+        {
+            g_value_set_string (value, g_quark_to_string (column->sort_attribute));
+        }
+        break;
+
         case PROP_LABEL:
         {
             g_value_set_string (value, column->label);
@@ -171,6 +179,13 @@ nautilus_column_set_property (GObject      *object,
         }
         break;
 
+        case PROP_SORT_ATTRIBUTE:
+        {
+            column->sort_attribute = g_quark_from_string (g_value_get_string (value));
+            g_object_notify (object, "sort-attribute");
+        }
+        break;
+
         case PROP_LABEL:
         {
             g_free (column->label);
@@ -281,6 +296,22 @@ nautilus_column_class_init (NautilusColumnClass *class)
                                                         0, G_MAXUINT, 0,
                                                         G_PARAM_READABLE));
 
+    /**
+     * NautilusColumn:sort-attribute:
+     *
+     * The file attribute to sort the column by, if not the displayed one.
+     * Its values are compared with strcmp(), so an extension showing
+     * numbers can sort them by value by setting a zero-padded copy of
+     * them as this attribute.
+     */
+    g_object_class_install_property (G_OBJECT_CLASS (class),
+                                     PROP_SORT_ATTRIBUTE,
+                                     g_param_spec_string ("sort-attribute",
+                                                          "Sort attribute",
+                                                          "The attribute name to sort by",
+                                                          NULL,
+                                                          G_PARAM_READWRITE));
+
     /**
      * NautilusColumn:label:
      *
@@ -70,6 +70,221 @@ nautilus_info_provider_cancel_update (NautilusInfoProvider    *self,
     iface->cancel_update (self, handle);
 }
 
+/* Drives a provider that only implements update_file_info() through a
+ * batch, one file after the other.
+ */
+typedef struct
+{
+    grefcount ref_count;
+
+    NautilusInfoProvider *provider;
+    GList *files;
+    GCancellable *cancellable;
+    gulong cancelled_id;
+    NautilusInfoProviderFileDoneFunc file_done;
+    gpointer user_data;
+
+    NautilusFileInfo *current;
+    NautilusOperationHandle *handle;
+    NautilusOperationResult result;
+    guint idle_id;
+    gboolean finished;
+} BatchAdapter;
+
+static void batch_adapter_next (BatchAdapter *adapter);
+
+static BatchAdapter *
+batch_adapter_ref (BatchAdapter *adapter)
+{
+    g_ref_count_inc (&adapter->ref_count);
+    return adapter;
+}
+
+static void
+batch_adapter_unref (BatchAdapter *adapter)
+{
+    if (!g_ref_count_dec (&adapter->ref_count))
+    {
+        return;
+    }
+
+    g_list_free_full (adapter->files, g_object_unref);
+    g_clear_object (&adapter->current);
+    g_clear_object (&adapter->cancellable);
+    g_object_unref (adapter->provider);
+    g_free (adapter);
+}
+
+static void
+batch_adapter_finish (BatchAdapter *adapter)
+{
+    if (adapter->finished)
+    {
+        return;
+    }
+    adapter->finished = TRUE;
+
+    g_clear_handle_id (&adapter->idle_id, g_source_remove);
+    if (adapter->cancelled_id != 0)
+    {
+        g_signal_handler_disconnect (adapter->cancellable, adapter->cancelled_id);
+        adapter->cancelled_id = 0;
+    }
+
+    batch_adapter_unref (adapter);
+}
+
+static void
+batch_adapter_cancelled (GCancellable *cancellable,
+                         gpointer      user_data)
+{
+    BatchAdapter *adapter = user_data;
+
+    if (adapter->handle != NULL)
+    {
+        nautilus_info_provider_cancel_update (adapter->provider, adapter->handle);
+        adapter->handle = NULL;
+    }
+
+    batch_adapter_finish (adapter);
+}
+
+static gboolean
+batch_adapter_idle (gpointer user_data)
+{
+    BatchAdapter *adapter = user_data;
+    g_autoptr (NautilusFileInfo) file = NULL;
+
+    adapter->idle_id = 0;
+    adapter->handle = NULL;
+    file = g_steal_pointer (&adapter->current);
+
+    /* The caller may cancel the batch from file_done(). */
+    batch_adapter_ref (adapter);
+    adapter->file_done (adapter->provider, file, adapter->result, adapter->user_data);
+    batch_adapter_next (adapter);
+    batch_adapter_unref (adapter);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+batch_adapter_update_complete (NautilusInfoProvider    *provider,
+                               NautilusOperationHandle *handle,
+                               NautilusOperationResult  result,
+                               gpointer                 user_data)
+{
+    BatchAdapter *adapter = user_data;
+
+    if (adapter->finished || adapter->current == NULL || adapter->idle_id != 0)
+    {
+        return;
+    }
+
+    /* The extension may call this before update_file_info() has even
+     * returned, so report back from an idle, as the application always did.
+     * The operation is over, so cancelling until then mustn't touch it.
+     */
+    adapter->handle = NULL;
+    adapter->result = result;
+    adapter->idle_id = g_idle_add (batch_adapter_idle, adapter);
+}
+
+static void
+batch_adapter_next (BatchAdapter *adapter)
+{
+    batch_adapter_ref (adapter);
+
+    while (!adapter->finished && adapter->current == NULL)
+    {
+        g_autoptr (NautilusFileInfo) file = NULL;
+        g_autoptr (GClosure) update_complete = NULL;
+        NautilusOperationHandle *handle = NULL;
+        NautilusOperationResult result;
+
+        if (adapter->files == NULL)
+        {
+            batch_adapter_finish (adapter);
+            break;
+        }
+
+        file = adapter->files->data;
+        adapter->files = g_list_delete_link (adapter->files, adapter->files);
+        adapter->current = g_object_ref (file);
+
+        update_complete = g_cclosure_new (G_CALLBACK (batch_adapter_update_complete),
+                                          batch_adapter_ref (adapter),
+                                          (GClosureNotify) batch_adapter_unref);
+        g_closure_set_marshal (update_complete, g_cclosure_marshal_generic);
+
+        result = nautilus_info_provider_update_file_info (adapter->provider,
+                                                          file,
+                                                          update_complete,
+                                                          &handle);
+        if (result == NAUTILUS_OPERATION_IN_PROGRESS)
+        {
+            if (adapter->idle_id == 0)
+            {
+                adapter->handle = handle;
+            }
+        }
+        else
+        {
+            g_clear_handle_id (&adapter->idle_id, g_source_remove);
+            g_clear_object (&adapter->current);
+            adapter->file_done (adapter->provider, file, result, adapter->user_data);
+        }
+    }
+
+    batch_adapter_unref (adapter);
+}
+
+void
+nautilus_info_provider_update_file_info_batch (NautilusInfoProvider             *self,
+                                               GList                            *files,
+                                               GCancellable                     *cancellable,
+                                               NautilusInfoProviderFileDoneFunc  file_done,
+                                               gpointer                          user_data)
+{
+    NautilusInfoProviderInterface *iface;
+    BatchAdapter *adapter;
+
+    g_return_if_fail (NAUTILUS_IS_INFO_PROVIDER (self));
+    g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+    g_return_if_fail (file_done != NULL);
+
+    iface = NAUTILUS_INFO_PROVIDER_GET_IFACE (self);
+
+    if (iface->update_file_info_batch != NULL)
+    {
+        iface->update_file_info_batch (self, files, cancellable, file_done, user_data);
+        return;
+    }
+
+    g_return_if_fail (iface->update_file_info != NULL);
+
+    if (cancellable != NULL && g_cancellable_is_cancelled (cancellable))
+    {
+        return;
+    }
+
+    adapter = g_new0 (BatchAdapter, 1);
+    g_ref_count_init (&adapter->ref_count);
+    adapter->provider = g_object_ref (self);
+    adapter->files = g_list_copy_deep (files, (GCopyFunc) g_object_ref, NULL);
+    adapter->file_done = file_done;
+    adapter->user_data = user_data;
+    if (cancellable != NULL)
+    {
+        adapter->cancellable = g_object_ref (cancellable);
+        adapter->cancelled_id = g_signal_connect (cancellable, "cancelled",
+                                                  G_CALLBACK (batch_adapter_cancelled),
+                                                  adapter);
+    }
+
+    batch_adapter_next (adapter);
+}
+
 void
 nautilus_info_provider_update_complete_invoke (GClosure                *update_complete,
                                                NautilusInfoProvider    *provider,
@@ -33,6 +33,7 @@
 #endif
 
 #include <glib-object.h>
+#include <gio/gio.h>
 #include "nautilus-file-info.h"
 
 G_BEGIN_DECLS
@@ -91,6 +92,20 @@ typedef enum
     NAUTILUS_OPERATION_IN_PROGRESS
 } NautilusOperationResult;
 
+/**
+ * NautilusInfoProviderFileDoneFunc:
+ * @provider: the #NautilusInfoProvider
+ * @file: the #NautilusFileInfo whose information was updated
+ * @result: either @NAUTILUS_OPERATION_COMPLETE or @NAUTILUS_OPERATION_FAILED
+ * @user_data: the data passed to nautilus_info_provider_update_file_info_batch()
+ *
+ * Called once for each file of a batch when the extension is done with it.
+ */
+typedef void (*NautilusInfoProviderFileDoneFunc) (NautilusInfoProvider    *provider,
+                                                  NautilusFileInfo        *file,
+                                                  NautilusOperationResult  result,
+                                                  gpointer                 user_data);
+
 /**
  * NautilusInfoProviderInterface:
  * @g_iface: The parent interface.
@@ -98,6 +113,8 @@ typedef enum
  *                    See nautilus_info_provider_update_file_info() for details.
  * @cancel_update: Cancels a previous call to nautilus_info_provider_update_file_info().
  *                 See nautilus_info_provider_cancel_update() for details.
+ * @update_file_info_batch: Updates the information of several files at once.
+ *                          See nautilus_info_provider_update_file_info_batch() for details.
  *
  * Interface for extensions to provide additional information about files.
  */
@@ -111,6 +128,12 @@ struct _NautilusInfoProviderInterface
                                                  NautilusOperationHandle **handle);
     void                    (*cancel_update)    (NautilusInfoProvider     *provider,
                                                  NautilusOperationHandle  *handle);
+
+    void                    (*update_file_info_batch) (NautilusInfoProvider             *provider,
+                                                       GList                            *files,
+                                                       GCancellable                     *cancellable,
+                                                       NautilusInfoProviderFileDoneFunc  file_done,
+                                                       gpointer                          user_data);
 };
 
 /* Interface Functions */
@@ -137,6 +160,27 @@ NautilusOperationResult nautilus_info_provider_update_file_info       (NautilusI
  */
 void                    nautilus_info_provider_cancel_update          (NautilusInfoProvider     *provider,
                                                                        NautilusOperationHandle  *handle);
+/**
+ * nautilus_info_provider_update_file_info_batch:
+ * @provider: a #NautilusInfoProvider
+ * @files: (element-type NautilusFileInfo): the files to update
+ * @cancellable: a #GCancellable
+ * @file_done: (scope forever): the function to call for each file once it is done
+ * @user_data: the data to pass to @file_done
+ *
+ * Updates the information of all @files. @file_done is called exactly once
+ * for every file, possibly before this function returns, until @cancellable
+ * is cancelled; after that it is not called any more. The caller may have
+ * several batches in flight at the same time.
+ *
+ * Extensions that only implement update_file_info() are driven through it
+ * one file after the other.
+ */
+void                    nautilus_info_provider_update_file_info_batch (NautilusInfoProvider             *provider,
+                                                                       GList                            *files,
+                                                                       GCancellable                     *cancellable,
+                                                                       NautilusInfoProviderFileDoneFunc  file_done,
+                                                                       gpointer                          user_data);
 
 
 
@@ -52,6 +52,7 @@
 #include "nautilus-freedesktop-dbus.h"
 #include "nautilus-global-preferences.h"
 #include "nautilus-icon-info.h"
+#include "nautilus-keyfile-metadata.h"
 #include "nautilus-module.h"
 #include "nautilus-preferences-window.h"
 #include "nautilus-previewer.h"
@@ -562,6 +563,8 @@ nautilus_application_finalize (GObject *object)
 
     nautilus_trash_monitor_clear ();
 
+    nautilus_directory_release_all_retained ();
+
     G_OBJECT_CLASS (nautilus_application_parent_class)->finalize (object);
 }
 
@@ -1046,6 +1049,7 @@ on_application_shutdown (GApplication *application,
 
     g_list_free (notification_ids);
 
+    nautilus_keyfile_metadata_flush ();
     nautilus_icon_info_clear_caches ();
 }
 
@@ -31,6 +31,163 @@
 #define ROW_MARGIN_START 6
 #define ROW_MARGIN_TOP_BOTTOM 4
 
+/* A file name within a given parent directory. */
+typedef struct
+{
+    NautilusFile *parent;
+    const char *name;
+} NameKey;
+
+#define NAUTILUS_TYPE_BATCH_RENAME_ITEM (nautilus_batch_rename_item_get_type ())
+G_DECLARE_FINAL_TYPE (NautilusBatchRenameItem, nautilus_batch_rename_item, NAUTILUS, BATCH_RENAME_ITEM, GObject)
+
+/* One row of the preview. */
+struct _NautilusBatchRenameItem
+{
+    GObject parent_instance;
+
+    NautilusFile *file;
+    char *old_name;
+    char *new_name;
+    /* Points to the parent and old_name fields */
+    NameKey old_key;
+    /* Index in the selection, as currently sorted */
+    guint position;
+    gboolean conflict;
+};
+
+enum
+{
+    ITEM_PROP_0,
+    ITEM_PROP_NEW_NAME,
+    ITEM_PROP_CONFLICT,
+    ITEM_N_PROPS
+};
+
+static GParamSpec *item_properties[ITEM_N_PROPS] = { NULL, };
+
+G_DEFINE_TYPE (NautilusBatchRenameItem, nautilus_batch_rename_item, G_TYPE_OBJECT);
+
+static void
+nautilus_batch_rename_item_init (NautilusBatchRenameItem *item)
+{
+}
+
+static void
+nautilus_batch_rename_item_finalize (GObject *object)
+{
+    NautilusBatchRenameItem *item = NAUTILUS_BATCH_RENAME_ITEM (object);
+
+    nautilus_file_unref (item->file);
+    nautilus_file_unref (item->old_key.parent);
+    g_free (item->old_name);
+    g_free (item->new_name);
+
+    G_OBJECT_CLASS (nautilus_batch_rename_item_parent_class)->finalize (object);
+}
+
+static void
+nautilus_batch_rename_item_get_property (GObject    *object,
+                                         guint       prop_id,
+                                         GValue     *value,
+                                         GParamSpec *pspec)
+{
+    NautilusBatchRenameItem *item = NAUTILUS_BATCH_RENAME_ITEM (object);
+
+    switch (prop_id)
+    {
+        case ITEM_PROP_NEW_NAME:
+        {
+            g_value_set_string (value, item->new_name);
+        }
+        break;
+
+        case ITEM_PROP_CONFLICT:
+        {
+            g_value_set_boolean (value, item->conflict);
+        }
+        break;
+
+        default:
+        {
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        }
+    }
+}
+
+static void
+nautilus_batch_rename_item_class_init (NautilusBatchRenameItemClass *class)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+    object_class->finalize = nautilus_batch_rename_item_finalize;
+    object_class->get_property = nautilus_batch_rename_item_get_property;
+
+    item_properties[ITEM_PROP_NEW_NAME] =
+        g_param_spec_string ("new-name", NULL, NULL,
+                             NULL,
+                             G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+    item_properties[ITEM_PROP_CONFLICT] =
+        g_param_spec_boolean ("conflict", NULL, NULL,
+                              FALSE,
+                              G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, ITEM_N_PROPS, item_properties);
+}
+
+static NautilusBatchRenameItem *
+nautilus_batch_rename_item_new (NautilusFile *file,
+                                guint         position)
+{
+    NautilusBatchRenameItem *item = g_object_new (NAUTILUS_TYPE_BATCH_RENAME_ITEM, NULL);
+
+    item->file = nautilus_file_ref (file);
+    item->old_name = g_strdup (nautilus_file_get_name (file));
+    item->old_key.parent = nautilus_file_get_parent (file);
+    item->old_key.name = item->old_name;
+    item->position = position;
+
+    return item;
+}
+
+static void
+nautilus_batch_rename_item_set_conflict (NautilusBatchRenameItem *item,
+                                         gboolean                 conflict)
+{
+    if (item->conflict != conflict)
+    {
+        item->conflict = conflict;
+        g_object_notify_by_pspec (G_OBJECT (item), item_properties[ITEM_PROP_CONFLICT]);
+    }
+}
+
+static guint
+name_key_hash (gconstpointer key)
+{
+    const NameKey *name_key = key;
+
+    return g_direct_hash (name_key->parent) ^ g_str_hash (name_key->name);
+}
+
+static gboolean
+name_key_equal (gconstpointer a,
+                gconstpointer b)
+{
+    const NameKey *key_a = a;
+    const NameKey *key_b = b;
+
+    return key_a->parent == key_b->parent && g_str_equal (key_a->name, key_b->name);
+}
+
+static void
+name_key_free (gpointer data)
+{
+    NameKey *name_key = data;
+
+    g_free ((char *) name_key->name);
+    g_free (name_key);
+}
+
 struct _NautilusBatchRenameDialog
 {
     GtkDialog parent;
@@ -39,9 +196,7 @@ struct _NautilusBatchRenameDialog
     NautilusWindow *window;
 
     GtkWidget *cancel_button;
-    GtkWidget *original_name_listbox;
-    GtkWidget *arrow_listbox;
-    GtkWidget *result_listbox;
+    GtkWidget *preview_list_view;
     GtkWidget *name_entry;
     GtkWidget *rename_button;
     GtkWidget *find_entry;
@@ -58,10 +213,18 @@ struct _NautilusBatchRenameDialog
     GtkWidget *conflict_down;
     GtkWidget *conflict_up;
 
-    GList *listbox_labels_new;
-    GList *listbox_labels_old;
-    GList *listbox_icons;
-    GtkSizeGroup *size_group;
+    /* NautilusBatchRenameItem, in the same order as selection */
+    GPtrArray *items;
+    GListStore *preview_store;
+    GtkSingleSelection *preview_selection;
+    /* NautilusFile -> NautilusBatchRenameItem */
+    GHashTable *items_by_file;
+    /* NameKey of the current name -> NautilusBatchRenameItem */
+    GHashTable *items_by_old_name;
+    /* Parent NautilusFile -> GPtrArray of NautilusBatchRenameItem */
+    GHashTable *items_by_parent;
+    /* NameKey (owned) of a new name -> number of items getting it */
+    GHashTable *new_name_counts;
 
     GList *selection;
     GList *new_names;
@@ -89,10 +252,6 @@ struct _NautilusBatchRenameDialog
      * and position */
     GHashTable *tag_info_table;
 
-    GtkWidget *preselected_row1;
-    GtkWidget *preselected_row2;
-
-    gint row_height;
     gboolean rename_clicked;
 
     GCancellable *metadata_cancellable;
@@ -110,6 +269,7 @@ typedef struct
 
 
 static void     update_display_text (NautilusBatchRenameDialog *dialog);
+static void     sort_preview_items (NautilusBatchRenameDialog *dialog);
 static void     cancel_conflict_check (NautilusBatchRenameDialog *self);
 
 G_DEFINE_TYPE (NautilusBatchRenameDialog, nautilus_batch_rename_dialog, ADW_TYPE_WINDOW);
@@ -136,6 +296,7 @@ change_numbering_order (GSimpleAction *action,
             dialog->selection = nautilus_batch_rename_dialog_sort (dialog->selection,
                                                                    sorts_constants[i].sort_mode,
                                                                    dialog->create_date);
+            sort_preview_items (dialog);
             break;
         }
     }
@@ -431,153 +592,220 @@ begin_batch_rename (NautilusBatchRenameDialog *dialog,
 }
 
 static void
-listbox_header_func (GtkListBoxRow             *row,
-                     GtkListBoxRow             *before,
-                     NautilusBatchRenameDialog *dialog)
+update_preview_row (NautilusBatchRenameDialog *dialog,
+                    GtkListItem               *list_item)
 {
-    GtkWidget *separator;
+    NautilusBatchRenameItem *item = gtk_list_item_get_item (list_item);
+    GtkWidget *box = gtk_list_item_get_child (list_item);
+    GtkWidget *label_old = g_object_get_data (G_OBJECT (list_item), "label-old");
+    GtkWidget *label_new = g_object_get_data (G_OBJECT (list_item), "label-new");
 
-    if (before == NULL)
+    if (item == NULL)
     {
-        /* First row needs no separator */
-        gtk_list_box_row_set_header (row, NULL);
         return;
     }
 
-    separator = gtk_list_box_row_get_header (row);
-    if (separator == NULL)
+    gtk_widget_set_tooltip_text (label_old, item->old_name);
+    if (dialog->mode == NAUTILUS_BATCH_RENAME_DIALOG_FORMAT)
+    {
+        gtk_label_set_label (GTK_LABEL (label_old), item->old_name);
+    }
+    else
     {
-        separator = gtk_separator_new (GTK_ORIENTATION_HORIZONTAL);
+        g_autoptr (GString) markup = NULL;
+
+        markup = batch_rename_replace_label_text (item->old_name,
+                                                  gtk_editable_get_text (GTK_EDITABLE (dialog->find_entry)));
+        gtk_label_set_markup (GTK_LABEL (label_old), markup->str);
+    }
 
-        gtk_list_box_row_set_header (row, separator);
+    gtk_label_set_label (GTK_LABEL (label_new), item->new_name != NULL ? item->new_name : "");
+    gtk_widget_set_tooltip_text (label_new, item->new_name);
+
+    if (item->conflict)
+    {
+        gtk_widget_add_css_class (box, "conflict-row");
+    }
+    else
+    {
+        gtk_widget_remove_css_class (box, "conflict-row");
     }
 }
 
-/* This is manually done instead of using GtkSizeGroup because of the computational
- * complexity of the later.*/
 static void
-update_rows_height (NautilusBatchRenameDialog *dialog)
+on_preview_item_notify (NautilusBatchRenameItem *item,
+                        GParamSpec              *pspec,
+                        GtkListItem             *list_item)
 {
-    GList *l;
-    GtkRequisition current_row_natural_size;
-    gint maximum_height;
+    NautilusBatchRenameDialog *dialog = g_object_get_data (G_OBJECT (list_item), "dialog");
 
-    maximum_height = -1;
+    update_preview_row (dialog, list_item);
+}
 
-    /* check if maximum height has changed */
-    for (l = dialog->listbox_labels_new; l != NULL; l = l->next)
-    {
-        gtk_widget_get_preferred_size (GTK_WIDGET (l->data),
-                                       NULL,
-                                       &current_row_natural_size);
+static GtkWidget *
+create_preview_label (void)
+{
+    GtkWidget *label;
 
-        if (current_row_natural_size.height > maximum_height)
-        {
-            maximum_height = current_row_natural_size.height;
-        }
-    }
+    label = gtk_label_new (NULL);
+    gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+    gtk_widget_set_hexpand (label, TRUE);
+    gtk_widget_set_margin_start (label, ROW_MARGIN_START);
+    gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_END);
+    /* Keep the natural width small, so that both names get the same width. */
+    gtk_label_set_max_width_chars (GTK_LABEL (label), 1);
 
-    for (l = dialog->listbox_labels_old; l != NULL; l = l->next)
-    {
-        gtk_widget_get_preferred_size (GTK_WIDGET (l->data),
-                                       NULL,
-                                       &current_row_natural_size);
+    return label;
+}
 
-        if (current_row_natural_size.height > maximum_height)
-        {
-            maximum_height = current_row_natural_size.height;
-        }
-    }
+static void
+preview_setup_item (GtkSignalListItemFactory  *factory,
+                    GtkListItem               *list_item,
+                    NautilusBatchRenameDialog *dialog)
+{
+    GtkWidget *box;
+    GtkWidget *label_old;
+    GtkWidget *arrow;
+    GtkWidget *label_new;
 
-    for (l = dialog->listbox_icons; l != NULL; l = l->next)
-    {
-        gtk_widget_get_preferred_size (GTK_WIDGET (l->data),
-                                       NULL,
-                                       &current_row_natural_size);
+    box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+    gtk_widget_set_margin_top (box, ROW_MARGIN_TOP_BOTTOM);
+    gtk_widget_set_margin_bottom (box, ROW_MARGIN_TOP_BOTTOM);
 
-        if (current_row_natural_size.height > maximum_height)
-        {
-            maximum_height = current_row_natural_size.height;
-        }
-    }
+    label_old = create_preview_label ();
+    gtk_box_append (GTK_BOX (box), label_old);
 
-    if (maximum_height != dialog->row_height)
+    if (gtk_widget_get_direction (GTK_WIDGET (dialog)) == GTK_TEXT_DIR_RTL)
     {
-        dialog->row_height = maximum_height + ROW_MARGIN_TOP_BOTTOM * 2;
+        arrow = gtk_label_new ("←");
+    }
+    else
+    {
+        arrow = gtk_label_new ("→");
+    }
+    gtk_widget_set_margin_start (arrow, ROW_MARGIN_START);
+    gtk_box_append (GTK_BOX (box), arrow);
 
-        for (l = dialog->listbox_icons; l != NULL; l = l->next)
-        {
-            g_object_set (G_OBJECT (l->data), "height-request", dialog->row_height, NULL);
-        }
+    label_new = create_preview_label ();
+    gtk_box_append (GTK_BOX (box), label_new);
 
-        for (l = dialog->listbox_labels_new; l != NULL; l = l->next)
-        {
-            g_object_set (G_OBJECT (l->data), "height-request", dialog->row_height, NULL);
-        }
+    g_object_set_data (G_OBJECT (list_item), "dialog", dialog);
+    g_object_set_data (G_OBJECT (list_item), "label-old", label_old);
+    g_object_set_data (G_OBJECT (list_item), "label-new", label_new);
 
-        for (l = dialog->listbox_labels_old; l != NULL; l = l->next)
-        {
-            g_object_set (G_OBJECT (l->data), "height-request", dialog->row_height, NULL);
-        }
-    }
+    gtk_list_item_set_activatable (list_item, FALSE);
+    gtk_list_item_set_child (list_item, box);
 }
 
-static GtkWidget *
-create_original_name_label (NautilusBatchRenameDialog *dialog,
-                            const gchar               *old_text)
+static void
+preview_bind_item (GtkSignalListItemFactory  *factory,
+                   GtkListItem               *list_item,
+                   NautilusBatchRenameDialog *dialog)
 {
-    GtkWidget *label_old;
+    NautilusBatchRenameItem *item = gtk_list_item_get_item (list_item);
 
-    label_old = gtk_label_new (old_text);
-    gtk_label_set_xalign (GTK_LABEL (label_old), 0.0);
-    gtk_widget_set_hexpand (label_old, TRUE);
-    gtk_widget_set_margin_start (label_old, ROW_MARGIN_START);
-    gtk_label_set_ellipsize (GTK_LABEL (label_old), PANGO_ELLIPSIZE_END);
+    g_signal_connect (item, "notify", G_CALLBACK (on_preview_item_notify), list_item);
+    update_preview_row (dialog, list_item);
+}
 
-    dialog->listbox_labels_old = g_list_prepend (dialog->listbox_labels_old, label_old);
+static void
+preview_unbind_item (GtkSignalListItemFactory  *factory,
+                     GtkListItem               *list_item,
+                     NautilusBatchRenameDialog *dialog)
+{
+    NautilusBatchRenameItem *item = gtk_list_item_get_item (list_item);
 
-    return label_old;
+    g_signal_handlers_disconnect_by_func (item, on_preview_item_notify, list_item);
 }
 
-static GtkWidget *
-create_result_label (NautilusBatchRenameDialog *dialog,
-                     const gchar               *new_text)
+static void
+new_name_counts_add (NautilusBatchRenameDialog *dialog,
+                     NautilusFile              *parent,
+                     const char                *name)
 {
-    GtkWidget *label_new;
+    NameKey key = { parent, name };
+    gpointer stored_key;
+    gpointer count;
 
-    label_new = gtk_label_new (new_text);
-    gtk_label_set_xalign (GTK_LABEL (label_new), 0.0);
-    gtk_widget_set_hexpand (label_new, TRUE);
-    gtk_widget_set_margin_start (label_new, ROW_MARGIN_START);
-    gtk_label_set_ellipsize (GTK_LABEL (label_new), PANGO_ELLIPSIZE_END);
-
-    dialog->listbox_labels_new = g_list_prepend (dialog->listbox_labels_new, label_new);
+    if (g_hash_table_lookup_extended (dialog->new_name_counts, &key, &stored_key, &count))
+    {
+        g_hash_table_insert (dialog->new_name_counts, stored_key,
+                             GUINT_TO_POINTER (GPOINTER_TO_UINT (count) + 1));
+    }
+    else
+    {
+        NameKey *new_key = g_new (NameKey, 1);
 
-    return label_new;
+        new_key->parent = parent;
+        new_key->name = g_strdup (name);
+        g_hash_table_insert (dialog->new_name_counts, new_key, GUINT_TO_POINTER (1));
+    }
 }
 
-static GtkWidget *
-create_arrow (NautilusBatchRenameDialog *dialog,
-              GtkTextDirection           text_direction)
+static void
+new_name_counts_remove (NautilusBatchRenameDialog *dialog,
+                        NautilusFile              *parent,
+                        const char                *name)
 {
-    GtkWidget *icon;
+    NameKey key = { parent, name };
+    gpointer stored_key;
+    gpointer count;
 
-    if (text_direction == GTK_TEXT_DIR_RTL)
+    if (!g_hash_table_lookup_extended (dialog->new_name_counts, &key, &stored_key, &count))
     {
-        icon = gtk_label_new ("←");
+        return;
+    }
+
+    if (GPOINTER_TO_UINT (count) <= 1)
+    {
+        g_hash_table_remove (dialog->new_name_counts, &key);
     }
     else
     {
-        icon = gtk_label_new ("→");
+        g_hash_table_insert (dialog->new_name_counts, stored_key,
+                             GUINT_TO_POINTER (GPOINTER_TO_UINT (count) - 1));
     }
+}
+
+static guint
+new_name_counts_get (NautilusBatchRenameDialog *dialog,
+                     NautilusFile              *parent,
+                     const char                *name)
+{
+    NameKey key = { parent, name };
 
-    gtk_label_set_xalign (GTK_LABEL (icon), 1.0);
-    gtk_widget_set_hexpand (icon, FALSE);
-    gtk_widget_set_margin_start (icon, ROW_MARGIN_START);
+    return GPOINTER_TO_UINT (g_hash_table_lookup (dialog->new_name_counts, &key));
+}
 
-    dialog->listbox_icons = g_list_prepend (dialog->listbox_icons, icon);
+/* Only names which actually changed touch the new name counts, so editing the
+ * pattern costs as much as the number of affected files. */
+static void
+update_preview_names (NautilusBatchRenameDialog *dialog)
+{
+    GList *l;
+    guint i;
 
-    return icon;
+    for (i = 0, l = dialog->new_names; i < dialog->items->len && l != NULL; i++, l = l->next)
+    {
+        NautilusBatchRenameItem *item = g_ptr_array_index (dialog->items, i);
+        GString *new_name = l->data;
+
+        if (g_strcmp0 (item->new_name, new_name->str) != 0)
+        {
+            if (item->new_name != NULL)
+            {
+                new_name_counts_remove (dialog, item->old_key.parent, item->new_name);
+            }
+
+            g_free (item->new_name);
+            item->new_name = g_strdup (new_name->str);
+            new_name_counts_add (dialog, item->old_key.parent, item->new_name);
+        }
+
+        /* Even if the new name is the same, the highlighting of the old name
+         * may have changed. */
+        g_object_notify_by_pspec (G_OBJECT (item), item_properties[ITEM_PROP_NEW_NAME]);
+    }
 }
 
 static void
@@ -618,108 +846,88 @@ batch_rename_dialog_on_cancel (NautilusBatchRenameDialog *dialog,
 }
 
 static void
-fill_display_listbox (NautilusBatchRenameDialog *dialog)
+fill_preview_model (NautilusBatchRenameDialog *dialog)
 {
-    GtkWidget *row_child;
-    GList *l1;
-    GList *l2;
-    GtkTextDirection text_direction;
-
-    gtk_size_group_add_widget (dialog->size_group, dialog->result_listbox);
-    gtk_size_group_add_widget (dialog->size_group, dialog->original_name_listbox);
-
-    text_direction = gtk_widget_get_direction (GTK_WIDGET (dialog));
+    GList *l;
+    guint i;
 
-    for (l1 = dialog->new_names, l2 = dialog->selection; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
+    for (l = dialog->selection, i = 0; l != NULL; l = l->next, i++)
     {
-        const char *name = nautilus_file_get_name (NAUTILUS_FILE (l2->data));
-        GString *new_name = l1->data;
-
-        row_child = create_original_name_label (dialog, name);
-        gtk_list_box_insert (GTK_LIST_BOX (dialog->original_name_listbox), row_child, -1);
+        NautilusBatchRenameItem *item;
+        GPtrArray *siblings;
 
-        row_child = create_arrow (dialog, text_direction);
-        gtk_list_box_insert (GTK_LIST_BOX (dialog->arrow_listbox), row_child, -1);
+        item = nautilus_batch_rename_item_new (NAUTILUS_FILE (l->data), i);
+        g_ptr_array_add (dialog->items, item);
+        g_hash_table_insert (dialog->items_by_file, item->file, item);
+        g_hash_table_insert (dialog->items_by_old_name, &item->old_key, item);
 
-        row_child = create_result_label (dialog, new_name->str);
-        gtk_list_box_insert (GTK_LIST_BOX (dialog->result_listbox), row_child, -1);
+        siblings = g_hash_table_lookup (dialog->items_by_parent, item->old_key.parent);
+        if (siblings == NULL)
+        {
+            siblings = g_ptr_array_new ();
+            g_hash_table_insert (dialog->items_by_parent, item->old_key.parent, siblings);
+        }
+        g_ptr_array_add (siblings, item);
     }
 
-    dialog->listbox_labels_old = g_list_reverse (dialog->listbox_labels_old);
-    dialog->listbox_labels_new = g_list_reverse (dialog->listbox_labels_new);
-    dialog->listbox_icons = g_list_reverse (dialog->listbox_icons);
+    g_list_store_splice (dialog->preview_store, 0, 0,
+                         dialog->items->pdata, dialog->items->len);
 }
 
+/* Follow the order of the selection after it has been sorted. */
 static void
-select_nth_conflict (NautilusBatchRenameDialog *dialog)
+sort_preview_items (NautilusBatchRenameDialog *dialog)
 {
     GList *l;
-    GString *conflict_file_name;
-    GString *display_text;
-    GString *new_name;
-    gint nth_conflict_index;
-    gint nth_conflict;
-    gint name_occurences;
-    GtkAdjustment *adjustment;
-    ConflictData *conflict_data;
-    GtkListBoxRow *list_box_row;
+    guint i;
 
-    nth_conflict = dialog->selected_conflict;
-    l = g_list_nth (dialog->duplicates, nth_conflict);
-    conflict_data = l->data;
+    if (dialog->items->len == 0)
+    {
+        return;
+    }
 
-    /* the conflict that has to be selected */
-    conflict_file_name = g_string_new (conflict_data->name);
-    display_text = g_string_new ("");
+    for (l = dialog->selection, i = 0; l != NULL; l = l->next, i++)
+    {
+        NautilusBatchRenameItem *item = g_hash_table_lookup (dialog->items_by_file, l->data);
 
-    nth_conflict_index = conflict_data->index;
+        item->position = i;
+        dialog->items->pdata[i] = item;
+    }
 
-    l = g_list_nth (dialog->listbox_labels_new, nth_conflict_index);
-    list_box_row = GTK_LIST_BOX_ROW (gtk_widget_get_parent (l->data));
-    gtk_list_box_select_row (GTK_LIST_BOX (dialog->original_name_listbox),
-                             list_box_row);
+    g_list_store_splice (dialog->preview_store, 0, dialog->items->len,
+                         dialog->items->pdata, dialog->items->len);
+}
 
-    l = g_list_nth (dialog->listbox_labels_old, nth_conflict_index);
-    list_box_row = GTK_LIST_BOX_ROW (gtk_widget_get_parent (l->data));
-    gtk_list_box_select_row (GTK_LIST_BOX (dialog->arrow_listbox),
-                             list_box_row);
+static void
+select_nth_conflict (NautilusBatchRenameDialog *dialog)
+{
+    GList *l;
+    g_autofree gchar *display_text = NULL;
+    NautilusBatchRenameItem *item;
+    ConflictData *conflict_data;
 
-    l = g_list_nth (dialog->listbox_icons, nth_conflict_index);
-    list_box_row = GTK_LIST_BOX_ROW (gtk_widget_get_parent (l->data));
-    gtk_list_box_select_row (GTK_LIST_BOX (dialog->result_listbox),
-                             list_box_row);
+    l = g_list_nth (dialog->duplicates, dialog->selected_conflict);
+    conflict_data = l->data;
+    item = g_ptr_array_index (dialog->items, conflict_data->index);
 
-    /* scroll to the selected row */
-    adjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (dialog->scrolled_window));
-    gtk_adjustment_set_value (adjustment, (gtk_widget_get_height (GTK_WIDGET (l->data)) + 1) * nth_conflict_index);
+    /* select and scroll to the conflicting row */
+    gtk_list_view_scroll_to (GTK_LIST_VIEW (dialog->preview_list_view),
+                             conflict_data->index,
+                             GTK_LIST_SCROLL_SELECT,
+                             NULL);
 
-    name_occurences = 0;
-    for (l = dialog->new_names; l != NULL; l = l->next)
+    if (new_name_counts_get (dialog, item->old_key.parent, conflict_data->name) > 1)
     {
-        new_name = l->data;
-        if (g_string_equal (new_name, conflict_file_name))
-        {
-            name_occurences++;
-        }
-    }
-    if (name_occurences > 1)
-    {
-        g_string_append_printf (display_text,
-                                _("“%s” would not be a unique new name."),
-                                conflict_file_name->str);
+        display_text = g_strdup_printf (_("“%s” would not be a unique new name."),
+                                        conflict_data->name);
     }
     else
     {
-        g_string_append_printf (display_text,
-                                _("“%s” would conflict with an existing file."),
-                                conflict_file_name->str);
+        display_text = g_strdup_printf (_("“%s” would conflict with an existing file."),
+                                        conflict_data->name);
     }
 
-    gtk_label_set_label (GTK_LABEL (dialog->conflict_label),
-                         display_text->str);
-
-    g_string_free (conflict_file_name, TRUE);
-    g_string_free (display_text, TRUE);
+    gtk_label_set_label (GTK_LABEL (dialog->conflict_label), display_text);
 }
 
 static void
@@ -761,95 +969,47 @@ select_next_conflict_up (NautilusBatchRenameDialog *dialog)
 static void
 update_conflict_row_background (NautilusBatchRenameDialog *dialog)
 {
-    GList *l1;
-    GList *l2;
-    GList *l3;
     GList *duplicates;
-    gint index;
     ConflictData *conflict_data;
 
-    index = 0;
-
     duplicates = dialog->duplicates;
 
-    for (l1 = dialog->listbox_labels_new,
-         l2 = dialog->listbox_labels_old,
-         l3 = dialog->listbox_icons;
-         l1 != NULL && l2 != NULL && l3 != NULL;
-         l1 = l1->next, l2 = l2->next, l3 = l3->next)
+    for (guint i = 0; i < dialog->items->len; i++)
     {
-        GtkWidget *row1 = gtk_widget_get_parent (l1->data);
-        GtkWidget *row2 = gtk_widget_get_parent (l2->data);
-        GtkWidget *row3 = gtk_widget_get_parent (l3->data);
-
-        if (gtk_widget_has_css_class (row1, "conflict-row"))
-        {
-            gtk_widget_remove_css_class (row1, "conflict-row");
-            gtk_widget_remove_css_class (row2, "conflict-row");
-            gtk_widget_remove_css_class (row3, "conflict-row");
-        }
+        gboolean conflict = FALSE;
 
         if (duplicates != NULL)
         {
             conflict_data = duplicates->data;
-            if (conflict_data->index == index)
+            if (conflict_data->index == (gint) i)
             {
-                gtk_widget_add_css_class (row1, "conflict-row");
-                gtk_widget_add_css_class (row2, "conflict-row");
-                gtk_widget_add_css_class (row3, "conflict-row");
-
+                conflict = TRUE;
                 duplicates = duplicates->next;
             }
         }
-        index++;
+
+        nautilus_batch_rename_item_set_conflict (g_ptr_array_index (dialog->items, i), conflict);
     }
 }
 
 static void
 update_listbox (NautilusBatchRenameDialog *dialog)
 {
-    GList *l1;
-    GList *l2;
+    GList *l;
     GString *new_name;
     gboolean empty_name = FALSE;
 
-    for (l1 = dialog->new_names, l2 = dialog->listbox_labels_new; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
+    for (l = dialog->new_names; l != NULL; l = l->next)
     {
-        GtkLabel *label = GTK_LABEL (l2->data);
-        new_name = l1->data;
-
-        gtk_label_set_label (label, new_name->str);
-        gtk_widget_set_tooltip_text (GTK_WIDGET (label), new_name->str);
+        new_name = l->data;
 
-        if (g_strcmp0 (new_name->str, "") == 0)
+        if (new_name->len == 0)
         {
             empty_name = TRUE;
+            break;
         }
     }
 
-    for (l1 = dialog->selection, l2 = dialog->listbox_labels_old; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
-    {
-        GtkLabel *label = GTK_LABEL (l2->data);
-        const char *old_name = nautilus_file_get_name (NAUTILUS_FILE (l1->data));
-
-        gtk_widget_set_tooltip_text (GTK_WIDGET (label), old_name);
-
-        if (dialog->mode == NAUTILUS_BATCH_RENAME_DIALOG_FORMAT)
-        {
-            gtk_label_set_label (label, old_name);
-        }
-        else
-        {
-            new_name = batch_rename_replace_label_text (old_name,
-                                                        gtk_editable_get_text (GTK_EDITABLE (dialog->find_entry)));
-            gtk_label_set_markup (GTK_LABEL (label), new_name->str);
-
-            g_string_free (new_name, TRUE);
-        }
-    }
-
-    update_rows_height (dialog);
-
     if (empty_name)
     {
         gtk_widget_set_sensitive (dialog->rename_button, FALSE);
@@ -873,7 +1033,7 @@ update_listbox (NautilusBatchRenameDialog *dialog)
 
         gtk_widget_set_sensitive (dialog->conflict_up, FALSE);
 
-        if (g_list_length (dialog->duplicates) == 1)
+        if (dialog->conflicts_number == 1)
         {
             gtk_widget_set_sensitive (dialog->conflict_down, FALSE);
         }
@@ -911,130 +1071,67 @@ check_conflict_for_files (NautilusBatchRenameDialog *dialog,
                           NautilusDirectory         *directory,
                           GList                     *files)
 {
-    gchar *current_directory;
-    gchar *parent_uri;
-    GString *file_name;
-    GList *l1, *l2;
-    GHashTable *directory_files_table;
-    GHashTable *new_names_table;
-    GHashTable *names_conflicts_table;
-    gboolean exists;
-    gboolean have_conflict;
-    gboolean tag_present;
-    gboolean same_parent_directory;
-    ConflictData *conflict_data;
-
-    current_directory = nautilus_directory_get_uri (directory);
-
-    directory_files_table = g_hash_table_new_full (g_str_hash,
-                                                   g_str_equal,
-                                                   (GDestroyNotify) g_free,
-                                                   NULL);
-    new_names_table = g_hash_table_new_full (g_str_hash,
-                                             g_str_equal,
-                                             (GDestroyNotify) g_free,
-                                             (GDestroyNotify) g_free);
-    names_conflicts_table = g_hash_table_new_full (g_str_hash,
-                                                   g_str_equal,
-                                                   (GDestroyNotify) g_free,
-                                                   (GDestroyNotify) g_free);
-
-    /* names_conflicts_table is used for knowing which names from the list are not unique,
-     * so that they can easily be reached when needed */
-    for (l1 = dialog->new_names, l2 = dialog->selection;
-         l1 != NULL && l2 != NULL;
-         l1 = l1->next, l2 = l2->next)
-    {
-        GString *new_name = l1->data;
-        NautilusFile *file = NAUTILUS_FILE (l2->data);
-        parent_uri = nautilus_file_get_parent_uri (file);
-
-        tag_present = g_hash_table_lookup (new_names_table, new_name->str) != NULL;
-        same_parent_directory = g_strcmp0 (parent_uri, current_directory) == 0;
-
-        if (same_parent_directory)
-        {
-            if (!tag_present)
-            {
-                g_hash_table_insert (new_names_table,
-                                     g_strdup (new_name->str),
-                                     nautilus_file_get_parent_uri (file));
-            }
-            else
-            {
-                g_hash_table_insert (names_conflicts_table,
-                                     g_strdup (new_name->str),
-                                     nautilus_file_get_parent_uri (file));
-            }
-        }
+    g_autoptr (NautilusFile) directory_file = NULL;
+    g_autoptr (GHashTable) directory_names = NULL;
+    GPtrArray *items;
+    GList *l;
 
-        g_free (parent_uri);
+    directory_file = nautilus_directory_get_corresponding_file (directory);
+    items = g_hash_table_lookup (dialog->items_by_parent, directory_file);
+    if (items == NULL)
+    {
+        return;
     }
 
-    for (l1 = files; l1 != NULL; l1 = l1->next)
+    directory_names = g_hash_table_new (g_str_hash, g_str_equal);
+    for (l = files; l != NULL; l = l->next)
     {
-        NautilusFile *file = NAUTILUS_FILE (l1->data);
-        g_hash_table_insert (directory_files_table,
-                             g_strdup (nautilus_file_get_name (file)),
-                             GINT_TO_POINTER (TRUE));
+        g_hash_table_add (directory_names, (gpointer) nautilus_file_get_name (NAUTILUS_FILE (l->data)));
     }
 
-    for (l1 = dialog->selection, l2 = dialog->new_names; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
+    for (guint i = 0; i < items->len; i++)
     {
-        NautilusFile *file = NAUTILUS_FILE (l1->data);
-        GString *new_name = l2->data;
-
-        file_name = g_string_new (nautilus_file_get_name (file));
-
-        parent_uri = nautilus_file_get_parent_uri (file);
-
-        have_conflict = FALSE;
+        NautilusBatchRenameItem *item = g_ptr_array_index (items, i);
+        gboolean have_conflict = FALSE;
+        ConflictData *conflict_data;
 
-        /* check for duplicate only if the parent of the current file is
-         * the current directory and the name of the file has changed */
-        if (g_strcmp0 (parent_uri, current_directory) == 0 &&
-            !g_string_equal (new_name, file_name))
+        /* check for an existing file only if the name of the file has changed */
+        if (g_strcmp0 (item->new_name, item->old_name) != 0 &&
+            g_hash_table_contains (directory_names, item->new_name))
         {
-            exists = GPOINTER_TO_INT (g_hash_table_lookup (directory_files_table, new_name->str));
-
-            if (exists == TRUE &&
-                !file_name_conflicts_with_results (dialog->selection, dialog->new_names, new_name, parent_uri))
-            {
-                conflict_data = g_new (ConflictData, 1);
-                conflict_data->name = g_strdup (new_name->str);
-                conflict_data->index = g_list_index (dialog->selection, l1->data);
-                dialog->duplicates = g_list_prepend (dialog->duplicates,
-                                                     conflict_data);
-
-                have_conflict = TRUE;
-            }
+            NameKey key = { item->old_key.parent, item->new_name };
+            NautilusBatchRenameItem *existing;
+
+            /* The existing file is no obstacle if it's part of the selection
+             * and gets renamed as well. */
+            existing = g_hash_table_lookup (dialog->items_by_old_name, &key);
+            have_conflict = (existing == NULL ||
+                             g_strcmp0 (existing->new_name, existing->old_name) == 0);
         }
 
         if (!have_conflict)
         {
-            tag_present = g_hash_table_lookup (names_conflicts_table, new_name->str) != NULL;
-            same_parent_directory = g_strcmp0 (parent_uri, current_directory) == 0;
-
-            if (tag_present && same_parent_directory)
-            {
-                conflict_data = g_new (ConflictData, 1);
-                conflict_data->name = g_strdup (new_name->str);
-                conflict_data->index = g_list_index (dialog->selection, l1->data);
-                dialog->duplicates = g_list_prepend (dialog->duplicates,
-                                                     conflict_data);
-
-                have_conflict = TRUE;
-            }
+            have_conflict = new_name_counts_get (dialog, item->old_key.parent, item->new_name) > 1;
         }
 
-        g_string_free (file_name, TRUE);
-        g_free (parent_uri);
+        if (have_conflict)
+        {
+            conflict_data = g_new (ConflictData, 1);
+            conflict_data->name = g_strdup (item->new_name);
+            conflict_data->index = item->position;
+            dialog->duplicates = g_list_prepend (dialog->duplicates, conflict_data);
+        }
     }
+}
 
-    g_free (current_directory);
-    g_hash_table_destroy (directory_files_table);
-    g_hash_table_destroy (new_names_table);
-    g_hash_table_destroy (names_conflicts_table);
+static gint
+compare_conflict_data_by_index (gconstpointer a,
+                                gconstpointer b)
+{
+    const ConflictData *conflict_a = a;
+    const ConflictData *conflict_b = b;
+
+    return conflict_a->index - conflict_b->index;
 }
 
 static void
@@ -1056,7 +1153,7 @@ on_directory_attributes_ready_for_conflicts_check (NautilusDirectory *conflict_d
 
     if (self->directories_pending_conflict_check == NULL)
     {
-        self->duplicates = g_list_reverse (self->duplicates);
+        self->duplicates = g_list_sort (self->duplicates, compare_conflict_data_by_index);
 
         update_listbox (self);
     }
@@ -1268,6 +1365,7 @@ update_display_text (NautilusBatchRenameDialog *dialog)
     }
 
     dialog->new_names = batch_rename_dialog_get_new_names (dialog);
+    update_preview_names (dialog);
 
     if (have_unallowed_character (dialog))
     {
@@ -1367,99 +1465,6 @@ nautilus_batch_rename_dialog_query_finished (NautilusBatchRenameDialog *dialog,
     }
 }
 
-static void
-update_row_shadowing (GtkWidget *row,
-                      gboolean   shown)
-{
-    GtkStateFlags flags;
-
-    if (!GTK_IS_LIST_BOX_ROW (row))
-    {
-        return;
-    }
-
-    flags = gtk_widget_get_state_flags (row);
-
-    if (shown)
-    {
-        flags |= GTK_STATE_FLAG_PRELIGHT;
-    }
-    else
-    {
-        flags &= ~GTK_STATE_FLAG_PRELIGHT;
-    }
-
-    gtk_widget_set_state_flags (row, flags, FALSE);
-}
-
-static void
-on_event_controller_motion_motion (GtkEventControllerMotion *controller,
-                                   double                    x,
-                                   double                    y,
-                                   gpointer                  user_data)
-{
-    GtkWidget *widget;
-    NautilusBatchRenameDialog *dialog;
-    GtkListBoxRow *row;
-
-    widget = gtk_event_controller_get_widget (GTK_EVENT_CONTROLLER (controller));
-    dialog = NAUTILUS_BATCH_RENAME_DIALOG (user_data);
-
-    if (dialog->preselected_row1 && dialog->preselected_row2)
-    {
-        update_row_shadowing (dialog->preselected_row1, FALSE);
-        update_row_shadowing (dialog->preselected_row2, FALSE);
-    }
-
-    if (widget == dialog->result_listbox)
-    {
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->original_name_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row1 = GTK_WIDGET (row);
-
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->arrow_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row2 = GTK_WIDGET (row);
-    }
-
-    if (widget == dialog->arrow_listbox)
-    {
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->original_name_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row1 = GTK_WIDGET (row);
-
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->result_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row2 = GTK_WIDGET (row);
-    }
-
-    if (widget == dialog->original_name_listbox)
-    {
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->result_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row1 = GTK_WIDGET (row);
-
-        row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (dialog->arrow_listbox), y);
-        update_row_shadowing (GTK_WIDGET (row), TRUE);
-        dialog->preselected_row2 = GTK_WIDGET (row);
-    }
-}
-
-static void
-on_event_controller_motion_leave (GtkEventControllerMotion *controller,
-                                  gpointer                  user_data)
-{
-    NautilusBatchRenameDialog *dialog;
-
-    dialog = NAUTILUS_BATCH_RENAME_DIALOG (user_data);
-
-    update_row_shadowing (dialog->preselected_row1, FALSE);
-    update_row_shadowing (dialog->preselected_row2, FALSE);
-
-    dialog->preselected_row1 = NULL;
-    dialog->preselected_row2 = NULL;
-}
-
 static void
 nautilus_batch_rename_dialog_initialize_actions (NautilusBatchRenameDialog *dialog)
 {
@@ -1734,9 +1739,12 @@ nautilus_batch_rename_dialog_finalize (GObject *object)
         cancel_conflict_check (dialog);
     }
 
-    g_list_free (dialog->listbox_labels_new);
-    g_list_free (dialog->listbox_labels_old);
-    g_list_free (dialog->listbox_icons);
+    g_hash_table_destroy (dialog->items_by_file);
+    g_hash_table_destroy (dialog->items_by_old_name);
+    g_hash_table_destroy (dialog->items_by_parent);
+    g_hash_table_destroy (dialog->new_name_counts);
+    g_ptr_array_unref (dialog->items);
+    g_object_unref (dialog->preview_store);
 
     for (l = dialog->selection_metadata; l != NULL; l = g_list_delete_link (l, l))
     {
@@ -1767,8 +1775,6 @@ nautilus_batch_rename_dialog_finalize (GObject *object)
     nautilus_directory_unref (dialog->directory);
     nautilus_directory_list_free (dialog->distinct_parent_directories);
 
-    g_object_unref (dialog->size_group);
-
     g_hash_table_destroy (dialog->tag_info_table);
 
     g_cancellable_cancel (dialog->metadata_cancellable);
@@ -1792,9 +1798,7 @@ nautilus_batch_rename_dialog_class_init (NautilusBatchRenameDialogClass *klass)
     gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/nautilus/ui/nautilus-batch-rename-dialog.ui");
 
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, grid);
-    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, original_name_listbox);
-    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, arrow_listbox);
-    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, result_listbox);
+    gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, preview_list_view);
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, name_entry);
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, rename_button);
     gtk_widget_class_bind_template_child (widget_class, NautilusBatchRenameDialog, find_entry);
@@ -1895,12 +1899,12 @@ nautilus_batch_rename_dialog_new (GList             *selection,
 
     add_tag (dialog, metadata_tags_constants[ORIGINAL_FILE_NAME]);
 
+    fill_preview_model (dialog);
+
     nautilus_batch_rename_dialog_initialize_actions (dialog);
 
     update_display_text (dialog);
 
-    fill_display_listbox (dialog);
-
     gtk_widget_set_cursor (GTK_WIDGET (window), NULL);
 
     g_string_free (dialog_title, TRUE);
@@ -1908,41 +1912,38 @@ nautilus_batch_rename_dialog_new (GList             *selection,
     return GTK_WIDGET (dialog);
 }
 
-static void
-connect_to_pointer_motion_events (NautilusBatchRenameDialog *self,
-                                  GtkWidget                 *listbox)
-{
-    GtkEventController *controller;
-
-    controller = gtk_event_controller_motion_new ();
-    gtk_widget_add_controller (listbox, controller);
-    gtk_event_controller_set_propagation_phase (controller, GTK_PHASE_CAPTURE);
-    g_signal_connect (controller, "leave",
-                      G_CALLBACK (on_event_controller_motion_leave), self);
-    g_signal_connect (controller, "motion",
-                      G_CALLBACK (on_event_controller_motion_motion), self);
-}
-
 static void
 nautilus_batch_rename_dialog_init (NautilusBatchRenameDialog *self)
 {
     TagData *tag_data;
+    GtkListItemFactory *factory;
     guint i;
 
     gtk_widget_init_template (GTK_WIDGET (self));
 
-    gtk_list_box_set_header_func (GTK_LIST_BOX (self->original_name_listbox),
-                                  (GtkListBoxUpdateHeaderFunc) listbox_header_func,
-                                  self,
-                                  NULL);
-    gtk_list_box_set_header_func (GTK_LIST_BOX (self->arrow_listbox),
-                                  (GtkListBoxUpdateHeaderFunc) listbox_header_func,
-                                  self,
-                                  NULL);
-    gtk_list_box_set_header_func (GTK_LIST_BOX (self->result_listbox),
-                                  (GtkListBoxUpdateHeaderFunc) listbox_header_func,
-                                  self,
-                                  NULL);
+    self->items = g_ptr_array_new_with_free_func (g_object_unref);
+    self->preview_store = g_list_store_new (NAUTILUS_TYPE_BATCH_RENAME_ITEM);
+    self->items_by_file = g_hash_table_new (NULL, NULL);
+    self->items_by_old_name = g_hash_table_new (name_key_hash, name_key_equal);
+    self->items_by_parent = g_hash_table_new_full (NULL, NULL, NULL,
+                                                   (GDestroyNotify) g_ptr_array_unref);
+    self->new_name_counts = g_hash_table_new_full (name_key_hash, name_key_equal,
+                                                   name_key_free, NULL);
+
+    self->preview_selection = gtk_single_selection_new (g_object_ref (G_LIST_MODEL (self->preview_store)));
+    gtk_single_selection_set_autoselect (self->preview_selection, FALSE);
+    gtk_single_selection_set_can_unselect (self->preview_selection, TRUE);
+
+    factory = gtk_signal_list_item_factory_new ();
+    g_signal_connect (factory, "setup", G_CALLBACK (preview_setup_item), self);
+    g_signal_connect (factory, "bind", G_CALLBACK (preview_bind_item), self);
+    g_signal_connect (factory, "unbind", G_CALLBACK (preview_unbind_item), self);
+
+    gtk_list_view_set_model (GTK_LIST_VIEW (self->preview_list_view),
+                             GTK_SELECTION_MODEL (self->preview_selection));
+    gtk_list_view_set_factory (GTK_LIST_VIEW (self->preview_list_view), factory);
+    g_object_unref (self->preview_selection);
+    g_object_unref (factory);
 
 
     self->mode = NAUTILUS_BATCH_RENAME_DIALOG_FORMAT;
@@ -1989,18 +1990,10 @@ nautilus_batch_rename_dialog_init (NautilusBatchRenameDialog *self)
         g_hash_table_insert (self->tag_info_table, g_strdup (tag_text_representation), tag_data);
     }
 
-    self->row_height = -1;
-
     g_signal_connect_object (gtk_editable_get_delegate (GTK_EDITABLE (self->name_entry)),
                              "delete-text", G_CALLBACK (on_delete_text), self, 0);
     g_signal_connect_object (gtk_editable_get_delegate (GTK_EDITABLE (self->name_entry)),
                              "insert-text", G_CALLBACK (on_insert_text), self, 0);
 
-    self->size_group = gtk_size_group_new (GTK_SIZE_GROUP_HORIZONTAL);
-
-    connect_to_pointer_motion_events (self, self->original_name_listbox);
-    connect_to_pointer_motion_events (self, self->result_listbox);
-    connect_to_pointer_motion_events (self, self->arrow_listbox);
-
     self->metadata_cancellable = g_cancellable_new ();
 }
@@ -534,50 +534,6 @@ batch_rename_dialog_get_new_names_list (NautilusBatchRenameDialogMode  mode,
     return result;
 }
 
-/* There is a case that a new name for a file conflicts with an existing file name
- * in the directory but it's not a problem because the file in the directory that
- * conflicts is part of the batch renaming selection and it's going to change the name anyway. */
-gboolean
-file_name_conflicts_with_results (GList   *selection,
-                                  GList   *new_names,
-                                  GString *old_name,
-                                  gchar   *parent_uri)
-{
-    GList *l1;
-    GList *l2;
-    GString *new_name;
-
-    for (l1 = selection, l2 = new_names; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
-    {
-        NautilusFile *selection_file = NAUTILUS_FILE (l1->data);
-        const char *name1 = nautilus_file_get_name (selection_file);
-        g_autofree gchar *selection_parent_uri = NULL;
-
-        selection_parent_uri = nautilus_file_get_parent_uri (selection_file);
-
-        if (g_strcmp0 (name1, old_name->str) == 0)
-        {
-            new_name = l2->data;
-
-            /* if the name didn't change, then there's a conflict */
-            if (g_string_equal (old_name, new_name) &&
-                (parent_uri == NULL || g_strcmp0 (parent_uri, selection_parent_uri) == 0))
-            {
-                return FALSE;
-            }
-
-
-            /* if this file exists and it changed it's name, then there's no
-             * conflict */
-            return TRUE;
-        }
-    }
-
-    /* the case this function searched for doesn't exist, so the file
-     * has a conlfict */
-    return FALSE;
-}
-
 static gint
 compare_files_by_name_ascending (gconstpointer a,
                                  gconstpointer b)
@@ -52,11 +52,6 @@ void conflict_data_free                         (gpointer mem);
 
 GList* batch_rename_files_get_distinct_parents  (GList *selection);
 
-gboolean file_name_conflicts_with_results       (GList        *selection,
-                                                 GList        *new_names,
-                                                 GString      *old_name,
-                                                 gchar        *parent_uri);
-
 GString* batch_rename_replace_label_text        (const char        *label,
                                                  const gchar       *substr);
 
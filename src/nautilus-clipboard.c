@@ -33,16 +33,41 @@
 #include <gtk/gtk.h>
 #include <string.h>
 
-/* The .files member contains elements of type NautilusFile. */
+/* The .files member contains elements of type NautilusFile. The contents are
+ * never modified after creation, so copies of the boxed value share one
+ * reference counted instance. .file_set holds the same files, for lookups
+ * which don't depend on the size of the selection. */
 struct _NautilusClipboard
 {
+    gatomicrefcount ref_count;
     gboolean cut;
     GList *files;
+    GHashTable *file_set;
 };
 
 /* Boxed type used to wrap this struct in a clipboard GValue. */
 G_DEFINE_BOXED_TYPE (NautilusClipboard, nautilus_clipboard,
-                     nautilus_clipboard_copy, nautilus_clipboard_free)
+                     nautilus_clipboard_ref, nautilus_clipboard_unref)
+
+/* Takes ownership of @files. */
+static NautilusClipboard *
+nautilus_clipboard_new (GList    *files,
+                        gboolean  cut)
+{
+    NautilusClipboard *clip = g_new0 (NautilusClipboard, 1);
+
+    g_atomic_ref_count_init (&clip->ref_count);
+    clip->cut = cut;
+    clip->files = files;
+    clip->file_set = g_hash_table_new (NULL, NULL);
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        g_hash_table_add (clip->file_set, l->data);
+    }
+
+    return clip;
+}
 
 static char *
 nautilus_clipboard_to_string (NautilusClipboard *clip)
@@ -105,10 +130,9 @@ nautilus_clipboard_from_string (char    *string,
         files = g_list_prepend (files, nautilus_file_get_by_uri (lines[i]));
     }
 
-    clip = g_new0 (NautilusClipboard, 1);
     files = g_list_reverse (files);
-    clip->files = g_steal_pointer (&files);
-    clip->cut = g_str_equal (lines[0], "cut");
+    clip = nautilus_clipboard_new (g_steal_pointer (&files),
+                                   g_str_equal (lines[0], "cut"));
 
     return clip;
 }
@@ -121,7 +145,6 @@ nautilus_clipboard_clear_if_colliding_uris (GtkWidget   *widget,
     GdkContentFormats *formats = gdk_clipboard_get_formats (clipboard);
     g_auto (GValue) value = G_VALUE_INIT;
     NautilusClipboard *nautilus_clipboard;
-    GList *clipboard_item_uris;
 
     if (!gdk_clipboard_is_local (clipboard) ||
         !gdk_content_formats_contain_gtype (formats, NAUTILUS_TYPE_CLIPBOARD))
@@ -135,19 +158,20 @@ nautilus_clipboard_clear_if_colliding_uris (GtkWidget   *widget,
         return;
     }
     nautilus_clipboard = g_value_get_boxed (&value);
-    clipboard_item_uris = nautilus_clipboard_get_uri_list (nautilus_clipboard);
 
+    /* The clipboard holds a reference to each of its files, so any colliding
+     * URI resolves to one of them through the file cache, without turning the
+     * whole clipboard into URIs first. */
     for (GList *l = (GList *) item_uris; l != NULL; l = l->next)
     {
-        if (g_list_find_custom ((GList *) clipboard_item_uris, l->data,
-                                (GCompareFunc) g_strcmp0))
+        g_autoptr (NautilusFile) file = nautilus_file_get_existing_by_uri (l->data);
+
+        if (file != NULL && nautilus_clipboard_contains_file (nautilus_clipboard, file))
         {
             gdk_clipboard_set_content (clipboard, NULL);
             break;
         }
     }
-
-    g_list_free_full (clipboard_item_uris, g_free);
 }
 
 /*
@@ -282,45 +306,189 @@ nautilus_clipboard_is_cut (NautilusClipboard *clip)
     return clip->cut;
 }
 
-NautilusClipboard *
-nautilus_clipboard_copy (NautilusClipboard *clip)
+/**
+ * nautilus_clipboard_contains_file:
+ * @clip: The current local clipboard value.
+ * @file: The file to look up.
+ *
+ * Returns: Whether @file is one of the clipboard files.
+ */
+gboolean
+nautilus_clipboard_contains_file (NautilusClipboard *clip,
+                                  NautilusFile      *file)
 {
-    NautilusClipboard *new_clip = g_new0 (NautilusClipboard, 1);
+    return g_hash_table_contains (clip->file_set, file);
+}
 
-    new_clip->cut = clip->cut;
-    new_clip->files = nautilus_file_list_copy (clip->files);
+NautilusClipboard *
+nautilus_clipboard_ref (NautilusClipboard *clip)
+{
+    g_atomic_ref_count_inc (&clip->ref_count);
 
-    return new_clip;
+    return clip;
 }
 
 void
-nautilus_clipboard_free (NautilusClipboard *clip)
+nautilus_clipboard_unref (NautilusClipboard *clip)
 {
+    if (!g_atomic_ref_count_dec (&clip->ref_count))
+    {
+        return;
+    }
+
+    g_hash_table_destroy (clip->file_set);
     nautilus_file_list_free (clip->files);
     g_free (clip);
 }
 
+/* Content provider which offers the clipboard both as NautilusClipboard and as
+ * a GdkFileList, but only builds the GFile list (and from it, the URI list)
+ * when another application actually asks for it. Cutting or copying a huge
+ * selection then costs no more than referencing the files. */
+#define NAUTILUS_TYPE_CLIPBOARD_PROVIDER (nautilus_clipboard_provider_get_type ())
+G_DECLARE_FINAL_TYPE (NautilusClipboardProvider, nautilus_clipboard_provider,
+                      NAUTILUS, CLIPBOARD_PROVIDER, GdkContentProvider)
+
+struct _NautilusClipboardProvider
+{
+    GdkContentProvider parent_instance;
+
+    NautilusClipboard *clip;
+};
+
+G_DEFINE_FINAL_TYPE (NautilusClipboardProvider, nautilus_clipboard_provider,
+                     GDK_TYPE_CONTENT_PROVIDER)
+
+static GdkContentFormats *
+nautilus_clipboard_provider_ref_formats (GdkContentProvider *provider)
+{
+    GdkContentFormatsBuilder *builder = gdk_content_formats_builder_new ();
+
+    gdk_content_formats_builder_add_gtype (builder, NAUTILUS_TYPE_CLIPBOARD);
+    gdk_content_formats_builder_add_gtype (builder, GDK_TYPE_FILE_LIST);
+
+    return gdk_content_formats_builder_free_to_formats (builder);
+}
+
+static gboolean
+nautilus_clipboard_provider_get_value (GdkContentProvider  *provider,
+                                       GValue              *value,
+                                       GError             **error)
+{
+    NautilusClipboardProvider *self = NAUTILUS_CLIPBOARD_PROVIDER (provider);
+
+    if (G_VALUE_HOLDS (value, NAUTILUS_TYPE_CLIPBOARD))
+    {
+        g_value_set_boxed (value, self->clip);
+        return TRUE;
+    }
+    else if (G_VALUE_HOLDS (value, GDK_TYPE_FILE_LIST))
+    {
+        g_value_take_boxed (value, convert_file_list_to_gdk_file_list (self->clip));
+        return TRUE;
+    }
+
+    return GDK_CONTENT_PROVIDER_CLASS (nautilus_clipboard_provider_parent_class)->get_value (provider, value, error);
+}
+
+static void
+nautilus_clipboard_provider_write_mime_type_done (GObject      *source_object,
+                                                  GAsyncResult *result,
+                                                  gpointer      user_data)
+{
+    g_autoptr (GTask) task = user_data;
+    GError *error = NULL;
+
+    if (!gdk_content_serialize_finish (result, &error))
+    {
+        g_task_return_error (task, error);
+    }
+    else
+    {
+        g_task_return_boolean (task, TRUE);
+    }
+}
+
+static void
+nautilus_clipboard_provider_write_mime_type_async (GdkContentProvider  *provider,
+                                                   const char          *mime_type,
+                                                   GOutputStream       *stream,
+                                                   int                  io_priority,
+                                                   GCancellable        *cancellable,
+                                                   GAsyncReadyCallback  callback,
+                                                   gpointer             user_data)
+{
+    g_autoptr (GdkContentFormats) formats = NULL;
+    g_auto (GValue) value = G_VALUE_INIT;
+    GTask *task;
+
+    task = g_task_new (provider, cancellable, callback, user_data);
+    g_task_set_priority (task, io_priority);
+    g_task_set_source_tag (task, nautilus_clipboard_provider_write_mime_type_async);
+
+    /* Serialize from whichever of our types provides this mime type. */
+    formats = gdk_content_formats_new_for_gtype (NAUTILUS_TYPE_CLIPBOARD);
+    formats = gdk_content_formats_union_serialize_mime_types (formats);
+    g_value_init (&value,
+                  gdk_content_formats_contain_mime_type (formats, mime_type) ?
+                  NAUTILUS_TYPE_CLIPBOARD : GDK_TYPE_FILE_LIST);
+    nautilus_clipboard_provider_get_value (provider, &value, NULL);
+
+    gdk_content_serialize_async (stream, mime_type, &value, io_priority, cancellable,
+                                 nautilus_clipboard_provider_write_mime_type_done,
+                                 task);
+}
+
+static gboolean
+nautilus_clipboard_provider_write_mime_type_finish (GdkContentProvider  *provider,
+                                                    GAsyncResult        *result,
+                                                    GError             **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, provider), FALSE);
+
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+nautilus_clipboard_provider_finalize (GObject *object)
+{
+    NautilusClipboardProvider *self = NAUTILUS_CLIPBOARD_PROVIDER (object);
+
+    nautilus_clipboard_unref (self->clip);
+
+    G_OBJECT_CLASS (nautilus_clipboard_provider_parent_class)->finalize (object);
+}
+
+static void
+nautilus_clipboard_provider_class_init (NautilusClipboardProviderClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GdkContentProviderClass *provider_class = GDK_CONTENT_PROVIDER_CLASS (klass);
+
+    object_class->finalize = nautilus_clipboard_provider_finalize;
+
+    provider_class->ref_formats = nautilus_clipboard_provider_ref_formats;
+    provider_class->get_value = nautilus_clipboard_provider_get_value;
+    provider_class->write_mime_type_async = nautilus_clipboard_provider_write_mime_type_async;
+    provider_class->write_mime_type_finish = nautilus_clipboard_provider_write_mime_type_finish;
+}
+
+static void
+nautilus_clipboard_provider_init (NautilusClipboardProvider *self)
+{
+}
+
 void
 nautilus_clipboard_prepare_for_files (GdkClipboard *clipboard,
                                       GList        *files,
                                       gboolean      cut)
 {
-    g_autoptr (NautilusClipboard) clip = NULL;
-    g_autoslist (GFile) file_list = NULL;
-    GdkContentProvider *providers[2];
-    g_autoptr (GdkContentProvider) provider = NULL;
-
-    clip = g_new (NautilusClipboard, 1);
-    clip->cut = cut;
-    clip->files = nautilus_file_list_copy (files);
-
-    file_list = convert_file_list_to_gdk_file_list (clip);
+    g_autoptr (NautilusClipboardProvider) provider = NULL;
 
-    providers[0] = gdk_content_provider_new_typed (NAUTILUS_TYPE_CLIPBOARD, clip);
-    providers[1] = gdk_content_provider_new_typed (GDK_TYPE_FILE_LIST, file_list);
+    provider = g_object_new (NAUTILUS_TYPE_CLIPBOARD_PROVIDER, NULL);
+    provider->clip = nautilus_clipboard_new (nautilus_file_list_copy (files), cut);
 
-    provider = gdk_content_provider_new_union (providers, 2);
-    gdk_clipboard_set_content (clipboard, provider);
+    gdk_clipboard_set_content (clipboard, GDK_CONTENT_PROVIDER (provider));
 }
 
 void
@@ -24,6 +24,8 @@
 
 #include <gtk/gtk.h>
 
+#include "nautilus-types.h"
+
 typedef struct _NautilusClipboard NautilusClipboard;
 #define NAUTILUS_TYPE_CLIPBOARD (nautilus_clipboard_get_type())
 GType              nautilus_clipboard_get_type     (void);
@@ -33,10 +35,12 @@ void nautilus_clipboard_clear_if_colliding_uris    (GtkWidget          *widget,
 GList             *nautilus_clipboard_peek_files   (NautilusClipboard *clip);
 GList             *nautilus_clipboard_get_uri_list (NautilusClipboard *clip);
 gboolean           nautilus_clipboard_is_cut       (NautilusClipboard *clip);
+gboolean           nautilus_clipboard_contains_file (NautilusClipboard *clip,
+                                                     NautilusFile      *file);
 
-NautilusClipboard *nautilus_clipboard_copy         (NautilusClipboard *clip);
-void               nautilus_clipboard_free         (NautilusClipboard *clip);
-G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusClipboard, nautilus_clipboard_free)
+NautilusClipboard *nautilus_clipboard_ref          (NautilusClipboard *clip);
+void               nautilus_clipboard_unref        (NautilusClipboard *clip);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusClipboard, nautilus_clipboard_unref)
 
 void nautilus_clipboard_prepare_for_files (GdkClipboard *clipboard,
                                            GList        *files,
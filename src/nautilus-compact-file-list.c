@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "nautilus-compact-file-list.h"
+
+#define NAMES_CHUNK_SIZE (16 * 1024)
+/* Marks entries of locations without a parent, whose name is their URI */
+#define NO_PARENT G_MAXUINT32
+
+typedef struct
+{
+    guint32 parent;
+    guint32 value;
+    const char *name;
+} Entry;
+
+struct _NautilusCompactFileList
+{
+    GArray *entries; /* Entry */
+    GStringChunk *names;
+
+    GPtrArray *parents; /* GFile */
+    GHashTable *parent_indexes; /* GFile -> index + 1 */
+    /* Files are mostly appended folder by folder, so the parent of the last
+     * one usually saves a lookup. */
+    guint32 last_parent;
+};
+
+NautilusCompactFileList *
+nautilus_compact_file_list_new (void)
+{
+    NautilusCompactFileList *list = g_new0 (NautilusCompactFileList, 1);
+
+    list->entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+    list->names = g_string_chunk_new (NAMES_CHUNK_SIZE);
+    list->parents = g_ptr_array_new_with_free_func (g_object_unref);
+    list->parent_indexes = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+    list->last_parent = NO_PARENT;
+
+    return list;
+}
+
+void
+nautilus_compact_file_list_free (NautilusCompactFileList *list)
+{
+    g_hash_table_destroy (list->parent_indexes);
+    g_ptr_array_unref (list->parents);
+    g_string_chunk_free (list->names);
+    g_array_unref (list->entries);
+    g_free (list);
+}
+
+static guint32
+get_parent_index (NautilusCompactFileList *list,
+                  GFile                   *parent)
+{
+    guint32 index;
+
+    if (list->last_parent != NO_PARENT &&
+        g_file_equal (parent, g_ptr_array_index (list->parents, list->last_parent)))
+    {
+        return list->last_parent;
+    }
+
+    index = GPOINTER_TO_UINT (g_hash_table_lookup (list->parent_indexes, parent));
+    if (index == 0)
+    {
+        GFile *stored_parent = g_object_ref (parent);
+
+        g_ptr_array_add (list->parents, stored_parent);
+        index = list->parents->len;
+        g_hash_table_insert (list->parent_indexes, stored_parent, GUINT_TO_POINTER (index));
+    }
+
+    list->last_parent = index - 1;
+
+    return list->last_parent;
+}
+
+void
+nautilus_compact_file_list_append (NautilusCompactFileList *list,
+                                   GFile                   *file,
+                                   guint32                  value)
+{
+    g_autoptr (GFile) parent = g_file_get_parent (file);
+    g_autofree char *name = NULL;
+    Entry entry = { .value = value };
+
+    if (parent != NULL)
+    {
+        entry.parent = get_parent_index (list, parent);
+        name = g_file_get_basename (file);
+    }
+    else
+    {
+        entry.parent = NO_PARENT;
+        name = g_file_get_uri (file);
+    }
+
+    entry.name = g_string_chunk_insert (list->names, name);
+    g_array_append_val (list->entries, entry);
+}
+
+guint
+nautilus_compact_file_list_get_n_parents (NautilusCompactFileList *list)
+{
+    return list->parents->len;
+}
+
+guint
+nautilus_compact_file_list_get_length (NautilusCompactFileList *list)
+{
+    return list->entries->len;
+}
+
+GFile *
+nautilus_compact_file_list_get_file (NautilusCompactFileList *list,
+                                     guint                    index)
+{
+    Entry *entry;
+
+    g_return_val_if_fail (index < list->entries->len, NULL);
+
+    entry = &g_array_index (list->entries, Entry, index);
+    if (entry->parent == NO_PARENT)
+    {
+        return g_file_new_for_uri (entry->name);
+    }
+
+    return g_file_get_child (g_ptr_array_index (list->parents, entry->parent), entry->name);
+}
+
+guint32
+nautilus_compact_file_list_get_value (NautilusCompactFileList *list,
+                                      guint                    index)
+{
+    g_return_val_if_fail (index < list->entries->len, 0);
+
+    return g_array_index (list->entries, Entry, index).value;
+}
+
+GList *
+nautilus_compact_file_list_expand (NautilusCompactFileList *list)
+{
+    GList *files = NULL;
+
+    for (guint i = list->entries->len; i > 0; i--)
+    {
+        files = g_list_prepend (files, nautilus_compact_file_list_get_file (list, i - 1));
+    }
+
+    return files;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 The GNOME project contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+/* An append-only list of locations, each with a 32-bit value, for records
+ * which may cover every file of a large tree. Parent folders are stored once
+ * and basenames are packed together, so an entry costs a few bytes plus its
+ * name instead of a GFile. Locations are only created again when read. */
+typedef struct _NautilusCompactFileList NautilusCompactFileList;
+
+NautilusCompactFileList *nautilus_compact_file_list_new        (void);
+void                     nautilus_compact_file_list_free       (NautilusCompactFileList *list);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusCompactFileList, nautilus_compact_file_list_free)
+
+void                     nautilus_compact_file_list_append     (NautilusCompactFileList *list,
+                                                                GFile                   *file,
+                                                                guint32                  value);
+guint                    nautilus_compact_file_list_get_length (NautilusCompactFileList *list);
+GFile                   *nautilus_compact_file_list_get_file   (NautilusCompactFileList *list,
+                                                                guint                    index);
+guint32                  nautilus_compact_file_list_get_value  (NautilusCompactFileList *list,
+                                                                guint                    index);
+
+/* Returns a new list of new GFiles, in the order they were appended. */
+GList                   *nautilus_compact_file_list_expand     (NautilusCompactFileList *list);
+
+/* nautilus_compact_file_list_get_n_parents() is for testing purposes only */
+guint                    nautilus_compact_file_list_get_n_parents (NautilusCompactFileList *list);
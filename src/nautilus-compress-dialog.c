@@ -279,6 +279,11 @@ extension_dropdown_setup (NautilusCompressDialog *self)
                                        _("Smaller archives but Linux and Mac only."));
     g_list_store_append (store, item);
     g_object_unref (item);
+    item = nautilus_compress_item_new (NAUTILUS_COMPRESSION_TAR_ZSTD,
+                                       ".tar.zst",
+                                       _("Fast to create and extract but Linux and Mac only."));
+    g_list_store_append (store, item);
+    g_object_unref (item);
     item = nautilus_compress_item_new (NAUTILUS_COMPRESSION_7ZIP,
                                        ".7z",
                                        _("Smaller archives but must be installed on Windows and Mac."));
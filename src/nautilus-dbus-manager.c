@@ -30,6 +30,9 @@
 #include "nautilus-file-operations.h"
 #include "nautilus-file-undo-manager.h"
 #include "nautilus-file.h"
+#include "nautilus-progress-info.h"
+
+#define JOBS_OBJECT_PATH "/org/gnome/Nautilus" PROFILE "/FileOperations2/Jobs"
 
 struct _NautilusDBusManager
 {
@@ -37,15 +40,188 @@ struct _NautilusDBusManager
 
     NautilusDBusFileOperations *file_operations;
     NautilusDBusFileOperations2 *file_operations2;
+
+    GDBusConnection *connection;
+    GHashTable *jobs; /* NautilusProgressInfo -> DBusJob */
+    guint last_job_id;
 };
 
+/* An operation started through one of the Queue* methods, exported as an
+ * org.gnome.Nautilus.FileOperationJob object until it finishes. */
+typedef struct
+{
+    NautilusDBusManager *manager;
+    NautilusProgressInfo *info;
+    NautilusDBusFileOperationJob *skeleton;
+} DBusJob;
+
 G_DEFINE_TYPE (NautilusDBusManager, nautilus_dbus_manager, G_TYPE_OBJECT);
 
+static void
+dbus_job_free (DBusJob *job)
+{
+    g_signal_handlers_disconnect_by_data (job->info, job);
+    g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (job->skeleton));
+    g_object_unref (job->skeleton);
+    g_object_unref (job->info);
+    g_free (job);
+}
+
+static const char *
+dbus_job_get_state (DBusJob *job)
+{
+    if (nautilus_progress_info_get_is_cancelled (job->info))
+    {
+        return "cancelled";
+    }
+    else if (nautilus_progress_info_get_is_finished (job->info))
+    {
+        return "finished";
+    }
+    else if (nautilus_progress_info_get_is_held (job->info) ||
+             nautilus_progress_info_get_is_paused (job->info))
+    {
+        return "paused";
+    }
+    else if (nautilus_progress_info_get_is_queued (job->info))
+    {
+        return "queued";
+    }
+
+    return "running";
+}
+
+static void
+dbus_job_changed (DBusJob *job)
+{
+    g_autofree char *status = nautilus_progress_info_get_status (job->info);
+    g_autofree char *details = nautilus_progress_info_get_details (job->info);
+
+    nautilus_dbus_file_operation_job_set_state (job->skeleton, dbus_job_get_state (job));
+    nautilus_dbus_file_operation_job_set_status (job->skeleton, status != NULL ? status : "");
+    nautilus_dbus_file_operation_job_set_details (job->skeleton, details != NULL ? details : "");
+}
+
+static void
+dbus_job_progress_changed (DBusJob *job)
+{
+    double progress = nautilus_progress_info_get_progress (job->info);
+
+    nautilus_dbus_file_operation_job_set_progress (job->skeleton, progress);
+    nautilus_dbus_file_operation_job_emit_progress_changed (job->skeleton, progress);
+}
+
+static void
+dbus_job_finished (DBusJob *job)
+{
+    gboolean success = !nautilus_progress_info_get_is_cancelled (job->info) &&
+                       !nautilus_progress_info_get_is_incomplete (job->info);
+
+    dbus_job_changed (job);
+    nautilus_dbus_file_operation_job_emit_finished (job->skeleton, success);
+
+    /* Frees the job */
+    g_hash_table_remove (job->manager->jobs, job->info);
+}
+
+static gboolean
+handle_job_pause (NautilusDBusFileOperationJob *object,
+                  GDBusMethodInvocation        *invocation,
+                  DBusJob                      *job)
+{
+    nautilus_progress_info_hold (job->info);
+
+    nautilus_dbus_file_operation_job_complete_pause (object, invocation);
+    return TRUE; /* invocation was handled */
+}
+
+static gboolean
+handle_job_resume (NautilusDBusFileOperationJob *object,
+                   GDBusMethodInvocation        *invocation,
+                   DBusJob                      *job)
+{
+    nautilus_progress_info_release (job->info);
+
+    nautilus_dbus_file_operation_job_complete_resume (object, invocation);
+    return TRUE; /* invocation was handled */
+}
+
+static gboolean
+handle_job_cancel (NautilusDBusFileOperationJob *object,
+                   GDBusMethodInvocation        *invocation,
+                   DBusJob                      *job)
+{
+    nautilus_progress_info_cancel (job->info);
+
+    nautilus_dbus_file_operation_job_complete_cancel (object, invocation);
+    return TRUE; /* invocation was handled */
+}
+
+/* Exports the operation which was started with @dbus_data, and returns its
+ * object path, or "/" if there is none. */
+static char *
+export_job (NautilusDBusManager            *self,
+            NautilusFileOperationsDBusData *dbus_data)
+{
+    NautilusProgressInfo *info;
+    DBusJob *job;
+    g_autofree char *object_path = NULL;
+    g_autoptr (GError) error = NULL;
+
+    info = nautilus_file_operations_dbus_data_get_progress_info (dbus_data);
+    if (info == NULL || self->connection == NULL ||
+        nautilus_progress_info_get_is_finished (info))
+    {
+        return g_strdup ("/");
+    }
+
+    object_path = g_strdup_printf (JOBS_OBJECT_PATH "/%u", ++self->last_job_id);
+
+    job = g_new0 (DBusJob, 1);
+    job->manager = self;
+    job->info = g_object_ref (info);
+    job->skeleton = nautilus_dbus_file_operation_job_skeleton_new ();
+
+    if (!g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (job->skeleton),
+                                           self->connection,
+                                           object_path,
+                                           &error))
+    {
+        g_warning ("Could not export file operation job: %s", error->message);
+        g_object_unref (job->skeleton);
+        g_object_unref (job->info);
+        g_free (job);
+
+        return g_strdup ("/");
+    }
+
+    g_signal_connect (job->skeleton, "handle-pause", G_CALLBACK (handle_job_pause), job);
+    g_signal_connect (job->skeleton, "handle-resume", G_CALLBACK (handle_job_resume), job);
+    g_signal_connect (job->skeleton, "handle-cancel", G_CALLBACK (handle_job_cancel), job);
+
+    g_signal_connect_swapped (info, "changed", G_CALLBACK (dbus_job_changed), job);
+    g_signal_connect_swapped (info, "started", G_CALLBACK (dbus_job_changed), job);
+    g_signal_connect_swapped (info, "cancelled", G_CALLBACK (dbus_job_changed), job);
+    g_signal_connect_swapped (info, "progress-changed", G_CALLBACK (dbus_job_progress_changed), job);
+    g_signal_connect_swapped (info, "finished", G_CALLBACK (dbus_job_finished), job);
+
+    g_hash_table_insert (self->jobs, info, job);
+
+    dbus_job_changed (job);
+    nautilus_dbus_file_operation_job_set_progress (job->skeleton,
+                                                   nautilus_progress_info_get_progress (info));
+
+    return g_steal_pointer (&object_path);
+}
+
 static void
 nautilus_dbus_manager_dispose (GObject *object)
 {
     NautilusDBusManager *self = (NautilusDBusManager *) object;
 
+    g_clear_pointer (&self->jobs, g_hash_table_destroy);
+    g_clear_object (&self->connection);
+
     if (self->file_operations)
     {
         g_object_unref (self->file_operations);
@@ -454,6 +630,84 @@ handle_delete_uris2 (NautilusDBusFileOperations2  *object,
     return TRUE; /* invocation was handled */
 }
 
+static gboolean
+handle_queue_copy_uris2 (NautilusDBusFileOperations2  *object,
+                         GDBusMethodInvocation        *invocation,
+                         const gchar                 **sources,
+                         const gchar                  *destination,
+                         GVariant                     *platform_data,
+                         NautilusDBusManager          *self)
+{
+    g_autoptr (NautilusFileOperationsDBusData) dbus_data = NULL;
+    g_autofree char *job_path = NULL;
+
+    dbus_data = nautilus_file_operations_dbus_data_new (platform_data);
+
+    handle_copy_uris_internal (sources, destination, dbus_data);
+    job_path = export_job (self, dbus_data);
+
+    nautilus_dbus_file_operations2_complete_queue_copy_uris (object, invocation, job_path);
+    return TRUE; /* invocation was handled */
+}
+
+static gboolean
+handle_queue_move_uris2 (NautilusDBusFileOperations2  *object,
+                         GDBusMethodInvocation        *invocation,
+                         const gchar                 **sources,
+                         const gchar                  *destination,
+                         GVariant                     *platform_data,
+                         NautilusDBusManager          *self)
+{
+    g_autoptr (NautilusFileOperationsDBusData) dbus_data = NULL;
+    g_autofree char *job_path = NULL;
+
+    dbus_data = nautilus_file_operations_dbus_data_new (platform_data);
+
+    handle_move_uris_internal (sources, destination, dbus_data);
+    job_path = export_job (self, dbus_data);
+
+    nautilus_dbus_file_operations2_complete_queue_move_uris (object, invocation, job_path);
+    return TRUE; /* invocation was handled */
+}
+
+static gboolean
+handle_queue_trash_uris2 (NautilusDBusFileOperations2  *object,
+                          GDBusMethodInvocation        *invocation,
+                          const gchar                 **uris,
+                          GVariant                     *platform_data,
+                          NautilusDBusManager          *self)
+{
+    g_autoptr (NautilusFileOperationsDBusData) dbus_data = NULL;
+    g_autofree char *job_path = NULL;
+
+    dbus_data = nautilus_file_operations_dbus_data_new (platform_data);
+
+    handle_trash_uris_internal (uris, dbus_data);
+    job_path = export_job (self, dbus_data);
+
+    nautilus_dbus_file_operations2_complete_queue_trash_uris (object, invocation, job_path);
+    return TRUE; /* invocation was handled */
+}
+
+static gboolean
+handle_queue_delete_uris2 (NautilusDBusFileOperations2  *object,
+                           GDBusMethodInvocation        *invocation,
+                           const gchar                 **uris,
+                           GVariant                     *platform_data,
+                           NautilusDBusManager          *self)
+{
+    g_autoptr (NautilusFileOperationsDBusData) dbus_data = NULL;
+    g_autofree char *job_path = NULL;
+
+    dbus_data = nautilus_file_operations_dbus_data_new (platform_data);
+
+    handle_delete_uris_internal (uris, dbus_data);
+    job_path = export_job (self, dbus_data);
+
+    nautilus_dbus_file_operations2_complete_queue_delete_uris (object, invocation, job_path);
+    return TRUE; /* invocation was handled */
+}
+
 static void
 rename_file_on_finished (NautilusFile *file,
                          GFile        *result_location,
@@ -528,6 +782,7 @@ nautilus_dbus_manager_init (NautilusDBusManager *self)
     G_GNUC_END_IGNORE_DEPRECATIONS
 
     self->file_operations2 = nautilus_dbus_file_operations2_skeleton_new ();
+    self->jobs = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) dbus_job_free);
 
     g_signal_connect (self->file_operations,
                       "handle-copy-uris",
@@ -565,6 +820,22 @@ nautilus_dbus_manager_init (NautilusDBusManager *self)
                       "handle-delete-uris",
                       G_CALLBACK (handle_delete_uris2),
                       self);
+    g_signal_connect (self->file_operations2,
+                      "handle-queue-copy-uris",
+                      G_CALLBACK (handle_queue_copy_uris2),
+                      self);
+    g_signal_connect (self->file_operations2,
+                      "handle-queue-move-uris",
+                      G_CALLBACK (handle_queue_move_uris2),
+                      self);
+    g_signal_connect (self->file_operations2,
+                      "handle-queue-trash-uris",
+                      G_CALLBACK (handle_queue_trash_uris2),
+                      self);
+    g_signal_connect (self->file_operations2,
+                      "handle-queue-delete-uris",
+                      G_CALLBACK (handle_queue_delete_uris2),
+                      self);
     g_signal_connect (self->file_operations,
                       "handle-create-folder",
                       G_CALLBACK (handle_create_folder),
@@ -636,6 +907,8 @@ nautilus_dbus_manager_register (NautilusDBusManager  *self,
 
     if (succes)
     {
+        g_set_object (&self->connection, connection);
+
         g_signal_connect_object (nautilus_file_undo_manager_get (),
                                  "undo-changed",
                                  G_CALLBACK (undo_manager_changed),
@@ -654,5 +927,11 @@ nautilus_dbus_manager_unregister (NautilusDBusManager *self)
     g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (self->file_operations));
     g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (self->file_operations2));
 
+    if (self->jobs != NULL)
+    {
+        g_hash_table_remove_all (self->jobs);
+    }
+    g_clear_object (&self->connection);
+
     g_signal_handlers_disconnect_by_data (nautilus_file_undo_manager_get (), self);
 }
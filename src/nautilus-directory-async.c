@@ -20,6 +20,8 @@
  */
 #define G_LOG_DOMAIN "nautilus-async-jobs"
 
+#include <config.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -33,15 +35,40 @@
 #include "nautilus-metadata.h"
 #include "nautilus-signaller.h"
 
-/* turn this on to check if async. job calls are balanced */
-#if 0
-#define DEBUG_ASYNC_JOBS
-#endif
+/* DEBUG_ASYNC_JOBS checks that async. job calls are balanced. It is set by
+ * the debug_async_jobs build option, and never in production builds. */
 
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 
+/* How many files are handed to an info provider at once. */
+#define EXTENSION_INFO_BATCH_SIZE 64
+
 /* Keep async. jobs down to this number for all directories. */
-#define MAX_ASYNC_JOBS 10
+#define MAX_ASYNC_JOBS 16
+
+/* Each backend (local files, or one remote host of a given scheme) has its
+ * own budget within MAX_ASYNC_JOBS, so that a slow mount can't keep local
+ * folders waiting. */
+#define MAX_LOCAL_ASYNC_JOBS 10
+#define MAX_REMOTE_ASYNC_JOBS 4
+
+/* Directories that are shown in a view are woken up before the ones that
+ * are only loaded in the background, but after this many wake-ups in a row
+ * a waiting background directory gets its turn. */
+#define MAX_FOREGROUND_WAKE_UPS_IN_A_ROW 4
+
+/* How many fetches of each kind may be in flight for the files of a single
+ * directory at the same time, or for extension info, how many batches. They
+ * all count towards MAX_ASYNC_JOBS too. Deep counts run one at a time. */
+static guint max_jobs_per_directory[REQUEST_TYPE_LAST] =
+{
+    [REQUEST_EXTENSION_INFO] = 4,
+    [REQUEST_FILE_INFO] = 4,
+    [REQUEST_DIRECTORY_COUNT] = 4,
+    [REQUEST_THUMBNAIL] = 2,
+    [REQUEST_MOUNT] = 2,
+    [REQUEST_FILESYSTEM_INFO] = 2,
+};
 
 struct ThumbnailState
 {
@@ -77,6 +104,7 @@ struct GetInfoState
 {
     NautilusDirectory *directory;
     GCancellable *cancellable;
+    NautilusFile *file;
 };
 
 struct NewFilesState
@@ -119,34 +147,69 @@ typedef struct
     gpointer callback_data;
     Request request;
     gboolean active;     /* Set to FALSE when the callback is triggered and
-                          * scheduled to be called at idle, its still kept
-                          * in the list so we can kill it when the file
-                          * goes away.
+                          * scheduled to be called at idle, it's then moved
+                          * to the fired queue so we can still kill it when
+                          * the file goes away.
                           */
 } ReadyCallback;
 
+/* Per-file bookkeeping of call when ready callbacks, so that the scheduler
+ * can tell whether a file is wanted without walking all the callbacks. The
+ * NULL file stands for the callbacks waiting for all the files.
+ */
+typedef struct
+{
+    guint n_callbacks;     /* Both active and fired ones. */
+    RequestCounter active_counters;
+    GQueue active_callbacks;     /* ReadyCallback */
+} ReadyCallbackCounts;
+
 typedef struct
 {
     NautilusFile *file;     /* Which file, NULL means all. */
     gboolean monitor_hidden_files;     /* defines whether "all" includes hidden files */
     gconstpointer client;
     Request request;
+    gboolean background;     /* only keeps the directory loaded, not displayed */
 } Monitor;
 
-typedef struct
+struct ExtensionInfoBatch
 {
     NautilusDirectory *directory;
     NautilusInfoProvider *provider;
-    NautilusOperationHandle *handle;
-    NautilusOperationResult result;
-} InfoProviderResponse;
+    GCancellable *cancellable;
+    GHashTable *files;     /* Files not done yet. */
+    gboolean dispatched;
+    gboolean dispatching;     /* The provider is being called. */
+    gboolean released;
+};
 
 typedef gboolean (*RequestCheck) (Request);
 typedef gboolean (*FileCheck) (NautilusFile *);
 
+struct AsyncJobBackend
+{
+    int job_count;
+    int max_jobs;
+};
+
+typedef struct
+{
+    NautilusDirectory *directory;
+    GQueue *queue;
+    GList *link;
+    gint64 since;
+} WaitingDirectory;
+
 /* Current number of async. jobs. */
 static int async_job_count;
+static GHashTable *async_job_backends;
+/* Directories waiting for a free job slot, NautilusDirectory -> WaitingDirectory. */
 static GHashTable *waiting_directories;
+static GQueue foreground_waiting_queue = G_QUEUE_INIT;
+static GQueue background_waiting_queue = G_QUEUE_INIT;
+static guint foreground_wake_ups_in_a_row;
+static NautilusAsyncJobStatistics async_job_statistics;
 #ifdef DEBUG_ASYNC_JOBS
 static GHashTable *async_jobs;
 #endif
@@ -160,12 +223,17 @@ static gboolean request_is_satisfied (NautilusDirectory *directory,
 static void     cancel_loading_attributes (NautilusDirectory     *directory,
                                            NautilusFileAttributes file_attributes);
 static void     add_all_files_to_work_queue (NautilusDirectory *directory);
+static void     extension_info_batch_cancel (NautilusDirectory  *directory,
+                                             ExtensionInfoBatch *batch);
 static void     move_file_to_low_priority_queue (NautilusDirectory *directory,
                                                  NautilusFile      *file);
 static void     move_file_to_extension_queue (NautilusDirectory *directory,
                                               NautilusFile      *file);
 static void     nautilus_directory_invalidate_file_attributes (NautilusDirectory     *directory,
                                                                NautilusFileAttributes file_attributes);
+static void     async_state_changed (NautilusDirectory *directory);
+static void     async_state_changed_for_file (NautilusDirectory *directory,
+                                              NautilusFile      *file);
 
 static void
 request_counter_add_request (RequestCounter counter,
@@ -240,6 +308,11 @@ nautilus_directory_verify_request_counts (NautilusDirectory *directory)
         ReadyCallback *callback = l->data;
         request_counter_add_request (counters, callback->request);
     }
+    for (l = directory->details->call_when_ready_fired.head; l != NULL; l = l->next)
+    {
+        ReadyCallback *callback = l->data;
+        request_counter_add_request (counters, callback->request);
+    }
     for (i = 0; i < REQUEST_TYPE_LAST; i++)
     {
         if (counters[i] != directory->details->call_when_ready_counters[i])
@@ -253,6 +326,136 @@ nautilus_directory_verify_request_counts (NautilusDirectory *directory)
 }
 #endif
 
+static AsyncJobBackend *
+get_async_job_backend (NautilusDirectory *directory)
+{
+    g_autofree char *key = NULL;
+    AsyncJobBackend *backend;
+
+    if (directory->details->async_job_backend != NULL)
+    {
+        return directory->details->async_job_backend;
+    }
+
+    if (g_file_is_native (directory->details->location))
+    {
+        key = g_strdup ("local");
+    }
+    else
+    {
+        g_autofree char *uri = NULL;
+        g_autofree char *scheme = NULL;
+        g_autofree char *host = NULL;
+
+        uri = nautilus_directory_get_uri (directory);
+        g_uri_split (uri, G_URI_FLAGS_NONE, &scheme, NULL, &host, NULL, NULL, NULL, NULL, NULL);
+        key = g_strdup_printf ("%s://%s", scheme != NULL ? scheme : "", host != NULL ? host : "");
+    }
+
+    if (async_job_backends == NULL)
+    {
+        async_job_backends = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    }
+
+    backend = g_hash_table_lookup (async_job_backends, key);
+    if (backend == NULL)
+    {
+        backend = g_new0 (AsyncJobBackend, 1);
+        backend->max_jobs = g_file_is_native (directory->details->location) ?
+                            MAX_LOCAL_ASYNC_JOBS : MAX_REMOTE_ASYNC_JOBS;
+        g_hash_table_insert (async_job_backends, g_steal_pointer (&key), backend);
+    }
+
+    directory->details->async_job_backend = backend;
+
+    return backend;
+}
+
+static gboolean
+async_job_slot_available (AsyncJobBackend *backend)
+{
+    return async_job_count < MAX_ASYNC_JOBS && backend->job_count < backend->max_jobs;
+}
+
+/* Directories with monitors are the ones displayed by a view, unless their
+ * only monitors keep them loaded in the background. Those are always of all
+ * the files. */
+static gboolean
+is_displayed (NautilusDirectory *directory)
+{
+    GList *all_files_monitors;
+    guint n_monitored;
+
+    all_files_monitors = g_hash_table_lookup (directory->details->monitor_table, NULL);
+    n_monitored = g_hash_table_size (directory->details->monitor_table);
+
+    if (all_files_monitors == NULL)
+    {
+        return n_monitored > 0;
+    }
+
+    return n_monitored > 1 ||
+           g_list_length (all_files_monitors) > directory->details->n_background_monitors;
+}
+
+static void
+async_job_wait (NautilusDirectory *directory)
+{
+    WaitingDirectory *waiting;
+
+    if (waiting_directories == NULL)
+    {
+        waiting_directories = g_hash_table_new (NULL, NULL);
+    }
+    else if (g_hash_table_contains (waiting_directories, directory))
+    {
+        return;
+    }
+
+    waiting = g_new0 (WaitingDirectory, 1);
+    waiting->directory = directory;
+    waiting->since = g_get_monotonic_time ();
+    waiting->queue = is_displayed (directory) ?
+                     &foreground_waiting_queue : &background_waiting_queue;
+    g_queue_push_tail (waiting->queue, waiting);
+    waiting->link = waiting->queue->tail;
+
+    g_hash_table_insert (waiting_directories, directory, waiting);
+
+    async_job_statistics.waiting = g_hash_table_size (waiting_directories);
+    async_job_statistics.max_waiting = MAX (async_job_statistics.max_waiting,
+                                            async_job_statistics.waiting);
+}
+
+static void
+async_job_stop_waiting (NautilusDirectory *directory)
+{
+    WaitingDirectory *waiting;
+    gint64 wait_time;
+
+    if (waiting_directories == NULL)
+    {
+        return;
+    }
+
+    waiting = g_hash_table_lookup (waiting_directories, directory);
+    if (waiting == NULL)
+    {
+        return;
+    }
+
+    g_hash_table_remove (waiting_directories, directory);
+    g_queue_delete_link (waiting->queue, waiting->link);
+
+    wait_time = g_get_monotonic_time () - waiting->since;
+    async_job_statistics.waiting = g_hash_table_size (waiting_directories);
+    async_job_statistics.n_waits += 1;
+    async_job_statistics.total_wait_time += wait_time;
+    async_job_statistics.max_wait_time = MAX (async_job_statistics.max_wait_time, wait_time);
+
+    g_free (waiting);
+}
+
 /* Start a job. This is really just a way of limiting the number of
  * async. requests that we issue at any given time. Without this, the
  * number of requests is unbounded.
@@ -261,8 +464,10 @@ static gboolean
 async_job_start (NautilusDirectory *directory,
                  const char        *job)
 {
+    AsyncJobBackend *backend;
 #ifdef DEBUG_ASYNC_JOBS
     char *key;
+    gpointer table_key, value;
 #endif
 
     g_debug ("starting %s in %p", job, directory->details->location);
@@ -270,17 +475,10 @@ async_job_start (NautilusDirectory *directory,
     g_assert (async_job_count >= 0);
     g_assert (async_job_count <= MAX_ASYNC_JOBS);
 
-    if (async_job_count >= MAX_ASYNC_JOBS)
+    backend = get_async_job_backend (directory);
+    if (!async_job_slot_available (backend))
     {
-        if (waiting_directories == NULL)
-        {
-            waiting_directories = g_hash_table_new (NULL, NULL);
-        }
-
-        g_hash_table_insert (waiting_directories,
-                             directory,
-                             directory);
-
+        async_job_wait (directory);
         return FALSE;
     }
 
@@ -293,17 +491,24 @@ async_job_start (NautilusDirectory *directory,
         }
         uri = nautilus_directory_get_uri (directory);
         key = g_strconcat (uri, ": ", job, NULL);
-        if (g_hash_table_lookup (async_jobs, key) != NULL)
+        /* Several jobs of a kind can run for one directory, count them. */
+        if (g_hash_table_lookup_extended (async_jobs, key, &table_key, &value))
         {
-            g_warning ("same job twice: %s in %s",
-                       job, uri);
+            g_hash_table_insert (async_jobs, table_key, GINT_TO_POINTER (GPOINTER_TO_INT (value) + 1));
+            g_free (key);
+        }
+        else
+        {
+            g_hash_table_insert (async_jobs, key, GINT_TO_POINTER (1));
         }
         g_free (uri);
-        g_hash_table_insert (async_jobs, key, directory);
     }
 #endif
 
     async_job_count += 1;
+    backend->job_count += 1;
+    async_job_statistics.running = async_job_count;
+    async_job_statistics.max_running = MAX (async_job_statistics.max_running, async_job_count);
     return TRUE;
 }
 
@@ -312,6 +517,7 @@ static void
 async_job_end (NautilusDirectory *directory,
                const char        *job)
 {
+    AsyncJobBackend *backend;
 #ifdef DEBUG_ASYNC_JOBS
     char *key;
     gpointer table_key, value;
@@ -319,7 +525,10 @@ async_job_end (NautilusDirectory *directory,
 
     g_debug ("stopping %s in %p", job, directory->details->location);
 
+    backend = get_async_job_backend (directory);
+
     g_assert (async_job_count > 0);
+    g_assert (backend->job_count > 0);
 
 #ifdef DEBUG_ASYNC_JOBS
     {
@@ -332,6 +541,10 @@ async_job_end (NautilusDirectory *directory,
             g_warning ("ending job we didn't start: %s in %s",
                        job, uri);
         }
+        else if (GPOINTER_TO_INT (value) > 1)
+        {
+            g_hash_table_insert (async_jobs, table_key, GINT_TO_POINTER (GPOINTER_TO_INT (value) - 1));
+        }
         else
         {
             g_hash_table_remove (async_jobs, key);
@@ -343,32 +556,52 @@ async_job_end (NautilusDirectory *directory,
 #endif
 
     async_job_count -= 1;
+    backend->job_count -= 1;
+    async_job_statistics.running = async_job_count;
 }
 
-/* Helper to get one value from a hash table. */
-static void
-get_one_value_callback (gpointer key,
-                        gpointer value,
-                        gpointer callback_data)
+/* Return the directory that has been waiting the longest in the queue and
+ * whose backend has a free slot. */
+static WaitingDirectory *
+find_waiting_directory (GQueue *queue)
 {
-    gpointer *returned_value;
+    for (GList *l = queue->head; l != NULL; l = l->next)
+    {
+        WaitingDirectory *waiting = l->data;
 
-    returned_value = callback_data;
-    *returned_value = value;
+        if (async_job_slot_available (get_async_job_backend (waiting->directory)))
+        {
+            return waiting;
+        }
+    }
+
+    return NULL;
 }
 
-/* return a single value from a hash table. */
-static gpointer
-get_one_value (GHashTable *table)
+static NautilusDirectory *
+next_waiting_directory (void)
 {
-    gpointer value;
+    WaitingDirectory *waiting = NULL;
+
+    if (foreground_wake_ups_in_a_row < MAX_FOREGROUND_WAKE_UPS_IN_A_ROW)
+    {
+        waiting = find_waiting_directory (&foreground_waiting_queue);
+    }
+
+    if (waiting != NULL)
+    {
+        foreground_wake_ups_in_a_row += 1;
+        return waiting->directory;
+    }
 
-    value = NULL;
-    if (table != NULL)
+    foreground_wake_ups_in_a_row = 0;
+    waiting = find_waiting_directory (&background_waiting_queue);
+    if (waiting == NULL)
     {
-        g_hash_table_foreach (table, get_one_value_callback, &value);
+        waiting = find_waiting_directory (&foreground_waiting_queue);
     }
-    return value;
+
+    return waiting != NULL ? waiting->directory : NULL;
 }
 
 /* Wake up directories that are "blocked" as long as there are job
@@ -378,7 +611,7 @@ static void
 async_job_wake_up (void)
 {
     static gboolean already_waking_up = FALSE;
-    gpointer value;
+    NautilusDirectory *directory;
 
     g_assert (async_job_count >= 0);
     g_assert (async_job_count <= MAX_ASYNC_JOBS);
@@ -391,25 +624,52 @@ async_job_wake_up (void)
     already_waking_up = TRUE;
     while (async_job_count < MAX_ASYNC_JOBS)
     {
-        value = get_one_value (waiting_directories);
-        if (value == NULL)
+        directory = next_waiting_directory ();
+        if (directory == NULL)
         {
             break;
         }
-        g_hash_table_remove (waiting_directories, value);
-        nautilus_directory_async_state_changed
-            (NAUTILUS_DIRECTORY (value));
+        async_job_stop_waiting (directory);
+        async_state_changed (directory);
     }
     already_waking_up = FALSE;
 }
 
+void
+nautilus_directory_get_async_job_statistics (NautilusAsyncJobStatistics *statistics)
+{
+    g_return_if_fail (statistics != NULL);
+
+    *statistics = async_job_statistics;
+}
+
+void
+nautilus_directory_set_max_jobs_per_directory (RequestType type,
+                                               guint       max_jobs)
+{
+    g_return_if_fail (type < REQUEST_TYPE_LAST);
+    g_return_if_fail (max_jobs > 0);
+
+    max_jobs_per_directory[type] = max_jobs;
+}
+
+static void
+directory_count_cancel_one (NautilusDirectory   *directory,
+                            DirectoryCountState *state)
+{
+    /* The callback notices, ends the job and frees the state. */
+    g_cancellable_cancel (state->cancellable);
+    g_hash_table_remove (directory->details->count_in_progress, state->count_file);
+}
+
 static void
 directory_count_cancel (NautilusDirectory *directory)
 {
-    if (directory->details->count_in_progress != NULL)
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->count_in_progress);
+
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        g_cancellable_cancel (directory->details->count_in_progress->cancellable);
-        directory->details->count_in_progress = NULL;
+        directory_count_cancel_one (directory, l->data);
     }
 }
 
@@ -432,41 +692,102 @@ deep_count_cancel (NautilusDirectory *directory)
     }
 }
 
+static void
+thumbnail_cancel_one (NautilusDirectory *directory,
+                      ThumbnailState    *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    g_hash_table_remove (directory->details->thumbnail_in_progress, state->file);
+    state->directory = NULL;
+    async_job_end (directory, "thumbnail");
+}
+
 static void
 thumbnail_cancel (NautilusDirectory *directory)
 {
-    if (directory->details->thumbnail_state != NULL)
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->thumbnail_in_progress);
+
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        g_cancellable_cancel (directory->details->thumbnail_state->cancellable);
-        directory->details->thumbnail_state->directory = NULL;
-        directory->details->thumbnail_state = NULL;
-        async_job_end (directory, "thumbnail");
+        thumbnail_cancel_one (directory, l->data);
     }
 }
 
+static void
+mount_cancel_one (NautilusDirectory *directory,
+                  MountState        *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    g_hash_table_remove (directory->details->mount_in_progress, state->file);
+    state->directory = NULL;
+    async_job_end (directory, "mount");
+}
+
 static void
 mount_cancel (NautilusDirectory *directory)
 {
-    if (directory->details->mount_state != NULL)
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->mount_in_progress);
+
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        g_cancellable_cancel (directory->details->mount_state->cancellable);
-        directory->details->mount_state->directory = NULL;
-        directory->details->mount_state = NULL;
-        async_job_end (directory, "mount");
+        mount_cancel_one (directory, l->data);
     }
 }
 
+static void
+file_info_cancel_one (NautilusDirectory *directory,
+                      GetInfoState      *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    g_hash_table_remove (directory->details->get_info_in_progress, state->file);
+    state->directory = NULL;
+    async_job_end (directory, "file info");
+}
+
 static void
 file_info_cancel (NautilusDirectory *directory)
 {
-    if (directory->details->get_info_in_progress != NULL)
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->get_info_in_progress);
+
+    for (GList *l = states; l != NULL; l = l->next)
+    {
+        file_info_cancel_one (directory, l->data);
+    }
+}
+
+static void
+filesystem_info_cancel_one (NautilusDirectory   *directory,
+                            FilesystemInfoState *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    g_hash_table_remove (directory->details->filesystem_info_in_progress, state->file);
+    state->directory = NULL;
+    async_job_end (directory, "filesystem info");
+}
+
+static void
+filesystem_info_cancel (NautilusDirectory *directory)
+{
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->filesystem_info_in_progress);
+
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        g_cancellable_cancel (directory->details->get_info_in_progress->cancellable);
-        directory->details->get_info_in_progress->directory = NULL;
-        directory->details->get_info_in_progress = NULL;
-        directory->details->get_info_file = NULL;
+        filesystem_info_cancel_one (directory, l->data);
+    }
+}
 
-        async_job_end (directory, "file info");
+/* Files whose fetches are all in flight are taken off the work queues, so
+ * that the files behind them can be worked on meanwhile. Once a fetch is done
+ * or stopped, put the file back to have the rest of its attributes looked at.
+ */
+static void
+requeue_file (NautilusDirectory *directory,
+              NautilusFile      *file,
+              NautilusFileQueue *queue)
+{
+    if (file->details->directory == directory && !file->details->is_gone)
+    {
+        nautilus_file_queue_enqueue (queue, file);
     }
 }
 
@@ -619,6 +940,10 @@ remove_monitor (NautilusDirectory *directory,
     {
         request_counter_remove_request (directory->details->monitor_counters,
                                         monitor->request);
+        if (monitor->background)
+        {
+            directory->details->n_background_monitors--;
+        }
         g_free (monitor);
     }
 }
@@ -716,6 +1041,7 @@ nautilus_directory_monitor_add_internal (NautilusDirectory         *directory,
     monitor->monitor_hidden_files = monitor_hidden_files;
     monitor->client = client;
     monitor->request = nautilus_directory_set_up_request (file_attributes);
+    monitor->background = FALSE;
 
     if (file == NULL)
     {
@@ -762,7 +1088,7 @@ nautilus_directory_monitor_add_internal (NautilusDirectory         *directory,
     }
 
     /* Kick off I/O. */
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed (directory);
 }
 
 static void
@@ -1115,6 +1441,23 @@ directory_load_done (NautilusDirectory *directory,
     g_object_unref (directory);
 }
 
+/* Marks the monitor of all the files by @client as not displaying the
+ * directory, so that it doesn't put its jobs ahead of those of other
+ * directories. */
+void
+nautilus_directory_monitor_set_background (NautilusDirectory *directory,
+                                           gconstpointer      client)
+{
+    Monitor *monitor;
+
+    monitor = find_monitor (directory, NULL, client);
+    if (monitor != NULL && !monitor->background)
+    {
+        monitor->background = TRUE;
+        directory->details->n_background_monitors++;
+    }
+}
+
 void
 nautilus_directory_monitor_remove_internal (NautilusDirectory *directory,
                                             NautilusFile      *file,
@@ -1135,7 +1478,7 @@ nautilus_directory_monitor_remove_internal (NautilusDirectory *directory,
 
     /* XXX - do we need to remove anything from the work queue? */
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed (directory);
 }
 
 FileMonitors *
@@ -1166,7 +1509,7 @@ nautilus_directory_remove_file_monitors (NautilusDirectory *directory,
 
     /* XXX - do we need to remove anything from the work queue? */
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed (directory);
 
     return (FileMonitors *) result;
 }
@@ -1200,7 +1543,36 @@ nautilus_directory_add_file_monitors (NautilusDirectory *directory,
 
     nautilus_directory_add_file_to_work_queue (directory, file);
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed (directory);
+}
+
+static ReadyCallbackCounts *
+get_ready_callback_counts (NautilusDirectory *directory,
+                           NautilusFile      *file,
+                           gboolean           create)
+{
+    ReadyCallbackCounts *counts;
+
+    counts = g_hash_table_lookup (directory->details->call_when_ready_counts, file);
+    if (counts == NULL && create)
+    {
+        counts = g_new0 (ReadyCallbackCounts, 1);
+        g_hash_table_insert (directory->details->call_when_ready_counts, file, counts);
+    }
+
+    return counts;
+}
+
+static void
+release_ready_callback_counts (NautilusDirectory   *directory,
+                               NautilusFile        *file,
+                               ReadyCallbackCounts *counts)
+{
+    counts->n_callbacks -= 1;
+    if (counts->n_callbacks == 0)
+    {
+        g_hash_table_remove (directory->details->call_when_ready_counts, file);
+    }
 }
 
 static int
@@ -1259,21 +1631,118 @@ ready_callback_key_compare (gconstpointer a,
     return 0;
 }
 
-static int
-ready_callback_key_compare_only_active (gconstpointer a,
-                                        gconstpointer b)
+static guint
+ready_callback_key_hash (gconstpointer key)
 {
-    const ReadyCallback *callback_a;
+    const ReadyCallback *callback = key;
 
-    callback_a = a;
+    /* Both union members have the same size, whichever is set. */
+    return g_direct_hash (callback->file) ^
+           g_direct_hash ((gpointer) callback->callback.file) ^
+           g_direct_hash (callback->callback_data);
+}
+
+static gboolean
+ready_callback_key_equal (gconstpointer a,
+                          gconstpointer b)
+{
+    return ready_callback_key_compare (a, b) == 0;
+}
+
+static void
+add_callback (NautilusDirectory *directory,
+              ReadyCallback     *callback)
+{
+    ReadyCallbackCounts *counts;
 
-    /* Non active callbacks never match */
-    if (!callback_a->active)
+    if (directory->details->call_when_ready_index == NULL)
     {
-        return -1;
+        directory->details->call_when_ready_index = g_hash_table_new (ready_callback_key_hash,
+                                                                      ready_callback_key_equal);
+    }
+
+    directory->details->call_when_ready_list = g_list_prepend
+                                                   (directory->details->call_when_ready_list,
+                                                   callback);
+    g_hash_table_insert (directory->details->call_when_ready_index,
+                         callback,
+                         directory->details->call_when_ready_list);
+
+    request_counter_add_request (directory->details->call_when_ready_counters,
+                                 callback->request);
+
+    counts = get_ready_callback_counts (directory, callback->file, TRUE);
+    counts->n_callbacks += 1;
+    request_counter_add_request (counts->active_counters, callback->request);
+    g_queue_push_tail (&counts->active_callbacks, callback);
+
+    /* It may be satisfied already. */
+    g_hash_table_add (directory->details->call_when_ready_changed_files, callback->file);
+}
+
+/* Mark a callback as triggered and move it to the queue of the ones to
+ * be called at idle.
+ */
+static void
+fire_callback (NautilusDirectory *directory,
+               GList             *link)
+{
+    ReadyCallback *callback;
+    ReadyCallbackCounts *counts;
+
+    callback = link->data;
+    g_assert (callback->active);
+
+    g_hash_table_remove (directory->details->call_when_ready_index, callback);
+    directory->details->call_when_ready_list = g_list_remove_link
+                                                   (directory->details->call_when_ready_list, link);
+
+    callback->active = FALSE;
+    counts = get_ready_callback_counts (directory, callback->file, FALSE);
+    request_counter_remove_request (counts->active_counters, callback->request);
+    g_queue_remove (&counts->active_callbacks, callback);
+
+    g_queue_push_tail_link (&directory->details->call_when_ready_fired, link);
+}
+
+static void
+remove_callback_link_keep_data (NautilusDirectory *directory,
+                                GList             *link)
+{
+    ReadyCallback *callback;
+    ReadyCallbackCounts *counts;
+
+    callback = link->data;
+    counts = get_ready_callback_counts (directory, callback->file, FALSE);
+
+    if (callback->active)
+    {
+        g_hash_table_remove (directory->details->call_when_ready_index, callback);
+        directory->details->call_when_ready_list = g_list_remove_link
+                                                       (directory->details->call_when_ready_list, link);
+        request_counter_remove_request (counts->active_counters, callback->request);
+        g_queue_remove (&counts->active_callbacks, callback);
     }
+    else
+    {
+        g_queue_unlink (&directory->details->call_when_ready_fired, link);
+    }
+
+    request_counter_remove_request (directory->details->call_when_ready_counters,
+                                    callback->request);
+    release_ready_callback_counts (directory, callback->file, counts);
+    g_list_free_1 (link);
+}
+
+static void
+remove_callback_link (NautilusDirectory *directory,
+                      GList             *link)
+{
+    ReadyCallback *callback;
 
-    return ready_callback_key_compare (a, b);
+    callback = link->data;
+    remove_callback_link_keep_data (directory, link);
+    g_free (callback);
 }
 
 static void
@@ -1353,9 +1822,8 @@ nautilus_directory_call_when_ready_internal (NautilusDirectory         *director
     }
 
     /* Check if the callback is already there. */
-    if (g_list_find_custom (directory->details->call_when_ready_list,
-                            &callback,
-                            ready_callback_key_compare_only_active) != NULL)
+    if (directory->details->call_when_ready_index != NULL &&
+        g_hash_table_contains (directory->details->call_when_ready_index, &callback))
     {
         if (file_callback != NULL && directory_callback != NULL)
         {
@@ -1366,11 +1834,7 @@ nautilus_directory_call_when_ready_internal (NautilusDirectory         *director
     }
 
     /* Add the new callback to the list. */
-    directory->details->call_when_ready_list = g_list_prepend
-                                                   (directory->details->call_when_ready_list,
-                                                   g_memdup2 (&callback, sizeof (callback)));
-    request_counter_add_request (directory->details->call_when_ready_counters,
-                                 callback.request);
+    add_callback (directory, g_memdup2 (&callback, sizeof (callback)));
 
     /* Put the callback file or all the files on the work queue. */
     if (file != NULL)
@@ -1382,7 +1846,7 @@ nautilus_directory_call_when_ready_internal (NautilusDirectory         *director
         add_all_files_to_work_queue (directory);
     }
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed (directory);
 }
 
 gboolean
@@ -1398,33 +1862,6 @@ nautilus_directory_check_if_ready_internal (NautilusDirectory      *directory,
     return request_is_satisfied (directory, file, request);
 }
 
-static void
-remove_callback_link_keep_data (NautilusDirectory *directory,
-                                GList             *link)
-{
-    ReadyCallback *callback;
-
-    callback = link->data;
-
-    directory->details->call_when_ready_list = g_list_remove_link
-                                                   (directory->details->call_when_ready_list, link);
-
-    request_counter_remove_request (directory->details->call_when_ready_counters,
-                                    callback->request);
-    g_list_free_1 (link);
-}
-
-static void
-remove_callback_link (NautilusDirectory *directory,
-                      GList             *link)
-{
-    ReadyCallback *callback;
-
-    callback = link->data;
-    remove_callback_link_keep_data (directory, link);
-    g_free (callback);
-}
-
 void
 nautilus_directory_cancel_callback_internal (NautilusDirectory         *directory,
                                              NautilusFile              *file,
@@ -1433,7 +1870,7 @@ nautilus_directory_cancel_callback_internal (NautilusDirectory         *director
                                              gpointer                   callback_data)
 {
     ReadyCallback callback;
-    GList *node;
+    GList *node, *next;
 
     if (directory == NULL)
     {
@@ -1458,19 +1895,29 @@ nautilus_directory_cancel_callback_internal (NautilusDirectory         *director
     callback.callback_data = callback_data;
 
     /* Remove all queued callback from the list (including non-active). */
-    do
+    node = NULL;
+    if (directory->details->call_when_ready_index != NULL)
+    {
+        node = g_hash_table_lookup (directory->details->call_when_ready_index, &callback);
+    }
+    if (node != NULL)
     {
-        node = g_list_find_custom (directory->details->call_when_ready_list,
-                                   &callback,
-                                   ready_callback_key_compare);
-        if (node != NULL)
+        remove_callback_link (directory, node);
+
+        async_state_changed (directory);
+    }
+
+    /* The fired ones are only around until the next idle, so there are few. */
+    for (node = directory->details->call_when_ready_fired.head; node != NULL; node = next)
+    {
+        next = node->next;
+        if (ready_callback_key_compare (node->data, &callback) == 0)
         {
             remove_callback_link (directory, node);
 
-            nautilus_directory_async_state_changed (directory);
+            async_state_changed (directory);
         }
     }
-    while (node != NULL);
 }
 
 static void
@@ -1570,25 +2017,45 @@ nautilus_async_destroying_file (NautilusFile *file)
     GList *node, *next;
     ReadyCallback *callback;
     Monitor *monitor;
+    DirectoryCountState *count_state;
+    GetInfoState *get_info_state;
+    ThumbnailState *thumbnail_state;
+    MountState *mount_state;
+    FilesystemInfoState *filesystem_info_state;
+    ExtensionInfoBatch *extension_info_batch;
 
     directory = file->details->directory;
     changed = FALSE;
 
+    g_hash_table_remove (directory->details->call_when_ready_changed_files, file);
+
     /* Check for callbacks. */
-    for (node = directory->details->call_when_ready_list; node != NULL; node = next)
+    if (get_ready_callback_counts (directory, file, FALSE) != NULL)
     {
-        next = node->next;
-        callback = node->data;
+        GList *lists[] =
+        {
+            directory->details->call_when_ready_list,
+            directory->details->call_when_ready_fired.head
+        };
 
-        if (callback->file == file)
+        for (guint i = 0; i < G_N_ELEMENTS (lists); i++)
         {
-            /* Client should have cancelled callback. */
-            if (callback->active)
+            for (node = lists[i]; node != NULL; node = next)
             {
-                g_warning ("destroyed file has call_when_ready pending");
+                next = node->next;
+                callback = node->data;
+
+                if (callback->file == file)
+                {
+                    /* Client should have cancelled callback. */
+                    if (callback->active)
+                    {
+                        g_warning ("destroyed file has call_when_ready pending");
+                    }
+                    remove_callback_link (directory, node);
+                    changed = TRUE;
+                }
             }
-            remove_callback_link (directory, node);
-            changed = TRUE;
         }
     }
 
@@ -1609,12 +2076,12 @@ nautilus_async_destroying_file (NautilusFile *file)
     }
 
     /* Check if it's a file that's currently being worked on.
-     * If so, make that NULL so it gets canceled right away.
+     * If so, cancel that right away.
      */
-    if (directory->details->count_in_progress != NULL &&
-        directory->details->count_in_progress->count_file == file)
+    count_state = g_hash_table_lookup (directory->details->count_in_progress, file);
+    if (count_state != NULL)
     {
-        directory->details->count_in_progress->count_file = NULL;
+        directory_count_cancel_one (directory, count_state);
         changed = TRUE;
     }
     if (directory->details->deep_count_file == file)
@@ -1622,35 +2089,42 @@ nautilus_async_destroying_file (NautilusFile *file)
         directory->details->deep_count_file = NULL;
         changed = TRUE;
     }
-    if (directory->details->get_info_file == file)
+    get_info_state = g_hash_table_lookup (directory->details->get_info_in_progress, file);
+    if (get_info_state != NULL)
     {
-        directory->details->get_info_file = NULL;
+        file_info_cancel_one (directory, get_info_state);
         changed = TRUE;
     }
-    if (directory->details->extension_info_file == file)
+    extension_info_batch = g_hash_table_lookup (directory->details->extension_info_in_progress, file);
+    if (extension_info_batch != NULL)
     {
-        directory->details->extension_info_file = NULL;
+        g_hash_table_remove (directory->details->extension_info_in_progress, file);
+        g_hash_table_remove (extension_info_batch->files, file);
+        if (g_hash_table_size (extension_info_batch->files) == 0)
+        {
+            extension_info_batch_cancel (directory, extension_info_batch);
+        }
         changed = TRUE;
     }
 
-    if (directory->details->thumbnail_state != NULL &&
-        directory->details->thumbnail_state->file == file)
+    thumbnail_state = g_hash_table_lookup (directory->details->thumbnail_in_progress, file);
+    if (thumbnail_state != NULL)
     {
-        directory->details->thumbnail_state->file = NULL;
+        thumbnail_cancel_one (directory, thumbnail_state);
         changed = TRUE;
     }
 
-    if (directory->details->mount_state != NULL &&
-        directory->details->mount_state->file == file)
+    mount_state = g_hash_table_lookup (directory->details->mount_in_progress, file);
+    if (mount_state != NULL)
     {
-        directory->details->mount_state->file = NULL;
+        mount_cancel_one (directory, mount_state);
         changed = TRUE;
     }
 
-    if (directory->details->filesystem_info_state != NULL &&
-        directory->details->filesystem_info_state->file == file)
+    filesystem_info_state = g_hash_table_lookup (directory->details->filesystem_info_in_progress, file);
+    if (filesystem_info_state != NULL)
     {
-        directory->details->filesystem_info_state->file = NULL;
+        filesystem_info_cancel_one (directory, filesystem_info_state);
         changed = TRUE;
     }
 
@@ -1817,7 +2291,7 @@ static gboolean
 call_ready_callbacks_at_idle (gpointer callback_data)
 {
     NautilusDirectory *directory;
-    GList *node, *next;
+    GList *node;
     ReadyCallback *callback;
 
     directory = NAUTILUS_DIRECTORY (callback_data);
@@ -1825,25 +2299,10 @@ call_ready_callbacks_at_idle (gpointer callback_data)
 
     nautilus_directory_ref (directory);
 
-    callback = NULL;
-    while (1)
+    /* Call the non-active callbacks. */
+    while ((node = directory->details->call_when_ready_fired.head) != NULL)
     {
-        /* Check if any callbacks are non-active and call them if they are. */
-        for (node = directory->details->call_when_ready_list;
-             node != NULL; node = next)
-        {
-            next = node->next;
-            callback = node->data;
-            if (!callback->active)
-            {
-                /* Non-active, remove and call */
-                break;
-            }
-        }
-        if (node == NULL)
-        {
-            break;
-        }
+        callback = node->data;
 
         /* Callbacks are one-shots, so remove it now. */
         remove_callback_link_keep_data (directory, node);
@@ -1853,7 +2312,7 @@ call_ready_callbacks_at_idle (gpointer callback_data)
         g_free (callback);
     }
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed (directory);
 
     nautilus_directory_unref (directory);
 
@@ -1870,28 +2329,93 @@ schedule_call_ready_callbacks (NautilusDirectory *directory)
     }
 }
 
+/* Notes that the attributes of @file changed, so that its callbacks are
+ * checked again. Callbacks of other files are left alone. */
+static void
+ready_callbacks_file_changed (NautilusDirectory *directory,
+                              NautilusFile      *file)
+{
+    if (get_ready_callback_counts (directory, file, FALSE) != NULL)
+    {
+        g_hash_table_add (directory->details->call_when_ready_changed_files, file);
+    }
+}
+
+/* Fires the active callbacks of @file that are satisfied. */
+static gboolean
+call_ready_callbacks_for_file (NautilusDirectory *directory,
+                               NautilusFile      *file)
+{
+    ReadyCallbackCounts *counts;
+    gboolean found_any;
+    GList *node, *next;
+    ReadyCallback *callback;
+
+    counts = get_ready_callback_counts (directory, file, FALSE);
+    if (counts == NULL)
+    {
+        return FALSE;
+    }
+
+    found_any = FALSE;
+    for (node = counts->active_callbacks.head; node != NULL; node = next)
+    {
+        next = node->next;
+        callback = node->data;
+        if (request_is_satisfied (directory, callback->file, callback->request))
+        {
+            fire_callback (directory,
+                           g_hash_table_lookup (directory->details->call_when_ready_index, callback));
+            found_any = TRUE;
+        }
+    }
+
+    return found_any;
+}
+
 /* Marks all callbacks that are ready as non-active and
  * calls them at idle time, unless they are removed
- * before then */
+ * before then. Only the callbacks of files whose attributes
+ * changed are checked, unless anything may have changed. */
 static gboolean
 call_ready_callbacks (NautilusDirectory *directory)
 {
+    g_autoptr (GHashTable) changed_files = NULL;
     gboolean found_any;
-    GList *node, *next;
-    ReadyCallback *callback;
+    GHashTableIter iter;
+    NautilusFile *file;
+
+    if (directory->details->call_when_ready_check_all)
+    {
+        directory->details->call_when_ready_check_all = FALSE;
+        g_hash_table_remove_all (directory->details->call_when_ready_changed_files);
+
+        changed_files = g_hash_table_new (NULL, NULL);
+        g_hash_table_iter_init (&iter, directory->details->call_when_ready_counts);
+        while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
+        {
+            g_hash_table_add (changed_files, file);
+        }
+    }
+    else if (g_hash_table_size (directory->details->call_when_ready_changed_files) > 0)
+    {
+        changed_files = g_steal_pointer (&directory->details->call_when_ready_changed_files);
+        directory->details->call_when_ready_changed_files = g_hash_table_new (NULL, NULL);
+
+        /* Callbacks for all the files wait for each of them. */
+        g_hash_table_add (changed_files, NULL);
+    }
+    else
+    {
+        return FALSE;
+    }
 
     found_any = FALSE;
-
-    /* Check if any callbacks are satisifed and mark them for call them if they are. */
-    for (node = directory->details->call_when_ready_list;
-         node != NULL; node = next)
+    g_hash_table_iter_init (&iter, changed_files);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
     {
-        next = node->next;
-        callback = node->data;
-        if (callback->active &&
-            request_is_satisfied (directory, callback->file, callback->request))
+        if (call_ready_callbacks_for_file (directory, file))
         {
-            callback->active = FALSE;
             found_any = TRUE;
         }
     }
@@ -1925,18 +2449,10 @@ gboolean
 nautilus_directory_has_active_request_for_file (NautilusDirectory *directory,
                                                 NautilusFile      *file)
 {
-    GList *node;
-    ReadyCallback *callback;
-
-    for (node = directory->details->call_when_ready_list;
-         node != NULL; node = node->next)
+    if (get_ready_callback_counts (directory, file, FALSE) != NULL ||
+        get_ready_callback_counts (directory, NULL, FALSE) != NULL)
     {
-        callback = node->data;
-        if (callback->file == file ||
-            callback->file == NULL)
-        {
-            return TRUE;
-        }
+        return TRUE;
     }
 
     if (lookup_monitors (directory->details->monitor_table, file) != NULL)
@@ -2304,8 +2820,7 @@ is_needy (NautilusFile *file,
           RequestType   request_type_wanted)
 {
     NautilusDirectory *directory;
-    GList *node;
-    ReadyCallback *callback;
+    ReadyCallbackCounts *counts;
 
     if (!(*check_missing)(file))
     {
@@ -2315,22 +2830,18 @@ is_needy (NautilusFile *file,
     directory = file->details->directory;
     if (directory->details->call_when_ready_counters[request_type_wanted] > 0)
     {
-        for (node = directory->details->call_when_ready_list;
-             node != NULL; node = node->next)
+        counts = get_ready_callback_counts (directory, file, FALSE);
+        if (counts != NULL && counts->active_counters[request_type_wanted] > 0)
+        {
+            return TRUE;
+        }
+
+        if (file != directory->details->as_file)
         {
-            callback = node->data;
-            if (callback->active &&
-                REQUEST_WANTS_TYPE (callback->request, request_type_wanted))
+            counts = get_ready_callback_counts (directory, NULL, FALSE);
+            if (counts != NULL && counts->active_counters[request_type_wanted] > 0)
             {
-                if (callback->file == file)
-                {
-                    return TRUE;
-                }
-                if (callback->file == NULL
-                    && file != directory->details->as_file)
-                {
-                    return TRUE;
-                }
+                return TRUE;
             }
         }
     }
@@ -2358,25 +2869,23 @@ is_needy (NautilusFile *file,
 static void
 directory_count_stop (NautilusDirectory *directory)
 {
-    NautilusFile *file;
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->count_in_progress);
 
-    if (directory->details->count_in_progress != NULL)
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        file = directory->details->count_in_progress->count_file;
-        if (file != NULL)
+        DirectoryCountState *state = l->data;
+        NautilusFile *file = state->count_file;
+
+        g_assert (NAUTILUS_IS_FILE (file));
+        g_assert (file->details->directory == directory);
+        if (!is_needy (file,
+                       should_get_directory_count_now,
+                       REQUEST_DIRECTORY_COUNT))
         {
-            g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file,
-                          should_get_directory_count_now,
-                          REQUEST_DIRECTORY_COUNT))
-            {
-                return;
-            }
+            /* The count is not wanted, so stop it. */
+            directory_count_cancel_one (directory, state);
+            requeue_file (directory, file, directory->details->low_priority_queue);
         }
-
-        /* The count is not wanted, so stop it. */
-        directory_count_cancel (directory);
     }
 }
 
@@ -2422,7 +2931,8 @@ count_children_done (NautilusDirectory *directory,
         count_file->details->got_directory_count = TRUE;
         count_file->details->directory_count = count;
     }
-    directory->details->count_in_progress = NULL;
+    g_hash_table_remove (directory->details->count_in_progress, count_file);
+    requeue_file (directory, count_file, directory->details->low_priority_queue);
 
     /* Send file-changed even if count failed, so interested parties can
      * distinguish between unknowable and not-yet-known cases.
@@ -2431,7 +2941,7 @@ count_children_done (NautilusDirectory *directory,
 
     /* Start up the next one. */
     async_job_end (directory, "directory count");
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed_for_file (directory, count_file);
 }
 
 static void
@@ -2469,15 +2979,14 @@ count_more_files_callback (GObject      *source_object,
         /* Operation was cancelled. Bail out */
 
         async_job_end (directory, "directory count");
-        nautilus_directory_async_state_changed (directory);
+        async_state_changed (directory);
 
         directory_count_state_free (state);
 
         return;
     }
 
-    g_assert (directory->details->count_in_progress != NULL);
-    g_assert (directory->details->count_in_progress == state);
+    g_assert (g_hash_table_lookup (directory->details->count_in_progress, state->count_file) == state);
 
     error = NULL;
     files = g_file_enumerator_next_files_finish (state->enumerator,
@@ -2527,7 +3036,7 @@ count_children_callback (GObject      *source_object,
         directory = state->directory;
 
         async_job_end (directory, "directory count");
-        nautilus_directory_async_state_changed (directory);
+        async_state_changed (directory);
 
         directory_count_state_free (state);
 
@@ -2562,14 +3071,15 @@ count_children_callback (GObject      *source_object,
 static void
 directory_count_start (NautilusDirectory *directory,
                        NautilusFile      *file,
-                       gboolean          *doing_io)
+                       gboolean          *doing_io,
+                       gboolean          *in_flight)
 {
     DirectoryCountState *state;
     GFile *location;
 
-    if (directory->details->count_in_progress != NULL)
+    if (g_hash_table_contains (directory->details->count_in_progress, file))
     {
-        *doing_io = TRUE;
+        *in_flight = TRUE;
         return;
     }
 
@@ -2579,7 +3089,6 @@ directory_count_start (NautilusDirectory *directory,
     {
         return;
     }
-    *doing_io = TRUE;
 
     if (!nautilus_file_is_directory (file))
     {
@@ -2587,14 +3096,19 @@ directory_count_start (NautilusDirectory *directory,
         file->details->directory_count_failed = FALSE;
         file->details->got_directory_count = FALSE;
 
-        nautilus_directory_async_state_changed (directory);
+        *doing_io = TRUE;
+        async_state_changed_for_file (directory, file);
         return;
     }
 
-    if (!async_job_start (directory, "directory count"))
+    if (g_hash_table_size (directory->details->count_in_progress) >= max_jobs_per_directory[REQUEST_DIRECTORY_COUNT] ||
+        !async_job_start (directory, "directory count"))
     {
+        /* Wait for a free slot. */
+        *doing_io = TRUE;
         return;
     }
+    *in_flight = TRUE;
 
     /* Start counting. */
     state = g_new0 (DirectoryCountState, 1);
@@ -2602,7 +3116,7 @@ directory_count_start (NautilusDirectory *directory,
     state->directory = nautilus_directory_ref (directory);
     state->cancellable = g_cancellable_new ();
 
-    directory->details->count_in_progress = state;
+    g_hash_table_insert (directory->details->count_in_progress, file, state);
 
     location = nautilus_file_get_location (file);
 
@@ -2769,7 +3283,7 @@ deep_count_next_dir (DeepCountState *state)
     {
         nautilus_file_changed (file);
         async_job_end (directory, "deep count");
-        nautilus_directory_async_state_changed (directory);
+        async_state_changed_for_file (directory, file);
     }
 }
 
@@ -2964,7 +3478,7 @@ deep_count_start (NautilusDirectory *directory,
     {
         file->details->deep_counts_status = NAUTILUS_REQUEST_DONE;
 
-        nautilus_directory_async_state_changed (directory);
+        async_state_changed_for_file (directory, file);
         return;
     }
 
@@ -3029,11 +3543,10 @@ query_info_callback (GObject      *source_object,
 
     directory = nautilus_directory_ref (state->directory);
 
-    get_info_file = directory->details->get_info_file;
+    get_info_file = state->file;
     g_assert (NAUTILUS_IS_FILE (get_info_file));
 
-    directory->details->get_info_file = NULL;
-    directory->details->get_info_in_progress = NULL;
+    g_hash_table_remove (directory->details->get_info_in_progress, get_info_file);
 
     /* ref here because we might be removing the last ref when we
      * mark the file gone below, but we need to keep a ref at
@@ -3062,11 +3575,12 @@ query_info_callback (GObject      *source_object,
         g_object_unref (info);
     }
 
+    requeue_file (directory, get_info_file, directory->details->high_priority_queue);
     nautilus_file_changed (get_info_file);
-    nautilus_file_unref (get_info_file);
 
     async_job_end (directory, "file info");
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed_for_file (directory, get_info_file);
+    nautilus_file_unref (get_info_file);
 
     nautilus_directory_unref (directory);
 
@@ -3076,39 +3590,38 @@ query_info_callback (GObject      *source_object,
 static void
 file_info_stop (NautilusDirectory *directory)
 {
-    NautilusFile *file;
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->get_info_in_progress);
 
-    if (directory->details->get_info_in_progress != NULL)
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        file = directory->details->get_info_file;
-        if (file != NULL)
+        GetInfoState *state = l->data;
+        NautilusFile *file = state->file;
+
+        g_assert (NAUTILUS_IS_FILE (file));
+        g_assert (file->details->directory == directory);
+        if (!is_needy (file, lacks_info, REQUEST_FILE_INFO))
         {
-            g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file, lacks_info, REQUEST_FILE_INFO))
-            {
-                return;
-            }
+            /* The info is not wanted, so stop it. */
+            file_info_cancel_one (directory, state);
+            requeue_file (directory, file, directory->details->high_priority_queue);
         }
-
-        /* The info is not wanted, so stop it. */
-        file_info_cancel (directory);
     }
 }
 
 static void
 file_info_start (NautilusDirectory *directory,
                  NautilusFile      *file,
-                 gboolean          *doing_io)
+                 gboolean          *doing_io,
+                 gboolean          *in_flight)
 {
     GFile *location;
     GetInfoState *state;
 
     file_info_stop (directory);
 
-    if (directory->details->get_info_in_progress != NULL)
+    if (g_hash_table_contains (directory->details->get_info_in_progress, file))
     {
-        *doing_io = TRUE;
+        *in_flight = TRUE;
         return;
     }
 
@@ -3116,14 +3629,16 @@ file_info_start (NautilusDirectory *directory,
     {
         return;
     }
-    *doing_io = TRUE;
 
-    if (!async_job_start (directory, "file info"))
+    if (g_hash_table_size (directory->details->get_info_in_progress) >= max_jobs_per_directory[REQUEST_FILE_INFO] ||
+        !async_job_start (directory, "file info"))
     {
+        /* Wait for a free slot. */
+        *doing_io = TRUE;
         return;
     }
+    *in_flight = TRUE;
 
-    directory->details->get_info_file = file;
     file->details->get_info_failed = FALSE;
     if (file->details->get_info_error)
     {
@@ -3134,8 +3649,9 @@ file_info_start (NautilusDirectory *directory,
     state = g_new (GetInfoState, 1);
     state->directory = directory;
     state->cancellable = g_cancellable_new ();
+    state->file = file;
 
-    directory->details->get_info_in_progress = state;
+    g_hash_table_insert (directory->details->get_info_in_progress, file, state);
 
     location = nautilus_file_get_location (file);
     g_file_query_info_async (location,
@@ -3156,32 +3672,29 @@ thumbnail_done (NautilusDirectory *directory,
         g_clear_pointer (&file->details->thumbnail_path, g_free);
     }
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed_for_file (directory, file);
 }
 
 static void
 thumbnail_stop (NautilusDirectory *directory)
 {
-    NautilusFile *file;
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->thumbnail_in_progress);
 
-    if (directory->details->thumbnail_state != NULL)
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        file = directory->details->thumbnail_state->file;
+        ThumbnailState *state = l->data;
+        NautilusFile *file = state->file;
 
-        if (file != NULL)
+        g_assert (NAUTILUS_IS_FILE (file));
+        g_assert (file->details->directory == directory);
+        if (!is_needy (file,
+                       lacks_thumbnail,
+                       REQUEST_THUMBNAIL))
         {
-            g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file,
-                          lacks_thumbnail,
-                          REQUEST_THUMBNAIL))
-            {
-                return;
-            }
+            /* The thumbnail is not wanted, so stop it. */
+            thumbnail_cancel_one (directory, state);
+            requeue_file (directory, file, directory->details->low_priority_queue);
         }
-
-        /* The link info is not wanted, so stop it. */
-        thumbnail_cancel (directory);
     }
 }
 
@@ -3317,10 +3830,11 @@ thumbnail_read_callback (GObject      *source_object,
         g_free (file_contents);
     }
 
-    state->directory->details->thumbnail_state = NULL;
-    async_job_end (state->directory, "thumbnail");
+    g_hash_table_remove (directory->details->thumbnail_in_progress, state->file);
+    requeue_file (directory, state->file, directory->details->low_priority_queue);
+    async_job_end (directory, "thumbnail");
 
-    thumbnail_got_pixbuf (state->directory, state->file, pixbuf);
+    thumbnail_got_pixbuf (directory, state->file, pixbuf);
 
     thumbnail_state_free (state);
 
@@ -3330,14 +3844,15 @@ thumbnail_read_callback (GObject      *source_object,
 static void
 thumbnail_start (NautilusDirectory *directory,
                  NautilusFile      *file,
-                 gboolean          *doing_io)
+                 gboolean          *doing_io,
+                 gboolean          *in_flight)
 {
     GFile *location;
     ThumbnailState *state;
 
-    if (directory->details->thumbnail_state != NULL)
+    if (g_hash_table_contains (directory->details->thumbnail_in_progress, file))
     {
-        *doing_io = TRUE;
+        *in_flight = TRUE;
         return;
     }
 
@@ -3347,12 +3862,15 @@ thumbnail_start (NautilusDirectory *directory,
     {
         return;
     }
-    *doing_io = TRUE;
 
-    if (!async_job_start (directory, "thumbnail"))
+    if (g_hash_table_size (directory->details->thumbnail_in_progress) >= max_jobs_per_directory[REQUEST_THUMBNAIL] ||
+        !async_job_start (directory, "thumbnail"))
     {
+        /* Wait for a free slot. */
+        *doing_io = TRUE;
         return;
     }
+    *in_flight = TRUE;
 
     state = g_new0 (ThumbnailState, 1);
     state->directory = directory;
@@ -3361,7 +3879,7 @@ thumbnail_start (NautilusDirectory *directory,
 
     location = g_file_new_for_path (file->details->thumbnail_path);
 
-    directory->details->thumbnail_state = state;
+    g_hash_table_insert (directory->details->thumbnail_in_progress, file, state);
 
     g_file_load_contents_async (location,
                                 state->cancellable,
@@ -3373,26 +3891,23 @@ thumbnail_start (NautilusDirectory *directory,
 static void
 mount_stop (NautilusDirectory *directory)
 {
-    NautilusFile *file;
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->mount_in_progress);
 
-    if (directory->details->mount_state != NULL)
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        file = directory->details->mount_state->file;
+        MountState *state = l->data;
+        NautilusFile *file = state->file;
 
-        if (file != NULL)
+        g_assert (NAUTILUS_IS_FILE (file));
+        g_assert (file->details->directory == directory);
+        if (!is_needy (file,
+                       lacks_mount,
+                       REQUEST_MOUNT))
         {
-            g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file,
-                          lacks_mount,
-                          REQUEST_MOUNT))
-            {
-                return;
-            }
+            /* The mount is not wanted, so stop it. */
+            mount_cancel_one (directory, state);
+            requeue_file (directory, file, directory->details->low_priority_queue);
         }
-
-        /* The link info is not wanted, so stop it. */
-        mount_cancel (directory);
     }
 }
 
@@ -3412,15 +3927,16 @@ got_mount (MountState *state,
 
     directory = nautilus_directory_ref (state->directory);
 
-    state->directory->details->mount_state = NULL;
-    async_job_end (state->directory, "mount");
-
     file = nautilus_file_ref (state->file);
 
+    g_hash_table_remove (directory->details->mount_in_progress, file);
+    requeue_file (directory, file, directory->details->low_priority_queue);
+    async_job_end (directory, "mount");
+
     file->details->mount_is_up_to_date = TRUE;
     nautilus_file_set_mount (file, mount);
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed_for_file (directory, file);
     nautilus_file_changed (file);
 
     nautilus_file_unref (file);
@@ -3474,14 +3990,15 @@ find_enclosing_mount_callback (GObject      *source_object,
 static void
 mount_start (NautilusDirectory *directory,
              NautilusFile      *file,
-             gboolean          *doing_io)
+             gboolean          *doing_io,
+             gboolean          *in_flight)
 {
     GFile *location;
     MountState *state;
 
-    if (directory->details->mount_state != NULL)
+    if (g_hash_table_contains (directory->details->mount_in_progress, file))
     {
-        *doing_io = TRUE;
+        *in_flight = TRUE;
         return;
     }
 
@@ -3491,10 +4008,12 @@ mount_start (NautilusDirectory *directory,
     {
         return;
     }
-    *doing_io = TRUE;
 
-    if (!async_job_start (directory, "mount"))
+    if (g_hash_table_size (directory->details->mount_in_progress) >= max_jobs_per_directory[REQUEST_MOUNT] ||
+        !async_job_start (directory, "mount"))
     {
+        /* Wait for a free slot. */
+        *doing_io = TRUE;
         return;
     }
 
@@ -3505,7 +4024,7 @@ mount_start (NautilusDirectory *directory,
 
     location = nautilus_file_get_location (file);
 
-    directory->details->mount_state = state;
+    g_hash_table_insert (directory->details->mount_in_progress, file, state);
 
     if (file->details->type == G_FILE_TYPE_MOUNTABLE)
     {
@@ -3520,6 +4039,7 @@ mount_start (NautilusDirectory *directory,
             g_object_unref (target);
         }
 
+        /* This completes synchronously and requeues the file. */
         got_mount (state, mount);
 
         if (mount)
@@ -3529,6 +4049,7 @@ mount_start (NautilusDirectory *directory,
     }
     else
     {
+        *in_flight = TRUE;
         g_file_find_enclosing_mount_async (location,
                                            G_PRIORITY_DEFAULT,
                                            state->cancellable,
@@ -3538,41 +4059,26 @@ mount_start (NautilusDirectory *directory,
     g_object_unref (location);
 }
 
-static void
-filesystem_info_cancel (NautilusDirectory *directory)
-{
-    if (directory->details->filesystem_info_state != NULL)
-    {
-        g_cancellable_cancel (directory->details->filesystem_info_state->cancellable);
-        directory->details->filesystem_info_state->directory = NULL;
-        directory->details->filesystem_info_state = NULL;
-        async_job_end (directory, "filesystem info");
-    }
-}
-
 static void
 filesystem_info_stop (NautilusDirectory *directory)
 {
-    NautilusFile *file;
+    g_autoptr (GList) states = g_hash_table_get_values (directory->details->filesystem_info_in_progress);
 
-    if (directory->details->filesystem_info_state != NULL)
+    for (GList *l = states; l != NULL; l = l->next)
     {
-        file = directory->details->filesystem_info_state->file;
+        FilesystemInfoState *state = l->data;
+        NautilusFile *file = state->file;
 
-        if (file != NULL)
+        g_assert (NAUTILUS_IS_FILE (file));
+        g_assert (file->details->directory == directory);
+        if (!is_needy (file,
+                       lacks_filesystem_info,
+                       REQUEST_FILESYSTEM_INFO))
         {
-            g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file,
-                          lacks_filesystem_info,
-                          REQUEST_FILESYSTEM_INFO))
-            {
-                return;
-            }
+            /* The filesystem info is not wanted, so stop it. */
+            filesystem_info_cancel_one (directory, state);
+            requeue_file (directory, file, directory->details->low_priority_queue);
         }
-
-        /* The filesystem info is not wanted, so stop it. */
-        filesystem_info_cancel (directory);
     }
 }
 
@@ -3594,11 +4100,12 @@ got_filesystem_info (FilesystemInfoState *state,
 
     directory = nautilus_directory_ref (state->directory);
 
-    state->directory->details->filesystem_info_state = NULL;
-    async_job_end (state->directory, "filesystem info");
-
     file = nautilus_file_ref (state->file);
 
+    g_hash_table_remove (directory->details->filesystem_info_in_progress, file);
+    requeue_file (directory, file, directory->details->low_priority_queue);
+    async_job_end (directory, "filesystem info");
+
     file->details->filesystem_info_is_up_to_date = TRUE;
     if (info != NULL)
     {
@@ -3609,7 +4116,7 @@ got_filesystem_info (FilesystemInfoState *state,
         file->details->filesystem_remote = g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE);
     }
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed_for_file (directory, file);
     nautilus_file_changed (file);
 
     nautilus_file_unref (file);
@@ -3648,14 +4155,15 @@ query_filesystem_info_callback (GObject      *source_object,
 static void
 filesystem_info_start (NautilusDirectory *directory,
                        NautilusFile      *file,
-                       gboolean          *doing_io)
+                       gboolean          *doing_io,
+                       gboolean          *in_flight)
 {
     GFile *location;
     FilesystemInfoState *state;
 
-    if (directory->details->filesystem_info_state != NULL)
+    if (g_hash_table_contains (directory->details->filesystem_info_in_progress, file))
     {
-        *doing_io = TRUE;
+        *in_flight = TRUE;
         return;
     }
 
@@ -3665,12 +4173,15 @@ filesystem_info_start (NautilusDirectory *directory,
     {
         return;
     }
-    *doing_io = TRUE;
 
-    if (!async_job_start (directory, "filesystem info"))
+    if (g_hash_table_size (directory->details->filesystem_info_in_progress) >= max_jobs_per_directory[REQUEST_FILESYSTEM_INFO] ||
+        !async_job_start (directory, "filesystem info"))
     {
+        /* Wait for a free slot. */
+        *doing_io = TRUE;
         return;
     }
+    *in_flight = TRUE;
 
     state = g_new0 (FilesystemInfoState, 1);
     state->directory = directory;
@@ -3679,7 +4190,7 @@ filesystem_info_start (NautilusDirectory *directory,
 
     location = nautilus_file_get_location (file);
 
-    directory->details->filesystem_info_state = state;
+    g_hash_table_insert (directory->details->filesystem_info_in_progress, file, state);
 
     g_file_query_filesystem_info_async (location,
                                         G_FILE_ATTRIBUTE_FILESYSTEM_READONLY ","
@@ -3693,50 +4204,96 @@ filesystem_info_start (NautilusDirectory *directory,
 }
 
 static void
-extension_info_cancel (NautilusDirectory *directory)
+extension_info_batch_free (ExtensionInfoBatch *batch)
+{
+    g_object_unref (batch->provider);
+    g_object_unref (batch->cancellable);
+    g_hash_table_destroy (batch->files);
+    g_free (batch);
+}
+
+static void
+extension_info_batch_release (ExtensionInfoBatch *batch)
 {
-    if (directory->details->extension_info_in_progress != NULL)
+    /* The provider may be done with the batch, or the batch may be
+     * cancelled, before the provider has returned. Leave it to
+     * extension_info_dispatch() to free it then. */
+    if (batch->dispatching)
     {
-        if (directory->details->extension_info_idle)
-        {
-            g_source_remove (directory->details->extension_info_idle);
-        }
-        else
-        {
-            nautilus_info_provider_cancel_update
-                (directory->details->extension_info_provider,
-                directory->details->extension_info_in_progress);
-        }
+        batch->released = TRUE;
+    }
+    else
+    {
+        extension_info_batch_free (batch);
+    }
+}
 
-        directory->details->extension_info_in_progress = NULL;
-        directory->details->extension_info_file = NULL;
-        directory->details->extension_info_provider = NULL;
-        directory->details->extension_info_idle = 0;
+static void
+extension_info_batch_cancel (NautilusDirectory  *directory,
+                             ExtensionInfoBatch *batch)
+{
+    GHashTableIter iter;
+    gpointer file;
 
-        async_job_end (directory, "extension info");
+    g_hash_table_iter_init (&iter, batch->files);
+    while (g_hash_table_iter_next (&iter, &file, NULL))
+    {
+        g_hash_table_remove (directory->details->extension_info_in_progress, file);
+    }
+
+    directory->details->extension_info_batches =
+        g_list_remove (directory->details->extension_info_batches, batch);
+
+    /* The provider does not call back anymore after this. */
+    g_cancellable_cancel (batch->cancellable);
+    extension_info_batch_release (batch);
+
+    async_job_end (directory, "extension info");
+}
+
+static void
+extension_info_cancel (NautilusDirectory *directory)
+{
+    while (directory->details->extension_info_batches != NULL)
+    {
+        extension_info_batch_cancel (directory, directory->details->extension_info_batches->data);
     }
 }
 
 static void
 extension_info_stop (NautilusDirectory *directory)
 {
-    if (directory->details->extension_info_in_progress != NULL)
+    GList *node, *next;
+
+    for (node = directory->details->extension_info_batches; node != NULL; node = next)
     {
-        NautilusFile *file;
+        ExtensionInfoBatch *batch = node->data;
+        GHashTableIter iter;
+        gpointer file;
+        gboolean needed;
 
-        file = directory->details->extension_info_file;
-        if (file != NULL)
+        next = node->next;
+        needed = FALSE;
+
+        g_hash_table_iter_init (&iter, batch->files);
+        while (!needed && g_hash_table_iter_next (&iter, &file, NULL))
         {
             g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO))
+            g_assert (NAUTILUS_FILE (file)->details->directory == directory);
+            needed = is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO);
+        }
+
+        if (!needed)
+        {
+            g_autoptr (GList) files = g_hash_table_get_keys (batch->files);
+
+            /* The info is not wanted, so stop it. */
+            extension_info_batch_cancel (directory, batch);
+            for (GList *l = files; l != NULL; l = l->next)
             {
-                return;
+                requeue_file (directory, l->data, directory->details->extension_queue);
             }
         }
-
-        /* The info is not wanted, so stop it. */
-        extension_info_cancel (directory);
     }
 }
 
@@ -3750,7 +4307,7 @@ finish_info_provider (NautilusDirectory    *directory,
                        provider);
     g_object_unref (provider);
 
-    nautilus_directory_async_state_changed (directory);
+    async_state_changed_for_file (directory, file);
 
     if (file->details->pending_info_providers == NULL)
     {
@@ -3758,72 +4315,55 @@ finish_info_provider (NautilusDirectory    *directory,
     }
 }
 
-
-static gboolean
-info_provider_idle_callback (gpointer user_data)
+static void
+extension_info_file_done (NautilusInfoProvider    *provider,
+                          NautilusFileInfo        *file_info,
+                          NautilusOperationResult  result,
+                          gpointer                 user_data)
 {
-    InfoProviderResponse *response;
+    ExtensionInfoBatch *batch;
     NautilusDirectory *directory;
+    NautilusFile *file;
 
-    response = user_data;
-    directory = response->directory;
+    batch = user_data;
+    directory = nautilus_directory_ref (batch->directory);
+    file = NAUTILUS_FILE (file_info);
 
-    if (response->handle != directory->details->extension_info_in_progress
-        || response->provider != directory->details->extension_info_provider)
+    if (!g_hash_table_remove (batch->files, file))
     {
-        g_warning ("Unexpected plugin response.  This probably indicates a bug in a Nautilus extension: handle=%p", response->handle);
+        g_warning ("Unexpected plugin response.  This probably indicates a bug in a Nautilus extension: file=%p", file);
+        nautilus_directory_unref (directory);
+        return;
     }
-    else
+    g_hash_table_remove (directory->details->extension_info_in_progress, file);
+
+    if (g_hash_table_size (batch->files) == 0)
     {
-        NautilusFile *file;
+        directory->details->extension_info_batches =
+            g_list_remove (directory->details->extension_info_batches, batch);
+        extension_info_batch_release (batch);
         async_job_end (directory, "extension info");
-
-        file = directory->details->extension_info_file;
-
-        directory->details->extension_info_file = NULL;
-        directory->details->extension_info_provider = NULL;
-        directory->details->extension_info_in_progress = NULL;
-        directory->details->extension_info_idle = 0;
-
-        finish_info_provider (directory, file, response->provider);
     }
 
-    return FALSE;
-}
-
-static void
-info_provider_callback (NautilusInfoProvider    *provider,
-                        NautilusOperationHandle *handle,
-                        NautilusOperationResult  result,
-                        gpointer                 user_data)
-{
-    InfoProviderResponse *response;
-
-    response = g_new0 (InfoProviderResponse, 1);
-    response->provider = provider;
-    response->handle = handle;
-    response->result = result;
-    response->directory = NAUTILUS_DIRECTORY (user_data);
+    requeue_file (directory, file, directory->details->extension_queue);
+    finish_info_provider (directory, file, provider);
 
-    response->directory->details->extension_info_idle =
-        g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-                         info_provider_idle_callback, response,
-                         g_free);
+    nautilus_directory_unref (directory);
 }
 
 static void
 extension_info_start (NautilusDirectory *directory,
                       NautilusFile      *file,
-                      gboolean          *doing_io)
+                      gboolean          *doing_io,
+                      gboolean          *in_flight)
 {
     NautilusInfoProvider *provider;
-    NautilusOperationResult result;
-    NautilusOperationHandle *handle;
-    GClosure *update_complete;
+    ExtensionInfoBatch *batch;
+    GList *node;
 
-    if (directory->details->extension_info_in_progress != NULL)
+    if (g_hash_table_contains (directory->details->extension_info_in_progress, file))
     {
-        *doing_io = TRUE;
+        *in_flight = TRUE;
         return;
     }
 
@@ -3831,40 +4371,83 @@ extension_info_start (NautilusDirectory *directory,
     {
         return;
     }
-    *doing_io = TRUE;
 
-    if (!async_job_start (directory, "extension info"))
+    provider = file->details->pending_info_providers->data;
+
+    /* Add the file to a batch that is being put together for its provider. */
+    batch = NULL;
+    for (node = directory->details->extension_info_batches; node != NULL; node = node->next)
     {
-        return;
+        ExtensionInfoBatch *candidate = node->data;
+
+        if (!candidate->dispatched && candidate->provider == provider &&
+            g_hash_table_size (candidate->files) < EXTENSION_INFO_BATCH_SIZE)
+        {
+            batch = candidate;
+            break;
+        }
     }
 
-    provider = file->details->pending_info_providers->data;
+    if (batch == NULL)
+    {
+        if (g_list_length (directory->details->extension_info_batches) >= max_jobs_per_directory[REQUEST_EXTENSION_INFO] ||
+            !async_job_start (directory, "extension info"))
+        {
+            /* Wait for a free slot. */
+            *doing_io = TRUE;
+            return;
+        }
 
-    update_complete = g_cclosure_new (G_CALLBACK (info_provider_callback),
-                                      directory,
-                                      NULL);
-    g_closure_set_marshal (update_complete,
-                           g_cclosure_marshal_generic);
+        batch = g_new0 (ExtensionInfoBatch, 1);
+        batch->directory = directory;
+        batch->provider = g_object_ref (provider);
+        batch->cancellable = g_cancellable_new ();
+        batch->files = g_hash_table_new (NULL, NULL);
+        directory->details->extension_info_batches =
+            g_list_prepend (directory->details->extension_info_batches, batch);
+    }
 
-    result = nautilus_info_provider_update_file_info
-                 (provider,
-                 NAUTILUS_FILE_INFO (file),
-                 update_complete,
-                 &handle);
+    *in_flight = TRUE;
+    g_hash_table_add (batch->files, file);
+    g_hash_table_insert (directory->details->extension_info_in_progress, file, batch);
+}
 
-    g_closure_unref (update_complete);
+/* Hand the batches put together by extension_info_start() over to their
+ * providers.
+ */
+static void
+extension_info_dispatch (NautilusDirectory *directory)
+{
+    g_autoptr (GList) batches = NULL;
 
-    if (result == NAUTILUS_OPERATION_COMPLETE ||
-        result == NAUTILUS_OPERATION_FAILED)
+    for (GList *node = directory->details->extension_info_batches; node != NULL; node = node->next)
     {
-        finish_info_provider (directory, file, provider);
-        async_job_end (directory, "extension info");
+        ExtensionInfoBatch *batch = node->data;
+
+        if (!batch->dispatched)
+        {
+            batches = g_list_prepend (batches, batch);
+        }
     }
-    else
+
+    for (GList *node = batches; node != NULL; node = node->next)
     {
-        directory->details->extension_info_in_progress = handle;
-        directory->details->extension_info_provider = provider;
-        directory->details->extension_info_file = file;
+        ExtensionInfoBatch *batch = node->data;
+        g_autoptr (GList) files = NULL;
+
+        files = g_hash_table_get_keys (batch->files);
+        batch->dispatched = TRUE;
+        batch->dispatching = TRUE;
+        nautilus_info_provider_update_file_info_batch (batch->provider,
+                                                       files,
+                                                       batch->cancellable,
+                                                       extension_info_file_done,
+                                                       batch);
+        batch->dispatching = FALSE;
+        if (batch->released)
+        {
+            extension_info_batch_free (batch);
+        }
     }
 }
 
@@ -3873,6 +4456,7 @@ start_or_stop_io (NautilusDirectory *directory)
 {
     NautilusFile *file;
     gboolean doing_io;
+    gboolean in_flight;
 
     /* Start or stop reading files. */
     file_list_start_or_stop (directory);
@@ -3893,13 +4477,21 @@ start_or_stop_io (NautilusDirectory *directory)
         file = nautilus_file_queue_head (directory->details->high_priority_queue);
 
         /* Start getting attributes if possible */
-        file_info_start (directory, file, &doing_io);
+        in_flight = FALSE;
+        file_info_start (directory, file, &doing_io, &in_flight);
 
         if (doing_io)
         {
             return;
         }
 
+        if (in_flight)
+        {
+            /* Park the file; it is requeued once its job is done. */
+            nautilus_file_queue_remove (directory->details->high_priority_queue, file);
+            continue;
+        }
+
         move_file_to_low_priority_queue (directory, file);
     }
 
@@ -3909,17 +4501,24 @@ start_or_stop_io (NautilusDirectory *directory)
         file = nautilus_file_queue_head (directory->details->low_priority_queue);
 
         /* Start getting attributes if possible */
-        mount_start (directory, file, &doing_io);
-        directory_count_start (directory, file, &doing_io);
+        in_flight = FALSE;
+        mount_start (directory, file, &doing_io, &in_flight);
+        directory_count_start (directory, file, &doing_io, &in_flight);
         deep_count_start (directory, file, &doing_io);
-        thumbnail_start (directory, file, &doing_io);
-        filesystem_info_start (directory, file, &doing_io);
+        thumbnail_start (directory, file, &doing_io, &in_flight);
+        filesystem_info_start (directory, file, &doing_io, &in_flight);
 
         if (doing_io)
         {
             return;
         }
 
+        if (in_flight)
+        {
+            nautilus_file_queue_remove (directory->details->low_priority_queue, file);
+            continue;
+        }
+
         move_file_to_extension_queue (directory, file);
     }
 
@@ -3929,21 +4528,30 @@ start_or_stop_io (NautilusDirectory *directory)
         file = nautilus_file_queue_head (directory->details->extension_queue);
 
         /* Start getting attributes if possible */
-        extension_info_start (directory, file, &doing_io);
+        in_flight = FALSE;
+        extension_info_start (directory, file, &doing_io, &in_flight);
         if (doing_io)
         {
-            return;
+            break;
+        }
+
+        if (in_flight)
+        {
+            nautilus_file_queue_remove (directory->details->extension_queue, file);
+            continue;
         }
 
         nautilus_directory_remove_file_from_work_queue (directory, file);
     }
+
+    extension_info_dispatch (directory);
 }
 
-/* Call this when the monitor or call when ready list changes,
- * or when some I/O is completed.
+/* Starts or stops I/O as needed, and checks the callbacks of the files
+ * noted with ready_callbacks_file_changed().
  */
-void
-nautilus_directory_async_state_changed (NautilusDirectory *directory)
+static void
+async_state_changed (NautilusDirectory *directory)
 {
     /* Check if any callbacks are satisfied and call them if they
      * are. Do this last so that any changes done in start or stop
@@ -3977,6 +4585,25 @@ nautilus_directory_async_state_changed (NautilusDirectory *directory)
     async_job_wake_up ();
 }
 
+static void
+async_state_changed_for_file (NautilusDirectory *directory,
+                              NautilusFile      *file)
+{
+    ready_callbacks_file_changed (directory, file);
+    async_state_changed (directory);
+}
+
+/* Call this when the monitor or call when ready list changes,
+ * or when some I/O is completed. As it can't tell what changed,
+ * all callbacks are checked again.
+ */
+void
+nautilus_directory_async_state_changed (NautilusDirectory *directory)
+{
+    directory->details->call_when_ready_check_all = TRUE;
+    async_state_changed (directory);
+}
+
 void
 nautilus_directory_cancel (NautilusDirectory *directory)
 {
@@ -3992,10 +4619,7 @@ nautilus_directory_cancel (NautilusDirectory *directory)
     filesystem_info_cancel (directory);
 
     /* We aren't waiting for anything any more. */
-    if (waiting_directories != NULL)
-    {
-        g_hash_table_remove (waiting_directories, directory);
-    }
+    async_job_stop_waiting (directory);
 
     /* Check if any directories should wake up. */
     async_job_wake_up ();
@@ -4005,10 +4629,12 @@ static void
 cancel_directory_count_for_file (NautilusDirectory *directory,
                                  NautilusFile      *file)
 {
-    if (directory->details->count_in_progress != NULL &&
-        directory->details->count_in_progress->count_file == file)
+    DirectoryCountState *state;
+
+    state = g_hash_table_lookup (directory->details->count_in_progress, file);
+    if (state != NULL)
     {
-        directory_count_cancel (directory);
+        directory_count_cancel_one (directory, state);
     }
 }
 
@@ -4026,9 +4652,12 @@ static void
 cancel_file_info_for_file (NautilusDirectory *directory,
                            NautilusFile      *file)
 {
-    if (directory->details->get_info_file == file)
+    GetInfoState *state;
+
+    state = g_hash_table_lookup (directory->details->get_info_in_progress, file);
+    if (state != NULL)
     {
-        file_info_cancel (directory);
+        file_info_cancel_one (directory, state);
     }
 }
 
@@ -4036,10 +4665,12 @@ static void
 cancel_thumbnail_for_file (NautilusDirectory *directory,
                            NautilusFile      *file)
 {
-    if (directory->details->thumbnail_state != NULL &&
-        directory->details->thumbnail_state->file == file)
+    ThumbnailState *state;
+
+    state = g_hash_table_lookup (directory->details->thumbnail_in_progress, file);
+    if (state != NULL)
     {
-        thumbnail_cancel (directory);
+        thumbnail_cancel_one (directory, state);
     }
 }
 
@@ -4047,10 +4678,12 @@ static void
 cancel_mount_for_file (NautilusDirectory *directory,
                        NautilusFile      *file)
 {
-    if (directory->details->mount_state != NULL &&
-        directory->details->mount_state->file == file)
+    MountState *state;
+
+    state = g_hash_table_lookup (directory->details->mount_in_progress, file);
+    if (state != NULL)
     {
-        mount_cancel (directory);
+        mount_cancel_one (directory, state);
     }
 }
 
@@ -4058,10 +4691,12 @@ static void
 cancel_filesystem_info_for_file (NautilusDirectory *directory,
                                  NautilusFile      *file)
 {
-    if (directory->details->filesystem_info_state != NULL &&
-        directory->details->filesystem_info_state->file == file)
+    FilesystemInfoState *state;
+
+    state = g_hash_table_lookup (directory->details->filesystem_info_in_progress, file);
+    if (state != NULL)
     {
-        filesystem_info_cancel (directory);
+        filesystem_info_cancel_one (directory, state);
     }
 }
 
@@ -36,6 +36,8 @@ typedef struct NewFilesState NewFilesState;
 typedef struct ThumbnailState ThumbnailState;
 typedef struct MountState MountState;
 typedef struct FilesystemInfoState FilesystemInfoState;
+typedef struct AsyncJobBackend AsyncJobBackend;
+typedef struct ExtensionInfoBatch ExtensionInfoBatch;
 
 typedef enum {
 	REQUEST_DEEP_COUNT,
@@ -71,13 +73,22 @@ struct NautilusDirectoryPrivate
 	NautilusFileQueue *low_priority_queue;
 	NautilusFileQueue *extension_queue;
 
-	/* These lists are going to be pretty short.  If we think they
-	 * are going to get big, we can use hash tables instead.
+	/* There can be one callback per visible file, so the lists are
+	 * indexed: the active callbacks by key, and the per-file counts by
+	 * file (NULL for all files).
 	 */
-	GList *call_when_ready_list;
+	GList *call_when_ready_list; /* active ones only */
+	GQueue call_when_ready_fired; /* triggered, to be called at idle */
 	RequestCounter call_when_ready_counters;
+	GHashTable *call_when_ready_index;
+	GHashTable *call_when_ready_counts;
+	/* Files whose attributes changed since the callbacks were last
+	 * checked, so that only their callbacks are checked again. */
+	GHashTable *call_when_ready_changed_files;
+	gboolean call_when_ready_check_all;
 	GHashTable *monitor_table;
 	RequestCounter monitor_counters;
+	guint n_background_monitors;
 	guint call_ready_idle_id;
 
 	NautilusMonitor *monitor;
@@ -85,6 +96,7 @@ struct NautilusDirectoryPrivate
 
 	gboolean in_async_service_loop;
 	gboolean state_changed;
+	AsyncJobBackend *async_job_backend;
 
 	gboolean file_list_monitored;
 	gboolean directory_loaded;
@@ -103,24 +115,22 @@ struct NautilusDirectoryPrivate
 	 */
 	GList *files_changed_while_adding;
 
-	DirectoryCountState *count_in_progress;
+	/* Attribute fetches in flight, NautilusFile -> job state. Several
+	 * files of a directory can be worked on at the same time, up to a
+	 * per-kind limit (see nautilus-directory-async.c). */
+	GHashTable *count_in_progress;
 
 	NautilusFile *deep_count_file;
 	DeepCountState *deep_count_in_progress;
 
-	NautilusFile *get_info_file;
-	GetInfoState *get_info_in_progress;
+	GHashTable *get_info_in_progress;
 
-	NautilusFile *extension_info_file;
-	NautilusInfoProvider *extension_info_provider;
-	NautilusOperationHandle *extension_info_in_progress;
-	guint extension_info_idle;
+	GList *extension_info_batches; /* list of ExtensionInfoBatch * */
+	GHashTable *extension_info_in_progress; /* NautilusFile -> ExtensionInfoBatch */
 
-	ThumbnailState *thumbnail_state;
-
-	MountState *mount_state;
-
-	FilesystemInfoState *filesystem_info_state;
+	GHashTable *thumbnail_in_progress;
+	GHashTable *mount_in_progress;
+	GHashTable *filesystem_info_in_progress;
 
 	GList *file_operations_in_progress; /* list of FileOperation * */
 };
@@ -151,6 +161,8 @@ void               nautilus_directory_monitor_add_internal            (NautilusD
 								       NautilusFileAttributes     attributes,
 								       NautilusDirectoryCallback  callback,
 								       gpointer                   callback_data);
+void               nautilus_directory_monitor_set_background          (NautilusDirectory         *directory,
+								       gconstpointer              client);
 void               nautilus_directory_monitor_remove_internal         (NautilusDirectory         *directory,
 								       NautilusFile              *file,
 								       gconstpointer              client);
@@ -223,3 +235,20 @@ void               nautilus_directory_remove_file_from_work_queue     (NautilusD
 
 /* debugging functions */
 int                nautilus_directory_number_outstanding              (void);
+
+typedef struct
+{
+	guint running;
+	guint max_running;
+	guint waiting;
+	guint max_waiting;
+	guint64 n_waits;
+	gint64 total_wait_time; /* in microseconds */
+	gint64 max_wait_time;
+} NautilusAsyncJobStatistics;
+
+void               nautilus_directory_get_async_job_statistics        (NautilusAsyncJobStatistics *statistics);
+
+/* nautilus_directory_set_max_jobs_per_directory() is for testing purposes only */
+void               nautilus_directory_set_max_jobs_per_directory      (RequestType                 type,
+								       guint                       max_jobs);
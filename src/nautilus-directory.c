@@ -59,6 +59,14 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
 static GHashTable *directories;
 
+/* Directories that were displayed recently are kept loaded and monitored, so
+ * that going back to them doesn't require reading them again. The most
+ * recently displayed one is at the head. Both the number of directories and
+ * the number of files they hold are bounded. */
+#define MAX_RETAINED_DIRECTORIES 8
+#define MAX_RETAINED_FILES 100000
+static GQueue retained_directories = G_QUEUE_INIT;
+
 static NautilusDirectory *nautilus_directory_new (GFile *location);
 static void               set_directory_location (NautilusDirectory *directory,
                                                   GFile             *location);
@@ -169,7 +177,6 @@ nautilus_directory_finalize (GObject *object)
     g_hash_table_remove (directories, directory->details->location);
 
     nautilus_directory_cancel (directory);
-    g_assert (directory->details->count_in_progress == NULL);
 
     if (g_hash_table_size (directory->details->monitor_table) != 0)
     {
@@ -187,6 +194,9 @@ nautilus_directory_finalize (GObject *object)
         g_hash_table_remove_all (directory->details->monitor_table);
     }
     g_hash_table_destroy (directory->details->monitor_table);
+    g_clear_pointer (&directory->details->call_when_ready_index, g_hash_table_destroy);
+    g_hash_table_destroy (directory->details->call_when_ready_counts);
+    g_hash_table_destroy (directory->details->call_when_ready_changed_files);
 
     if (directory->details->monitor != NULL)
     {
@@ -216,7 +226,13 @@ nautilus_directory_finalize (GObject *object)
     nautilus_file_queue_destroy (directory->details->extension_queue);
     g_clear_list (&directory->details->files_changed_while_adding, g_object_unref);
     g_assert (directory->details->directory_load_in_progress == NULL);
-    g_assert (directory->details->count_in_progress == NULL);
+    g_assert (g_hash_table_size (directory->details->count_in_progress) == 0);
+    g_hash_table_destroy (directory->details->count_in_progress);
+    g_hash_table_destroy (directory->details->get_info_in_progress);
+    g_hash_table_destroy (directory->details->thumbnail_in_progress);
+    g_hash_table_destroy (directory->details->mount_in_progress);
+    g_hash_table_destroy (directory->details->filesystem_info_in_progress);
+    g_hash_table_destroy (directory->details->extension_info_in_progress);
     g_assert (directory->details->dequeue_pending_idle_id == 0);
     g_list_free_full (directory->details->pending_file_info, g_object_unref);
 
@@ -343,6 +359,14 @@ nautilus_directory_init (NautilusDirectory *directory)
     directory->details->low_priority_queue = nautilus_file_queue_new ();
     directory->details->extension_queue = nautilus_file_queue_new ();
     directory->details->monitor_table = g_hash_table_new (NULL, NULL);
+    directory->details->call_when_ready_counts = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+    directory->details->call_when_ready_changed_files = g_hash_table_new (NULL, NULL);
+    directory->details->count_in_progress = g_hash_table_new (NULL, NULL);
+    directory->details->get_info_in_progress = g_hash_table_new (NULL, NULL);
+    directory->details->thumbnail_in_progress = g_hash_table_new (NULL, NULL);
+    directory->details->mount_in_progress = g_hash_table_new (NULL, NULL);
+    directory->details->filesystem_info_in_progress = g_hash_table_new (NULL, NULL);
+    directory->details->extension_info_in_progress = g_hash_table_new (NULL, NULL);
 }
 
 NautilusDirectory *
@@ -541,6 +565,87 @@ nautilus_directory_get_internal (GFile    *location,
     return directory;
 }
 
+static void
+release_retained_directory (NautilusDirectory *directory)
+{
+    nautilus_directory_file_monitor_remove (directory, &retained_directories);
+    nautilus_directory_unref (directory);
+}
+
+/**
+ * nautilus_directory_retain:
+ * @directory: a #NautilusDirectory that is no longer displayed
+ * @attributes: the attributes that were monitored to display it
+ *
+ * Keeps @directory loaded and monitored for a while, so that displaying it
+ * again is instant. The least recently displayed directories are released
+ * when there are too many of them or too many files in them.
+ */
+void
+nautilus_directory_retain (NautilusDirectory      *directory,
+                           NautilusFileAttributes  attributes)
+{
+    guint n_files;
+
+    g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+
+    /* Only complete, local listings are worth keeping: monitoring remote
+     * locations is costly and partial ones are going to be read again anyway. */
+    if (!g_file_is_native (directory->details->location) ||
+        !nautilus_directory_are_all_files_seen (directory))
+    {
+        return;
+    }
+
+    if (g_queue_remove (&retained_directories, directory))
+    {
+        g_queue_push_head (&retained_directories, directory);
+        return;
+    }
+
+    /* Include the hidden files, so that the directory can be displayed
+     * either way. */
+    nautilus_directory_file_monitor_add (directory, &retained_directories, TRUE,
+                                         attributes, NULL, NULL);
+    /* Refreshing it must not get ahead of the displayed directories. */
+    nautilus_directory_monitor_set_background (directory, &retained_directories);
+    g_queue_push_head (&retained_directories, nautilus_directory_ref (directory));
+
+    n_files = 0;
+    for (GList *l = retained_directories.head; l != NULL; l = l->next)
+    {
+        NautilusDirectory *retained = l->data;
+
+        n_files += g_hash_table_size (retained->details->file_hash);
+    }
+
+    while (retained_directories.length > 1 &&
+           (retained_directories.length > MAX_RETAINED_DIRECTORIES ||
+            n_files > MAX_RETAINED_FILES))
+    {
+        NautilusDirectory *oldest = g_queue_pop_tail (&retained_directories);
+
+        n_files -= g_hash_table_size (oldest->details->file_hash);
+        release_retained_directory (oldest);
+    }
+}
+
+/**
+ * nautilus_directory_release_all_retained:
+ *
+ * Releases all the directories kept by nautilus_directory_retain().
+ */
+void
+nautilus_directory_release_all_retained (void)
+{
+    NautilusDirectory *directory;
+
+    while ((directory = g_queue_pop_head (&retained_directories)) != NULL)
+    {
+        release_retained_directory (directory);
+    }
+}
+
 NautilusDirectory *
 nautilus_directory_get (GFile *location)
 {
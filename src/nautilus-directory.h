@@ -210,6 +210,11 @@ void               nautilus_directory_file_monitor_remove      (NautilusDirector
 								gconstpointer              client);
 void               nautilus_directory_force_reload             (NautilusDirectory         *directory);
 
+/* Keep a directory that is no longer displayed loaded for a while. */
+void               nautilus_directory_retain                   (NautilusDirectory         *directory,
+								NautilusFileAttributes     attributes);
+void               nautilus_directory_release_all_retained     (void);
+
 /* Get a list of all files currently known in the directory. */
 GList *            nautilus_directory_get_file_list            (NautilusDirectory         *directory);
 
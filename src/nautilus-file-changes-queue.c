@@ -288,6 +288,8 @@ nautilus_file_changes_consume_changes (void)
             if (moves != NULL)
             {
                 moves = g_list_reverse (moves);
+                nautilus_tag_manager_update_moved_uris_list (nautilus_tag_manager_get (),
+                                                             moves);
                 nautilus_directory_notify_files_moved (moves);
                 pairs_list_free (moves);
                 moves = NULL;
@@ -344,10 +346,6 @@ nautilus_file_changes_consume_changes (void)
 
             case CHANGE_FILE_MOVED:
             {
-                nautilus_tag_manager_update_moved_uris (nautilus_tag_manager_get (),
-                                                        change->from,
-                                                        change->to);
-
                 pair = g_new (GFilePair, 1);
                 pair->from = change->from;
                 pair->to = change->to;
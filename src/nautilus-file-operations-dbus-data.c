@@ -25,6 +25,9 @@ struct _NautilusFileOperationsDBusData
     char *parent_handle;
 
     guint32 timestamp;
+
+    /* The operation started with this data, if any */
+    NautilusProgressInfo *progress_info;
 };
 
 NautilusFileOperationsDBusData *
@@ -58,6 +61,7 @@ nautilus_file_operations_dbus_data_unref (NautilusFileOperationsDBusData *self)
     if (g_atomic_ref_count_dec (&self->ref_count))
     {
         g_free (self->parent_handle);
+        g_clear_object (&self->progress_info);
         g_free (self);
     }
 }
@@ -73,3 +77,16 @@ nautilus_file_operations_dbus_data_get_timestamp (NautilusFileOperationsDBusData
 {
     return self->timestamp;
 }
+
+void
+nautilus_file_operations_dbus_data_set_progress_info (NautilusFileOperationsDBusData *self,
+                                                      NautilusProgressInfo           *progress_info)
+{
+    g_set_object (&self->progress_info, progress_info);
+}
+
+NautilusProgressInfo *
+nautilus_file_operations_dbus_data_get_progress_info (NautilusFileOperationsDBusData *self)
+{
+    return self->progress_info;
+}
@@ -19,6 +19,8 @@
 
 #include <glib.h>
 
+#include "nautilus-progress-info.h"
+
 typedef struct _NautilusFileOperationsDBusData NautilusFileOperationsDBusData;
 
 NautilusFileOperationsDBusData *nautilus_file_operations_dbus_data_new               (GVariant                       *platform_data);
@@ -31,4 +33,9 @@ const char                     *nautilus_file_operations_dbus_data_get_parent_ha
 
 guint32                         nautilus_file_operations_dbus_data_get_timestamp     (NautilusFileOperationsDBusData *self);
 
+void                            nautilus_file_operations_dbus_data_set_progress_info (NautilusFileOperationsDBusData *self,
+                                                                                      NautilusProgressInfo           *progress_info);
+
+NautilusProgressInfo           *nautilus_file_operations_dbus_data_get_progress_info (NautilusFileOperationsDBusData *self);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusFileOperationsDBusData, nautilus_file_operations_dbus_data_unref)
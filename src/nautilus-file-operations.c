@@ -29,7 +29,12 @@
 #include <math.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <archive.h>
+#include <archive_entry.h>
 
 #include "nautilus-file-operations.h"
 
@@ -84,6 +89,16 @@ typedef struct
     gboolean merge_all;
     gboolean replace_all;
     gboolean delete_all;
+
+    /* Device queue, see run_queued_job_in_thread() */
+    GTaskThreadFunc queued_func;
+    const char *queue_class;
+    GList *queue_locations;
+    GList *queue_sources; /* Only kept for jobs that may be small */
+    GStrv queue_devices; /* Set once resolved */
+    gboolean queue_admitted;
+    GTask *queue_task; /* Until started */
+    gulong queue_cancelled_id;
 } CommonJob;
 
 typedef struct
@@ -94,6 +109,7 @@ typedef struct
     GFile *destination;
     GFile *fake_display_source;
     GHashTable *debuting_files;
+    GHashTable *name_snapshots; /* GFile dest dir -> NautilusNameSnapshot */
     gchar *target_name;
     NautilusCopyCallback done_callback;
     gpointer done_callback_data;
@@ -153,8 +169,20 @@ typedef struct
     guint32 file_mask;
     guint32 dir_permissions;
     guint32 dir_mask;
+
+    /* Local fast path, see set_permissions_local() */
+    GThreadPool *pool;
+    GMutex mutex;
+    GCond cond;
+    guint pending_dirs;
 } SetPermissionsJob;
 
+typedef struct
+{
+    int fd;
+    char *path;
+} SetPermissionsDir;
+
 typedef enum
 {
     OP_KIND_COPY,
@@ -203,20 +231,39 @@ typedef struct
     CommonJob common;
     GList *source_files;
     GFile *destination_directory;
-    GList *output_files;
-    gboolean destination_decided;
-    gboolean extraction_failed;
-
-    gdouble base_progress;
 
-    guint64 archive_compressed_size;
+    /* Archives are extracted by several workers at once; this protects
+     * everything below, which they all update. */
+    GMutex mutex;
+    GList *output_files;
+    NautilusNameSnapshot *destination_names;
     guint64 total_compressed_size;
+    guint64 completed_compressed_size;
     gint total_files;
+    gint finished_files;
+
+    /* Held while asking the user anything, so that the questions about
+     * different archives come one at a time. */
+    GMutex interaction_mutex;
 
     NautilusExtractCallback done_callback;
     gpointer done_callback_data;
 } ExtractJob;
 
+typedef struct
+{
+    ExtractJob *extract_job;
+    GFile *source_file;
+    guint64 compressed_size;
+    /* How much of the compressed size was accounted as completed */
+    guint64 consumed_size;
+    gint64 last_notify_time;
+
+    GFile *output_file;
+    gchar *passphrase;
+    GError *error;
+} ArchiveExtraction;
+
 typedef struct
 {
     CommonJob common;
@@ -263,6 +310,7 @@ G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (SourceInfo, source_info_clear)
 #define SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE 8
 #define NSEC_PER_MICROSEC 1000
 #define PROGRESS_NOTIFY_INTERVAL 100 * NSEC_PER_MICROSEC
+#define MAX_EXTRACT_WORKERS 4
 #define LONG_JOB_THRESHOLD_IN_SECONDS 2
 
 #define MAXIMUM_DISPLAYED_FILE_NAME_LENGTH 50
@@ -543,12 +591,14 @@ init_common (gsize                           job_size,
                                    (gpointer *) &common->parent_window);
     }
 
+    common->progress = nautilus_progress_info_new ();
+
     if (dbus_data)
     {
         common->dbus_data = nautilus_file_operations_dbus_data_ref (dbus_data);
+        nautilus_file_operations_dbus_data_set_progress_info (dbus_data, common->progress);
     }
 
-    common->progress = nautilus_progress_info_new ();
     common->cancellable = nautilus_progress_info_get_cancellable (common->progress);
     common->time = g_timer_new ();
     common->inhibit_cookie = 0;
@@ -590,6 +640,10 @@ finalize_common (CommonJob *common)
         g_hash_table_destroy (common->skip_readdir_error);
     }
 
+    g_list_free_full (common->queue_locations, g_object_unref);
+    g_list_free_full (common->queue_sources, g_object_unref);
+    g_strfreev (common->queue_devices);
+
     if (common->undo_info != NULL)
     {
         nautilus_file_undo_manager_set_action (common->undo_info);
@@ -888,6 +942,16 @@ do_run_simple_dialog (gpointer _data)
     return FALSE;
 }
 
+/* Button answered in place of showing dialogs, see
+ * nautilus_file_operations_set_dialog_answer_for_testing() */
+static const char *dialog_answer_for_testing = NULL;
+
+void
+nautilus_file_operations_set_dialog_answer_for_testing (const char *button_title)
+{
+    dialog_answer_for_testing = button_title;
+}
+
 /* NOTE: This frees the primary / secondary strings, in order to
  *  avoid doing that everywhere. So, make sure they are strduped */
 
@@ -927,23 +991,47 @@ run_simple_dialog_va (CommonJob      *job,
     g_ptr_array_add (ptr_array, NULL);
     data->button_titles = (const char **) g_ptr_array_free (ptr_array, FALSE);
 
-    nautilus_progress_info_pause (job->progress);
+    g_mutex_lock (&data->mutex);
+
+    if (dialog_answer_for_testing != NULL)
+    {
+        res = -1;
+        for (int i = 0; data->button_titles[i] != NULL; i++)
+        {
+            if (g_strcmp0 (data->button_titles[i], dialog_answer_for_testing) == 0)
+            {
+                res = i;
+            }
+        }
+    }
+    else
+    {
+        nautilus_progress_info_pause (job->progress);
 
-    data->should_start_inactive = is_long_job (job);
+        data->should_start_inactive = is_long_job (job);
 
-    g_mutex_lock (&data->mutex);
+        g_main_context_invoke (NULL,
+                               do_run_simple_dialog,
+                               data);
 
-    g_main_context_invoke (NULL,
-                           do_run_simple_dialog,
-                           data);
+        while (!data->completed)
+        {
+            g_cond_wait (&data->cond, &data->mutex);
+        }
 
-    while (!data->completed)
-    {
-        g_cond_wait (&data->cond, &data->mutex);
+        nautilus_progress_info_resume (job->progress);
+        res = data->result;
     }
 
-    nautilus_progress_info_resume (job->progress);
-    res = data->result;
+    /* Skipped files weren't handled, so the job won't have done everything
+     * it was asked to. Confirmations and warnings which were answered to go
+     * on leave it complete. */
+    button_title = res >= 0 ? data->button_titles[res] : NULL;
+    if (g_strcmp0 (button_title, SKIP) == 0 ||
+        g_strcmp0 (button_title, SKIP_ALL) == 0)
+    {
+        nautilus_progress_info_set_incomplete (job->progress);
+    }
 
     g_mutex_unlock (&data->mutex);
     g_mutex_clear (&data->mutex);
@@ -1101,6 +1189,9 @@ inhibit_power_manager (CommonJob  *job,
 static void
 abort_job (CommonJob *job)
 {
+    /* Whatever is left won't be done */
+    nautilus_progress_info_set_incomplete (job->progress);
+
     /* destroy the undo action data too */
     g_clear_object (&job->undo_info);
 
@@ -1113,6 +1204,374 @@ job_aborted (CommonJob *job)
     return g_cancellable_is_cancelled (job->cancellable);
 }
 
+/* Copies, moves, trashing and deleting can all be started much faster than the
+ * disks involved can serve them, and running them all at once only makes each
+ * of them slower. So at most MAX_JOBS_PER_DEVICE jobs of the same class run on
+ * any one filesystem, be it a source or the destination; the others wait in
+ * the order they were started, shown as queued. Transfers and removals are
+ * separate classes, so that trashing a file doesn't wait for a large copy.
+ * Two jobs per device keep a small copy from waiting for the whole of a
+ * large one, and jobs of a few small files don't wait at all.
+ */
+#define MAX_JOBS_PER_DEVICE 2
+#define SMALL_JOB_MAX_SOURCES 8
+#define SMALL_JOB_MAX_BYTES (16 * 1024 * 1024)
+
+#define QUEUE_CLASS_TRANSFER "transfer"
+#define QUEUE_CLASS_REMOVAL "removal"
+
+/* Jobs only get a thread once admitted, so that waiting ones don't tie up
+ * the threads GIO shares with everything else. */
+static GMutex device_queue_mutex;
+/* "class:filesystem-id" -> number of admitted jobs */
+static GHashTable *device_jobs = NULL;
+/* CommonJob, waiting to be admitted, in submission order */
+static GQueue device_queue = G_QUEUE_INIT;
+
+static GStrv
+resolve_queue_devices (CommonJob *job)
+{
+    g_autoptr (GHashTable) devices = NULL;
+    g_autoptr (GStrvBuilder) builder = NULL;
+    GHashTableIter iter;
+    const char *device;
+
+    devices = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (GList *l = job->queue_locations; l != NULL && !job_aborted (job); l = l->next)
+    {
+        g_autoptr (GFile) location = g_object_ref (l->data);
+
+        /* Destinations may not exist yet, so fall back to their ancestors. */
+        while (location != NULL)
+        {
+            GFile *parent;
+            g_autoptr (GFileInfo) info = NULL;
+            const char *fs_id;
+
+            info = g_file_query_info (location,
+                                      G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+                                      G_FILE_QUERY_INFO_NONE,
+                                      job->cancellable,
+                                      NULL);
+            fs_id = info != NULL ?
+                    g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM) :
+                    NULL;
+            if (fs_id != NULL)
+            {
+                g_hash_table_add (devices,
+                                  g_strconcat (job->queue_class, ":", fs_id, NULL));
+                break;
+            }
+
+            parent = g_file_get_parent (location);
+            g_object_unref (location);
+            location = parent;
+        }
+    }
+
+    builder = g_strv_builder_new ();
+    g_hash_table_iter_init (&iter, devices);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &device, NULL))
+    {
+        g_strv_builder_add (builder, device);
+    }
+
+    return g_strv_builder_end (builder);
+}
+
+/* Whether the job only handles a few files which are not directories, and
+ * small enough to not hold up other jobs. */
+static gboolean
+job_is_small (CommonJob *job)
+{
+    goffset total_size = 0;
+
+    if (job->queue_sources == NULL)
+    {
+        return FALSE;
+    }
+
+    for (GList *l = job->queue_sources; l != NULL; l = l->next)
+    {
+        g_autoptr (GFileInfo) info = NULL;
+
+        info = g_file_query_info (l->data,
+                                  G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                                  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                  job->cancellable,
+                                  NULL);
+        if (info == NULL || g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+        {
+            return FALSE;
+        }
+
+        total_size += g_file_info_get_size (info);
+        if (total_size > SMALL_JOB_MAX_BYTES)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Called with device_queue_mutex held */
+static gboolean
+device_queue_can_admit (CommonJob *job)
+{
+    /* Jobs started earlier on any of the same devices go first. */
+    for (GList *l = device_queue.head; l != NULL && l->data != job; l = l->next)
+    {
+        CommonJob *earlier = l->data;
+
+        if (earlier->queue_devices == NULL)
+        {
+            continue;
+        }
+
+        for (char **device = job->queue_devices; *device != NULL; device++)
+        {
+            if (g_strv_contains ((const char * const *) earlier->queue_devices, *device))
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    for (char **device = job->queue_devices; *device != NULL; device++)
+    {
+        if (GPOINTER_TO_UINT (g_hash_table_lookup (device_jobs, *device)) >= MAX_JOBS_PER_DEVICE)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Called with device_queue_mutex held. Takes the jobs which may run now out
+ * of the queue, for the caller to start once the lock is released. Cancelled
+ * jobs are taken too, without being admitted, so that they can finish. */
+static GList *
+device_queue_take_runnable (void)
+{
+    GList *runnable = NULL;
+    GList *next;
+
+    for (GList *l = device_queue.head; l != NULL; l = next)
+    {
+        CommonJob *job = l->data;
+
+        next = l->next;
+
+        /* Jobs whose devices are still being resolved wait for that. */
+        if (job->queue_devices == NULL ||
+            (!job_aborted (job) && !device_queue_can_admit (job)))
+        {
+            continue;
+        }
+
+        g_queue_delete_link (&device_queue, l);
+
+        if (!job_aborted (job))
+        {
+            job->queue_admitted = TRUE;
+            for (char **device = job->queue_devices; *device != NULL; device++)
+            {
+                guint count = GPOINTER_TO_UINT (g_hash_table_lookup (device_jobs, *device));
+
+                g_hash_table_insert (device_jobs, g_strdup (*device), GUINT_TO_POINTER (count + 1));
+            }
+        }
+
+        runnable = g_list_prepend (runnable, job);
+    }
+
+    return g_list_reverse (runnable);
+}
+
+static void
+queued_job_thread_func (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable);
+
+static void
+device_queue_start (GList *jobs)
+{
+    for (GList *l = jobs; l != NULL; l = l->next)
+    {
+        CommonJob *job = l->data;
+        g_autoptr (GTask) task = g_steal_pointer (&job->queue_task);
+
+        nautilus_progress_info_set_queued (job->progress, FALSE);
+        g_task_run_in_thread (task, queued_job_thread_func);
+    }
+
+    g_list_free (jobs);
+}
+
+static void
+device_queue_job_cancelled (GCancellable *cancellable,
+                            gpointer      user_data)
+{
+    GList *runnable;
+
+    g_mutex_lock (&device_queue_mutex);
+    runnable = device_queue_take_runnable ();
+    g_mutex_unlock (&device_queue_mutex);
+
+    device_queue_start (runnable);
+}
+
+/* Resolving the devices of a job takes a few queries, so it's done in a
+ * thread, which is then let go whether the job may run or not. */
+static void
+device_queue_enter_thread_func (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
+{
+    CommonJob *job = task_data;
+    GStrv devices;
+    GList *runnable;
+
+    /* Small jobs don't count against any device. */
+    devices = job_is_small (job) ? g_new0 (char *, 1) : resolve_queue_devices (job);
+
+    /* Called right away if already cancelled, while the job isn't runnable
+     * yet, so it's taken below. */
+    job->queue_cancelled_id = g_cancellable_connect (job->cancellable,
+                                                     G_CALLBACK (device_queue_job_cancelled),
+                                                     NULL, NULL);
+
+    g_mutex_lock (&device_queue_mutex);
+
+    job->queue_devices = devices;
+    runnable = device_queue_take_runnable ();
+
+    if (g_list_find (runnable, job) == NULL && g_queue_find (&device_queue, job) != NULL)
+    {
+        nautilus_progress_info_start (job->progress);
+        nautilus_progress_info_set_status (job->progress,
+                                           _("Waiting for other operations on the same disk"));
+        nautilus_progress_info_set_queued (job->progress, TRUE);
+    }
+
+    g_mutex_unlock (&device_queue_mutex);
+
+    device_queue_start (runnable);
+}
+
+static void
+device_queue_leave (CommonJob *job)
+{
+    GList *runnable = NULL;
+
+    g_mutex_lock (&device_queue_mutex);
+
+    if (job->queue_admitted)
+    {
+        job->queue_admitted = FALSE;
+        for (char **device = job->queue_devices; *device != NULL; device++)
+        {
+            guint count = GPOINTER_TO_UINT (g_hash_table_lookup (device_jobs, *device));
+
+            if (count > 1)
+            {
+                g_hash_table_insert (device_jobs, g_strdup (*device), GUINT_TO_POINTER (count - 1));
+            }
+            else
+            {
+                g_hash_table_remove (device_jobs, *device);
+            }
+        }
+
+        /* Leaving may let later jobs through. */
+        runnable = device_queue_take_runnable ();
+    }
+
+    g_mutex_unlock (&device_queue_mutex);
+
+    device_queue_start (runnable);
+}
+
+static void
+queued_job_thread_func (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+    CommonJob *job = task_data;
+
+    g_cancellable_disconnect (job->cancellable, job->queue_cancelled_id);
+    job->queue_cancelled_id = 0;
+
+    job->queued_func (task, source_object, task_data, cancellable);
+    device_queue_leave (job);
+}
+
+/* Runs @func in a thread like g_task_run_in_thread(), once the devices of
+ * @sources and @destination (which may be %NULL) have room for another job
+ * of @queue_class. Until then, the job doesn't hold a thread. The task data
+ * must be the job. */
+static void
+run_queued_job_in_thread (GTask           *task,
+                          GTaskThreadFunc  func,
+                          const char      *queue_class,
+                          GList           *sources,
+                          GFile           *destination)
+{
+    CommonJob *job = g_task_get_task_data (task);
+    g_autoptr (GHashTable) seen = NULL;
+    g_autoptr (GTask) enter_task = NULL;
+
+    job->queued_func = func;
+    job->queue_class = queue_class;
+
+    if (g_list_length (sources) <= SMALL_JOB_MAX_SOURCES)
+    {
+        job->queue_sources = g_list_copy_deep (sources, (GCopyFunc) g_object_ref, NULL);
+    }
+
+    /* Querying every source would be a round-trip per file, while selections
+     * almost always share a few parent directories. */
+    seen = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+    for (GList *l = sources; l != NULL; l = l->next)
+    {
+        g_autoptr (GFile) parent = g_file_get_parent (l->data);
+        GFile *location = parent != NULL ? parent : l->data;
+
+        if (!g_hash_table_contains (seen, location))
+        {
+            job->queue_locations = g_list_prepend (job->queue_locations,
+                                                   g_object_ref (location));
+            g_hash_table_add (seen, job->queue_locations->data);
+        }
+    }
+    if (destination != NULL)
+    {
+        job->queue_locations = g_list_prepend (job->queue_locations,
+                                               g_object_ref (destination));
+    }
+
+    job->queue_task = g_object_ref (task);
+
+    g_mutex_lock (&device_queue_mutex);
+    if (device_jobs == NULL)
+    {
+        device_jobs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    }
+    g_queue_push_tail (&device_queue, job);
+    g_mutex_unlock (&device_queue_mutex);
+
+    enter_task = g_task_new (NULL, NULL, NULL, NULL);
+    g_task_set_task_data (enter_task, job, NULL);
+    g_task_run_in_thread (enter_task, device_queue_enter_thread_func);
+}
+
 static gboolean
 confirm_delete_from_trash (CommonJob *job,
                            GList     *files)
@@ -1233,6 +1692,7 @@ report_delete_progress (CommonJob    *job,
     DeleteJob *delete_job;
 
     delete_job = (DeleteJob *) job;
+    nautilus_progress_info_wait_while_held (job->progress);
     now = g_get_monotonic_time ();
     files_left = source_info->num_files - transfer_info->num_files;
 
@@ -1666,6 +2126,7 @@ report_trash_progress (CommonJob    *job,
     DeleteJob *delete_job;
 
     delete_job = (DeleteJob *) job;
+    nautilus_progress_info_wait_while_held (job->progress);
     now = g_get_monotonic_time ();
     files_left = source_info->num_files - transfer_info->num_files;
 
@@ -1826,6 +2287,7 @@ trash_file (CommonJob     *job,
     char *primary, *secondary, *details;
     int response;
     g_autofree gchar *basename = NULL;
+    guint64 inode = 0;
 
     if (should_skip_file (job, file))
     {
@@ -1835,6 +2297,20 @@ trash_file (CommonJob     *job,
 
     error = NULL;
 
+    if (job->undo_info != NULL)
+    {
+        /* Moving to the home trash keeps the inode, which tells the item
+         * apart from others trashed from the same location. */
+        g_autoptr (GFileInfo) info = g_file_query_info (file, G_FILE_ATTRIBUTE_UNIX_INODE,
+                                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                        job->cancellable, NULL);
+
+        if (info != NULL)
+        {
+            inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+        }
+    }
+
     if (g_file_trash (file, job->cancellable, &error))
     {
         transfer_info->num_files++;
@@ -1842,7 +2318,8 @@ trash_file (CommonJob     *job,
 
         if (job->undo_info != NULL)
         {
-            nautilus_file_undo_info_trash_add_file (NAUTILUS_FILE_UNDO_INFO_TRASH (job->undo_info), file);
+            nautilus_file_undo_info_trash_add_file (NAUTILUS_FILE_UNDO_INFO_TRASH (job->undo_info),
+                                                    file, inode);
         }
 
         report_trash_progress (job, source_info, transfer_info);
@@ -2132,6 +2609,7 @@ trash_or_delete_internal (GTask        *task,
         else
         {
             job->user_cancel = TRUE;
+            nautilus_progress_info_set_incomplete (common->progress);
         }
     }
 
@@ -2233,7 +2711,8 @@ trash_or_delete_internal_async (GList                          *files,
 
     task = g_task_new (NULL, NULL, delete_task_done, job);
     g_task_set_task_data (task, job, NULL);
-    g_task_run_in_thread (task, trash_or_delete_internal);
+    run_queued_job_in_thread (task, trash_or_delete_internal,
+                              QUEUE_CLASS_REMOVAL, job->files, NULL);
     g_object_unref (task);
 }
 
@@ -3466,6 +3945,10 @@ report_copy_progress (CopyMoveJob  *copy_job,
 
     job = (CommonJob *) copy_job;
 
+    /* Progress is reported at least once per chunk, so this is where a
+     * paused operation stops. */
+    nautilus_progress_info_wait_while_held (job->progress);
+
     is_move = copy_job->is_move;
 
     now = g_get_monotonic_time ();
@@ -3850,42 +4333,26 @@ make_file_name_valid_for_dest_fs (char       *filename,
 }
 
 static GFile *
-get_unique_target_file (GFile        *src,
-                        GFile        *dest_dir,
-                        GCancellable *cancellable,
-                        gboolean      same_fs,
-                        const char   *dest_fs_type,
-                        int           count)
-{
-    const char *editname, *end;
+build_unique_target_file (GFile      *src,
+                          GFile      *dest_dir,
+                          const char *editname,
+                          gboolean    ignore_extension,
+                          int         max_length,
+                          const char *dest_fs_type,
+                          int         count)
+{
+    const char *end;
     char *basename, *new_name;
-    GFileInfo *info;
     GFile *dest;
-    int max_length;
-    gboolean ignore_extension = FALSE;
-
-    max_length = nautilus_get_max_child_name_length_for_location (dest_dir);
 
     dest = NULL;
-    info = g_file_query_info (src,
-                              G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME ","
-                              G_FILE_ATTRIBUTE_STANDARD_TYPE,
-                              0, cancellable, NULL);
-    if (info != NULL)
+    if (editname != NULL)
     {
-        ignore_extension = (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY);
-        editname = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME);
-
-        if (editname != NULL)
-        {
-            new_name = nautilus_filename_for_copy (editname, count, max_length, ignore_extension);
-            make_file_name_valid_for_dest_fs (new_name, dest_fs_type);
-            dest = g_file_get_child_for_display_name (dest_dir, new_name, NULL);
-            g_free (new_name);
-        }
-
-        g_object_unref (info);
-    }
+        new_name = nautilus_filename_for_copy (editname, count, max_length, ignore_extension);
+        make_file_name_valid_for_dest_fs (new_name, dest_fs_type);
+        dest = g_file_get_child_for_display_name (dest_dir, new_name, NULL);
+        g_free (new_name);
+    }
 
     if (dest == NULL)
     {
@@ -3919,6 +4386,64 @@ get_unique_target_file (GFile        *src,
     return dest;
 }
 
+/* Picks the first copy name from *count on that isn't taken according to
+ * @snapshot, claims it and advances *count past it. The caller still has to
+ * handle G_IO_ERROR_EXISTS, as the snapshot may be stale.
+ */
+static GFile *
+get_unique_target_file (GFile                *src,
+                        GFile                *dest_dir,
+                        NautilusNameSnapshot *snapshot,
+                        GCancellable         *cancellable,
+                        gboolean              same_fs,
+                        const char           *dest_fs_type,
+                        int                  *count)
+{
+    g_autoptr (GFileInfo) info = NULL;
+    g_autofree char *src_basename = NULL;
+    const char *editname = NULL;
+    GFile *dest;
+    int max_length;
+    gboolean ignore_extension = FALSE;
+
+    max_length = nautilus_get_max_child_name_length_for_location (dest_dir);
+
+    info = g_file_query_info (src,
+                              G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME ","
+                              G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                              0, cancellable, NULL);
+    if (info != NULL)
+    {
+        ignore_extension = (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY);
+        editname = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_EDIT_NAME);
+    }
+
+    src_basename = g_file_get_basename (src);
+    *count = MAX (*count, nautilus_name_snapshot_get_next_count (snapshot, src_basename));
+
+    while (TRUE)
+    {
+        g_autofree char *dest_basename = NULL;
+
+        dest = build_unique_target_file (src, dest_dir, editname, ignore_extension,
+                                         max_length, dest_fs_type, *count);
+        *count += 1;
+
+        dest_basename = g_file_get_basename (dest);
+        if (nautilus_name_snapshot_claim (snapshot, dest_basename) ||
+            g_cancellable_is_cancelled (cancellable))
+        {
+            break;
+        }
+
+        g_object_unref (dest);
+    }
+
+    nautilus_name_snapshot_set_next_count (snapshot, src_basename, *count);
+
+    return dest;
+}
+
 static GFile *
 get_target_file_for_link (GFile      *src,
                           GFile      *dest_dir,
@@ -4759,6 +5284,29 @@ query_fs_type (GFile        *file,
     return ret;
 }
 
+static NautilusNameSnapshot *
+get_name_snapshot (CopyMoveJob *job,
+                   GFile       *dest_dir)
+{
+    NautilusNameSnapshot *snapshot;
+
+    if (job->name_snapshots == NULL)
+    {
+        job->name_snapshots = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                     g_object_unref,
+                                                     (GDestroyNotify) nautilus_name_snapshot_free);
+    }
+
+    snapshot = g_hash_table_lookup (job->name_snapshots, dest_dir);
+    if (snapshot == NULL)
+    {
+        snapshot = nautilus_name_snapshot_new (dest_dir, job->common.cancellable);
+        g_hash_table_insert (job->name_snapshots, g_object_ref (dest_dir), snapshot);
+    }
+
+    return snapshot;
+}
+
 static FileConflictResponse *
 handle_copy_move_conflict (CommonJob *job,
                            GFile     *src,
@@ -4777,7 +5325,8 @@ handle_copy_move_conflict (CommonJob *job,
     should_start_inactive = is_long_job (job);
 
     basename = g_file_get_basename (dest);
-    suggested_file = nautilus_generate_unique_file_in_directory (dest_dir, basename);
+    suggested_file = nautilus_name_snapshot_generate_unique_file (get_name_snapshot ((CopyMoveJob *) job, dest_dir),
+                                                                  basename);
     suggestion = g_file_get_basename (suggested_file);
 
     response = copy_move_conflict_ask_user_action (job->parent_window,
@@ -4907,7 +5456,8 @@ copy_move_file (CopyMoveJob   *copy_job,
 
     if (unique_names)
     {
-        dest = get_unique_target_file (src, dest_dir, job->cancellable, same_fs, *dest_fs_type, unique_name_nr++);
+        dest = get_unique_target_file (src, dest_dir, get_name_snapshot (copy_job, dest_dir),
+                                       job->cancellable, same_fs, *dest_fs_type, &unique_name_nr);
     }
     else if (copy_job->target_name != NULL)
     {
@@ -5113,7 +5663,8 @@ retry:
 
         if (unique_names)
         {
-            new_dest = get_unique_target_file (src, dest_dir, job->cancellable, same_fs, *dest_fs_type, unique_name_nr);
+            new_dest = get_unique_target_file (src, dest_dir, get_name_snapshot (copy_job, dest_dir),
+                                               job->cancellable, same_fs, *dest_fs_type, &unique_name_nr);
         }
         else
         {
@@ -5151,7 +5702,8 @@ retry:
         if (unique_names)
         {
             g_object_unref (dest);
-            dest = get_unique_target_file (src, dest_dir, job->cancellable, same_fs, *dest_fs_type, unique_name_nr++);
+            dest = get_unique_target_file (src, dest_dir, get_name_snapshot (copy_job, dest_dir),
+                                           job->cancellable, same_fs, *dest_fs_type, &unique_name_nr);
             goto retry;
         }
 
@@ -5490,6 +6042,7 @@ copy_task_done (GObject      *source_object,
         g_object_unref (job->destination);
     }
     g_hash_table_unref (job->debuting_files);
+    g_clear_pointer (&job->name_snapshots, g_hash_table_unref);
     g_free (job->target_name);
 
     g_clear_object (&job->fake_display_source);
@@ -5644,7 +6197,8 @@ nautilus_file_operations_copy_async (GList                          *files,
 
     task = g_task_new (NULL, job->common.cancellable, copy_task_done, job);
     g_task_set_task_data (task, job, NULL);
-    g_task_run_in_thread (task, nautilus_file_operations_copy);
+    run_queued_job_in_thread (task, nautilus_file_operations_copy,
+                              QUEUE_CLASS_TRANSFER, job->files, job->destination);
     g_object_unref (task);
 }
 
@@ -6153,6 +6707,7 @@ move_task_done (GObject      *source_object,
     g_list_free_full (job->files, g_object_unref);
     g_object_unref (job->destination);
     g_hash_table_unref (job->debuting_files);
+    g_clear_pointer (&job->name_snapshots, g_hash_table_unref);
 
     finalize_common ((CommonJob *) job);
 
@@ -6222,7 +6777,8 @@ nautilus_file_operations_move_async (GList                          *files,
 
     task = g_task_new (NULL, job->common.cancellable, move_task_done, job);
     g_task_set_task_data (task, job, NULL);
-    g_task_run_in_thread (task, nautilus_file_operations_move);
+    run_queued_job_in_thread (task, nautilus_file_operations_move,
+                              QUEUE_CLASS_TRANSFER, job->files, job->destination);
     g_object_unref (task);
 }
 
@@ -6709,7 +7265,8 @@ nautilus_file_operations_duplicate (GList                          *files,
 
     task = g_task_new (NULL, job->common.cancellable, copy_task_done, job);
     g_task_set_task_data (task, job, NULL);
-    g_task_run_in_thread (task, nautilus_file_operations_copy);
+    run_queued_job_in_thread (task, nautilus_file_operations_copy,
+                              QUEUE_CLASS_TRANSFER, job->files, NULL);
 }
 
 static void
@@ -6846,6 +7403,202 @@ set_permissions_file (SetPermissionsJob *job,
     }
 }
 
+/* Upper bound on directories waiting in the thread pool. Each of them holds
+ * an open fd, so once the queue is full, workers descend into subdirectories
+ * themselves instead of handing them off. */
+#define SET_PERMISSIONS_MAX_QUEUED_DIRS 64
+
+static void set_permissions_local_dir (SetPermissionsJob *job,
+                                       int                dir_fd,
+                                       const char        *dir_path);
+
+static gboolean
+set_permissions_local_queue_dir (SetPermissionsJob *job,
+                                 int                fd,
+                                 char              *path)
+{
+    SetPermissionsDir *dir;
+
+    g_mutex_lock (&job->mutex);
+    if (job->pending_dirs >= SET_PERMISSIONS_MAX_QUEUED_DIRS)
+    {
+        g_mutex_unlock (&job->mutex);
+        return FALSE;
+    }
+    job->pending_dirs++;
+    g_mutex_unlock (&job->mutex);
+
+    dir = g_new0 (SetPermissionsDir, 1);
+    dir->fd = fd;
+    dir->path = path;
+    g_thread_pool_push (job->pool, dir, NULL);
+
+    return TRUE;
+}
+
+static void
+set_permissions_local_worker (gpointer data,
+                              gpointer user_data)
+{
+    SetPermissionsDir *dir = data;
+    SetPermissionsJob *job = user_data;
+
+    /* Takes ownership of the fd */
+    set_permissions_local_dir (job, dir->fd, dir->path);
+
+    g_free (dir->path);
+    g_free (dir);
+
+    g_mutex_lock (&job->mutex);
+    job->pending_dirs--;
+    if (job->pending_dirs == 0)
+    {
+        g_cond_signal (&job->cond);
+    }
+    g_mutex_unlock (&job->mutex);
+}
+
+static void
+set_permissions_local_dir (SetPermissionsJob *job,
+                           int                dir_fd,
+                           const char        *dir_path)
+{
+    CommonJob *common;
+    DIR *dir;
+    struct dirent *entry;
+
+    common = (CommonJob *) job;
+
+    dir = fdopendir (dir_fd);
+    if (dir == NULL)
+    {
+        close (dir_fd);
+        return;
+    }
+
+    nautilus_progress_info_pulse_progress (common->progress);
+
+    while (!job_aborted (common) && (entry = readdir (dir)) != NULL)
+    {
+        struct stat statbuf;
+        guint32 value;
+        guint32 mask;
+        guint32 new_mode;
+        gboolean is_dir;
+
+        if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+
+        /* Ignore errors */
+        if (fstatat (dir_fd, entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            continue;
+        }
+
+        /* Permissions can't be set on symlinks themselves */
+        if (S_ISLNK (statbuf.st_mode))
+        {
+            continue;
+        }
+
+        is_dir = S_ISDIR (statbuf.st_mode);
+        if (is_dir)
+        {
+            value = job->dir_permissions;
+            mask = job->dir_mask;
+        }
+        else
+        {
+            value = job->file_permissions;
+            mask = job->file_mask;
+        }
+
+        if (common->undo_info != NULL)
+        {
+            g_autofree char *path = g_build_filename (dir_path, entry->d_name, NULL);
+            g_autoptr (GFile) file = g_file_new_for_path (path);
+
+            g_mutex_lock (&job->mutex);
+            nautilus_file_undo_info_rec_permissions_add_file (NAUTILUS_FILE_UNDO_INFO_REC_PERMISSIONS (common->undo_info),
+                                                              file, statbuf.st_mode);
+            g_mutex_unlock (&job->mutex);
+        }
+
+        new_mode = (statbuf.st_mode & ~mask) | value;
+        if (new_mode != statbuf.st_mode)
+        {
+            fchmodat (dir_fd, entry->d_name, new_mode & 07777, 0);
+        }
+
+        if (is_dir)
+        {
+            int child_fd;
+            char *child_path;
+
+            child_fd = openat (dir_fd, entry->d_name,
+                               O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child_fd < 0)
+            {
+                continue;
+            }
+
+            child_path = g_build_filename (dir_path, entry->d_name, NULL);
+            if (!set_permissions_local_queue_dir (job, child_fd, child_path))
+            {
+                set_permissions_local_dir (job, child_fd, child_path);
+                g_free (child_path);
+            }
+        }
+    }
+
+    closedir (dir);
+}
+
+/* Walks local trees with directory fds instead of GFile paths and spreads
+ * subtrees over a thread pool. Returns FALSE if the location has no local
+ * path, in which case the caller falls back to GIO. */
+static gboolean
+set_permissions_local (SetPermissionsJob *job)
+{
+    g_autofree char *path = NULL;
+    int fd;
+
+    path = g_file_get_path (job->file);
+    if (path == NULL)
+    {
+        return FALSE;
+    }
+
+    fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return FALSE;
+    }
+
+    g_mutex_init (&job->mutex);
+    g_cond_init (&job->cond);
+    job->pool = g_thread_pool_new (set_permissions_local_worker, job,
+                                   g_get_num_processors (), FALSE, NULL);
+
+    set_permissions_local_queue_dir (job, fd, g_steal_pointer (&path));
+
+    g_mutex_lock (&job->mutex);
+    while (job->pending_dirs > 0)
+    {
+        g_cond_wait (&job->cond, &job->mutex);
+    }
+    g_mutex_unlock (&job->mutex);
+
+    g_thread_pool_free (job->pool, FALSE, TRUE);
+    job->pool = NULL;
+    g_cond_clear (&job->cond);
+    g_mutex_clear (&job->mutex);
+
+    return TRUE;
+}
+
 static void
 set_permissions_thread_func (GTask        *task,
                              gpointer      source_object,
@@ -6861,7 +7614,10 @@ set_permissions_thread_func (GTask        *task,
                                        _("Setting permissions"));
 
     nautilus_progress_info_start (job->common.progress);
-    set_permissions_contained_files (job, job->file);
+    if (!set_permissions_local (job))
+    {
+        set_permissions_contained_files (job, job->file);
+    }
 }
 
 void
@@ -7121,6 +7877,7 @@ create_task_thread_func (GTask        *task,
     GFileOutputStream *out;
     gboolean handled_invalid_filename;
     int max_length;
+    g_autoptr (NautilusNameSnapshot) snapshot = NULL;
 
     job = task_data;
     common = &job->common;
@@ -7363,18 +8120,36 @@ retry:
         if (IS_IO_ERROR (error, EXISTS))
         {
             gboolean use_extension = job->src != NULL && !is_dir (job->src, common->cancellable);
-            g_autofree gchar *filename2 = nautilus_filename_for_conflict (filename, count, max_length, use_extension);
+            g_autofree gchar *dest_basename = g_file_get_basename (dest);
 
-            make_file_name_valid_for_dest_fs (filename2, dest_fs_type);
-            g_clear_object (&dest);
-            if (filename_is_utf8)
+            if (snapshot == NULL)
             {
-                dest = g_file_get_child_for_display_name (job->dest_dir, filename2, NULL);
+                snapshot = nautilus_name_snapshot_new (job->dest_dir, common->cancellable);
             }
-            if (dest == NULL)
+            /* Whatever the snapshot says, the name we just tried is taken. */
+            nautilus_name_snapshot_claim (snapshot, dest_basename);
+
+            do
             {
-                dest = g_file_get_child (job->dest_dir, filename2);
+                g_autofree gchar *filename2 = nautilus_filename_for_conflict (filename, count++, max_length, use_extension);
+
+                make_file_name_valid_for_dest_fs (filename2, dest_fs_type);
+                g_clear_object (&dest);
+                if (filename_is_utf8)
+                {
+                    dest = g_file_get_child_for_display_name (job->dest_dir, filename2, NULL);
+                }
+                if (dest == NULL)
+                {
+                    dest = g_file_get_child (job->dest_dir, filename2);
+                }
+
+                g_free (dest_basename);
+                dest_basename = g_file_get_basename (dest);
             }
+            while (!nautilus_name_snapshot_claim (snapshot, dest_basename) &&
+                   !job_aborted (common));
+
             g_error_free (error);
             goto retry;
         }
@@ -7884,109 +8659,144 @@ extract_task_done (GObject      *source_object,
     g_list_free_full (extract_job->source_files, g_object_unref);
     g_list_free_full (extract_job->output_files, g_object_unref);
     g_object_unref (extract_job->destination_directory);
+    g_clear_pointer (&extract_job->destination_names, nautilus_name_snapshot_free);
+    g_mutex_clear (&extract_job->mutex);
+    g_mutex_clear (&extract_job->interaction_mutex);
 
     finalize_common ((CommonJob *) extract_job);
 
     nautilus_file_changes_consume_changes ();
 }
 
+static void
+set_error_from_archive (GError         **error,
+                        struct archive  *archive)
+{
+    const char *message = archive_error_string (archive);
+
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                         message != NULL ? message : _("Unknown error"));
+}
+
+static ArchiveExtraction *
+archive_extraction_new (ExtractJob *extract_job,
+                        GFile      *source_file,
+                        guint64     compressed_size)
+{
+    ArchiveExtraction *extraction = g_new0 (ArchiveExtraction, 1);
+
+    extraction->extract_job = extract_job;
+    extraction->source_file = g_object_ref (source_file);
+    extraction->compressed_size = compressed_size;
+
+    return extraction;
+}
+
+static void
+archive_extraction_free (ArchiveExtraction *extraction)
+{
+    g_object_unref (extraction->source_file);
+    g_clear_object (&extraction->output_file);
+    g_free (extraction->passphrase);
+    g_clear_error (&extraction->error);
+    g_free (extraction);
+}
+
+/* Picks a name which no other file in the destination, nor the output of
+ * any other archive of the job, has already taken. */
 static GFile *
-extract_job_on_decide_destination (AutoarExtractor *extractor,
-                                   GFile           *destination,
-                                   GList           *files,
-                                   gpointer         user_data)
+extract_job_decide_destination (ArchiveExtraction *extraction,
+                                const char        *basename)
 {
-    ExtractJob *extract_job = user_data;
+    ExtractJob *extract_job = extraction->extract_job;
     GFile *decided_destination;
-    g_autofree char *basename = NULL;
+    g_autofree char *decided_basename = NULL;
 
     nautilus_progress_info_set_details (extract_job->common.progress,
                                         _("Verifying destination"));
 
-    basename = g_file_get_basename (destination);
-    decided_destination = nautilus_generate_unique_file_in_directory (extract_job->destination_directory,
-                                                                      basename);
+    g_mutex_lock (&extract_job->mutex);
 
-    if (job_aborted ((CommonJob *) extract_job))
+    if (extract_job->destination_names == NULL)
     {
-        g_object_unref (decided_destination);
-        return NULL;
+        extract_job->destination_names = nautilus_name_snapshot_new (extract_job->destination_directory,
+                                                                     extract_job->common.cancellable);
     }
 
-    /* The extract_job->destination_decided variable signalizes whether the
-     * extract_job->output_files list already contains the final location as
-     * its first link. There is no way to get this over the AutoarExtractor
-     * API currently.
-     */
+    decided_destination = nautilus_name_snapshot_generate_unique_file (extract_job->destination_names,
+                                                                       basename);
+    decided_basename = g_file_get_basename (decided_destination);
+    nautilus_name_snapshot_claim (extract_job->destination_names, decided_basename);
+
     extract_job->output_files = g_list_prepend (extract_job->output_files,
-                                                decided_destination);
-    extract_job->destination_decided = TRUE;
+                                                g_object_ref (decided_destination));
 
-    return g_object_ref (decided_destination);
+    g_mutex_unlock (&extract_job->mutex);
+
+    g_set_object (&extraction->output_file, decided_destination);
+
+    return decided_destination;
 }
 
+/* Gives up the destination decided for the archive, for when nothing
+ * ended up there. */
 static void
-extract_job_on_progress (AutoarExtractor *extractor,
-                         guint64          archive_current_decompressed_size,
-                         guint            archive_current_decompressed_files,
-                         gpointer         user_data)
+extract_job_forget_destination (ArchiveExtraction *extraction)
 {
-    ExtractJob *extract_job = user_data;
-    CommonJob *common = user_data;
-    GFile *source_file;
+    ExtractJob *extract_job = extraction->extract_job;
+    GList *link;
+
+    g_mutex_lock (&extract_job->mutex);
+    link = g_list_find (extract_job->output_files, extraction->output_file);
+    g_object_unref (link->data);
+    extract_job->output_files = g_list_delete_link (extract_job->output_files, link);
+    g_mutex_unlock (&extract_job->mutex);
+
+    g_clear_object (&extraction->output_file);
+}
+
+static void
+report_extract_progress (ArchiveExtraction *extraction,
+                         guint64            job_completed_size,
+                         guint64            job_total_size)
+{
+    CommonJob *common = (CommonJob *) extraction->extract_job;
     char *details;
     double elapsed;
     double transfer_rate;
     int remaining_time;
-    guint64 archive_total_decompressed_size;
-    gdouble archive_weight;
-    gdouble archive_decompress_progress;
-    guint64 job_completed_size;
     gdouble job_progress;
     g_autofree gchar *basename = NULL;
     g_autofree gchar *formatted_size_job_completed_size = NULL;
     g_autofree gchar *formatted_size_total_compressed_size = NULL;
 
-    source_file = autoar_extractor_get_source_file (extractor);
-
-    basename = get_basename (source_file);
+    basename = get_basename (extraction->source_file);
     nautilus_progress_info_take_status (common->progress,
                                         g_strdup_printf (_("Extracting “%s”"),
                                                          basename));
 
-    archive_total_decompressed_size = autoar_extractor_get_total_size (extractor);
-
-    archive_decompress_progress = (gdouble) archive_current_decompressed_size /
-                                  (gdouble) archive_total_decompressed_size;
-
-    archive_weight = 0;
-    if (extract_job->total_compressed_size)
+    job_progress = 0;
+    if (job_total_size > 0)
     {
-        archive_weight = (gdouble) extract_job->archive_compressed_size /
-                         (gdouble) extract_job->total_compressed_size;
+        job_progress = (gdouble) job_completed_size / (gdouble) job_total_size;
     }
 
-    job_progress = archive_decompress_progress * archive_weight + extract_job->base_progress;
-
     elapsed = g_timer_elapsed (common->time, NULL);
 
     transfer_rate = 0;
     remaining_time = -1;
 
-    job_completed_size = job_progress * extract_job->total_compressed_size;
-
     if (elapsed > 0)
     {
         transfer_rate = job_completed_size / elapsed;
     }
     if (transfer_rate > 0)
     {
-        remaining_time = (extract_job->total_compressed_size - job_completed_size) /
-                         transfer_rate;
+        remaining_time = (job_total_size - job_completed_size) / transfer_rate;
     }
 
     formatted_size_job_completed_size = g_format_size (job_completed_size);
-    formatted_size_total_compressed_size = g_format_size (extract_job->total_compressed_size);
+    formatted_size_total_compressed_size = g_format_size (job_total_size);
     if (elapsed < SECONDS_NEEDED_FOR_RELIABLE_TRANSFER_RATE ||
         transfer_rate == 0)
     {
@@ -8033,101 +8843,164 @@ extract_job_on_progress (AutoarExtractor *extractor,
     nautilus_progress_info_set_progress (common->progress, job_progress, 1);
 }
 
+/* Accounts @consumed_size of the archive's compressed size as extracted and
+ * reports the progress of the whole job, at most once per notify interval
+ * for each archive. */
 static void
-extract_job_on_error (AutoarExtractor *extractor,
-                      GError          *error,
-                      gpointer         user_data)
+archive_extraction_set_consumed_size (ArchiveExtraction *extraction,
+                                      guint64            consumed_size,
+                                      gboolean           force_notify)
 {
-    ExtractJob *extract_job = user_data;
-    GFile *source_file;
-    GFile *destination;
-    gint response_id;
-    gint remaining_files;
-    g_autofree gchar *basename = NULL;
-
-    source_file = autoar_extractor_get_source_file (extractor);
-
-    if (IS_IO_ERROR (error, NOT_SUPPORTED))
-    {
-        handle_unsupported_compressed_file (extract_job->common.parent_window,
-                                            source_file);
+    ExtractJob *extract_job = extraction->extract_job;
+    guint64 job_completed_size;
+    guint64 job_total_size;
+    gint64 now;
 
-        return;
-    }
+    consumed_size = MIN (consumed_size, extraction->compressed_size);
 
-    extract_job->extraction_failed = TRUE;
+    g_mutex_lock (&extract_job->mutex);
+    extract_job->completed_compressed_size += consumed_size - extraction->consumed_size;
+    extraction->consumed_size = consumed_size;
+    job_completed_size = extract_job->completed_compressed_size;
+    job_total_size = extract_job->total_compressed_size;
+    g_mutex_unlock (&extract_job->mutex);
 
-    /* It is safe to use extract_job->output_files->data only when the
-     * extract_job->destination_decided variable was set, see comment in the
-     * extract_job_on_decide_destination function.
-     */
-    if (extract_job->destination_decided)
+    now = g_get_monotonic_time ();
+    if (force_notify || now - extraction->last_notify_time >= PROGRESS_NOTIFY_INTERVAL)
     {
-        destination = extract_job->output_files->data;
-        delete_file_recursively (destination, NULL, NULL, NULL);
-        extract_job->output_files = g_list_delete_link (extract_job->output_files,
-                                                        extract_job->output_files);
-        g_object_unref (destination);
+        extraction->last_notify_time = now;
+        report_extract_progress (extraction, job_completed_size, job_total_size);
     }
+}
+
+static void
+archive_extraction_handle_error (ArchiveExtraction *extraction,
+                                 GError            *error)
+{
+    ExtractJob *extract_job = extraction->extract_job;
+    gint response_id;
+    gint total_files;
+    gint remaining_files;
+    g_autofree gchar *basename = NULL;
 
-    if (extract_job->common.skip_all_error)
+    if (extraction->output_file != NULL)
     {
-        return;
+        delete_file_recursively (extraction->output_file, NULL, NULL, NULL);
+        extract_job_forget_destination (extraction);
     }
 
-    basename = get_basename (source_file);
-    nautilus_progress_info_take_status (extract_job->common.progress,
-                                        g_strdup_printf (_("Error extracting “%s”"),
-                                                         basename));
+    /* A failed archive no longer counts towards the job. */
+    g_mutex_lock (&extract_job->mutex);
+    extract_job->completed_compressed_size -= extraction->consumed_size;
+    extract_job->total_compressed_size -= extraction->compressed_size;
+    total_files = extract_job->total_files--;
+    remaining_files = extract_job->total_files - extract_job->finished_files;
+    g_mutex_unlock (&extract_job->mutex);
 
-    remaining_files = g_list_length (g_list_find_custom (extract_job->source_files,
-                                                         source_file,
-                                                         (GCompareFunc) g_file_equal)) - 1;
-    response_id = run_cancel_or_skip_warning ((CommonJob *) extract_job,
-                                              g_strdup_printf (_("There was an error while extracting “%s”."),
-                                                               basename),
-                                              g_strdup (error->message),
-                                              NULL,
-                                              extract_job->total_files,
-                                              remaining_files);
+    g_mutex_lock (&extract_job->interaction_mutex);
 
-    if (response_id == 0 || response_id == GTK_RESPONSE_DELETE_EVENT)
+    if (IS_IO_ERROR (error, NOT_SUPPORTED))
     {
-        abort_job ((CommonJob *) extract_job);
+        handle_unsupported_compressed_file (extract_job->common.parent_window,
+                                            extraction->source_file);
     }
-    else if (response_id == 1)
+    else if (!extract_job->common.skip_all_error &&
+             !job_aborted ((CommonJob *) extract_job))
     {
-        extract_job->common.skip_all_error = TRUE;
-    }
-}
+        basename = get_basename (extraction->source_file);
+        nautilus_progress_info_take_status (extract_job->common.progress,
+                                            g_strdup_printf (_("Error extracting “%s”"),
+                                                             basename));
 
-static void
-extract_job_on_completed (AutoarExtractor *extractor,
-                          gpointer         user_data)
-{
-    ExtractJob *extract_job = user_data;
-    GFile *output_file;
+        response_id = run_cancel_or_skip_warning ((CommonJob *) extract_job,
+                                                  g_strdup_printf (_("There was an error while extracting “%s”."),
+                                                                   basename),
+                                                  g_strdup (error->message),
+                                                  NULL,
+                                                  total_files,
+                                                  remaining_files);
 
-    output_file = G_FILE (extract_job->output_files->data);
+        if (response_id == 0 || response_id == GTK_RESPONSE_DELETE_EVENT)
+        {
+            abort_job ((CommonJob *) extract_job);
+        }
+        else if (response_id == 1)
+        {
+            extract_job->common.skip_all_error = TRUE;
+        }
+    }
 
-    nautilus_file_changes_queue_file_added (output_file);
+    g_mutex_unlock (&extract_job->interaction_mutex);
 }
 
-static gchar *
-extract_job_on_request_passphrase (AutoarExtractor *extractor,
-                                   gpointer         user_data)
-{
-    ExtractJob *extract_job = user_data;
-    GtkWindow *parent_window;
-    GFile *source_file;
+static GFile *
+extract_job_on_decide_destination (AutoarExtractor *extractor,
+                                   GFile           *destination,
+                                   GList           *files,
+                                   gpointer         user_data)
+{
+    ArchiveExtraction *extraction = user_data;
+    g_autofree char *basename = NULL;
+
+    if (job_aborted ((CommonJob *) extraction->extract_job))
+    {
+        return NULL;
+    }
+
+    basename = g_file_get_basename (destination);
+
+    return g_object_ref (extract_job_decide_destination (extraction, basename));
+}
+
+static void
+extract_job_on_progress (AutoarExtractor *extractor,
+                         guint64          archive_current_decompressed_size,
+                         guint            archive_current_decompressed_files,
+                         gpointer         user_data)
+{
+    ArchiveExtraction *extraction = user_data;
+    guint64 archive_total_decompressed_size;
+    gdouble archive_decompress_progress;
+
+    archive_total_decompressed_size = autoar_extractor_get_total_size (extractor);
+
+    archive_decompress_progress = (gdouble) archive_current_decompressed_size /
+                                  (gdouble) archive_total_decompressed_size;
+
+    /* Notifications are already throttled by the extractor. */
+    archive_extraction_set_consumed_size (extraction,
+                                          archive_decompress_progress * extraction->compressed_size,
+                                          TRUE);
+}
+
+static void
+extract_job_on_error (AutoarExtractor *extractor,
+                      GError          *error,
+                      gpointer         user_data)
+{
+    ArchiveExtraction *extraction = user_data;
+
+    /* Handled once the extractor has stopped, like errors of single pass
+     * extractions. */
+    if (extraction->error == NULL)
+    {
+        extraction->error = g_error_copy (error);
+    }
+}
+
+static gchar *
+extract_ask_passphrase_once (ArchiveExtraction *extraction)
+{
+    ExtractJob *extract_job = extraction->extract_job;
     g_autofree gchar *basename = NULL;
     gchar *passphrase;
 
-    parent_window = extract_job->common.parent_window;
-    source_file = autoar_extractor_get_source_file (extractor);
-    basename = get_basename (source_file);
+    basename = get_basename (extraction->source_file);
+
+    g_mutex_lock (&extract_job->interaction_mutex);
+    passphrase = extract_ask_passphrase (extract_job->common.parent_window, basename);
+    g_mutex_unlock (&extract_job->interaction_mutex);
 
-    passphrase = extract_ask_passphrase (parent_window, basename);
     if (passphrase == NULL)
     {
         abort_job ((CommonJob *) extract_job);
@@ -8136,24 +9009,29 @@ extract_job_on_request_passphrase (AutoarExtractor *extractor,
     return passphrase;
 }
 
+static gchar *
+extract_job_on_request_passphrase (AutoarExtractor *extractor,
+                                   gpointer         user_data)
+{
+    return extract_ask_passphrase_once (user_data);
+}
+
 static void
 extract_job_on_scanned (AutoarExtractor *extractor,
                         guint            total_files,
                         gpointer         user_data)
 {
+    ArchiveExtraction *extraction = user_data;
+    ExtractJob *extract_job = extraction->extract_job;
     guint64 total_size;
-    ExtractJob *extract_job;
-    GFile *source_file;
     g_autofree gchar *basename = NULL;
     g_autoptr (GFileInfo) fsinfo = NULL;
     guint64 free_size;
 
-    extract_job = user_data;
     total_size = autoar_extractor_get_total_size (extractor);
-    source_file = autoar_extractor_get_source_file (extractor);
-    basename = get_basename (source_file);
+    basename = get_basename (extraction->source_file);
 
-    fsinfo = g_file_query_filesystem_info (source_file,
+    fsinfo = g_file_query_filesystem_info (extraction->source_file,
                                            G_FILE_ATTRIBUTE_FILESYSTEM_FREE ","
                                            G_FILE_ATTRIBUTE_FILESYSTEM_READONLY,
                                            extract_job->common.cancellable,
@@ -8166,6 +9044,7 @@ extract_job_on_scanned (AutoarExtractor *extractor,
      */
     if (total_size != G_MAXUINT64 && total_size > free_size)
     {
+        g_mutex_lock (&extract_job->interaction_mutex);
         nautilus_progress_info_take_status (extract_job->common.progress,
                                             g_strdup_printf (_("Error extracting “%s”"),
                                                              basename));
@@ -8176,11 +9055,556 @@ extract_job_on_scanned (AutoarExtractor *extractor,
                    FALSE,
                    CANCEL,
                    NULL);
+        g_mutex_unlock (&extract_job->interaction_mutex);
 
         abort_job ((CommonJob *) extract_job);
     }
 }
 
+/* gnome-autoar reads every archive twice, first to scan its contents and
+ * then to extract them, which is only worth it where libarchive can't
+ * reach the files directly. */
+static gboolean
+extract_archive_with_autoar (ArchiveExtraction  *extraction,
+                             GError            **error)
+{
+    ExtractJob *extract_job = extraction->extract_job;
+    g_autoptr (AutoarExtractor) extractor = NULL;
+
+    extractor = autoar_extractor_new (extraction->source_file,
+                                      extract_job->destination_directory);
+
+    autoar_extractor_set_notify_interval (extractor,
+                                          PROGRESS_NOTIFY_INTERVAL);
+    g_signal_connect (extractor, "scanned",
+                      G_CALLBACK (extract_job_on_scanned),
+                      extraction);
+    g_signal_connect (extractor, "error",
+                      G_CALLBACK (extract_job_on_error),
+                      extraction);
+    g_signal_connect (extractor, "decide-destination",
+                      G_CALLBACK (extract_job_on_decide_destination),
+                      extraction);
+    g_signal_connect (extractor, "progress",
+                      G_CALLBACK (extract_job_on_progress),
+                      extraction);
+    g_signal_connect (extractor, "request-passphrase",
+                      G_CALLBACK (extract_job_on_request_passphrase),
+                      extraction);
+
+    autoar_extractor_start (extractor,
+                            extract_job->common.cancellable);
+
+    g_signal_handlers_disconnect_by_data (extractor, extraction);
+
+    if (extraction->error != NULL)
+    {
+        g_propagate_error (error, g_steal_pointer (&extraction->error));
+        return FALSE;
+    }
+
+    return !g_cancellable_set_error_if_cancelled (extract_job->common.cancellable, error) &&
+           extraction->output_file != NULL;
+}
+
+static const char *
+extract_passphrase_callback (struct archive *archive,
+                             void           *user_data)
+{
+    ArchiveExtraction *extraction = user_data;
+
+    /* libarchive asks again for as long as the passphrase is wrong. */
+    g_free (extraction->passphrase);
+    extraction->passphrase = NULL;
+
+    if (!job_aborted ((CommonJob *) extraction->extract_job))
+    {
+        extraction->passphrase = extract_ask_passphrase_once (extraction);
+    }
+
+    return extraction->passphrase;
+}
+
+static void
+set_entry_error_from_errno (GError     **error,
+                            const char  *path,
+                            int          saved_errno)
+{
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                 "%s: %s", path, g_strerror (saved_errno));
+}
+
+/* Turns the path of an archive entry into one relative to the extraction
+ * directory, or returns NULL if it would point outside of it. */
+static gchar *
+sanitize_entry_path (const char *path)
+{
+    g_auto (GStrv) components = g_strsplit (path, "/", -1);
+    g_autoptr (GStrvBuilder) builder = g_strv_builder_new ();
+    g_auto (GStrv) sanitized = NULL;
+
+    for (guint i = 0; components[i] != NULL; i++)
+    {
+        if (components[i][0] == '\0' || strcmp (components[i], ".") == 0)
+        {
+            continue;
+        }
+        if (strcmp (components[i], "..") == 0)
+        {
+            return NULL;
+        }
+        g_strv_builder_add (builder, components[i]);
+    }
+
+    sanitized = g_strv_builder_end (builder);
+    if (sanitized[0] == NULL)
+    {
+        return NULL;
+    }
+
+    return g_strjoinv ("/", sanitized);
+}
+
+/* Opens the directory which contains @path below @root_fd, creating the
+ * missing ones. Symbolic links are never followed, so no entry can be
+ * written outside of @root_fd, whatever links the archive holds. */
+static int
+open_entry_parent (int          root_fd,
+                   const char  *path,
+                   const char **name)
+{
+    g_auto (GStrv) components = g_strsplit (path, "/", -1);
+    guint n_components = g_strv_length (components);
+    int fd = dup (root_fd);
+
+    for (guint i = 0; fd >= 0 && i + 1 < n_components; i++)
+    {
+        int child_fd;
+
+        if (mkdirat (fd, components[i], 0777) != 0 && errno != EEXIST)
+        {
+            int saved_errno = errno;
+
+            close (fd);
+            errno = saved_errno;
+            return -1;
+        }
+
+        child_fd = openat (fd, components[i], O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        close (fd);
+        fd = child_fd;
+    }
+
+    *name = strrchr (path, '/') != NULL ? strrchr (path, '/') + 1 : path;
+
+    return fd;
+}
+
+static gboolean
+write_entry_data (struct archive  *reader,
+                  int              fd,
+                  la_int64_t       size,
+                  const char      *path,
+                  GError         **error)
+{
+    const void *block;
+    size_t block_size;
+    la_int64_t offset;
+    int result;
+
+    while ((result = archive_read_data_block (reader, &block, &block_size, &offset)) == ARCHIVE_OK)
+    {
+        const char *data = block;
+
+        while (block_size > 0)
+        {
+            ssize_t written = pwrite (fd, data, block_size, offset);
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                set_entry_error_from_errno (error, path, errno);
+                return FALSE;
+            }
+
+            data += written;
+            block_size -= written;
+            offset += written;
+        }
+    }
+
+    if (result != ARCHIVE_EOF)
+    {
+        set_error_from_archive (error, reader);
+        return FALSE;
+    }
+
+    /* Sparse files may end with a hole, which has no block. */
+    if (ftruncate (fd, size) != 0)
+    {
+        set_entry_error_from_errno (error, path, errno);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+write_entry (struct archive        *reader,
+             struct archive_entry  *entry,
+             int                    root_fd,
+             const char            *path,
+             GError               **error)
+{
+    const char *name;
+    const char *hardlink = archive_entry_hardlink (entry);
+    mode_t mode = archive_entry_perm (entry) & 0777;
+    int parent_fd;
+    int result = 0;
+
+    parent_fd = open_entry_parent (root_fd, path, &name);
+    if (parent_fd < 0)
+    {
+        set_entry_error_from_errno (error, path, errno);
+        return FALSE;
+    }
+
+    /* Later entries replace earlier ones with the same path. */
+    if (archive_entry_filetype (entry) != AE_IFDIR)
+    {
+        unlinkat (parent_fd, name, 0);
+    }
+
+    if (hardlink != NULL)
+    {
+        g_autofree gchar *target_path = sanitize_entry_path (hardlink);
+        const char *target_name;
+        int target_parent_fd = -1;
+
+        if (target_path != NULL)
+        {
+            target_parent_fd = open_entry_parent (root_fd, target_path, &target_name);
+        }
+
+        if (target_parent_fd < 0)
+        {
+            result = -1;
+            errno = target_path == NULL ? EPERM : errno;
+        }
+        else
+        {
+            result = linkat (target_parent_fd, target_name, parent_fd, name, 0);
+            close (target_parent_fd);
+        }
+    }
+    else
+    {
+        switch (archive_entry_filetype (entry))
+        {
+            case AE_IFDIR:
+            {
+                result = mkdirat (parent_fd, name, mode | S_IRWXU);
+                if (result != 0 && errno == EEXIST)
+                {
+                    result = 0;
+                }
+            }
+            break;
+
+            case AE_IFLNK:
+            {
+                result = symlinkat (archive_entry_symlink (entry), parent_fd, name);
+            }
+            break;
+
+            case AE_IFREG:
+            {
+                struct timespec times[2] =
+                {
+                    { .tv_nsec = UTIME_OMIT },
+                    {
+                        .tv_sec = archive_entry_mtime (entry),
+                        .tv_nsec = archive_entry_mtime_nsec (entry)
+                    },
+                };
+                int fd;
+
+                fd = openat (parent_fd, name,
+                             O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                             mode | S_IRUSR | S_IWUSR);
+                if (fd < 0)
+                {
+                    result = -1;
+                    break;
+                }
+
+                if (!write_entry_data (reader, fd, archive_entry_size (entry), path, error))
+                {
+                    close (fd);
+                    close (parent_fd);
+                    return FALSE;
+                }
+
+                if (archive_entry_mtime_is_set (entry))
+                {
+                    futimens (fd, times);
+                }
+                result = close (fd);
+            }
+            break;
+
+            default:
+            {
+                /* Devices, sockets and pipes are not extracted. */
+            }
+            break;
+        }
+    }
+
+    if (result != 0)
+    {
+        set_entry_error_from_errno (error, path, errno);
+    }
+
+    close (parent_fd);
+
+    return result == 0;
+}
+
+/* Moves what was extracted into @staging_directory to its destination.
+ * Like gnome-autoar does, an archive holding a single top-level file or
+ * folder is extracted as just that, anything else into a new folder named
+ * after the archive. */
+static gboolean
+archive_extraction_finish (ArchiveExtraction  *extraction,
+                           GFile              *staging_directory,
+                           GError            **error)
+{
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    g_autoptr (GFile) single_child = NULL;
+    g_autofree gchar *basename = NULL;
+    GFile *destination;
+    guint n_children = 0;
+    gboolean success;
+
+    enumerator = g_file_enumerate_children (staging_directory,
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            NULL, error);
+    if (enumerator == NULL)
+    {
+        return FALSE;
+    }
+
+    while (n_children < 2)
+    {
+        GFile *child;
+
+        if (!g_file_enumerator_iterate (enumerator, NULL, &child, NULL, error))
+        {
+            return FALSE;
+        }
+        if (child == NULL)
+        {
+            break;
+        }
+
+        g_set_object (&single_child, child);
+        n_children++;
+    }
+
+    if (n_children == 1)
+    {
+        basename = g_file_get_basename (single_child);
+    }
+    else
+    {
+        g_autofree gchar *archive_basename = g_file_get_basename (extraction->source_file);
+
+        g_clear_object (&single_child);
+        basename = nautilus_filename_strip_extension (archive_basename);
+    }
+
+    destination = extract_job_decide_destination (extraction, basename);
+
+    success = g_file_move (single_child != NULL ? single_child : staging_directory,
+                           destination, G_FILE_COPY_NOFOLLOW_SYMLINKS | G_FILE_COPY_NO_FALLBACK_FOR_MOVE,
+                           NULL, NULL, NULL, error);
+
+    if (!success)
+    {
+        /* Whatever is there now is not ours to delete. */
+        extract_job_forget_destination (extraction);
+    }
+    else if (single_child != NULL)
+    {
+        g_file_delete (staging_directory, NULL, NULL);
+    }
+
+    return success;
+}
+
+/* Extracts an archive while reading it just once. As its decompressed size
+ * is not known up front, the progress is estimated from how much of the
+ * compressed file was read. Everything is extracted into a hidden folder in
+ * the destination first, and moved into place once it is known whether the
+ * archive has a single top-level item. */
+static gboolean
+extract_archive_in_single_pass (ArchiveExtraction  *extraction,
+                                GError            **error)
+{
+    ExtractJob *extract_job = extraction->extract_job;
+    CommonJob *common = (CommonJob *) extract_job;
+    g_autofree gchar *source_path = g_file_get_path (extraction->source_file);
+    g_autofree gchar *destination_path = g_file_get_path (extract_job->destination_directory);
+    g_autofree gchar *staging_path = NULL;
+    g_autoptr (GFile) staging_directory = NULL;
+    struct archive *reader;
+    struct archive_entry *entry;
+    int staging_fd = -1;
+    gboolean success = TRUE;
+
+    reader = archive_read_new ();
+    archive_read_support_filter_all (reader);
+    archive_read_support_format_all (reader);
+    archive_read_support_format_raw (reader);
+    archive_read_set_passphrase_callback (reader, extraction, extract_passphrase_callback);
+
+    if (archive_read_open_filename (reader, source_path, 64 * 1024) != ARCHIVE_OK)
+    {
+        set_error_from_archive (error, reader);
+        archive_read_free (reader);
+        return FALSE;
+    }
+
+    staging_path = g_build_filename (destination_path, ".nautilus-extract-XXXXXX", NULL);
+    if (g_mkdtemp_full (staging_path, 0777) == NULL ||
+        (staging_fd = open (staging_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+    {
+        set_entry_error_from_errno (error, destination_path, errno);
+        archive_read_free (reader);
+        return FALSE;
+    }
+    staging_directory = g_file_new_for_path (staging_path);
+
+    while (success)
+    {
+        g_autofree gchar *path = NULL;
+        int result;
+
+        if (g_cancellable_set_error_if_cancelled (common->cancellable, error))
+        {
+            success = FALSE;
+            break;
+        }
+
+        result = archive_read_next_header (reader, &entry);
+        if (result == ARCHIVE_EOF)
+        {
+            break;
+        }
+        if (result < ARCHIVE_WARN)
+        {
+            set_error_from_archive (error, reader);
+            success = FALSE;
+            break;
+        }
+
+        if (archive_format (reader) == ARCHIVE_FORMAT_RAW)
+        {
+            g_autofree gchar *basename = g_file_get_basename (extraction->source_file);
+
+            /* Anything can be read as raw data, so only files which were
+             * at least compressed count as archives. */
+            if (archive_filter_code (reader, 0) == ARCHIVE_FILTER_NONE)
+            {
+                g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                                     _("Unrecognized archive format"));
+                success = FALSE;
+                break;
+            }
+
+            /* A compressed file holds just its data, named after it. */
+            path = nautilus_filename_strip_extension (basename);
+            archive_entry_set_filetype (entry, AE_IFREG);
+            archive_entry_set_perm (entry, 0666);
+        }
+        else
+        {
+            const char *pathname = archive_entry_pathname (entry);
+
+            path = pathname != NULL ? sanitize_entry_path (pathname) : NULL;
+            if (path == NULL)
+            {
+                /* Like gnome-autoar, skip what would end up outside. */
+                archive_read_data_skip (reader);
+                continue;
+            }
+        }
+
+        success = write_entry (reader, entry, staging_fd, path, error);
+
+        archive_extraction_set_consumed_size (extraction, archive_filter_bytes (reader, -1), FALSE);
+    }
+
+    close (staging_fd);
+    archive_read_free (reader);
+
+    if (success)
+    {
+        success = archive_extraction_finish (extraction, staging_directory, error);
+    }
+
+    if (!success)
+    {
+        delete_file_recursively (staging_directory, NULL, NULL, NULL);
+    }
+
+    return success;
+}
+
+static void
+extract_archive (gpointer data,
+                 gpointer user_data)
+{
+    ArchiveExtraction *extraction = data;
+    ExtractJob *extract_job = extraction->extract_job;
+    g_autoptr (GError) error = NULL;
+    gboolean success;
+
+    if (job_aborted ((CommonJob *) extract_job))
+    {
+        return;
+    }
+
+    if (g_file_is_native (extraction->source_file) &&
+        g_file_is_native (extract_job->destination_directory))
+    {
+        success = extract_archive_in_single_pass (extraction, &error);
+    }
+    else
+    {
+        success = extract_archive_with_autoar (extraction, &error);
+    }
+
+    if (success)
+    {
+        nautilus_file_changes_queue_file_added (extraction->output_file);
+        archive_extraction_set_consumed_size (extraction, extraction->compressed_size, TRUE);
+    }
+    else if (error != NULL && !IS_IO_ERROR (error, CANCELLED))
+    {
+        archive_extraction_handle_error (extraction, error);
+    }
+
+    g_mutex_lock (&extract_job->mutex);
+    extract_job->finished_files++;
+    g_mutex_unlock (&extract_job->mutex);
+}
+
 static void
 report_extract_final_progress (ExtractJob *extract_job)
 {
@@ -8234,9 +9658,8 @@ extract_task_thread_func (GTask        *task,
                           GCancellable *cancellable)
 {
     ExtractJob *extract_job = task_data;
-    GList *l;
-    g_autofree guint64 *archive_compressed_sizes = NULL;
-    gint i;
+    g_autoptr (GPtrArray) extractions = NULL;
+    GThreadPool *workers;
 
     g_timer_start (extract_job->common.time);
 
@@ -8246,17 +9669,17 @@ extract_task_thread_func (GTask        *task,
                                         _("Preparing to extract"));
 
     extract_job->total_files = g_list_length (extract_job->source_files);
-
-    archive_compressed_sizes = g_malloc0_n (extract_job->total_files,
-                                            sizeof (guint64));
     extract_job->total_compressed_size = 0;
 
-    for (l = extract_job->source_files, i = 0;
+    extractions = g_ptr_array_new_with_free_func ((GDestroyNotify) archive_extraction_free);
+
+    for (GList *l = extract_job->source_files;
          l != NULL && !job_aborted ((CommonJob *) extract_job);
-         l = l->next, i++)
+         l = l->next)
     {
         GFile *source_file;
         g_autoptr (GFileInfo) info = NULL;
+        guint64 compressed_size = 0;
 
         source_file = G_FILE (l->data);
         info = g_file_query_info (source_file,
@@ -8267,66 +9690,24 @@ extract_task_thread_func (GTask        *task,
 
         if (info)
         {
-            archive_compressed_sizes[i] = g_file_info_get_size (info);
-            extract_job->total_compressed_size += archive_compressed_sizes[i];
+            compressed_size = g_file_info_get_size (info);
+            extract_job->total_compressed_size += compressed_size;
         }
-    }
 
-    extract_job->base_progress = 0;
+        g_ptr_array_add (extractions,
+                         archive_extraction_new (extract_job, source_file, compressed_size));
+    }
 
-    for (l = extract_job->source_files, i = 0;
-         l != NULL && !job_aborted ((CommonJob *) extract_job);
-         l = l->next, i++)
-    {
-        g_autoptr (AutoarExtractor) extractor = NULL;
-
-        extractor = autoar_extractor_new (G_FILE (l->data),
-                                          extract_job->destination_directory);
-
-        autoar_extractor_set_notify_interval (extractor,
-                                              PROGRESS_NOTIFY_INTERVAL);
-        g_signal_connect (extractor, "scanned",
-                          G_CALLBACK (extract_job_on_scanned),
-                          extract_job);
-        g_signal_connect (extractor, "error",
-                          G_CALLBACK (extract_job_on_error),
-                          extract_job);
-        g_signal_connect (extractor, "decide-destination",
-                          G_CALLBACK (extract_job_on_decide_destination),
-                          extract_job);
-        g_signal_connect (extractor, "progress",
-                          G_CALLBACK (extract_job_on_progress),
-                          extract_job);
-        g_signal_connect (extractor, "completed",
-                          G_CALLBACK (extract_job_on_completed),
-                          extract_job);
-        g_signal_connect (extractor, "request-passphrase",
-                          G_CALLBACK (extract_job_on_request_passphrase),
-                          extract_job);
-
-        extract_job->archive_compressed_size = archive_compressed_sizes[i];
-        extract_job->destination_decided = FALSE;
-        extract_job->extraction_failed = FALSE;
-
-        autoar_extractor_start (extractor,
-                                extract_job->common.cancellable);
-
-        g_signal_handlers_disconnect_by_data (extractor,
-                                              extract_job);
-
-        if (!extract_job->extraction_failed)
-        {
-            extract_job->base_progress += (gdouble) extract_job->archive_compressed_size /
-                                          (gdouble) extract_job->total_compressed_size;
-        }
-        else
-        {
-            extract_job->total_files--;
-            extract_job->base_progress *= extract_job->total_compressed_size;
-            extract_job->total_compressed_size -= extract_job->archive_compressed_size;
-            extract_job->base_progress /= extract_job->total_compressed_size;
-        }
+    /* Decompressing is mostly bound by the processor, so a batch of
+     * archives is extracted by a few workers at once. */
+    workers = g_thread_pool_new (extract_archive, NULL,
+                                 CLAMP (g_get_num_processors (), 1, MAX_EXTRACT_WORKERS),
+                                 FALSE, NULL);
+    for (guint i = 0; i < extractions->len; i++)
+    {
+        g_thread_pool_push (workers, g_ptr_array_index (extractions, i), NULL);
     }
+    g_thread_pool_free (workers, FALSE, TRUE);
 
     if (!job_aborted ((CommonJob *) extract_job))
     {
@@ -8370,6 +9751,8 @@ nautilus_file_operations_extract_files (GList                          *files,
     extract_job->destination_directory = g_object_ref (destination_directory);
     extract_job->done_callback = done_callback;
     extract_job->done_callback_data = done_callback_data;
+    g_mutex_init (&extract_job->mutex);
+    g_mutex_init (&extract_job->interaction_mutex);
 
     inhibit_power_manager ((CommonJob *) extract_job, _("Extracting Files"));
 
@@ -8649,6 +10032,269 @@ compress_job_on_completed (AutoarCompressor *compressor,
                                             destination_directory);
 }
 
+/* gnome-autoar can't write zstd and gives no access to the options of the
+ * libarchive filters, so it always compresses on a single thread. Tarballs
+ * are simple enough to be written here instead, with xz and zstd using a
+ * compression thread per processor. Progress and errors are still reported
+ * through the handlers above, just without a compressor.
+ */
+#define TARBALL_BUFFER_SIZE (1024 * 1024)
+
+typedef struct
+{
+    CompressJob *compress_job;
+    struct archive *writer;
+    gchar *buffer;
+
+    guint64 completed_size;
+    guint completed_files;
+    gint64 last_notify_time;
+} TarballWriter;
+
+static gboolean
+compress_job_uses_tarball_writer (CompressJob *compress_job)
+{
+    if (compress_job->format != AUTOAR_FORMAT_TAR)
+    {
+        return FALSE;
+    }
+
+    if (compress_job->filter == NAUTILUS_COMPRESS_FILTER_ZSTD)
+    {
+        return TRUE;
+    }
+
+    if (compress_job->filter != AUTOAR_FILTER_XZ ||
+        !g_file_is_native (compress_job->output_file))
+    {
+        return FALSE;
+    }
+
+    /* Sources which are not local are left to gnome-autoar. */
+    for (GList *l = compress_job->source_files; l != NULL; l = l->next)
+    {
+        if (!g_file_is_native (l->data))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void
+tarball_writer_notify (TarballWriter *self,
+                       gboolean       force)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    if (force || now - self->last_notify_time >= PROGRESS_NOTIFY_INTERVAL)
+    {
+        self->last_notify_time = now;
+        compress_job_on_progress (NULL, self->completed_size, self->completed_files,
+                                  self->compress_job);
+    }
+}
+
+static gboolean
+tarball_writer_add_source (TarballWriter  *self,
+                           GFile          *source,
+                           GError        **error)
+{
+    CommonJob *common = (CommonJob *) self->compress_job;
+    g_autofree gchar *path = g_file_get_path (source);
+    g_autofree gchar *parent_path = NULL;
+    struct archive *disk;
+    struct archive_entry *entry;
+    gsize prefix_length;
+    gboolean success = TRUE;
+
+    if (path == NULL)
+    {
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                             _("Only local files can be compressed into this format."));
+        return FALSE;
+    }
+
+    /* Entries are named relative to the parent, as gnome-autoar does. */
+    parent_path = g_path_get_dirname (path);
+    prefix_length = strlen (parent_path);
+    if (!g_str_has_suffix (parent_path, G_DIR_SEPARATOR_S))
+    {
+        prefix_length++;
+    }
+
+    disk = archive_read_disk_new ();
+    archive_read_disk_set_standard_lookup (disk);
+    entry = archive_entry_new ();
+
+    if (archive_read_disk_open (disk, path) != ARCHIVE_OK)
+    {
+        set_error_from_archive (error, disk);
+        archive_entry_free (entry);
+        archive_read_free (disk);
+        return FALSE;
+    }
+
+    while (success)
+    {
+        int result;
+
+        if (g_cancellable_set_error_if_cancelled (common->cancellable, error))
+        {
+            success = FALSE;
+            break;
+        }
+
+        archive_entry_clear (entry);
+        result = archive_read_next_header2 (disk, entry);
+        if (result == ARCHIVE_EOF)
+        {
+            break;
+        }
+        if (result < ARCHIVE_WARN)
+        {
+            set_error_from_archive (error, disk);
+            success = FALSE;
+            break;
+        }
+
+        archive_read_disk_descend (disk);
+        archive_entry_set_pathname (entry, archive_entry_sourcepath (entry) + prefix_length);
+
+        if (archive_write_header (self->writer, entry) < ARCHIVE_WARN)
+        {
+            set_error_from_archive (error, self->writer);
+            success = FALSE;
+            break;
+        }
+
+        if (archive_entry_filetype (entry) == AE_IFREG)
+        {
+            la_ssize_t read;
+
+            while ((read = archive_read_data (disk, self->buffer, TARBALL_BUFFER_SIZE)) > 0)
+            {
+                if (archive_write_data (self->writer, self->buffer, read) < 0)
+                {
+                    set_error_from_archive (error, self->writer);
+                    success = FALSE;
+                    break;
+                }
+
+                self->completed_size += read;
+                tarball_writer_notify (self, FALSE);
+
+                if (job_aborted (common))
+                {
+                    break;
+                }
+            }
+
+            if (read < 0)
+            {
+                set_error_from_archive (error, disk);
+                success = FALSE;
+            }
+        }
+
+        self->completed_files++;
+        tarball_writer_notify (self, FALSE);
+    }
+
+    archive_entry_free (entry);
+    archive_read_free (disk);
+
+    return success;
+}
+
+static gboolean
+compress_job_write_tarball (CompressJob  *compress_job,
+                            GError      **error)
+{
+    TarballWriter self = { .compress_job = compress_job };
+    g_autofree gchar *output_path = g_file_get_path (compress_job->output_file);
+    g_autofree gchar *threads = g_strdup_printf ("%u", g_get_num_processors ());
+    const char *filter_name;
+    gboolean success = TRUE;
+
+    if (output_path == NULL)
+    {
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                             _("Archives in this format can only be created in local folders."));
+        return FALSE;
+    }
+
+    self.writer = archive_write_new ();
+    archive_write_set_format_pax_restricted (self.writer);
+
+    if (compress_job->filter == NAUTILUS_COMPRESS_FILTER_ZSTD)
+    {
+        filter_name = "zstd";
+        success = archive_write_add_filter_zstd (self.writer) >= ARCHIVE_WARN;
+    }
+    else
+    {
+        filter_name = "xz";
+        success = archive_write_add_filter_xz (self.writer) >= ARCHIVE_WARN;
+    }
+
+    /* The option is only missing when libarchive runs an external program
+     * to compress, which then uses its own defaults. */
+    archive_write_set_filter_option (self.writer, filter_name, "threads", threads);
+
+    if (!success || archive_write_open_filename (self.writer, output_path) != ARCHIVE_OK)
+    {
+        set_error_from_archive (error, self.writer);
+        archive_write_free (self.writer);
+        return FALSE;
+    }
+
+    self.buffer = g_malloc (TARBALL_BUFFER_SIZE);
+
+    for (GList *l = compress_job->source_files; l != NULL && success; l = l->next)
+    {
+        success = tarball_writer_add_source (&self, l->data, error);
+    }
+
+    /* Closing flushes the compressor, which is where most of the time goes
+     * for the last blocks. */
+    if (archive_write_close (self.writer) != ARCHIVE_OK && success)
+    {
+        set_error_from_archive (error, self.writer);
+        success = FALSE;
+    }
+
+    if (success)
+    {
+        tarball_writer_notify (&self, TRUE);
+    }
+
+    archive_write_free (self.writer);
+    g_free (self.buffer);
+
+    return success;
+}
+
+static void
+compress_job_run_tarball_writer (CompressJob *compress_job)
+{
+    g_autoptr (GError) error = NULL;
+
+    if (compress_job_write_tarball (compress_job, &error))
+    {
+        compress_job_on_completed (NULL, compress_job);
+        return;
+    }
+
+    g_file_delete (compress_job->output_file, NULL, NULL);
+
+    if (!IS_IO_ERROR (error, CANCELLED))
+    {
+        compress_job_on_error (NULL, error, compress_job);
+    }
+}
+
 static void
 compress_task_thread_func (GTask        *task,
                            gpointer      source_object,
@@ -8692,29 +10338,36 @@ compress_task_thread_func (GTask        *task,
         return;
     }
 
-    compressor = autoar_compressor_new (compress_job->source_files,
-                                        compress_job->output_file,
-                                        compress_job->format,
-                                        compress_job->filter,
-                                        FALSE);
-    if (compress_job->passphrase && compress_job->passphrase[0] != '\0')
+    if (compress_job_uses_tarball_writer (compress_job))
     {
-        autoar_compressor_set_passphrase (compressor, compress_job->passphrase);
+        compress_job_run_tarball_writer (compress_job);
     }
+    else
+    {
+        compressor = autoar_compressor_new (compress_job->source_files,
+                                            compress_job->output_file,
+                                            compress_job->format,
+                                            compress_job->filter,
+                                            FALSE);
+        if (compress_job->passphrase && compress_job->passphrase[0] != '\0')
+        {
+            autoar_compressor_set_passphrase (compressor, compress_job->passphrase);
+        }
 
-    autoar_compressor_set_output_is_dest (compressor, TRUE);
+        autoar_compressor_set_output_is_dest (compressor, TRUE);
 
-    autoar_compressor_set_notify_interval (compressor,
-                                           PROGRESS_NOTIFY_INTERVAL);
+        autoar_compressor_set_notify_interval (compressor,
+                                               PROGRESS_NOTIFY_INTERVAL);
 
-    g_signal_connect (compressor, "progress",
-                      G_CALLBACK (compress_job_on_progress), compress_job);
-    g_signal_connect (compressor, "error",
-                      G_CALLBACK (compress_job_on_error), compress_job);
-    g_signal_connect (compressor, "completed",
-                      G_CALLBACK (compress_job_on_completed), compress_job);
-    autoar_compressor_start (compressor,
-                             compress_job->common.cancellable);
+        g_signal_connect (compressor, "progress",
+                          G_CALLBACK (compress_job_on_progress), compress_job);
+        g_signal_connect (compressor, "error",
+                          G_CALLBACK (compress_job_on_error), compress_job);
+        g_signal_connect (compressor, "completed",
+                          G_CALLBACK (compress_job_on_completed), compress_job);
+        autoar_compressor_start (compressor,
+                                 compress_job->common.cancellable);
+    }
 
     compress_job->success = g_file_query_exists (compress_job->output_file,
                                                  NULL);
@@ -8726,18 +10379,17 @@ compress_task_thread_func (GTask        *task,
     }
 }
 
-void
-nautilus_file_operations_compress (GList                          *files,
-                                   GFile                          *output,
-                                   AutoarFormat                    format,
-                                   AutoarFilter                    filter,
-                                   const gchar                    *passphrase,
-                                   GtkWindow                      *parent_window,
-                                   NautilusFileOperationsDBusData *dbus_data,
-                                   NautilusCreateCallback          done_callback,
-                                   gpointer                        done_callback_data)
+static CompressJob *
+compress_job_setup (GList                          *files,
+                    GFile                          *output,
+                    AutoarFormat                    format,
+                    AutoarFilter                    filter,
+                    const gchar                    *passphrase,
+                    GtkWindow                      *parent_window,
+                    NautilusFileOperationsDBusData *dbus_data,
+                    NautilusCreateCallback          done_callback,
+                    gpointer                        done_callback_data)
 {
-    g_autoptr (GTask) task = NULL;
     CompressJob *compress_job;
 
     compress_job = op_job_new (CompressJob, parent_window, dbus_data);
@@ -8751,8 +10403,6 @@ nautilus_file_operations_compress (GList                          *files,
     compress_job->done_callback = done_callback;
     compress_job->done_callback_data = done_callback_data;
 
-    inhibit_power_manager ((CommonJob *) compress_job, _("Compressing Files"));
-
     if (!nautilus_file_undo_manager_is_operating ())
     {
         compress_job->common.undo_info = nautilus_file_undo_info_compress_new (files,
@@ -8762,8 +10412,58 @@ nautilus_file_operations_compress (GList                          *files,
                                                                                passphrase);
     }
 
+    return compress_job;
+}
+
+void
+nautilus_file_operations_compress (GList                          *files,
+                                   GFile                          *output,
+                                   AutoarFormat                    format,
+                                   AutoarFilter                    filter,
+                                   const gchar                    *passphrase,
+                                   GtkWindow                      *parent_window,
+                                   NautilusFileOperationsDBusData *dbus_data,
+                                   NautilusCreateCallback          done_callback,
+                                   gpointer                        done_callback_data)
+{
+    g_autoptr (GTask) task = NULL;
+    CompressJob *compress_job;
+
+    compress_job = compress_job_setup (files, output, format, filter, passphrase,
+                                       parent_window, dbus_data,
+                                       done_callback, done_callback_data);
+
+    inhibit_power_manager ((CommonJob *) compress_job, _("Compressing Files"));
+
     task = g_task_new (NULL, compress_job->common.cancellable,
                        compress_task_done, compress_job);
     g_task_set_task_data (task, compress_job, NULL);
     g_task_run_in_thread (task, compress_task_thread_func);
 }
+
+gboolean
+nautilus_file_operations_compress_sync (GList        *files,
+                                        GFile        *output,
+                                        AutoarFormat  format,
+                                        AutoarFilter  filter)
+{
+    GTask *task;
+    CompressJob *compress_job;
+    gboolean success;
+
+    compress_job = compress_job_setup (files, output, format, filter, NULL,
+                                       NULL, NULL, NULL, NULL);
+
+    task = g_task_new (NULL, compress_job->common.cancellable, NULL, compress_job);
+    g_task_set_task_data (task, compress_job, NULL);
+    g_task_run_in_thread_sync (task, compress_task_thread_func);
+    g_object_unref (task);
+
+    success = compress_job->success;
+    /* Since g_task_run_in_thread_sync doesn't work with callbacks (in this case not reaching
+     * compress_task_done) we need to set up the undo information ourselves.
+     */
+    compress_task_done (NULL, NULL, compress_job);
+
+    return success;
+}
@@ -31,6 +31,10 @@
 
 #define SECONDS_NEEDED_FOR_APROXIMATE_TRANSFER_RATE 1
 
+/* gnome-autoar has no zstd filter, so tarballs compressed with zstd are
+ * requested with this value and written by nautilus itself. */
+#define NAUTILUS_COMPRESS_FILTER_ZSTD ((AutoarFilter) AUTOAR_FILTER_LAST)
+
 typedef void (* NautilusCopyCallback)      (GHashTable *debuting_uris,
 					    gboolean    success,
 					    gpointer    callback_data);
@@ -83,6 +87,10 @@ void nautilus_file_operations_new_file_from_template (GtkWidget               *p
 
 void nautilus_file_operations_trash_or_delete_sync (GList                  *files);
 void nautilus_file_operations_delete_sync (GList                  *files);
+/* nautilus_file_operations_set_dialog_answer_for_testing() is for testing
+ * purposes only: while set, dialogs aren't shown and are answered with the
+ * button of that title. */
+void nautilus_file_operations_set_dialog_answer_for_testing (const char *button_title);
 void nautilus_file_operations_trash_or_delete_async (GList                          *files,
                                                      GtkWindow                      *parent_window,
                                                      NautilusFileOperationsDBusData *dbus_data,
@@ -164,6 +172,10 @@ void nautilus_file_operations_compress (GList                          *files,
                                         NautilusFileOperationsDBusData *dbus_data,
                                         NautilusCreateCallback          done_callback,
                                         gpointer                        done_callback_data);
+gboolean nautilus_file_operations_compress_sync (GList        *files,
+                                                 GFile        *output,
+                                                 AutoarFormat  format,
+                                                 AutoarFilter  filter);
 
 void
 nautilus_file_operations_paste_image_from_clipboard (GtkWidget                      *parent_view,
@@ -237,6 +237,10 @@ gboolean      nautilus_file_update_name                    (NautilusFile
 							    const char             *name);
 gboolean      nautilus_file_update_metadata_from_info      (NautilusFile           *file,
 							    GFileInfo              *info);
+/* Adds the metadata the file has to info, except for keys info already
+ * has, so that info can be used to update just those keys. */
+void          nautilus_file_add_metadata_to_info           (NautilusFile           *file,
+							    GFileInfo              *info);
 
 gboolean      nautilus_file_update_name_and_directory      (NautilusFile           *file,
 							    const char             *name,
@@ -22,11 +22,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "nautilus-file-undo-operations.h"
 
 #include <glib/gi18n.h>
 
+#include "nautilus-compact-file-list.h"
 #include "nautilus-file-operations.h"
 #include "nautilus-file.h"
 #include "nautilus-file-undo-manager.h"
@@ -44,6 +46,19 @@
  */
 #define TRASH_TIME_EPSILON 2
 
+/* How many of the names GLib gives to items of the same name in the trash
+ * are looked at, before leaving it to enumerating the trash. */
+#define MAX_TRASH_NAME_PROBES 64
+/* GLib takes the first free name, so a few missing ones in a row mean the
+ * item is not in the home trash. A single gap is left by items which were
+ * removed from the trash meanwhile. */
+#define MAX_TRASH_NAME_MISSES 4
+
+#define TRASH_ITEM_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+                              G_FILE_ATTRIBUTE_TRASH_DELETION_DATE "," \
+                              G_FILE_ATTRIBUTE_TRASH_ORIG_PATH "," \
+                              G_FILE_ATTRIBUTE_UNIX_INODE
+
 typedef struct
 {
     NautilusFileUndoOp op_type;
@@ -403,8 +418,9 @@ struct _NautilusFileUndoInfoExt
 
     GFile *src_dir;
     GFile *dest_dir;
-    GQueue *sources;          /* Relative to src_dir */
-    GQueue *destinations;     /* Relative to dest_dir */
+    /* Copies cover every file of the tree, so these are kept compact */
+    NautilusCompactFileList *sources;          /* Relative to src_dir */
+    NautilusCompactFileList *destinations;     /* Relative to dest_dir */
 };
 
 G_DEFINE_TYPE (NautilusFileUndoInfoExt, nautilus_file_undo_info_ext, NAUTILUS_TYPE_FILE_UNDO_INFO)
@@ -412,18 +428,16 @@ G_DEFINE_TYPE (NautilusFileUndoInfoExt, nautilus_file_undo_info_ext, NAUTILUS_TY
 static char *
 ext_get_first_target_short_name (NautilusFileUndoInfoExt *self)
 {
-    GList *targets_first;
-    char *file_name = NULL;
+    g_autoptr (GFile) target_first = NULL;
 
-    targets_first = g_queue_peek_head_link (self->destinations);
-
-    if (targets_first != NULL &&
-        targets_first->data != NULL)
+    if (nautilus_compact_file_list_get_length (self->destinations) == 0)
     {
-        file_name = g_file_get_basename (targets_first->data);
+        return NULL;
     }
 
-    return file_name;
+    target_first = nautilus_compact_file_list_get_file (self->destinations, 0);
+
+    return g_file_get_basename (target_first);
 }
 
 static void
@@ -583,7 +597,9 @@ ext_create_link_redo_func (NautilusFileUndoInfoExt        *self,
                            GtkWindow                      *parent_window,
                            NautilusFileOperationsDBusData *dbus_data)
 {
-    nautilus_file_operations_link (g_queue_peek_head_link (self->sources),
+    g_autolist (GFile) files = nautilus_compact_file_list_expand (self->sources);
+
+    nautilus_file_operations_link (files,
                                    self->dest_dir,
                                    parent_window,
                                    dbus_data,
@@ -596,7 +612,9 @@ ext_duplicate_redo_func (NautilusFileUndoInfoExt        *self,
                          GtkWindow                      *parent_window,
                          NautilusFileOperationsDBusData *dbus_data)
 {
-    nautilus_file_operations_duplicate (g_queue_peek_head_link (self->sources),
+    g_autolist (GFile) files = nautilus_compact_file_list_expand (self->sources);
+
+    nautilus_file_operations_duplicate (files,
                                         parent_window,
                                         dbus_data,
                                         file_undo_info_transfer_callback,
@@ -608,7 +626,9 @@ ext_copy_redo_func (NautilusFileUndoInfoExt        *self,
                     GtkWindow                      *parent_window,
                     NautilusFileOperationsDBusData *dbus_data)
 {
-    nautilus_file_operations_copy_async (g_queue_peek_head_link (self->sources),
+    g_autolist (GFile) files = nautilus_compact_file_list_expand (self->sources);
+
+    nautilus_file_operations_copy_async (files,
                                          self->dest_dir,
                                          parent_window,
                                          dbus_data,
@@ -621,7 +641,9 @@ ext_move_restore_redo_func (NautilusFileUndoInfoExt        *self,
                             GtkWindow                      *parent_window,
                             NautilusFileOperationsDBusData *dbus_data)
 {
-    nautilus_file_operations_move_async (g_queue_peek_head_link (self->sources),
+    g_autolist (GFile) files = nautilus_compact_file_list_expand (self->sources);
+
+    nautilus_file_operations_move_async (files,
                                          self->dest_dir,
                                          parent_window,
                                          dbus_data,
@@ -665,7 +687,9 @@ ext_restore_undo_func (NautilusFileUndoInfoExt        *self,
                        GtkWindow                      *parent_window,
                        NautilusFileOperationsDBusData *dbus_data)
 {
-    nautilus_file_operations_trash_or_delete_async (g_queue_peek_head_link (self->destinations),
+    g_autolist (GFile) files = nautilus_compact_file_list_expand (self->destinations);
+
+    nautilus_file_operations_trash_or_delete_async (files,
                                                     parent_window,
                                                     dbus_data,
                                                     file_undo_info_delete_callback,
@@ -678,7 +702,9 @@ ext_move_undo_func (NautilusFileUndoInfoExt        *self,
                     GtkWindow                      *parent_window,
                     NautilusFileOperationsDBusData *dbus_data)
 {
-    nautilus_file_operations_move_async (g_queue_peek_head_link (self->destinations),
+    g_autolist (GFile) files = nautilus_compact_file_list_expand (self->destinations);
+
+    nautilus_file_operations_move_async (files,
                                          self->src_dir,
                                          parent_window,
                                          dbus_data,
@@ -691,16 +717,14 @@ ext_copy_duplicate_undo_func (NautilusFileUndoInfoExt        *self,
                               GtkWindow                      *parent_window,
                               NautilusFileOperationsDBusData *dbus_data)
 {
-    GList *files;
+    g_autolist (GFile) files = NULL;
 
-    files = g_list_copy (g_queue_peek_head_link (self->destinations));
+    files = nautilus_compact_file_list_expand (self->destinations);
     files = g_list_reverse (files);     /* Deleting must be done in reverse */
 
     nautilus_file_operations_delete_async (files, parent_window,
                                            dbus_data,
                                            file_undo_info_delete_callback, self);
-
-    g_list_free (files);
 }
 
 static void
@@ -741,15 +765,8 @@ nautilus_file_undo_info_ext_finalize (GObject *obj)
 {
     NautilusFileUndoInfoExt *self = NAUTILUS_FILE_UNDO_INFO_EXT (obj);
 
-    if (self->sources)
-    {
-        g_queue_free_full (self->sources, g_object_unref);
-    }
-
-    if (self->destinations)
-    {
-        g_queue_free_full (self->destinations, g_object_unref);
-    }
+    g_clear_pointer (&self->sources, nautilus_compact_file_list_free);
+    g_clear_pointer (&self->destinations, nautilus_compact_file_list_free);
 
     g_clear_object (&self->src_dir);
     g_clear_object (&self->dest_dir);
@@ -785,8 +802,8 @@ nautilus_file_undo_info_ext_new (NautilusFileUndoOp  op_type,
 
     self->src_dir = g_object_ref (src_dir);
     self->dest_dir = g_object_ref (target_dir);
-    self->sources = g_queue_new ();
-    self->destinations = g_queue_new ();
+    self->sources = nautilus_compact_file_list_new ();
+    self->destinations = nautilus_compact_file_list_new ();
 
     return NAUTILUS_FILE_UNDO_INFO (self);
 }
@@ -796,8 +813,8 @@ nautilus_file_undo_info_ext_add_origin_target_pair (NautilusFileUndoInfoExt *sel
                                                     GFile                   *origin,
                                                     GFile                   *target)
 {
-    g_queue_push_tail (self->sources, g_object_ref (origin));
-    g_queue_push_tail (self->destinations, g_object_ref (target));
+    nautilus_compact_file_list_append (self->sources, origin, 0);
+    nautilus_compact_file_list_append (self->destinations, target, 0);
 }
 
 /* create new file/folder */
@@ -1589,9 +1606,144 @@ struct _NautilusFileUndoInfoTrash
 {
     NautilusFileUndoInfo parent_instance;
 
-    GHashTable *trashed;
+    GHashTable *trashed; /* GFile original location -> TrashedItem */
+
+    /* How many items the last undo had to look for in the whole trash */
+    guint n_searched;
 };
 
+typedef struct
+{
+    gint64 trash_time;
+    /* Tells the item apart from others of the same location trashed in the
+     * same seconds, 0 if it is not known */
+    guint64 inode;
+} TrashedItem;
+
+static TrashedItem *
+trashed_item_new (gint64  trash_time,
+                  guint64 inode)
+{
+    TrashedItem *item = g_new0 (TrashedItem, 1);
+
+    item->trash_time = trash_time;
+    item->inode = inode;
+
+    return item;
+}
+
+static void
+trashed_item_free (TrashedItem *item)
+{
+    g_free (item);
+}
+
+static gboolean
+trash_time_matches (GDateTime *deletion_date,
+                    gint64     trash_time)
+{
+    return deletion_date != NULL &&
+           ABS (trash_time - g_date_time_to_unix (deletion_date)) <= TRASH_TIME_EPSILON;
+}
+
+/* Whether the trash item described by @info is @original, trashed as
+ * @item. */
+static gboolean
+trash_info_matches (GFileInfo   *info,
+                    GFile       *original,
+                    TrashedItem *item)
+{
+    const char *orig_path;
+    g_autoptr (GFile) orig_file = NULL;
+    g_autoptr (GDateTime) deletion_date = NULL;
+
+    orig_path = g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
+    if (orig_path == NULL)
+    {
+        return FALSE;
+    }
+
+    if (item->inode != 0 &&
+        g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_INODE) &&
+        g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE) != item->inode)
+    {
+        return FALSE;
+    }
+
+    orig_file = g_file_new_for_path (orig_path);
+    deletion_date = g_file_info_get_deletion_date (info);
+
+    return g_file_equal (orig_file, original) &&
+           trash_time_matches (deletion_date, item->trash_time);
+}
+
+/* The names GLib gives to items of the same name in the trash, in the order
+ * it tries them: the basename itself, then with ".2", ".3" and so on
+ * inserted before the first dot. */
+static gchar *
+get_trash_name_candidate (const gchar *basename,
+                          guint        id)
+{
+    const gchar *dot;
+
+    if (id == 1)
+    {
+        return g_strdup (basename);
+    }
+
+    dot = strchr (basename, '.');
+    if (dot == NULL)
+    {
+        return g_strdup_printf ("%s.%u", basename, id);
+    }
+
+    return g_strdup_printf ("%.*s.%u%s", (int) (dot - basename), basename, id, dot);
+}
+
+/* Finds the name which @original got in trash:/// when it was trashed as
+ * @item, by looking up the few names it can have been given. Items trashed on
+ * other mounts are named after their whole path, and are not found here. */
+static gchar *
+find_trash_name (GFile       *original,
+                 TrashedItem *item)
+{
+    g_autoptr (GFile) trash = NULL;
+    g_autofree gchar *basename = NULL;
+    guint n_missing = 0;
+
+    if (!g_file_is_native (original))
+    {
+        return NULL;
+    }
+
+    trash = g_file_new_for_uri (SCHEME_TRASH ":///");
+    basename = g_file_get_basename (original);
+
+    for (guint id = 1; id <= MAX_TRASH_NAME_PROBES && n_missing < MAX_TRASH_NAME_MISSES; id++)
+    {
+        g_autofree gchar *name = get_trash_name_candidate (basename, id);
+        g_autoptr (GFile) candidate = g_file_get_child (trash, name);
+        g_autoptr (GFileInfo) info = NULL;
+
+        info = g_file_query_info (candidate, TRASH_ITEM_ATTRIBUTES,
+                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                  NULL, NULL);
+        if (info == NULL)
+        {
+            n_missing++;
+            continue;
+        }
+
+        n_missing = 0;
+        if (trash_info_matches (info, original, item))
+        {
+            return g_strdup (g_file_info_get_name (info));
+        }
+    }
+
+    return NULL;
+}
+
 G_DEFINE_TYPE (NautilusFileUndoInfoTrash, nautilus_file_undo_info_trash, NAUTILUS_TYPE_FILE_UNDO_INFO)
 
 static void
@@ -1654,19 +1806,24 @@ trash_redo_func_callback (GHashTable *debuting_uris,
     {
         new_trashed_files =
             g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
-                                   g_object_unref, g_free);
+                                   g_object_unref, (GDestroyNotify) trashed_item_free);
 
         keys = g_hash_table_get_keys (self->trashed);
 
         /* Convert from microseconds to seconds */
         updated_trash_time = g_get_real_time () / 1000000;
 
+        /* The items got new trash times, which are looked up by when
+         * undoing again. */
         for (l = keys; l != NULL; l = l->next)
         {
+            TrashedItem *item;
+
             file = l->data;
+            item = g_hash_table_lookup (self->trashed, file);
             g_hash_table_insert (new_trashed_files,
                                  g_object_ref (file),
-                                 g_memdup2 (&updated_trash_time, sizeof (updated_trash_time)));
+                                 trashed_item_new (updated_trash_time, item->inode));
         }
 
         g_list_free (keys);
@@ -1698,6 +1855,8 @@ trash_redo_func (NautilusFileUndoInfo           *info,
     }
 }
 
+/* Looks up the items by their name in the trash first, and only lists the
+ * trash for those whose name is unknown or stale. */
 static void
 trash_retrieve_files_to_restore_thread (GTask        *task,
                                         gpointer      source_object,
@@ -1705,68 +1864,79 @@ trash_retrieve_files_to_restore_thread (GTask        *task,
                                         GCancellable *cancellable)
 {
     NautilusFileUndoInfoTrash *self = NAUTILUS_FILE_UNDO_INFO_TRASH (source_object);
-    GFileEnumerator *enumerator;
+    g_autoptr (GHashTable) unresolved = NULL;
+    g_autoptr (GFileEnumerator) enumerator = NULL;
     GHashTable *to_restore;
-    GFile *trash;
+    GHashTableIter iter;
+    GFile *original;
+    TrashedItem *trashed_item;
+    g_autoptr (GFile) trash = NULL;
     GError *error = NULL;
 
     to_restore = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
                                         g_object_unref, g_object_unref);
+    unresolved = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
 
     trash = g_file_new_for_uri (SCHEME_TRASH ":///");
 
-    enumerator = g_file_enumerate_children (trash,
-                                            G_FILE_ATTRIBUTE_STANDARD_NAME ","
-                                            G_FILE_ATTRIBUTE_TRASH_DELETION_DATE ","
-                                            G_FILE_ATTRIBUTE_TRASH_ORIG_PATH,
-                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                            NULL, &error);
+    g_hash_table_iter_init (&iter, self->trashed);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &original, (gpointer *) &trashed_item))
+    {
+        g_autofree gchar *trash_name = NULL;
+
+        /* Looked up here rather than when trashing, which it would slow
+         * down for an undo that most often never comes. */
+        trash_name = find_trash_name (original, trashed_item);
+        if (trash_name != NULL)
+        {
+            g_hash_table_insert (to_restore, g_file_get_child (trash, trash_name),
+                                 g_object_ref (original));
+        }
+        else
+        {
+            g_hash_table_add (unresolved, original);
+        }
+    }
+
+    g_atomic_int_set (&self->n_searched, g_hash_table_size (unresolved));
+
+    if (g_hash_table_size (unresolved) > 0)
+    {
+        enumerator = g_file_enumerate_children (trash, TRASH_ITEM_ATTRIBUTES,
+                                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                NULL, &error);
+    }
 
     if (enumerator)
     {
         GFileInfo *info;
-        gpointer lookupvalue;
-        GFile *item;
-        gint64 orig_trash_time;
-        gint64 trash_time;
-        const char *origpath;
-        GFile *origfile;
 
-        while ((info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
+        while (g_hash_table_size (unresolved) > 0 &&
+               (info = g_file_enumerator_next_file (enumerator, NULL, &error)) != NULL)
         {
+            const char *origpath;
+            g_autoptr (GFile) origfile = NULL;
+
             /* Retrieve the original file uri */
             origpath = g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
-            origfile = g_file_new_for_path (origpath);
-
-            lookupvalue = g_hash_table_lookup (self->trashed, origfile);
+            origfile = origpath != NULL ? g_file_new_for_path (origpath) : NULL;
+            trashed_item = origfile != NULL && g_hash_table_contains (unresolved, origfile) ?
+                           g_hash_table_lookup (self->trashed, origfile) : NULL;
 
-            if (lookupvalue)
+            if (trashed_item != NULL &&
+                trash_info_matches (info, origfile, trashed_item))
             {
-                GDateTime *date;
-
-                orig_trash_time = *((guint64 *) lookupvalue);
-                trash_time = 0;
-                date = g_file_info_get_deletion_date (info);
-                if (date)
-                {
-                    trash_time = g_date_time_to_unix (date);
-                    g_date_time_unref (date);
-                }
-
-                if (ABS (orig_trash_time - trash_time) <= TRASH_TIME_EPSILON)
-                {
-                    /* File in the trash */
-                    item = g_file_get_child (trash, g_file_info_get_name (info));
-                    g_hash_table_insert (to_restore, item, g_object_ref (origfile));
-                }
+                /* File in the trash */
+                g_hash_table_remove (unresolved, origfile);
+                g_hash_table_insert (to_restore,
+                                     g_file_get_child (trash, g_file_info_get_name (info)),
+                                     g_steal_pointer (&origfile));
             }
 
-            g_object_unref (origfile);
+            g_object_unref (info);
         }
         g_file_enumerator_close (enumerator, FALSE, NULL);
-        g_object_unref (enumerator);
     }
-    g_object_unref (trash);
 
     if (error != NULL)
     {
@@ -1852,7 +2022,7 @@ static void
 nautilus_file_undo_info_trash_init (NautilusFileUndoInfoTrash *self)
 {
     self->trashed = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
-                                           g_object_unref, g_free);
+                                           g_object_unref, (GDestroyNotify) trashed_item_free);
 }
 
 static void
@@ -1888,13 +2058,14 @@ nautilus_file_undo_info_trash_new (gint item_count)
 
 void
 nautilus_file_undo_info_trash_add_file (NautilusFileUndoInfoTrash *self,
-                                        GFile                     *file)
+                                        GFile                     *file,
+                                        guint64                    inode)
 {
     /* Convert from microseconds to seconds */
     gint64 orig_trash_time = g_get_real_time () / 1000000;
-    g_hash_table_insert (self->trashed,
-                         g_object_ref (file),
-                         g_memdup2 (&orig_trash_time, sizeof (orig_trash_time)));
+
+    g_hash_table_insert (self->trashed, g_object_ref (file),
+                         trashed_item_new (orig_trash_time, inode));
 }
 
 GList *
@@ -1903,13 +2074,19 @@ nautilus_file_undo_info_trash_get_files (NautilusFileUndoInfoTrash *self)
     return g_hash_table_get_keys (self->trashed);
 }
 
+guint
+nautilus_file_undo_info_trash_get_n_searched (NautilusFileUndoInfoTrash *self)
+{
+    return g_atomic_int_get (&self->n_searched);
+}
+
 /* recursive permissions */
 struct _NautilusFileUndoInfoRecPermissions
 {
     NautilusFileUndoInfo parent_instance;
 
     GFile *dest_dir;
-    GHashTable *original_permissions;
+    NautilusCompactFileList *original_permissions; /* Values are the modes */
     guint32 dir_mask;
     guint32 dir_permissions;
     guint32 file_mask;
@@ -1971,27 +2148,20 @@ rec_permissions_undo_func (NautilusFileUndoInfo           *info,
 {
     NautilusFileUndoInfoRecPermissions *self = NAUTILUS_FILE_UNDO_INFO_REC_PERMISSIONS (info);
 
-    if (g_hash_table_size (self->original_permissions) > 0)
-    {
-        GList *gfiles_list;
-        guint32 perm;
-        GList *l;
-        GFile *dest;
-        char *item;
+    guint n_files = nautilus_compact_file_list_get_length (self->original_permissions);
 
-        gfiles_list = g_hash_table_get_keys (self->original_permissions);
-        for (l = gfiles_list; l != NULL; l = l->next)
+    if (n_files > 0)
+    {
+        for (guint i = 0; i < n_files; i++)
         {
-            item = l->data;
-            perm = GPOINTER_TO_UINT (g_hash_table_lookup (self->original_permissions, item));
-            dest = g_file_new_for_uri (item);
+            g_autoptr (GFile) dest = nautilus_compact_file_list_get_file (self->original_permissions, i);
+            guint32 perm = nautilus_compact_file_list_get_value (self->original_permissions, i);
+
             g_file_set_attribute_uint32 (dest,
                                          G_FILE_ATTRIBUTE_UNIX_MODE,
                                          perm, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
-            g_object_unref (dest);
         }
 
-        g_list_free (gfiles_list);
         /* Here we must do what's necessary for the callback */
         file_undo_info_transfer_callback (NULL, TRUE, self);
     }
@@ -2000,8 +2170,7 @@ rec_permissions_undo_func (NautilusFileUndoInfo           *info,
 static void
 nautilus_file_undo_info_rec_permissions_init (NautilusFileUndoInfoRecPermissions *self)
 {
-    self->original_permissions = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                        g_free, NULL);
+    self->original_permissions = nautilus_compact_file_list_new ();
 }
 
 static void
@@ -2009,7 +2178,7 @@ nautilus_file_undo_info_rec_permissions_finalize (GObject *obj)
 {
     NautilusFileUndoInfoRecPermissions *self = NAUTILUS_FILE_UNDO_INFO_REC_PERMISSIONS (obj);
 
-    g_hash_table_destroy (self->original_permissions);
+    nautilus_compact_file_list_free (self->original_permissions);
     g_clear_object (&self->dest_dir);
 
     G_OBJECT_CLASS (nautilus_file_undo_info_rec_permissions_parent_class)->finalize (obj);
@@ -2056,8 +2225,7 @@ nautilus_file_undo_info_rec_permissions_add_file (NautilusFileUndoInfoRecPermiss
                                                   GFile                              *file,
                                                   guint32                             permission)
 {
-    gchar *original_uri = g_file_get_uri (file);
-    g_hash_table_insert (self->original_permissions, original_uri, GUINT_TO_POINTER (permission));
+    nautilus_compact_file_list_append (self->original_permissions, file, permission);
 }
 
 /* single file change permissions */
@@ -167,8 +167,13 @@ G_DECLARE_FINAL_TYPE (NautilusFileUndoInfoTrash, nautilus_file_undo_info_trash,
 
 NautilusFileUndoInfo *nautilus_file_undo_info_trash_new (gint item_count);
 void nautilus_file_undo_info_trash_add_file (NautilusFileUndoInfoTrash *self,
-                                             GFile                     *file);
+                                             GFile                     *file,
+                                             guint64                    inode);
 GList *nautilus_file_undo_info_trash_get_files (NautilusFileUndoInfoTrash *self);
+/* nautilus_file_undo_info_trash_get_n_searched() is for testing purposes only:
+ * how many items the last undo could not find by name, and looked for in the
+ * whole trash. */
+guint nautilus_file_undo_info_trash_get_n_searched (NautilusFileUndoInfoTrash *self);
 
 /* recursive permissions */
 #define NAUTILUS_TYPE_FILE_UNDO_INFO_REC_PERMISSIONS nautilus_file_undo_info_rec_permissions_get_type ()
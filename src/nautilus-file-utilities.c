@@ -263,6 +263,137 @@ nautilus_get_mounted_mount_for_root (GFile *location)
     return result;
 }
 
+struct _NautilusNameSnapshot
+{
+    GFile *directory;
+    GHashTable *names;        /* child names known to be taken */
+    GHashTable *next_counts;  /* base name -> first count not known to be taken */
+};
+
+NautilusNameSnapshot *
+nautilus_name_snapshot_new (GFile        *directory,
+                            GCancellable *cancellable)
+{
+    NautilusNameSnapshot *self;
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+
+    g_return_val_if_fail (G_IS_FILE (directory), NULL);
+
+    self = g_new0 (NautilusNameSnapshot, 1);
+    self->directory = g_object_ref (directory);
+    self->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    self->next_counts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    enumerator = g_file_enumerate_children (directory,
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            cancellable, NULL);
+    if (enumerator != NULL)
+    {
+        GFileInfo *info;
+
+        /* A partial listing is fine, the callers verify their final choice. */
+        while (g_file_enumerator_iterate (enumerator, &info, NULL, cancellable, NULL) &&
+               info != NULL)
+        {
+            g_hash_table_add (self->names, g_strdup (g_file_info_get_name (info)));
+        }
+    }
+
+    return self;
+}
+
+void
+nautilus_name_snapshot_free (NautilusNameSnapshot *self)
+{
+    if (self == NULL)
+    {
+        return;
+    }
+
+    g_object_unref (self->directory);
+    g_hash_table_destroy (self->names);
+    g_hash_table_destroy (self->next_counts);
+    g_free (self);
+}
+
+gboolean
+nautilus_name_snapshot_claim (NautilusNameSnapshot *self,
+                              const char           *name)
+{
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (name != NULL, FALSE);
+
+    if (g_hash_table_contains (self->names, name))
+    {
+        return FALSE;
+    }
+
+    g_hash_table_add (self->names, g_strdup (name));
+
+    return TRUE;
+}
+
+int
+nautilus_name_snapshot_get_next_count (NautilusNameSnapshot *self,
+                                       const char           *base_name)
+{
+    g_return_val_if_fail (self != NULL, 1);
+
+    return MAX (1, GPOINTER_TO_INT (g_hash_table_lookup (self->next_counts, base_name)));
+}
+
+void
+nautilus_name_snapshot_set_next_count (NautilusNameSnapshot *self,
+                                       const char           *base_name,
+                                       int                   count)
+{
+    g_return_if_fail (self != NULL);
+
+    if (count > nautilus_name_snapshot_get_next_count (self, base_name))
+    {
+        g_hash_table_insert (self->next_counts, g_strdup (base_name), GINT_TO_POINTER (count));
+    }
+}
+
+GFile *
+nautilus_name_snapshot_generate_unique_file (NautilusNameSnapshot *self,
+                                             const char           *basename)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (basename != NULL, NULL);
+
+    int counter = nautilus_name_snapshot_get_next_count (self, basename);
+
+    while (TRUE)
+    {
+        g_autofree char *filename = counter == 1 ?
+                                    g_strdup (basename) :
+                                    nautilus_filename_for_conflict (basename, counter - 1, -1, FALSE);
+
+        counter += 1;
+
+        if (g_hash_table_contains (self->names, filename))
+        {
+            continue;
+        }
+
+        GFile *child = g_file_get_child (self->directory, filename);
+
+        /* The snapshot may be stale, so verify the one name we settled on. */
+        if (!g_file_query_exists (child, NULL))
+        {
+            /* Everything below the suggestion is known to be taken. */
+            nautilus_name_snapshot_set_next_count (self, basename, counter - 1);
+
+            return child;
+        }
+
+        g_hash_table_add (self->names, g_steal_pointer (&filename));
+        g_object_unref (child);
+    }
+}
+
 GFile *
 nautilus_generate_unique_file_in_directory (GFile      *directory,
                                             const char *basename)
@@ -273,12 +404,13 @@ nautilus_generate_unique_file_in_directory (GFile      *directory,
 
     GFile *child = g_file_get_child (directory, basename);
 
-    for (size_t counter = 1; g_file_query_exists (child, NULL); counter += 1)
+    if (g_file_query_exists (child, NULL))
     {
-        g_autofree char *filename = nautilus_filename_for_conflict (basename, counter, -1, FALSE);
+        /* Read the directory once instead of probing every candidate. */
+        g_autoptr (NautilusNameSnapshot) snapshot = nautilus_name_snapshot_new (directory, NULL);
 
         g_object_unref (child);
-        child = g_file_get_child (directory, filename);
+        child = nautilus_name_snapshot_generate_unique_file (snapshot, basename);
     }
 
     return child;
@@ -62,6 +62,30 @@ GIcon *  nautilus_special_directory_get_symbolic_icon (GUserDirectory directory)
 GFile * nautilus_generate_unique_file_in_directory (GFile      *directory,
                                                     const char *basename);
 
+/* A snapshot of the names in a directory, read once, so that picking
+ * unique names for many files doesn't cost a round-trip per candidate.
+ * Names are claimed as they are handed out, and the next free count is
+ * remembered per base name. The snapshot can go stale, so callers must
+ * still verify their final choice, e.g. by an exclusive create.
+ * This does blocking I/O and is not thread-safe.
+ */
+typedef struct _NautilusNameSnapshot NautilusNameSnapshot;
+
+NautilusNameSnapshot * nautilus_name_snapshot_new            (GFile                *directory,
+                                                              GCancellable         *cancellable);
+void                   nautilus_name_snapshot_free           (NautilusNameSnapshot *self);
+gboolean               nautilus_name_snapshot_claim          (NautilusNameSnapshot *self,
+                                                              const char           *name);
+int                    nautilus_name_snapshot_get_next_count (NautilusNameSnapshot *self,
+                                                              const char           *base_name);
+void                   nautilus_name_snapshot_set_next_count (NautilusNameSnapshot *self,
+                                                              const char           *base_name,
+                                                              int                   count);
+GFile *                nautilus_name_snapshot_generate_unique_file (NautilusNameSnapshot *self,
+                                                                    const char           *basename);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (NautilusNameSnapshot, nautilus_name_snapshot_free)
+
 GFile *  nautilus_find_existing_uri_in_hierarchy     (GFile *location);
 
 char * nautilus_get_scripts_directory_path (void);
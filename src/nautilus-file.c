@@ -487,6 +487,44 @@ nautilus_file_update_metadata_from_info (NautilusFile *file,
     return changed;
 }
 
+void
+nautilus_file_add_metadata_to_info (NautilusFile *file,
+                                    GFileInfo    *info)
+{
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+
+    if (file->details->metadata == NULL)
+    {
+        return;
+    }
+
+    g_hash_table_iter_init (&iter, file->details->metadata);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        guint id = GPOINTER_TO_UINT (key);
+        g_autofree char *gio_key = NULL;
+
+        gio_key = g_strconcat ("metadata::",
+                               nautilus_metadata_get_name (id & ~METADATA_ID_IS_LIST_MASK),
+                               NULL);
+        if (g_file_info_has_attribute (info, gio_key))
+        {
+            continue;
+        }
+
+        if (id & METADATA_ID_IS_LIST_MASK)
+        {
+            g_file_info_set_attribute_stringv (info, gio_key, value);
+        }
+        else
+        {
+            g_file_info_set_attribute_string (info, gio_key, value);
+        }
+    }
+}
+
 void
 nautilus_file_clear_info (NautilusFile *file)
 {
@@ -4839,6 +4877,30 @@ nautilus_file_get_thumbnail_icon (NautilusFile          *file,
     return icon;
 }
 
+static void
+on_icon_loaded (gpointer user_data)
+{
+    nautilus_file_changed (NAUTILUS_FILE (user_data));
+}
+
+static NautilusIconInfo *
+lookup_icon (NautilusFile          *file,
+             GIcon                 *gicon,
+             int                    size,
+             int                    scale,
+             NautilusFileIconFlags  flags)
+{
+    if (flags & NAUTILUS_FILE_ICON_FLAGS_LOAD_ASYNC)
+    {
+        return nautilus_icon_info_lookup_async (gicon, size, scale,
+                                                on_icon_loaded,
+                                                nautilus_file_ref (file),
+                                                (GDestroyNotify) nautilus_file_unref);
+    }
+
+    return nautilus_icon_info_lookup (gicon, size, scale);
+}
+
 NautilusIconInfo *
 nautilus_file_get_icon (NautilusFile          *file,
                         int                    size,
@@ -4858,10 +4920,14 @@ nautilus_file_get_icon (NautilusFile          *file,
     gicon = get_custom_icon (file);
     if (gicon != NULL)
     {
-        icon = nautilus_icon_info_lookup (gicon, size, scale);
+        icon = lookup_icon (file, gicon, size, scale, flags);
         g_object_unref (gicon);
 
-        goto out;
+        if (icon != NULL)
+        {
+            goto out;
+        }
+        /* Still loading, show the regular icon meanwhile. */
     }
 
     g_debug ("Called file_get_icon(), at size %d", size);
@@ -4876,12 +4942,12 @@ nautilus_file_get_icon (NautilusFile          *file,
     if (icon == NULL)
     {
         gicon = nautilus_file_get_gicon (file, flags);
-        icon = nautilus_icon_info_lookup (gicon, size, scale);
+        icon = lookup_icon (file, gicon, size, scale, flags);
         g_object_unref (gicon);
 
-        if (nautilus_icon_info_is_fallback (icon))
+        if (icon == NULL || nautilus_icon_info_is_fallback (icon))
         {
-            g_object_unref (icon);
+            g_clear_object (&icon);
             icon = nautilus_icon_info_lookup (get_default_file_icon (), size, scale);
         }
     }
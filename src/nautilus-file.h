@@ -81,6 +81,9 @@ typedef enum {
 	NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS = (1<<0),
 	/* uses the icon of the mount if present */
 	NAUTILUS_FILE_ICON_FLAGS_USE_MOUNT_ICON = (1<<1),
+	/* don't block on decoding loadable icons; a placeholder is returned
+	 * and the file is marked changed once the real icon is ready */
+	NAUTILUS_FILE_ICON_FLAGS_LOAD_ASYNC = (1<<2),
 } NautilusFileIconFlags;	
 
 #define NAUTILUS_THUMBNAIL_MINIMUM_ICON_SIZE 32
@@ -115,6 +115,15 @@
 
 #define MIN_COMMON_FILENAME_PREFIX_LENGTH 4
 
+/* Monitor the things needed to get the right icon. Also monitor a directory's
+ * item count because the "size" attribute is based on that, and the file's
+ * metadata and possible custom name. */
+#define DIRECTORY_MONITOR_ATTRIBUTES (NAUTILUS_FILE_ATTRIBUTES_FOR_ICON | \
+                                      NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT | \
+                                      NAUTILUS_FILE_ATTRIBUTE_INFO | \
+                                      NAUTILUS_FILE_ATTRIBUTE_MOUNT | \
+                                      NAUTILUS_FILE_ATTRIBUTE_EXTENSION_INFO)
+
 enum
 {
     ADD_FILES,
@@ -2355,6 +2364,13 @@ create_archive_callback (const char *archive_name,
         }
         break;
 
+        case NAUTILUS_COMPRESSION_TAR_ZSTD:
+        {
+            format = AUTOAR_FORMAT_TAR;
+            filter = NAUTILUS_COMPRESS_FILTER_ZSTD;
+        }
+        break;
+
         case NAUTILUS_COMPRESSION_7ZIP:
         {
             format = AUTOAR_FORMAT_7ZIP;
@@ -4268,6 +4284,7 @@ real_file_changed (NautilusFilesView *self,
     if (item != NULL)
     {
         nautilus_view_item_file_changed (item);
+        nautilus_view_model_selection_summary_item_changed (priv->model, item);
     }
     else
     {
@@ -4925,25 +4942,6 @@ nautilus_files_view_get_content_widget (NautilusFilesView *view)
     return priv->scrolled_window;
 }
 
-/* home_dir_in_selection()
- *
- * Return TRUE if the home directory is in the selection.
- */
-
-static gboolean
-home_dir_in_selection (GList *selection)
-{
-    for (GList *node = selection; node != NULL; node = node->next)
-    {
-        if (nautilus_file_is_home (NAUTILUS_FILE (node->data)))
-        {
-            return TRUE;
-        }
-    }
-
-    return FALSE;
-}
-
 static void
 trash_or_delete_done_cb (GHashTable        *debuting_uris,
                          gboolean           user_cancel,
@@ -7371,72 +7369,18 @@ on_clipboard_owner_changed (GdkClipboard *clipboard,
     nautilus_files_view_update_actions_state (self);
 }
 
-static gboolean
-can_delete_all (GList *files)
-{
-    NautilusFile *file;
-    GList *l;
-
-    for (l = files; l != NULL; l = l->next)
-    {
-        file = l->data;
-        if (!nautilus_file_can_delete (file))
-        {
-            return FALSE;
-        }
-    }
-    return TRUE;
-}
-
-static gboolean
-can_trash_all (GList *files)
-{
-    NautilusFile *file;
-    GList *l;
-
-    for (l = files; l != NULL; l = l->next)
-    {
-        file = l->data;
-        if (!nautilus_file_can_trash (file))
-        {
-            return FALSE;
-        }
-    }
-    return TRUE;
-}
-
-static gboolean
-all_in_trash (GList *files)
+/* The selection summary answers most questions about the selection, so the
+ * files are only listed for the checks which have to look at each of them. */
+static GList *
+peek_selection (NautilusFilesView  *view,
+                GList             **selection)
 {
-    NautilusFile *file;
-    GList *l;
-
-    for (l = files; l != NULL; l = l->next)
+    if (*selection == NULL)
     {
-        file = l->data;
-        if (!nautilus_file_is_in_trash (file))
-        {
-            return FALSE;
-        }
+        *selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
     }
-    return TRUE;
-}
-
-static gboolean
-can_extract_all (GList *files)
-{
-    NautilusFile *file;
-    GList *l;
 
-    for (l = files; l != NULL; l = l->next)
-    {
-        file = l->data;
-        if (!nautilus_file_is_archive (file))
-        {
-            return FALSE;
-        }
-    }
-    return TRUE;
+    return *selection;
 }
 
 static gboolean
@@ -7472,6 +7416,7 @@ static void
 real_update_actions_state (NautilusFilesView *view)
 {
     NautilusFilesViewPrivate *priv;
+    const NautilusSelectionSummary *summary;
     g_autolist (NautilusFile) selection = NULL;
     GList *l;
     gint selection_count;
@@ -7515,24 +7460,28 @@ real_update_actions_state (NautilusFilesView *view)
 
     view_action_group = priv->view_action_group;
 
-    selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
-    selection_count = g_list_length (selection);
-    selection_contains_home_dir = home_dir_in_selection (selection);
+    summary = nautilus_view_model_get_selection_summary (priv->model);
+    selection_count = summary->n_items;
+    if (selection_count == 1)
+    {
+        peek_selection (view, &selection);
+    }
+    selection_contains_home_dir = summary->n_home > 0;
     selection_contains_recent = showing_recent_directory (view);
     selection_contains_starred = showing_starred_directory (view);
     selection_contains_search = nautilus_view_is_searching (NAUTILUS_VIEW (view));
-    selection_all_in_trash = all_in_trash (selection);
+    selection_all_in_trash = summary->n_in_trash == summary->n_items;
     zoom_level_is_default = nautilus_files_view_is_zoom_level_default (view);
 
     is_read_only = nautilus_files_view_is_read_only (view);
     is_in_trash = showing_trash_directory (view);
     can_create_files = nautilus_files_view_supports_creating_files (view);
     can_delete_files =
-        can_delete_all (selection) &&
+        summary->n_can_delete == selection_count &&
         selection_count != 0 &&
         !selection_contains_home_dir;
     can_trash_files =
-        can_trash_all (selection) &&
+        summary->n_can_trash == selection_count &&
         selection_count != 0 &&
         !selection_contains_home_dir;
     can_copy_files = selection_count != 0;
@@ -7541,9 +7490,10 @@ real_update_actions_state (NautilusFilesView *view)
     can_paste_files_into = (selection_count == 1 &&
                             can_paste_into_file (NAUTILUS_FILE (selection->data)));
     can_extract_files = selection_count != 0 &&
-                        can_extract_all (selection);
+                        summary->n_archives == selection_count;
     can_extract_here = nautilus_files_view_supports_extract_here (view);
-    handles_all_files_to_extract = nautilus_handles_all_files_to_extract (selection);
+    handles_all_files_to_extract = can_extract_files &&
+                                   nautilus_handles_all_files_to_extract (peek_selection (view, &selection));
     settings_show_delete_permanently = g_settings_get_boolean (nautilus_preferences,
                                                                NAUTILUS_PREFERENCES_SHOW_DELETE_PERMANENTLY);
     settings_show_create_link = g_settings_get_boolean (nautilus_preferences,
@@ -7562,17 +7512,9 @@ real_update_actions_state (NautilusFilesView *view)
 
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
                                          "rename");
-    if (selection_count > 1)
-    {
-        g_simple_action_set_enabled (G_SIMPLE_ACTION (action),
-                                     nautilus_file_can_rename_files (selection));
-    }
-    else
-    {
-        g_simple_action_set_enabled (G_SIMPLE_ACTION (action),
-                                     selection_count == 1 &&
-                                     nautilus_file_can_rename (selection->data));
-    }
+    g_simple_action_set_enabled (G_SIMPLE_ACTION (action),
+                                 selection_count != 0 &&
+                                 summary->n_can_rename == selection_count);
 
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
                                          "extract-here");
@@ -7601,24 +7543,9 @@ real_update_actions_state (NautilusFilesView *view)
                                  (selection_contains_recent || selection_contains_search ||
                                   selection_contains_starred));
 
-    item_opens_in_view = selection_count != 0;
-
-    for (l = selection; l != NULL; l = l->next)
-    {
-        NautilusFile *file;
-
-        file = NAUTILUS_FILE (selection->data);
-
-        if (!nautilus_file_opens_in_view (file))
-        {
-            item_opens_in_view = FALSE;
-        }
-
-        if (!item_opens_in_view)
-        {
-            break;
-        }
-    }
+    /* Only folders open in the view */
+    item_opens_in_view = selection_count != 0 &&
+                         summary->n_directories == selection_count;
 
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
                                          "open-with-default-application");
@@ -7644,7 +7571,9 @@ real_update_actions_state (NautilusFilesView *view)
     g_simple_action_set_enabled (G_SIMPLE_ACTION (action), can_set_wallpaper (selection));
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
                                          "restore-from-trash");
-    g_simple_action_set_enabled (G_SIMPLE_ACTION (action), can_restore_from_trash (selection));
+    g_simple_action_set_enabled (G_SIMPLE_ACTION (action),
+                                 summary->n_in_trash != 0 &&
+                                 can_restore_from_trash (peek_selection (view, &selection)));
 
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
                                          "move-to-trash");
@@ -7725,42 +7654,25 @@ real_update_actions_state (NautilusFilesView *view)
                                  !selection_contains_starred);
 
     /* Drive menu */
-    show_mount = (selection != NULL);
-    show_unmount = (selection != NULL);
-    show_eject = (selection != NULL);
-    show_start = (selection != NULL && selection_count == 1);
-    show_stop = (selection != NULL && selection_count == 1);
-    show_detect_media = (selection != NULL && selection_count == 1);
-    for (l = selection; l != NULL && (show_mount || show_unmount
-                                      || show_eject
-                                      || show_start || show_stop
-                                      || show_detect_media);
-         l = l->next)
-    {
-        NautilusFile *file;
-        gboolean show_mount_one;
-        gboolean show_unmount_one;
-        gboolean show_eject_one;
-        gboolean show_start_one;
-        gboolean show_stop_one;
-        gboolean show_detect_media_one;
-
-        file = NAUTILUS_FILE (l->data);
-        file_should_show_foreach (file,
-                                  &show_mount_one,
-                                  &show_unmount_one,
-                                  &show_eject_one,
-                                  &show_start_one,
-                                  &show_stop_one,
-                                  &show_detect_media_one,
+    if (selection_count == 1)
+    {
+        file_should_show_foreach (NAUTILUS_FILE (selection->data),
+                                  &show_mount,
+                                  &show_unmount,
+                                  &show_eject,
+                                  &show_start,
+                                  &show_stop,
+                                  &show_detect_media,
                                   &start_stop_type);
-
-        show_mount &= show_mount_one;
-        show_unmount &= show_unmount_one;
-        show_eject &= show_eject_one;
-        show_start &= show_start_one;
-        show_stop &= show_stop_one;
-        show_detect_media &= show_detect_media_one;
+    }
+    else
+    {
+        show_mount = selection_count != 0 && summary->n_can_mount == selection_count;
+        show_unmount = selection_count != 0 && summary->n_can_unmount == selection_count;
+        show_eject = selection_count != 0 && summary->n_can_eject == selection_count;
+        show_start = FALSE;
+        show_stop = FALSE;
+        show_detect_media = FALSE;
     }
 
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
@@ -7820,7 +7732,7 @@ real_update_actions_state (NautilusFilesView *view)
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
                                          "console");
     g_simple_action_set_enabled (G_SIMPLE_ACTION (action),
-                                 selection_count == 1 && nautilus_file_is_directory (selection->data) &&
+                                 selection_count == 1 && summary->n_directories == 1 &&
                                  nautilus_dbus_launcher_is_available (nautilus_dbus_launcher_get (),
                                                                       NAUTILUS_DBUS_LAUNCHER_CONSOLE));
     action = g_action_map_lookup_action (G_ACTION_MAP (view_action_group),
@@ -7878,10 +7790,13 @@ real_update_actions_state (NautilusFilesView *view)
     current_uri = g_file_get_uri (current_location);
     can_star_current_directory = nautilus_tag_manager_can_star_contents (nautilus_tag_manager_get (), current_location);
 
-    show_star = (selection != NULL) &&
+    show_star = selection_count != 0 &&
                 (can_star_current_directory || selection_contains_starred);
-    show_unstar = (selection != NULL) &&
-                  (can_star_current_directory || selection_contains_starred);
+    show_unstar = show_star;
+    if (show_star)
+    {
+        peek_selection (view, &selection);
+    }
     for (l = selection; l != NULL; l = l->next)
     {
         NautilusFile *file;
@@ -7932,10 +7847,12 @@ update_selection_menu (NautilusFilesView *view,
                        GtkBuilder        *builder)
 {
     NautilusFilesViewPrivate *priv = nautilus_files_view_get_instance_private (view);
+    const NautilusSelectionSummary *summary;
     g_autolist (NautilusFile) selection = NULL;
     GList *l;
     gint selection_count;
     gboolean show_app;
+    gboolean check_app;
     gboolean show_run;
     gboolean show_extract;
     gboolean item_opens_in_view;
@@ -7954,15 +7871,13 @@ update_selection_menu (NautilusFilesView *view,
     gint i;
     GDriveStartStopType start_stop_type;
 
-    selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
-    selection_count = g_list_length (selection);
-
-    show_mount = (selection != NULL);
-    show_unmount = (selection != NULL);
-    show_eject = (selection != NULL);
-    show_start = (selection != NULL && selection_count == 1);
-    show_stop = (selection != NULL && selection_count == 1);
-    show_detect_media = (selection != NULL && selection_count == 1);
+    summary = nautilus_view_model_get_selection_summary (priv->model);
+    selection_count = summary->n_items;
+    if (selection_count == 1)
+    {
+        peek_selection (view, &selection);
+    }
+
     start_stop_type = G_DRIVE_START_STOP_TYPE_UNKNOWN;
     item_label = g_strdup_printf (ngettext ("New Folder with Selection (%'d Item)",
                                             "New Folder with Selection (%'d Items)",
@@ -7975,45 +7890,60 @@ update_selection_menu (NautilusFilesView *view,
     g_object_unref (menu_item);
     g_free (item_label);
 
-    /* Open With <App> menu item */
-    show_extract = show_app = show_run = item_opens_in_view = selection_count != 0;
-    for (l = selection; l != NULL; l = l->next)
+    /* Open With <App> menu item. Only folders open in the view, and files
+     * which are neither folders, archives nor launchable can only open in an
+     * application, so the files are only looked at when the counts can't
+     * tell. */
+    show_extract = selection_count != 0 && summary->n_archives == selection_count;
+    show_run = selection_count != 0 && summary->n_launchable == selection_count;
+    item_opens_in_view = selection_count != 0 && summary->n_directories == selection_count;
+    show_app = selection_count != 0 && summary->n_directories == 0;
+    check_app = show_app && (summary->n_archives != 0 || summary->n_launchable != 0);
+    if (show_extract || show_run || check_app)
     {
-        NautilusFile *file;
-
-        file = NAUTILUS_FILE (l->data);
-
-        if (show_extract && !nautilus_mime_file_extracts (file))
+        for (l = peek_selection (view, &selection); l != NULL; l = l->next)
         {
-            show_extract = FALSE;
-        }
+            NautilusFile *file;
 
-        if (show_app && !nautilus_mime_file_opens_in_external_app (file))
-        {
-            show_app = FALSE;
-        }
+            file = NAUTILUS_FILE (l->data);
 
-        if (show_run && !nautilus_mime_file_launches (file))
-        {
-            show_run = FALSE;
-        }
+            if (show_extract && !nautilus_mime_file_extracts (file))
+            {
+                show_extract = FALSE;
+            }
 
-        if (item_opens_in_view && !nautilus_file_opens_in_view (file))
-        {
-            item_opens_in_view = FALSE;
-        }
+            if (check_app && !nautilus_mime_file_opens_in_external_app (file))
+            {
+                show_app = check_app = FALSE;
+            }
 
-        if (!show_extract && !show_app && !show_run && !item_opens_in_view)
-        {
-            break;
+            if (show_run && !nautilus_mime_file_launches (file))
+            {
+                show_run = FALSE;
+            }
+
+            if (!show_extract && !check_app && !show_run)
+            {
+                break;
+            }
         }
     }
 
     item_label = NULL;
     app = NULL;
-    if (show_app)
+    if (show_app && summary->n_info_ready == summary->n_items &&
+        summary->n_local == summary->n_items)
+    {
+        /* Only the distinct MIME types matter, no need to look at every file. */
+        g_autoptr (GList) mime_types = g_hash_table_get_keys (summary->mime_types);
+
+        app = nautilus_mime_get_default_application_for_mime_types (mime_types, FALSE);
+    }
+
+    if (show_app && app == NULL)
     {
-        app = nautilus_mime_get_default_application_for_files (selection);
+        /* Look at each file, which also considers URI scheme handlers. */
+        app = nautilus_mime_get_default_application_for_files (peek_selection (view, &selection));
     }
 
     if (app != NULL)
@@ -8077,37 +8007,19 @@ update_selection_menu (NautilusFilesView *view,
 
     g_free (item_label);
 
-    /* Drives */
-    for (l = selection; l != NULL && (show_mount || show_unmount
-                                      || show_eject
-                                      || show_start || show_stop
-                                      || show_detect_media);
-         l = l->next)
-    {
-        NautilusFile *file;
-        gboolean show_mount_one;
-        gboolean show_unmount_one;
-        gboolean show_eject_one;
-        gboolean show_start_one;
-        gboolean show_stop_one;
-        gboolean show_detect_media_one;
-
-        file = NAUTILUS_FILE (l->data);
-        file_should_show_foreach (file,
-                                  &show_mount_one,
-                                  &show_unmount_one,
-                                  &show_eject_one,
-                                  &show_start_one,
-                                  &show_stop_one,
-                                  &show_detect_media_one,
+    /* Drives. Starting and stopping are only offered for a single item. */
+    show_start = FALSE;
+    show_stop = FALSE;
+    if (selection_count == 1)
+    {
+        file_should_show_foreach (NAUTILUS_FILE (selection->data),
+                                  &show_mount,
+                                  &show_unmount,
+                                  &show_eject,
+                                  &show_start,
+                                  &show_stop,
+                                  &show_detect_media,
                                   &start_stop_type);
-
-        show_mount &= show_mount_one;
-        show_unmount &= show_unmount_one;
-        show_eject &= show_eject_one;
-        show_start &= show_start_one;
-        show_stop &= show_stop_one;
-        show_detect_media &= show_detect_media_one;
     }
 
     if (show_start)
@@ -8832,17 +8744,7 @@ finish_loading (NautilusFilesView *view)
     priv->load_error_handler_id = g_signal_connect (priv->directory, "load-error",
                                                     G_CALLBACK (load_error_callback), view);
 
-    /* Monitor the things needed to get the right icon. Also
-     * monitor a directory's item count because the "size"
-     * attribute is based on that, and the file's metadata
-     * and possible custom name.
-     */
-    attributes =
-        NAUTILUS_FILE_ATTRIBUTES_FOR_ICON |
-        NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT |
-        NAUTILUS_FILE_ATTRIBUTE_INFO |
-        NAUTILUS_FILE_ATTRIBUTE_MOUNT |
-        NAUTILUS_FILE_ATTRIBUTE_EXTENSION_INFO;
+    attributes = DIRECTORY_MONITOR_ATTRIBUTES;
 
     priv->files_added_handler_id = g_signal_connect
                                        (priv->directory, "files-added",
@@ -8937,6 +8839,12 @@ disconnect_directory_handlers (NautilusFilesView *view)
     nautilus_directory_cancel_callback (priv->directory,
                                         metadata_for_files_in_directory_ready_callback,
                                         view);
+    /* Keep the directory around before the view stops monitoring it, so
+     * that going back to it shows it right away. */
+    if (!NAUTILUS_IS_SEARCH_DIRECTORY (priv->directory))
+    {
+        nautilus_directory_retain (priv->directory, DIRECTORY_MONITOR_ATTRIBUTES);
+    }
     nautilus_directory_file_monitor_remove (priv->directory,
                                             &priv->directory);
     nautilus_file_monitor_remove (priv->directory_as_file,
@@ -70,7 +70,8 @@ typedef enum
         NAUTILUS_COMPRESSION_ZIP = 0,
         NAUTILUS_COMPRESSION_TAR_XZ,
         NAUTILUS_COMPRESSION_7ZIP,
-        NAUTILUS_COMPRESSION_ENCRYPTED_ZIP
+        NAUTILUS_COMPRESSION_ENCRYPTED_ZIP,
+        NAUTILUS_COMPRESSION_TAR_ZSTD
 } NautilusCompressionFormat;
 
 /* Icon View */
@@ -43,7 +43,7 @@ update_icon (NautilusGridCell *self)
     file = nautilus_view_item_get_file (item);
     g_object_get (self, "icon-size", &icon_size, NULL);
     scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (self));
-    flags = NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS;
+    flags = NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS | NAUTILUS_FILE_ICON_FLAGS_LOAD_ASYNC;
 
     icon_paintable = nautilus_file_get_icon_paintable (file, icon_size, scale_factor, flags);
     gtk_picture_set_paintable (GTK_PICTURE (self->icon), icon_paintable);
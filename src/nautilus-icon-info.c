@@ -164,6 +164,34 @@ static GHashTable *loadable_icon_cache = NULL;
 static GHashTable *themed_icon_cache = NULL;
 static guint reap_cache_timeout = 0;
 
+/* Loadable icons are decoded by a small pool of threads. Finished loads are
+ * handed back to the main thread in batches, by a single idle source.
+ */
+#define MAX_LOAD_THREADS 4
+
+typedef struct
+{
+    NautilusIconInfoReadyFunc func;
+    gpointer user_data;
+    GDestroyNotify destroy_data;
+} IconLoadWaiter;
+
+typedef struct
+{
+    LoadableIconKey *key;
+    guint64 serial;
+    GdkTexture *texture;
+    GList *waiters;
+} IconLoadRequest;
+
+static GHashTable *pending_loads = NULL; /* LoadableIconKey -> IconLoadRequest */
+static GThreadPool *load_pool = NULL;
+static guint64 load_serial = 0;
+
+G_LOCK_DEFINE_STATIC (finished_loads);
+static GList *finished_loads = NULL;
+static guint finished_loads_idle = 0;
+
 #define MICROSEC_PER_SEC ((guint64) 1000000L)
 
 static guint64 time_now;
@@ -326,6 +354,64 @@ themed_icon_key_free (ThemedIconKey *key)
     g_slice_free (ThemedIconKey, key);
 }
 
+static void
+ensure_loadable_icon_cache (void)
+{
+    if (loadable_icon_cache == NULL)
+    {
+        loadable_icon_cache =
+            g_hash_table_new_full ((GHashFunc) loadable_icon_key_hash,
+                                   (GEqualFunc) loadable_icon_key_equal,
+                                   (GDestroyNotify) loadable_icon_key_free,
+                                   (GDestroyNotify) g_object_unref);
+    }
+}
+
+/* Does blocking I/O and decoding, so it's safe to call from any thread. */
+static GdkTexture *
+load_icon_texture (GIcon *icon,
+                   int    pixel_size)
+{
+    g_autoptr (GdkPixbuf) pixbuf = NULL;
+    GInputStream *stream;
+
+    stream = g_loadable_icon_load (G_LOADABLE_ICON (icon),
+                                   pixel_size,
+                                   NULL, NULL, NULL);
+    if (stream)
+    {
+        pixbuf = gdk_pixbuf_new_from_stream_at_scale (stream,
+                                                      pixel_size, pixel_size,
+                                                      TRUE,
+                                                      NULL, NULL);
+        g_input_stream_close (stream, NULL, NULL);
+        g_object_unref (stream);
+    }
+
+    return pixbuf != NULL ? gdk_texture_new_for_pixbuf (pixbuf) : NULL;
+}
+
+static NautilusIconInfo *
+nautilus_icon_info_new_for_loaded_texture (GdkTexture *texture,
+                                           int         scale)
+{
+    g_autoptr (GdkPaintable) paintable = NULL;
+
+    if (texture != NULL)
+    {
+        double width = gdk_texture_get_width (texture) / scale;
+        double height = gdk_texture_get_height (texture) / scale;
+        g_autoptr (GtkSnapshot) snapshot = gtk_snapshot_new ();
+
+        gdk_paintable_snapshot (GDK_PAINTABLE (texture),
+                                GDK_SNAPSHOT (snapshot),
+                                width, height);
+        paintable = gtk_snapshot_to_paintable (snapshot, NULL);
+    }
+
+    return nautilus_icon_info_new_for_paintable (paintable, scale);
+}
+
 NautilusIconInfo *
 nautilus_icon_info_lookup (GIcon *icon,
                            int    size,
@@ -336,24 +422,14 @@ nautilus_icon_info_lookup (GIcon *icon,
 
     if (G_IS_LOADABLE_ICON (icon))
     {
-        g_autoptr (GdkPixbuf) pixbuf = NULL;
-        g_autoptr (GdkPaintable) paintable = NULL;
+        g_autoptr (GdkTexture) texture = NULL;
         LoadableIconKey lookup_key;
-        LoadableIconKey *key;
-        GInputStream *stream;
 
-        if (loadable_icon_cache == NULL)
-        {
-            loadable_icon_cache =
-                g_hash_table_new_full ((GHashFunc) loadable_icon_key_hash,
-                                       (GEqualFunc) loadable_icon_key_equal,
-                                       (GDestroyNotify) loadable_icon_key_free,
-                                       (GDestroyNotify) g_object_unref);
-        }
+        ensure_loadable_icon_cache ();
 
         lookup_key.icon = icon;
         lookup_key.scale = scale;
-        lookup_key.size = size * scale;
+        lookup_key.size = size;
 
         icon_info = g_hash_table_lookup (loadable_icon_cache, &lookup_key);
         if (icon_info)
@@ -361,36 +437,12 @@ nautilus_icon_info_lookup (GIcon *icon,
             return g_object_ref (icon_info);
         }
 
-        stream = g_loadable_icon_load (G_LOADABLE_ICON (icon),
-                                       size * scale,
-                                       NULL, NULL, NULL);
-        if (stream)
-        {
-            pixbuf = gdk_pixbuf_new_from_stream_at_scale (stream,
-                                                          size * scale, size * scale,
-                                                          TRUE,
-                                                          NULL, NULL);
-            g_input_stream_close (stream, NULL, NULL);
-            g_object_unref (stream);
-        }
-
-        if (pixbuf != NULL)
-        {
-            double width = gdk_pixbuf_get_width (pixbuf) / scale;
-            double height = gdk_pixbuf_get_height (pixbuf) / scale;
-            g_autoptr (GdkTexture) texture = gdk_texture_new_for_pixbuf (pixbuf);
-            g_autoptr (GtkSnapshot) snapshot = gtk_snapshot_new ();
-
-            gdk_paintable_snapshot (GDK_PAINTABLE (texture),
-                                    GDK_SNAPSHOT (snapshot),
-                                    width, height);
-            paintable = gtk_snapshot_to_paintable (snapshot, NULL);
-        }
-
-        icon_info = nautilus_icon_info_new_for_paintable (paintable, scale);
+        texture = load_icon_texture (icon, size * scale);
+        icon_info = nautilus_icon_info_new_for_loaded_texture (texture, scale);
 
-        key = loadable_icon_key_new (icon, scale, size);
-        g_hash_table_insert (loadable_icon_cache, key, icon_info);
+        g_hash_table_insert (loadable_icon_cache,
+                             loadable_icon_key_new (icon, scale, size),
+                             icon_info);
 
         return g_object_ref (icon_info);
     }
@@ -441,6 +493,188 @@ nautilus_icon_info_lookup (GIcon *icon,
     }
 }
 
+static void
+icon_load_waiter_free (IconLoadWaiter *waiter)
+{
+    if (waiter->destroy_data != NULL)
+    {
+        waiter->destroy_data (waiter->user_data);
+    }
+    g_free (waiter);
+}
+
+static void
+icon_load_request_free (IconLoadRequest *request)
+{
+    g_clear_pointer (&request->key, loadable_icon_key_free);
+    g_clear_object (&request->texture);
+    g_list_free_full (request->waiters, (GDestroyNotify) icon_load_waiter_free);
+    g_free (request);
+}
+
+static gboolean
+deliver_finished_loads (gpointer user_data)
+{
+    GList *loads;
+
+    G_LOCK (finished_loads);
+    loads = g_steal_pointer (&finished_loads);
+    finished_loads_idle = 0;
+    G_UNLOCK (finished_loads);
+
+    ensure_loadable_icon_cache ();
+
+    /* Fill the cache with the whole batch first, so that waiters looking up
+     * their icon again find the ones loaded alongside it too. */
+    for (GList *l = loads; l != NULL; l = l->next)
+    {
+        IconLoadRequest *request = l->data;
+
+        g_hash_table_remove (pending_loads, request->key);
+
+        if (!g_hash_table_contains (loadable_icon_cache, request->key))
+        {
+            NautilusIconInfo *icon_info;
+
+            icon_info = nautilus_icon_info_new_for_loaded_texture (request->texture,
+                                                                   request->key->scale);
+            g_hash_table_insert (loadable_icon_cache,
+                                 g_steal_pointer (&request->key),
+                                 icon_info);
+        }
+    }
+
+    for (GList *l = loads; l != NULL; l = l->next)
+    {
+        IconLoadRequest *request = l->data;
+
+        for (GList *w = request->waiters; w != NULL; w = w->next)
+        {
+            IconLoadWaiter *waiter = w->data;
+
+            waiter->func (waiter->user_data);
+        }
+    }
+
+    g_list_free_full (loads, (GDestroyNotify) icon_load_request_free);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+load_icon_thread_func (gpointer data,
+                       gpointer user_data)
+{
+    IconLoadRequest *request = data;
+
+    request->texture = load_icon_texture (request->key->icon,
+                                          request->key->size * request->key->scale);
+
+    G_LOCK (finished_loads);
+    finished_loads = g_list_prepend (finished_loads, request);
+    if (finished_loads_idle == 0)
+    {
+        finished_loads_idle = g_idle_add (deliver_finished_loads, NULL);
+    }
+    G_UNLOCK (finished_loads);
+}
+
+static gint
+compare_load_requests (gconstpointer a,
+                       gconstpointer b,
+                       gpointer      user_data)
+{
+    const IconLoadRequest *request_a = a;
+    const IconLoadRequest *request_b = b;
+
+    /* Newest first: those are the icons that just scrolled into view. */
+    return (request_a->serial < request_b->serial) - (request_a->serial > request_b->serial);
+}
+
+NautilusIconInfo *
+nautilus_icon_info_lookup_async (GIcon                     *icon,
+                                 int                        size,
+                                 int                        scale,
+                                 NautilusIconInfoReadyFunc  ready_func,
+                                 gpointer                   user_data,
+                                 GDestroyNotify             destroy_data)
+{
+    NautilusIconInfo *icon_info;
+    IconLoadRequest *request;
+    IconLoadWaiter *waiter;
+    LoadableIconKey lookup_key;
+
+    if (!G_IS_LOADABLE_ICON (icon))
+    {
+        if (destroy_data != NULL)
+        {
+            destroy_data (user_data);
+        }
+
+        return nautilus_icon_info_lookup (icon, size, scale);
+    }
+
+    ensure_loadable_icon_cache ();
+
+    lookup_key.icon = icon;
+    lookup_key.scale = scale;
+    lookup_key.size = size;
+
+    icon_info = g_hash_table_lookup (loadable_icon_cache, &lookup_key);
+    if (icon_info != NULL)
+    {
+        if (destroy_data != NULL)
+        {
+            destroy_data (user_data);
+        }
+
+        return g_object_ref (icon_info);
+    }
+
+    if (pending_loads == NULL)
+    {
+        pending_loads = g_hash_table_new ((GHashFunc) loadable_icon_key_hash,
+                                          (GEqualFunc) loadable_icon_key_equal);
+        load_pool = g_thread_pool_new (load_icon_thread_func, NULL,
+                                       MAX_LOAD_THREADS, FALSE, NULL);
+        g_thread_pool_set_sort_function (load_pool, compare_load_requests, NULL);
+    }
+
+    request = g_hash_table_lookup (pending_loads, &lookup_key);
+    if (request == NULL)
+    {
+        request = g_new0 (IconLoadRequest, 1);
+        request->key = loadable_icon_key_new (icon, scale, size);
+        request->serial = ++load_serial;
+        g_hash_table_insert (pending_loads, request->key, request);
+        g_thread_pool_push (load_pool, request, NULL);
+    }
+
+    for (GList *l = request->waiters; l != NULL; l = l->next)
+    {
+        waiter = l->data;
+
+        if (waiter->func == ready_func && waiter->user_data == user_data)
+        {
+            /* Already waiting, e.g. the same item was rebound. */
+            if (destroy_data != NULL)
+            {
+                destroy_data (user_data);
+            }
+
+            return NULL;
+        }
+    }
+
+    waiter = g_new (IconLoadWaiter, 1);
+    waiter->func = ready_func;
+    waiter->user_data = user_data;
+    waiter->destroy_data = destroy_data;
+    request->waiters = g_list_prepend (request->waiters, waiter);
+
+    return NULL;
+}
+
 static GdkPaintable *
 nautilus_icon_info_get_paintable_nodefault (NautilusIconInfo *icon)
 {
@@ -19,6 +19,20 @@ NautilusIconInfo *    nautilus_icon_info_new_for_paintable            (GdkPainta
 NautilusIconInfo *    nautilus_icon_info_lookup                       (GIcon             *icon,
 								       int                size,
 								       int                scale);
+
+/* Like nautilus_icon_info_lookup(), but never blocks on decoding a
+ * GLoadableIcon. If the icon isn't loaded yet, NULL is returned and
+ * @ready_func is called on the main thread once a lookup would succeed.
+ * @destroy_data is called on @user_data when it is no longer needed. */
+typedef void (*NautilusIconInfoReadyFunc) (gpointer user_data);
+
+NautilusIconInfo *    nautilus_icon_info_lookup_async                 (GIcon                     *icon,
+								       int                        size,
+								       int                        scale,
+								       NautilusIconInfoReadyFunc  ready_func,
+								       gpointer                   user_data,
+								       GDestroyNotify             destroy_data);
+
 gboolean              nautilus_icon_info_is_fallback                  (NautilusIconInfo  *icon);
 GdkPaintable *        nautilus_icon_info_get_paintable                (NautilusIconInfo  *icon);
 GdkTexture *          nautilus_icon_info_get_texture                  (NautilusIconInfo  *icon);
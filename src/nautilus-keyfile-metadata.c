@@ -34,18 +34,106 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+/* Changes are saved once none were made for this long. */
+#define SAVE_DELAY_MSEC 500
+
+/* Shared with the threads writing the keyfile out. Writes are numbered as
+ * they are taken, so that one which is overtaken by a later one, e.g. when
+ * flushing, doesn't undo it. */
+typedef struct
+{
+    gatomicrefcount ref_count;
+    char *filename;
+
+    GMutex mutex;
+    guint64 written_generation;
+} KeyfileWriter;
+
+typedef struct
+{
+    KeyfileWriter *writer;
+    guint64 generation;
+    gchar *contents;
+    gsize length;
+} KeyfileSave;
+
 typedef struct
 {
+    /* Until loaded, this only holds the changes made since, which are
+     * applied over what is loaded. */
     GKeyFile *keyfile;
-    guint save_in_idle_id;
+    gboolean loaded;
+    GCancellable *load_cancellable;
+    /* NautilusFile -> group name, for files changed while loading, whose
+     * metadata is complete only once loaded. */
+    GHashTable *files_to_update;
+
+    KeyfileWriter *writer;
+    guint64 last_generation;
+    guint save_timeout_id;
 } KeyfileMetadataData;
 
 static GHashTable *data_hash = NULL;
 
-static KeyfileMetadataData *
-keyfile_metadata_data_new (const char *keyfile_filename)
+static void load_keyfile_callback (GObject      *source_object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data);
+
+static KeyfileWriter *
+keyfile_writer_ref (KeyfileWriter *writer)
+{
+    g_atomic_ref_count_inc (&writer->ref_count);
+
+    return writer;
+}
+
+static void
+keyfile_writer_unref (KeyfileWriter *writer)
+{
+    if (g_atomic_ref_count_dec (&writer->ref_count))
+    {
+        g_mutex_clear (&writer->mutex);
+        g_free (writer->filename);
+        g_free (writer);
+    }
+}
+
+static void
+keyfile_save_free (KeyfileSave *save)
+{
+    keyfile_writer_unref (save->writer);
+    g_free (save->contents);
+    g_free (save);
+}
+
+static void
+keyfile_save_write (KeyfileSave *save)
+{
+    KeyfileWriter *writer = save->writer;
+    g_autoptr (GError) error = NULL;
+
+    g_mutex_lock (&writer->mutex);
+
+    if (save->generation > writer->written_generation)
+    {
+        writer->written_generation = save->generation;
+
+        if (!g_file_set_contents_full (writer->filename,
+                                       save->contents, save->length,
+                                       G_FILE_SET_CONTENTS_CONSISTENT, 0666,
+                                       &error))
+        {
+            g_warning ("Couldn't save the desktop metadata keyfile to disk: %s",
+                       error->message);
+        }
+    }
+
+    g_mutex_unlock (&writer->mutex);
+}
+
+static GKeyFile *
+load_keyfile (const char *keyfile_filename)
 {
-    KeyfileMetadataData *data;
     GKeyFile *retval;
     GError *error = NULL;
 
@@ -69,8 +157,40 @@ keyfile_metadata_data_new (const char *keyfile_filename)
         g_error_free (error);
     }
 
+    return retval;
+}
+
+static void
+load_keyfile_thread_func (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+    g_task_return_pointer (task, load_keyfile (task_data),
+                           (GDestroyNotify) g_key_file_unref);
+}
+
+static KeyfileMetadataData *
+keyfile_metadata_data_new (const char *keyfile_filename)
+{
+    KeyfileMetadataData *data;
+    g_autoptr (GTask) task = NULL;
+
     data = g_slice_new0 (KeyfileMetadataData);
-    data->keyfile = retval;
+    data->keyfile = g_key_file_new ();
+    data->load_cancellable = g_cancellable_new ();
+    data->files_to_update = g_hash_table_new_full (NULL, NULL,
+                                                   (GDestroyNotify) nautilus_file_unref,
+                                                   g_free);
+
+    data->writer = g_new0 (KeyfileWriter, 1);
+    g_atomic_ref_count_init (&data->writer->ref_count);
+    data->writer->filename = g_strdup (keyfile_filename);
+    g_mutex_init (&data->writer->mutex);
+
+    task = g_task_new (NULL, data->load_cancellable, load_keyfile_callback, NULL);
+    g_task_set_task_data (task, g_strdup (keyfile_filename), g_free);
+    g_task_run_in_thread (task, load_keyfile_thread_func);
 
     return data;
 }
@@ -80,16 +200,22 @@ keyfile_metadata_data_free (KeyfileMetadataData *data)
 {
     g_key_file_unref (data->keyfile);
 
-    if (data->save_in_idle_id != 0)
+    g_cancellable_cancel (data->load_cancellable);
+    g_object_unref (data->load_cancellable);
+    g_hash_table_unref (data->files_to_update);
+
+    if (data->save_timeout_id != 0)
     {
-        g_source_remove (data->save_in_idle_id);
+        g_source_remove (data->save_timeout_id);
     }
 
+    keyfile_writer_unref (data->writer);
+
     g_slice_free (KeyfileMetadataData, data);
 }
 
-static GKeyFile *
-get_keyfile (const char *keyfile_filename)
+static KeyfileMetadataData *
+get_data (const char *keyfile_filename)
 {
     KeyfileMetadataData *data;
 
@@ -112,59 +238,206 @@ get_keyfile (const char *keyfile_filename)
                              data);
     }
 
-    return data->keyfile;
+    return data;
+}
+
+static GKeyFile *
+get_keyfile (const char *keyfile_filename)
+{
+    return get_data (keyfile_filename)->keyfile;
+}
+
+static KeyfileSave *
+take_save (KeyfileMetadataData *data)
+{
+    KeyfileSave *save;
+
+    save = g_new0 (KeyfileSave, 1);
+    save->writer = keyfile_writer_ref (data->writer);
+    save->generation = ++data->last_generation;
+    save->contents = g_key_file_to_data (data->keyfile, &save->length, NULL);
+
+    return save;
+}
+
+static void
+save_thread_func (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+    keyfile_save_write (task_data);
 }
 
 static gboolean
-save_in_idle_cb (const gchar *keyfile_filename)
+save_timeout_cb (const gchar *keyfile_filename)
 {
     KeyfileMetadataData *data;
-    gchar *contents;
-    gsize length;
-    GError *error = NULL;
+    g_autoptr (GTask) task = NULL;
 
     data = g_hash_table_lookup (data_hash, keyfile_filename);
-    data->save_in_idle_id = 0;
+    data->save_timeout_id = 0;
 
-    contents = g_key_file_to_data (data->keyfile, &length, NULL);
+    task = g_task_new (NULL, NULL, NULL, NULL);
+    g_task_set_task_data (task, take_save (data), (GDestroyNotify) keyfile_save_free);
+    g_task_run_in_thread (task, save_thread_func);
 
-    if (contents != NULL)
+    return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_save (KeyfileMetadataData *data,
+               const char          *keyfile_filename)
+{
+    /* Saving before loading would drop what is in the file, so the save
+     * is scheduled once loaded. */
+    if (!data->loaded)
     {
-        g_file_set_contents (keyfile_filename,
-                             contents, length,
-                             &error);
-        g_free (contents);
+        return;
     }
 
-    if (error != NULL)
+    g_clear_handle_id (&data->save_timeout_id, g_source_remove);
+    data->save_timeout_id = g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE,
+                                                SAVE_DELAY_MSEC,
+                                                (GSourceFunc) save_timeout_cb,
+                                                g_strdup (keyfile_filename),
+                                                g_free);
+}
+
+static gboolean
+merge_changes (KeyfileMetadataData *data,
+               GKeyFile            *loaded_keyfile)
+{
+    g_auto (GStrv) groups = g_key_file_get_groups (data->keyfile, NULL);
+    gboolean changed = FALSE;
+
+    for (guint i = 0; groups[i] != NULL; i++)
     {
-        g_warning ("Couldn't save the desktop metadata keyfile to disk: %s",
-                   error->message);
-        g_error_free (error);
+        g_auto (GStrv) keys = g_key_file_get_keys (data->keyfile, groups[i], NULL, NULL);
+
+        for (guint j = 0; keys != NULL && keys[j] != NULL; j++)
+        {
+            g_autofree gchar *value = g_key_file_get_value (data->keyfile,
+                                                            groups[i], keys[j], NULL);
+
+            g_key_file_set_value (loaded_keyfile, groups[i], keys[j], value);
+            changed = TRUE;
+        }
     }
 
-    return FALSE;
+    g_key_file_unref (data->keyfile);
+    data->keyfile = g_key_file_ref (loaded_keyfile);
+    data->loaded = TRUE;
+
+    return changed;
 }
 
 static void
-save_in_idle (const char *keyfile_filename)
+finish_loading (KeyfileMetadataData *data,
+                GKeyFile            *loaded_keyfile,
+                const char          *keyfile_filename)
 {
+    GHashTableIter iter;
+    NautilusFile *file;
+    const char *name;
+
+    if (merge_changes (data, loaded_keyfile))
+    {
+        schedule_save (data, keyfile_filename);
+    }
+
+    g_hash_table_iter_init (&iter, data->files_to_update);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, (gpointer *) &name))
+    {
+        if (nautilus_keyfile_metadata_update_from_keyfile (file, keyfile_filename, name))
+        {
+            nautilus_file_changed (file);
+        }
+    }
+    g_hash_table_remove_all (data->files_to_update);
+}
+
+static void
+load_keyfile_callback (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+    g_autoptr (GKeyFile) loaded_keyfile = NULL;
+    const char *keyfile_filename;
     KeyfileMetadataData *data;
 
-    g_return_if_fail (data_hash != NULL);
+    loaded_keyfile = g_task_propagate_pointer (G_TASK (result), NULL);
+    keyfile_filename = g_task_get_task_data (G_TASK (result));
+    if (loaded_keyfile == NULL)
+    {
+        /* Cancelled */
+        return;
+    }
 
     data = g_hash_table_lookup (data_hash, keyfile_filename);
-    g_return_if_fail (data != NULL);
+    if (data == NULL || data->loaded)
+    {
+        return;
+    }
+
+    finish_loading (data, loaded_keyfile, keyfile_filename);
+}
 
-    if (data->save_in_idle_id != 0)
+static void
+keyfile_changed (NautilusFile *file,
+                 const char   *keyfile_filename,
+                 const char   *name)
+{
+    KeyfileMetadataData *data = get_data (keyfile_filename);
+
+    if (!data->loaded)
+    {
+        g_hash_table_insert (data->files_to_update,
+                             nautilus_file_ref (file), g_strdup (name));
+    }
+
+    schedule_save (data, keyfile_filename);
+
+    if (nautilus_keyfile_metadata_update_from_keyfile (file, keyfile_filename, name))
+    {
+        nautilus_file_changed (file);
+    }
+}
+
+/* Writes out pending changes right away, for when the application quits. */
+void
+nautilus_keyfile_metadata_flush (void)
+{
+    GHashTableIter iter;
+    KeyfileMetadataData *data;
+
+    if (data_hash == NULL)
     {
         return;
     }
 
-    data->save_in_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-                                             (GSourceFunc) save_in_idle_cb,
-                                             g_strdup (keyfile_filename),
-                                             g_free);
+    g_hash_table_iter_init (&iter, data_hash);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &data))
+    {
+        KeyfileSave *save;
+
+        if (!data->loaded)
+        {
+            g_autoptr (GKeyFile) loaded_keyfile = load_keyfile (data->writer->filename);
+
+            finish_loading (data, loaded_keyfile, data->writer->filename);
+        }
+
+        if (data->save_timeout_id == 0)
+        {
+            continue;
+        }
+
+        g_clear_handle_id (&data->save_timeout_id, g_source_remove);
+        save = take_save (data);
+        keyfile_save_write (save);
+        keyfile_save_free (save);
+    }
 }
 
 void
@@ -183,12 +456,7 @@ nautilus_keyfile_metadata_set_string (NautilusFile *file,
                            key,
                            string);
 
-    save_in_idle (keyfile_filename);
-
-    if (nautilus_keyfile_metadata_update_from_keyfile (file, keyfile_filename, name))
-    {
-        nautilus_file_changed (file);
-    }
+    keyfile_changed (file, keyfile_filename, name);
 }
 
 #define STRV_TERMINATOR "@x-nautilus-desktop-metadata-term@"
@@ -234,12 +502,7 @@ nautilus_keyfile_metadata_set_stringv (NautilusFile       *file,
                                 (const gchar **) actual_stringv,
                                 length);
 
-    save_in_idle (keyfile_filename);
-
-    if (nautilus_keyfile_metadata_update_from_keyfile (file, keyfile_filename, name))
-    {
-        nautilus_file_changed (file);
-    }
+    keyfile_changed (file, keyfile_filename, name);
 
     if (free_strv)
     {
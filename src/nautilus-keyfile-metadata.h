@@ -41,3 +41,5 @@ void nautilus_keyfile_metadata_set_stringv (NautilusFile *file,
 gboolean nautilus_keyfile_metadata_update_from_keyfile (NautilusFile *file,
                                                         const char *keyfile_filename,
                                                         const gchar *name);
+
+void nautilus_keyfile_metadata_flush (void);
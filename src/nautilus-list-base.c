@@ -41,9 +41,10 @@ struct _NautilusListBasePrivate
 {
     NautilusViewModel *model;
 
-    GList *cut_files;
+    NautilusClipboard *cut_clipboard;
 
     guint prioritize_thumbnailing_handle_id;
+    GHashTable *prioritized_thumbnail_uris;
     GtkAdjustment *vadjustment;
 
     gboolean single_click_mode;
@@ -938,7 +939,8 @@ on_clipboard_contents_received (GObject      *source_object,
     NautilusFilesView *files_view;
     NautilusListBase *self;
     NautilusListBasePrivate *priv;
-    NautilusClipboard *clip;
+    NautilusClipboard *clip = NULL;
+    NautilusClipboard *old_clip;
     NautilusViewItem *item;
     const GValue *value;
 
@@ -953,40 +955,62 @@ on_clipboard_contents_received (GObject      *source_object,
     self = NAUTILUS_LIST_BASE (files_view);
     priv = nautilus_list_base_get_instance_private (self);
 
-    for (GList *l = priv->cut_files; l != NULL; l = l->next)
+    if (G_VALUE_HOLDS (value, NAUTILUS_TYPE_CLIPBOARD))
     {
-        item = nautilus_view_model_get_item_for_file (priv->model, l->data);
-        if (item != NULL)
-        {
-            nautilus_view_item_set_cut (item, FALSE);
-        }
+        clip = g_value_get_boxed (value);
     }
-    g_clear_list (&priv->cut_files, g_object_unref);
 
-    if (G_VALUE_HOLDS (value, NAUTILUS_TYPE_CLIPBOARD))
+    if (clip != NULL && !nautilus_clipboard_is_cut (clip))
     {
-        clip = g_value_get_boxed (value);
+        clip = NULL;
     }
-    else
+
+    if (clip == priv->cut_clipboard)
     {
+        /* Local clipboard values are shared, so this is the same selection. */
         return;
     }
 
-    if (clip != NULL && nautilus_clipboard_is_cut (clip))
+    /* Only touch the items whose cut state actually changes, so that cutting
+     * more files to a large cut selection doesn't reset all of it. */
+    old_clip = g_steal_pointer (&priv->cut_clipboard);
+    if (old_clip != NULL)
     {
-        priv->cut_files = g_list_copy_deep (nautilus_clipboard_peek_files (clip),
-                                            (GCopyFunc) g_object_ref,
-                                            NULL);
+        for (GList *l = nautilus_clipboard_peek_files (old_clip); l != NULL; l = l->next)
+        {
+            if (clip != NULL && nautilus_clipboard_contains_file (clip, l->data))
+            {
+                continue;
+            }
+
+            item = nautilus_view_model_get_item_for_file (priv->model, l->data);
+            if (item != NULL)
+            {
+                nautilus_view_item_set_cut (item, FALSE);
+            }
+        }
     }
 
-    for (GList *l = priv->cut_files; l != NULL; l = l->next)
+    if (clip != NULL)
     {
-        item = nautilus_view_model_get_item_for_file (priv->model, l->data);
-        if (item != NULL)
+        priv->cut_clipboard = nautilus_clipboard_ref (clip);
+
+        for (GList *l = nautilus_clipboard_peek_files (clip); l != NULL; l = l->next)
         {
-            nautilus_view_item_set_cut (item, TRUE);
+            if (old_clip != NULL && nautilus_clipboard_contains_file (old_clip, l->data))
+            {
+                continue;
+            }
+
+            item = nautilus_view_model_get_item_for_file (priv->model, l->data);
+            if (item != NULL)
+            {
+                nautilus_view_item_set_cut (item, TRUE);
+            }
         }
     }
+
+    g_clear_pointer (&old_clip, nautilus_clipboard_unref);
 }
 
 static void
@@ -1262,6 +1286,33 @@ real_preview_selection_event (NautilusFilesView *files_view,
     nautilus_list_base_set_cursor (self, i, TRUE, TRUE);
 }
 
+/* Lets thumbnails of files which are no longer visible wait for those of
+ * the visible ones. */
+static void
+deprioritize_thumbnails (NautilusListBase *self,
+                         GHashTable       *visible_uris)
+{
+    NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
+    GHashTableIter iter;
+    const char *uri;
+
+    if (priv->prioritized_thumbnail_uris == NULL)
+    {
+        return;
+    }
+
+    g_hash_table_iter_init (&iter, priv->prioritized_thumbnail_uris);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &uri, NULL))
+    {
+        if (visible_uris == NULL || !g_hash_table_contains (visible_uris, uri))
+        {
+            nautilus_thumbnail_deprioritize (uri);
+        }
+    }
+
+    g_clear_pointer (&priv->prioritized_thumbnail_uris, g_hash_table_unref);
+}
+
 static void
 nautilus_list_base_dispose (GObject *object)
 {
@@ -1270,6 +1321,7 @@ nautilus_list_base_dispose (GObject *object)
 
     g_clear_handle_id (&priv->prioritize_thumbnailing_handle_id, g_source_remove);
     g_clear_handle_id (&priv->hover_timer_id, g_source_remove);
+    deprioritize_thumbnails (self, NULL);
 
     g_cancellable_cancel (priv->clipboard_cancellable);
 
@@ -1282,7 +1334,8 @@ nautilus_list_base_finalize (GObject *object)
     NautilusListBase *self = NAUTILUS_LIST_BASE (object);
     NautilusListBasePrivate *priv = nautilus_list_base_get_instance_private (self);
 
-    g_clear_list (&priv->cut_files, g_object_unref);
+    g_clear_pointer (&priv->cut_clipboard, nautilus_clipboard_unref);
+    g_clear_pointer (&priv->prioritized_thumbnail_uris, g_hash_table_unref);
     /* Clear cancellable in finalize to prevent null usage */
     g_clear_object (&priv->clipboard_cancellable);
 
@@ -1301,6 +1354,7 @@ prioritize_thumbnailing_on_idle (NautilusListBase *self)
     gdouble y;
     guint last_index;
     g_autoptr (NautilusViewItem) first_item = NULL;
+    g_autoptr (GHashTable) visible_uris = NULL;
     NautilusFile *file;
 
     priv->prioritize_thumbnailing_handle_id = 0;
@@ -1309,6 +1363,7 @@ prioritize_thumbnailing_on_idle (NautilusListBase *self)
     first_index = get_first_visible_item (self);
     if (first_index == G_MAXUINT)
     {
+        deprioritize_thumbnails (self, NULL);
         return G_SOURCE_REMOVE;
     }
 
@@ -1337,6 +1392,8 @@ prioritize_thumbnailing_on_idle (NautilusListBase *self)
     }
     last_index = next_index - 1;
 
+    visible_uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
     /* Do the iteration in reverse to give higher priority to the top */
     for (guint i = 0; i <= last_index - first_index; i++)
     {
@@ -1350,9 +1407,13 @@ prioritize_thumbnailing_on_idle (NautilusListBase *self)
         {
             g_autofree gchar *uri = nautilus_file_get_uri (file);
             nautilus_thumbnail_prioritize (uri);
+            g_hash_table_add (visible_uris, g_steal_pointer (&uri));
         }
     }
 
+    deprioritize_thumbnails (self, visible_uris);
+    priv->prioritized_thumbnail_uris = g_steal_pointer (&visible_uris);
+
     return G_SOURCE_REMOVE;
 }
 
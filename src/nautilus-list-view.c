@@ -1102,7 +1102,8 @@ setup_view_columns (NautilusListView *self)
         NautilusColumn *nautilus_column = NAUTILUS_COLUMN (l->data);
         g_autofree gchar *name = NULL;
         g_autofree gchar *label = NULL;
-        GQuark attribute_q = 0;
+        GQuark sort_attribute_q = 0;
+        g_autofree gchar *sort_attribute = NULL;
         GtkSortType sort_order;
         g_autoptr (GtkCustomSorter) sorter = NULL;
         g_autoptr (GtkColumnViewColumn) view_column = NULL;
@@ -1110,12 +1111,18 @@ setup_view_columns (NautilusListView *self)
         g_object_get (nautilus_column,
                       "name", &name,
                       "label", &label,
-                      "attribute_q", &attribute_q,
+                      "attribute_q", &sort_attribute_q,
+                      "sort-attribute", &sort_attribute,
                       "default-sort-order", &sort_order,
                       NULL);
 
+        if (sort_attribute != NULL)
+        {
+            sort_attribute_q = g_quark_from_string (sort_attribute);
+        }
+
         sorter = gtk_custom_sorter_new (nautilus_list_view_sort,
-                                        GUINT_TO_POINTER (attribute_q),
+                                        GUINT_TO_POINTER (sort_attribute_q),
                                         NULL);
 
         factory = gtk_signal_list_item_factory_new ();
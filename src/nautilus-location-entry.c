@@ -43,10 +43,25 @@
 #include <string.h>
 
 
+/* Names of the folders in a folder, sorted, to complete paths from. It is
+ * built in a thread and reused while typing in the same folder, as long as
+ * it is not older than this. */
+#define DIRECTORY_INDEX_MAX_AGE_USEC (10 * G_USEC_PER_SEC)
+
+typedef struct
+{
+    GFile *directory;
+    GPtrArray *names;
+    gint64 build_time;
+} DirectoryIndex;
+
 typedef struct _NautilusLocationEntryPrivate
 {
     char *current_directory;
-    GFilenameCompleter *completer;
+
+    DirectoryIndex *directory_index;
+    GFile *indexing_directory;
+    GCancellable *indexing_cancellable;
 
     guint idle_id;
     gboolean idle_insert_completion;
@@ -293,6 +308,284 @@ position_and_selection_are_at_end (GtkEditable *editable)
     return gtk_editable_get_position (editable) == end;
 }
 
+static void
+directory_index_free (DirectoryIndex *index)
+{
+    g_object_unref (index->directory);
+    g_ptr_array_unref (index->names);
+    g_free (index);
+}
+
+static gint
+compare_names (gconstpointer a,
+               gconstpointer b)
+{
+    return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static void
+build_directory_index_thread_func (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable)
+{
+    GFile *directory = task_data;
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    g_autoptr (GError) error = NULL;
+    DirectoryIndex *index;
+    GFileInfo *info;
+
+    enumerator = g_file_enumerate_children (directory,
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                            G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                            G_FILE_QUERY_INFO_NONE,
+                                            cancellable, &error);
+    if (enumerator == NULL)
+    {
+        g_task_return_error (task, g_steal_pointer (&error));
+        return;
+    }
+
+    index = g_new0 (DirectoryIndex, 1);
+    index->directory = g_object_ref (directory);
+    index->names = g_ptr_array_new_with_free_func (g_free);
+
+    while (g_file_enumerator_iterate (enumerator, &info, NULL, cancellable, &error) &&
+           info != NULL)
+    {
+        /* Only folders are completed, like in a shell. */
+        if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+        {
+            g_ptr_array_add (index->names, g_strdup (g_file_info_get_name (info)));
+        }
+    }
+
+    if (error != NULL)
+    {
+        directory_index_free (index);
+        g_task_return_error (task, g_steal_pointer (&error));
+        return;
+    }
+
+    g_ptr_array_sort (index->names, compare_names);
+    index->build_time = g_get_monotonic_time ();
+
+    g_task_return_pointer (task, index, (GDestroyNotify) directory_index_free);
+}
+
+static gboolean update_completions_store (gpointer callback_data);
+
+static void
+build_directory_index_callback (GObject      *source_object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+    NautilusLocationEntry *entry;
+    NautilusLocationEntryPrivate *priv;
+    DirectoryIndex *index;
+    g_autoptr (GError) error = NULL;
+
+    index = g_task_propagate_pointer (G_TASK (result), &error);
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        return;
+    }
+
+    entry = NAUTILUS_LOCATION_ENTRY (user_data);
+    priv = nautilus_location_entry_get_instance_private (entry);
+
+    g_clear_object (&priv->indexing_directory);
+    g_clear_object (&priv->indexing_cancellable);
+
+    if (index == NULL)
+    {
+        return;
+    }
+
+    g_clear_pointer (&priv->directory_index, directory_index_free);
+    priv->directory_index = index;
+
+    g_clear_handle_id (&priv->idle_id, g_source_remove);
+    update_completions_store (entry);
+}
+
+/* Returns the index of the directory if there is a recent enough one, and
+ * otherwise starts building it. */
+static DirectoryIndex *
+get_directory_index (NautilusLocationEntry *entry,
+                     GFile                 *directory)
+{
+    NautilusLocationEntryPrivate *priv = nautilus_location_entry_get_instance_private (entry);
+    g_autoptr (GTask) task = NULL;
+
+    if (priv->directory_index != NULL &&
+        g_file_equal (priv->directory_index->directory, directory) &&
+        g_get_monotonic_time () - priv->directory_index->build_time < DIRECTORY_INDEX_MAX_AGE_USEC)
+    {
+        return priv->directory_index;
+    }
+
+    if (priv->indexing_directory != NULL &&
+        g_file_equal (priv->indexing_directory, directory))
+    {
+        return NULL;
+    }
+
+    g_cancellable_cancel (priv->indexing_cancellable);
+    g_clear_object (&priv->indexing_cancellable);
+    g_set_object (&priv->indexing_directory, directory);
+    priv->indexing_cancellable = g_cancellable_new ();
+
+    task = g_task_new (NULL, priv->indexing_cancellable,
+                       build_directory_index_callback, entry);
+    g_task_set_task_data (task, g_object_ref (directory), g_object_unref);
+    g_task_run_in_thread (task, build_directory_index_thread_func);
+
+    return NULL;
+}
+
+/* Returns the completions of location, a path or URI, in the same form,
+ * sorted. Returns NULL if they are not known yet. */
+static GPtrArray *
+get_completions (NautilusLocationEntry *entry,
+                 const char            *location)
+{
+    const char *basename;
+    g_autofree char *unescaped_basename = NULL;
+    g_autofree char *dirname = NULL;
+    gboolean is_uri;
+    g_autoptr (GFile) directory = NULL;
+    DirectoryIndex *index;
+    GPtrArray *completions;
+    gsize basename_length;
+    guint low;
+    guint high;
+
+    basename = strrchr (location, '/');
+    if (basename == NULL)
+    {
+        return g_ptr_array_new ();
+    }
+    basename++;
+
+    dirname = g_strndup (location, basename - location);
+
+    /* The index holds plain names, while URIs are escaped. */
+    is_uri = g_uri_peek_scheme (dirname) != NULL;
+    if (is_uri)
+    {
+        unescaped_basename = g_uri_unescape_string (basename, NULL);
+        if (unescaped_basename == NULL)
+        {
+            return g_ptr_array_new ();
+        }
+        basename = unescaped_basename;
+    }
+    basename_length = strlen (basename);
+
+    directory = g_file_parse_name (dirname);
+    index = get_directory_index (entry, directory);
+    if (index == NULL)
+    {
+        return NULL;
+    }
+
+    /* Find the first name which is not less than the basename. */
+    low = 0;
+    high = index->names->len;
+    while (low < high)
+    {
+        guint middle = low + (high - low) / 2;
+
+        if (strcmp (g_ptr_array_index (index->names, middle), basename) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    completions = g_ptr_array_new_with_free_func (g_free);
+    for (guint i = low; i < index->names->len; i++)
+    {
+        const char *name = g_ptr_array_index (index->names, i);
+
+        if (strncmp (name, basename, basename_length) != 0)
+        {
+            break;
+        }
+
+        /* Hidden folders only when asked for. */
+        if (name[0] == '.' && basename[0] != '.')
+        {
+            continue;
+        }
+
+        if (is_uri)
+        {
+            g_autofree char *escaped_name = NULL;
+
+            escaped_name = g_uri_escape_string (name, G_URI_RESERVED_CHARS_ALLOWED_IN_PATH, TRUE);
+            g_ptr_array_add (completions, g_strconcat (dirname, escaped_name, "/", NULL));
+        }
+        else
+        {
+            g_ptr_array_add (completions, g_strconcat (dirname, name, "/", NULL));
+        }
+    }
+
+    return completions;
+}
+
+/* Turns the rows of the store, which are sorted, into the completions by
+ * removing and inserting only those which differ. */
+static void
+update_store_rows (GtkListStore *store,
+                   GPtrArray    *completions)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL (store);
+    GtkTreeIter iter;
+    gboolean valid;
+    guint i = 0;
+
+    valid = gtk_tree_model_get_iter_first (model, &iter);
+    while (valid)
+    {
+        g_autofree char *row = NULL;
+        int cmp;
+
+        gtk_tree_model_get (model, &iter, 0, &row, -1);
+        cmp = i < completions->len ? strcmp (row, g_ptr_array_index (completions, i)) : -1;
+
+        if (cmp < 0)
+        {
+            valid = gtk_list_store_remove (store, &iter);
+        }
+        else if (cmp == 0)
+        {
+            valid = gtk_tree_model_iter_next (model, &iter);
+            i++;
+        }
+        else
+        {
+            GtkTreeIter new_iter;
+
+            gtk_list_store_insert_before (store, &new_iter, &iter);
+            gtk_list_store_set (store, &new_iter, 0, g_ptr_array_index (completions, i), -1);
+            i++;
+        }
+    }
+
+    for (; i < completions->len; i++)
+    {
+        gtk_list_store_insert_with_values (store, NULL, -1,
+                                           0, g_ptr_array_index (completions, i),
+                                           -1);
+    }
+}
+
 /* Update the path completions list based on the current text of the entry. */
 static gboolean
 update_completions_store (gpointer callback_data)
@@ -305,10 +598,7 @@ update_completions_store (gpointer callback_data)
     gboolean is_relative = FALSE;
     int start_sel;
     g_autofree char *uri_scheme = NULL;
-    g_auto (GStrv) completions = NULL;
-    char *completion;
-    int i;
-    GtkTreeIter iter;
+    g_autoptr (GPtrArray) completions = NULL;
     guint current_dir_strlen;
 
     entry = NAUTILUS_LOCATION_ENTRY (callback_data);
@@ -348,17 +638,19 @@ update_completions_store (gpointer callback_data)
         absolute_location = g_steal_pointer (&user_location);
     }
 
-    completions = g_filename_completer_get_completions (priv->completer, absolute_location);
-
-    /* populate the completions model */
-    gtk_list_store_clear (priv->completions_store);
+    completions = get_completions (entry, absolute_location);
+    if (completions == NULL)
+    {
+        /* Updated again once the folder is indexed. */
+        return FALSE;
+    }
 
     current_dir_strlen = strlen (priv->current_directory);
-    for (i = 0; completions[i] != NULL; i++)
+    for (guint i = 0; is_relative && i < completions->len; i++)
     {
-        completion = completions[i];
+        char *completion = g_ptr_array_index (completions, i);
 
-        if (is_relative && strlen (completion) >= current_dir_strlen)
+        if (strlen (completion) >= current_dir_strlen)
         {
             /* For relative paths, we need to strip the current directory
              * (and the trailing slash) so the completions will match what's
@@ -368,12 +660,13 @@ update_completions_store (gpointer callback_data)
             {
                 completion++;
             }
+            memmove (g_ptr_array_index (completions, i), completion, strlen (completion) + 1);
         }
-
-        gtk_list_store_append (priv->completions_store, &iter);
-        gtk_list_store_set (priv->completions_store, &iter, 0, completion, -1);
     }
 
+    /* update the completions model */
+    update_store_rows (priv->completions_store, completions);
+
     /* refilter the completions dropdown */
     gtk_entry_completion_complete (priv->completion);
 
@@ -386,22 +679,6 @@ update_completions_store (gpointer callback_data)
     return FALSE;
 }
 
-static void
-got_completion_data_callback (GFilenameCompleter    *completer,
-                              NautilusLocationEntry *entry)
-{
-    NautilusLocationEntryPrivate *priv;
-
-    priv = nautilus_location_entry_get_instance_private (entry);
-
-    if (priv->idle_id)
-    {
-        g_source_remove (priv->idle_id);
-        priv->idle_id = 0;
-    }
-    update_completions_store (entry);
-}
-
 static void
 finalize (GObject *object)
 {
@@ -411,7 +688,7 @@ finalize (GObject *object)
     entry = NAUTILUS_LOCATION_ENTRY (object);
     priv = nautilus_location_entry_get_instance_private (entry);
 
-    g_object_unref (priv->completer);
+    g_clear_pointer (&priv->directory_index, directory_index_free);
 
     g_clear_object (&priv->last_location);
     g_clear_object (&priv->completion);
@@ -437,6 +714,10 @@ nautilus_location_entry_dispose (GObject *object)
         priv->idle_id = 0;
     }
 
+    g_cancellable_cancel (priv->indexing_cancellable);
+    g_clear_object (&priv->indexing_cancellable);
+    g_clear_object (&priv->indexing_directory);
+
 
     G_OBJECT_CLASS (nautilus_location_entry_parent_class)->dispose (object);
 }
@@ -759,9 +1040,6 @@ nautilus_location_entry_init (NautilusLocationEntry *entry)
 
     priv = nautilus_location_entry_get_instance_private (entry);
 
-    priv->completer = g_filename_completer_new ();
-    g_filename_completer_set_dirs_only (priv->completer, TRUE);
-
     nautilus_location_entry_set_secondary_action (entry,
                                                   NAUTILUS_LOCATION_ENTRY_ACTION_CLEAR);
 
@@ -774,9 +1052,6 @@ nautilus_location_entry_init (NautilusLocationEntry *entry)
     g_signal_connect (entry, "icon-release",
                       G_CALLBACK (nautilus_location_entry_icon_release), NULL);
 
-    g_signal_connect (priv->completer, "got-completion-data",
-                      G_CALLBACK (got_completion_data_callback), entry);
-
     g_signal_connect_object (entry, "activate",
                              G_CALLBACK (editable_activate_callback), entry, G_CONNECT_AFTER);
     g_signal_connect_object (entry, "changed",
@@ -53,3 +53,11 @@ nautilus_metadata_get_id (const char *metadata)
 
     return GPOINTER_TO_INT (g_hash_table_lookup (hash, metadata));
 }
+
+const char *
+nautilus_metadata_get_name (guint id)
+{
+    g_return_val_if_fail (id > 0 && id < G_N_ELEMENTS (used_metadata_names), NULL);
+
+    return used_metadata_names[id - 1];
+}
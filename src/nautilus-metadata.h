@@ -43,3 +43,4 @@
 #define NAUTILUS_METADATA_KEY_EMBLEMS				"emblems"
 
 guint nautilus_metadata_get_id (const char *metadata);
+const char *nautilus_metadata_get_name (guint id);
@@ -420,6 +420,88 @@ nautilus_mime_actions_get_required_file_attributes (void)
     return NAUTILUS_FILE_ATTRIBUTE_INFO;
 }
 
+/* Default applications looked up by g_app_info_get_default_for_type() and
+ * g_app_info_get_default_for_uri_scheme(), which are costly enough to matter
+ * when done on every selection change. Keyed by interned strings; a lookup
+ * which found nothing is cached as NULL. Cleared whenever the set of
+ * installed applications or their associations change. */
+static GHashTable *default_app_for_type_cache = NULL;
+static GHashTable *default_app_for_uri_type_cache = NULL;
+static GHashTable *default_app_for_scheme_cache = NULL;
+
+static void
+app_info_unref_nullable (gpointer app)
+{
+    if (app != NULL)
+    {
+        g_object_unref (app);
+    }
+}
+
+static void
+on_app_info_monitor_changed (GAppInfoMonitor *monitor,
+                             gpointer         user_data)
+{
+    g_hash_table_remove_all (default_app_for_type_cache);
+    g_hash_table_remove_all (default_app_for_uri_type_cache);
+    g_hash_table_remove_all (default_app_for_scheme_cache);
+}
+
+static void
+ensure_default_app_caches (void)
+{
+    if (default_app_for_type_cache != NULL)
+    {
+        return;
+    }
+
+    default_app_for_type_cache = g_hash_table_new_full (NULL, NULL, NULL, app_info_unref_nullable);
+    default_app_for_uri_type_cache = g_hash_table_new_full (NULL, NULL, NULL, app_info_unref_nullable);
+    default_app_for_scheme_cache = g_hash_table_new_full (NULL, NULL, NULL, app_info_unref_nullable);
+
+    g_signal_connect (g_app_info_monitor_get (), "changed",
+                      G_CALLBACK (on_app_info_monitor_changed), NULL);
+}
+
+static GAppInfo *
+get_cached_default_application_for_type (const char *mime_type,
+                                         gboolean    must_support_uris)
+{
+    GHashTable *cache;
+    const char *key;
+    gpointer app;
+
+    ensure_default_app_caches ();
+
+    cache = must_support_uris ? default_app_for_uri_type_cache : default_app_for_type_cache;
+    key = g_intern_string (mime_type);
+    if (!g_hash_table_lookup_extended (cache, key, NULL, &app))
+    {
+        app = g_app_info_get_default_for_type (mime_type, must_support_uris);
+        g_hash_table_insert (cache, (gpointer) key, app);
+    }
+
+    return app != NULL ? g_object_ref (app) : NULL;
+}
+
+static GAppInfo *
+get_cached_default_application_for_uri_scheme (const char *uri_scheme)
+{
+    const char *key;
+    gpointer app;
+
+    ensure_default_app_caches ();
+
+    key = g_intern_string (uri_scheme);
+    if (!g_hash_table_lookup_extended (default_app_for_scheme_cache, key, NULL, &app))
+    {
+        app = g_app_info_get_default_for_uri_scheme (uri_scheme);
+        g_hash_table_insert (default_app_for_scheme_cache, (gpointer) key, app);
+    }
+
+    return app != NULL ? g_object_ref (app) : NULL;
+}
+
 GAppInfo *
 nautilus_mime_get_default_application_for_file (NautilusFile *file)
 {
@@ -431,15 +513,15 @@ nautilus_mime_get_default_application_for_file (NautilusFile *file)
         return NULL;
     }
 
-    app = g_app_info_get_default_for_type (nautilus_file_get_mime_type (file),
-                                           !nautilus_file_has_local_path (file));
+    app = get_cached_default_application_for_type (nautilus_file_get_mime_type (file),
+                                                   !nautilus_file_has_local_path (file));
 
     if (app == NULL)
     {
         uri_scheme = nautilus_file_get_uri_scheme (file);
         if (uri_scheme != NULL)
         {
-            app = g_app_info_get_default_for_uri_scheme (uri_scheme);
+            app = get_cached_default_application_for_uri_scheme (uri_scheme);
             g_free (uri_scheme);
         }
     }
@@ -447,37 +529,9 @@ nautilus_mime_get_default_application_for_file (NautilusFile *file)
     return app;
 }
 
-static int
-file_compare_by_mime_type (NautilusFile *file_a,
-                           NautilusFile *file_b)
-{
-    return strcmp (nautilus_file_get_mime_type (file_a),
-                   nautilus_file_get_mime_type (file_b));
-}
-
-static int
-file_compare_by_parent_uri (NautilusFile *file_a,
-                            NautilusFile *file_b)
-{
-    char *parent_uri_a, *parent_uri_b;
-    int ret;
-
-    parent_uri_a = nautilus_file_get_parent_uri (file_a);
-    parent_uri_b = nautilus_file_get_parent_uri (file_b);
-
-    ret = strcmp (parent_uri_a, parent_uri_b);
-
-    g_free (parent_uri_a);
-    g_free (parent_uri_b);
-
-    return ret;
-}
-
 GAppInfo *
 nautilus_mime_get_default_application_for_files (GList *files)
 {
-    GList *l, *sorted_files;
-    NautilusFile *file;
     GAppInfo *app = NULL;
 
     g_assert (files != NULL);
@@ -490,20 +544,53 @@ nautilus_mime_get_default_application_for_files (GList *files)
         return NULL;
     }
 
-    sorted_files = g_list_sort (g_list_copy (files), (GCompareFunc) file_compare_by_mime_type);
-
-    for (l = sorted_files; l != NULL; l = l->next)
+    for (GList *l = files; l != NULL; l = l->next)
     {
-        file = l->data;
+        g_autoptr (GAppInfo) one_app = nautilus_mime_get_default_application_for_file (l->data);
 
-        if (l->prev &&
-            file_compare_by_mime_type (file, l->prev->data) == 0 &&
-            file_compare_by_parent_uri (file, l->prev->data) == 0)
+        if (one_app == NULL || (app != NULL && !g_app_info_equal (app, one_app)))
         {
-            continue;
+            g_clear_object (&app);
+            break;
         }
 
-        g_autoptr (GAppInfo) one_app = nautilus_mime_get_default_application_for_file (file);
+        if (app == NULL)
+        {
+            app = g_steal_pointer (&one_app);
+        }
+    }
+
+    return app;
+}
+
+/**
+ * nautilus_mime_get_default_application_for_mime_types:
+ * @mime_types: (element-type utf8): the distinct MIME types of a set of files
+ * @must_support_uris: whether the files lack a local path
+ *
+ * Same as nautilus_mime_get_default_application_for_files(), for callers who
+ * already know the MIME types involved and don't want to walk every file.
+ * Unlike it, this doesn't fall back to URI scheme handlers.
+ *
+ * Returns: (transfer full) (nullable): the common default application
+ */
+GAppInfo *
+nautilus_mime_get_default_application_for_mime_types (GList    *mime_types,
+                                                      gboolean  must_support_uris)
+{
+    GAppInfo *app = NULL;
+
+    g_assert (mime_types != NULL);
+
+    if (nautilus_application_is_sandboxed ())
+    {
+        return NULL;
+    }
+
+    for (GList *l = mime_types; l != NULL; l = l->next)
+    {
+        g_autoptr (GAppInfo) one_app = get_cached_default_application_for_type (l->data,
+                                                                                must_support_uris);
 
         if (one_app == NULL || (app != NULL && !g_app_info_equal (app, one_app)))
         {
@@ -517,8 +604,6 @@ nautilus_mime_get_default_application_for_files (GList *files)
         }
     }
 
-    g_list_free (sorted_files);
-
     return app;
 }
 
@@ -33,6 +33,9 @@ GAppInfo *             nautilus_mime_get_default_application_for_file     (Nauti
 
 GAppInfo *             nautilus_mime_get_default_application_for_files    (GList                   *files);
 
+GAppInfo *             nautilus_mime_get_default_application_for_mime_types (GList                 *mime_types,
+                                                                            gboolean               must_support_uris);
+
 gboolean               nautilus_mime_file_extracts                        (NautilusFile            *file);
 gboolean               nautilus_mime_file_opens_in_external_app           (NautilusFile            *file);
 gboolean               nautilus_mime_file_launches                        (NautilusFile            *file);
@@ -20,7 +20,6 @@
  */
 
 #include <config.h>
-#include <math.h>
 #include <glib/gi18n.h>
 #include "nautilus-progress-info.h"
 #include "nautilus-progress-info-manager.h"
@@ -36,7 +35,26 @@ enum
     LAST_SIGNAL
 };
 
-#define SIGNAL_DELAY_MSEC 100
+/* Changes are published to the main thread at this rate, see
+ * sample_progress_infos(). */
+#define SAMPLE_INTERVAL_MSEC 100
+
+/* Progress is kept in these units, so that it can be updated atomically. */
+#define PROGRESS_SCALE 10000
+#define PROGRESS_ACTIVITY_MODE -1
+/* Emit on change of 0.5 percent */
+#define PROGRESS_MIN_CHANGE (PROGRESS_SCALE / 200)
+
+typedef enum
+{
+    PENDING_STARTED = 1 << 0,
+    PENDING_CHANGED = 1 << 1,
+    PENDING_PROGRESS_CHANGED = 1 << 2,
+    PENDING_FINISHED = 1 << 3,
+    PENDING_CANCELLED = 1 << 4,
+} PendingSignals;
+
+#define URGENT_SIGNALS (PENDING_STARTED | PENDING_FINISHED | PENDING_CANCELLED)
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
@@ -49,36 +67,44 @@ struct _NautilusProgressInfo
 
     GTimer *progress_timer;
 
+    /* Updated by the operation as it goes, without locking. */
+    gint progress;
+    gint remaining_time;
+    gint elapsed_time;
+    char *pending_status;
+    char *pending_details;
+
+    /* PendingSignals to emit at the next sample. An info with any of them
+     * is on the pending list, and holds a reference for it. */
+    gint pending_signals;
+    NautilusProgressInfo *next_pending;
+
+    /* Published by the sampler, main thread only */
     char *status;
     char *details;
-    double progress;
-    gdouble remaining_time;
-    gdouble elapsed_time;
-    gboolean activity_mode;
+
+    /* Protected by the lock below, as they change seldom. */
     gboolean started;
     gboolean finished;
     gboolean paused;
-
-    GSource *idle_source;
-    gboolean source_is_now;
-
-    gboolean start_at_idle;
-    gboolean finish_at_idle;
-    gboolean cancel_at_idle;
-    gboolean changed_at_idle;
-    gboolean progress_at_idle;
+    gboolean queued;
+    gboolean held;
+    gboolean incomplete;
 
     GFile *destination;
 };
 
 G_LOCK_DEFINE_STATIC (progress_info);
+/* Signalled, with the lock above, when a held info is released or cancelled. */
+static GCond held_cond;
 
-G_DEFINE_TYPE (NautilusProgressInfo, nautilus_progress_info, G_TYPE_OBJECT)
+/* Lock-free stack of the infos with pending signals. It is only ever
+ * pushed to, or taken as a whole, so there is no ABA problem. */
+static NautilusProgressInfo *pending_infos = NULL;
+static gint sample_scheduled = FALSE;
+static gint urgent_sample_scheduled = FALSE;
 
-static void set_details (NautilusProgressInfo *info,
-                         const char           *details);
-static void set_status (NautilusProgressInfo *info,
-                        const char           *status);
+G_DEFINE_TYPE (NautilusProgressInfo, nautilus_progress_info, G_TYPE_OBJECT)
 
 static void
 nautilus_progress_info_finalize (GObject *object)
@@ -89,6 +115,8 @@ nautilus_progress_info_finalize (GObject *object)
 
     g_free (info->status);
     g_free (info->details);
+    g_free (info->pending_status);
+    g_free (info->pending_details);
     g_clear_pointer (&info->progress_timer, g_timer_destroy);
     g_cancellable_disconnect (info->cancellable, info->cancellable_id);
     g_object_unref (info->cancellable);
@@ -100,34 +128,12 @@ nautilus_progress_info_finalize (GObject *object)
     }
 }
 
-static void
-nautilus_progress_info_dispose (GObject *object)
-{
-    NautilusProgressInfo *info;
-
-    info = NAUTILUS_PROGRESS_INFO (object);
-
-    G_LOCK (progress_info);
-
-    /* Destroy source in dispose, because the callback
-     *  could come here before the destroy, which should
-     *  ressurect the object for a while */
-    if (info->idle_source)
-    {
-        g_source_destroy (info->idle_source);
-        g_source_unref (info->idle_source);
-        info->idle_source = NULL;
-    }
-    G_UNLOCK (progress_info);
-}
-
 static void
 nautilus_progress_info_class_init (NautilusProgressInfoClass *klass)
 {
     GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
 
     gobject_class->finalize = nautilus_progress_info_finalize;
-    gobject_class->dispose = nautilus_progress_info_dispose;
 
     signals[CHANGED] =
         g_signal_new ("changed",
@@ -176,123 +182,121 @@ nautilus_progress_info_class_init (NautilusProgressInfoClass *klass)
 }
 
 static gboolean
-idle_callback (gpointer data)
+publish_string (char **published,
+                char  *pending)
 {
-    NautilusProgressInfo *info = data;
-    gboolean start_at_idle;
-    gboolean finish_at_idle;
-    gboolean changed_at_idle;
-    gboolean progress_at_idle;
-    gboolean cancelled_at_idle;
-    GSource *source;
-
-    G_LOCK (progress_info);
-
-    source = g_main_current_source ();
-
-    /* Protect agains races where the source has
-     *  been destroyed on another thread while it
-     *  was being dispatched.
-     *  Similar to what gdk_threads_add_idle does.
-     */
-    if (g_source_is_destroyed (source))
+    if (pending == NULL || g_strcmp0 (*published, pending) == 0)
     {
-        G_UNLOCK (progress_info);
+        g_free (pending);
         return FALSE;
     }
 
-    /* We hadn't destroyed the source, so take a ref.
-     * This might ressurect the object from dispose, but
-     * that should be ok.
-     */
-    g_object_ref (info);
+    g_free (*published);
+    *published = pending;
 
-    g_assert (source == info->idle_source);
+    return TRUE;
+}
 
-    g_source_unref (source);
-    info->idle_source = NULL;
+static void
+emit_pending_signals (NautilusProgressInfo *info)
+{
+    PendingSignals pending;
+    gboolean changed;
 
-    start_at_idle = info->start_at_idle;
-    finish_at_idle = info->finish_at_idle;
-    changed_at_idle = info->changed_at_idle;
-    progress_at_idle = info->progress_at_idle;
-    cancelled_at_idle = info->cancel_at_idle;
+    pending = g_atomic_int_exchange (&info->pending_signals, 0);
 
-    info->start_at_idle = FALSE;
-    info->finish_at_idle = FALSE;
-    info->changed_at_idle = FALSE;
-    info->progress_at_idle = FALSE;
-    info->cancel_at_idle = FALSE;
+    changed = publish_string (&info->status,
+                              g_atomic_pointer_exchange (&info->pending_status, NULL));
+    changed |= publish_string (&info->details,
+                               g_atomic_pointer_exchange (&info->pending_details, NULL));
 
-    G_UNLOCK (progress_info);
+    /* Details the operation set as it was being cancelled don't replace
+     * these. */
+    if (g_cancellable_is_cancelled (info->cancellable))
+    {
+        changed |= publish_string (&info->details, g_strdup (_("Canceled")));
+    }
 
-    if (start_at_idle)
+    if (pending & PENDING_STARTED)
     {
-        g_signal_emit (info,
-                       signals[STARTED],
-                       0);
+        g_signal_emit (info, signals[STARTED], 0);
     }
 
-    if (changed_at_idle)
+    if (changed || (pending & PENDING_CHANGED))
     {
-        g_signal_emit (info,
-                       signals[CHANGED],
-                       0);
+        g_signal_emit (info, signals[CHANGED], 0);
     }
 
-    if (progress_at_idle)
+    if (pending & PENDING_PROGRESS_CHANGED)
     {
-        g_signal_emit (info,
-                       signals[PROGRESS_CHANGED],
-                       0);
+        g_signal_emit (info, signals[PROGRESS_CHANGED], 0);
     }
 
-    if (finish_at_idle)
+    if (pending & PENDING_FINISHED)
     {
-        g_signal_emit (info,
-                       signals[FINISHED],
-                       0);
+        g_signal_emit (info, signals[FINISHED], 0);
     }
 
-    if (cancelled_at_idle)
+    if (pending & PENDING_CANCELLED)
     {
-        g_signal_emit (info,
-                       signals[CANCELLED],
-                       0);
+        g_signal_emit (info, signals[CANCELLED], 0);
     }
+}
+
+/* Emits the signals of all the infos which changed since the last time,
+ * once per info however many times they changed. */
+static gboolean
+sample_progress_infos (gpointer user_data)
+{
+    NautilusProgressInfo *info;
 
-    g_object_unref (info);
+    g_atomic_int_set (&sample_scheduled, FALSE);
+    g_atomic_int_set (&urgent_sample_scheduled, FALSE);
 
-    return FALSE;
-}
+    info = g_atomic_pointer_exchange (&pending_infos, NULL);
+    while (info != NULL)
+    {
+        /* Once its signals are taken the info may be pushed again, which
+         * overwrites the link. */
+        NautilusProgressInfo *next = info->next_pending;
+
+        emit_pending_signals (info);
+        g_object_unref (info);
 
+        info = next;
+    }
+
+    return G_SOURCE_REMOVE;
+}
 
-/* Called with lock held */
+/* Lock-free, can be called from any thread. */
 static void
-queue_idle (NautilusProgressInfo *info,
-            gboolean              now)
+add_pending_signals (NautilusProgressInfo *info,
+                     PendingSignals        signals_to_add)
 {
-    if (info->idle_source == NULL ||
-        (now && !info->source_is_now))
+    if (g_atomic_int_or (&info->pending_signals, signals_to_add) == 0)
     {
-        if (info->idle_source)
-        {
-            g_source_destroy (info->idle_source);
-            g_source_unref (info->idle_source);
-            info->idle_source = NULL;
-        }
+        NautilusProgressInfo *head;
 
-        info->source_is_now = now;
-        if (now)
+        g_object_ref (info);
+        do
         {
-            info->idle_source = g_idle_source_new ();
+            head = g_atomic_pointer_get (&pending_infos);
+            info->next_pending = head;
         }
-        else
+        while (!g_atomic_pointer_compare_and_exchange (&pending_infos, head, info));
+    }
+
+    if ((signals_to_add & URGENT_SIGNALS) != 0)
+    {
+        if (g_atomic_int_compare_and_exchange (&urgent_sample_scheduled, FALSE, TRUE))
         {
-            info->idle_source = g_timeout_source_new (SIGNAL_DELAY_MSEC);
+            g_idle_add (sample_progress_infos, NULL);
         }
-        g_source_set_callback (info->idle_source, idle_callback, info, NULL);
-        g_source_attach (info->idle_source, NULL);
+    }
+    else if (g_atomic_int_compare_and_exchange (&sample_scheduled, FALSE, TRUE))
+    {
+        g_timeout_add (SAMPLE_INTERVAL_MSEC, sample_progress_infos, NULL);
     }
 }
 
@@ -301,11 +305,11 @@ on_canceled (GCancellable         *cancellable,
              NautilusProgressInfo *info)
 {
     G_LOCK (progress_info);
-    set_details (info, _("Canceled"));
-    info->cancel_at_idle = TRUE;
     g_timer_stop (info->progress_timer);
-    queue_idle (info, TRUE);
+    g_cond_broadcast (&held_cond);
     G_UNLOCK (progress_info);
+
+    add_pending_signals (info, PENDING_CANCELLED);
 }
 
 static void
@@ -338,64 +342,40 @@ nautilus_progress_info_new (void)
 char *
 nautilus_progress_info_get_status (NautilusProgressInfo *info)
 {
-    char *res;
-
-    G_LOCK (progress_info);
-
     if (info->status)
     {
-        res = g_strdup (info->status);
+        return g_strdup (info->status);
     }
     else
     {
-        res = g_strdup (_("Preparing"));
+        return g_strdup (_("Preparing"));
     }
-
-    G_UNLOCK (progress_info);
-
-    return res;
 }
 
 char *
 nautilus_progress_info_get_details (NautilusProgressInfo *info)
 {
-    char *res;
-
-    G_LOCK (progress_info);
-
     if (info->details)
     {
-        res = g_strdup (info->details);
+        return g_strdup (info->details);
     }
     else
     {
-        res = g_strdup (_("Preparing"));
+        return g_strdup (_("Preparing"));
     }
-
-    G_UNLOCK (progress_info);
-
-    return res;
 }
 
 double
 nautilus_progress_info_get_progress (NautilusProgressInfo *info)
 {
-    double res;
-
-    G_LOCK (progress_info);
+    gint progress = g_atomic_int_get (&info->progress);
 
-    if (info->activity_mode)
+    if (progress == PROGRESS_ACTIVITY_MODE)
     {
-        res = -1.0;
+        return -1.0;
     }
-    else
-    {
-        res = info->progress;
-    }
-
-    G_UNLOCK (progress_info);
 
-    return res;
+    return (double) progress / PROGRESS_SCALE;
 }
 
 void
@@ -485,6 +465,8 @@ nautilus_progress_info_pause (NautilusProgressInfo *info)
     {
         info->paused = TRUE;
         g_timer_stop (info->progress_timer);
+
+        add_pending_signals (info, PENDING_CHANGED);
     }
 
     G_UNLOCK (progress_info);
@@ -499,150 +481,247 @@ nautilus_progress_info_resume (NautilusProgressInfo *info)
     {
         info->paused = FALSE;
         g_timer_continue (info->progress_timer);
+
+        add_pending_signals (info, PENDING_CHANGED);
     }
 
     G_UNLOCK (progress_info);
 }
 
-void
-nautilus_progress_info_start (NautilusProgressInfo *info)
+gboolean
+nautilus_progress_info_get_is_queued (NautilusProgressInfo *info)
 {
-    G_LOCK (progress_info);
+    gboolean res;
 
-    if (!info->started)
-    {
-        info->started = TRUE;
-        g_timer_start (info->progress_timer);
+    G_LOCK (progress_info);
 
-        info->start_at_idle = TRUE;
-        queue_idle (info, TRUE);
-    }
+    res = info->queued;
 
     G_UNLOCK (progress_info);
+
+    return res;
 }
 
+/* Marks the operation as waiting for other operations to finish before it
+ * can run. */
 void
-nautilus_progress_info_finish (NautilusProgressInfo *info)
+nautilus_progress_info_set_queued (NautilusProgressInfo *info,
+                                   gboolean              queued)
 {
     G_LOCK (progress_info);
 
-    if (!info->finished)
+    if (info->queued != queued)
     {
-        info->finished = TRUE;
-        g_timer_stop (info->progress_timer);
+        info->queued = queued;
 
-        info->finish_at_idle = TRUE;
-        queue_idle (info, TRUE);
+        add_pending_signals (info, PENDING_CHANGED);
     }
 
     G_UNLOCK (progress_info);
 }
 
-static void
-set_status (NautilusProgressInfo *info,
-            const char           *status)
+gboolean
+nautilus_progress_info_get_is_incomplete (NautilusProgressInfo *info)
 {
-    g_free (info->status);
-    info->status = g_strdup (status);
+    gboolean res;
+
+    G_LOCK (progress_info);
+
+    res = info->incomplete;
 
-    info->changed_at_idle = TRUE;
-    queue_idle (info, FALSE);
+    G_UNLOCK (progress_info);
+
+    return res;
 }
 
+/* Marks the operation as not having done all it was asked to, because of
+ * errors or skipped files, even if it runs to the end. */
 void
-nautilus_progress_info_take_status (NautilusProgressInfo *info,
-                                    char                 *status)
+nautilus_progress_info_set_incomplete (NautilusProgressInfo *info)
 {
     G_LOCK (progress_info);
 
-    if (g_strcmp0 (info->status, status) != 0 &&
-        !g_cancellable_is_cancelled (info->cancellable))
-    {
-        set_status (info, status);
-    }
+    info->incomplete = TRUE;
+
+    G_UNLOCK (progress_info);
+}
+
+gboolean
+nautilus_progress_info_get_is_held (NautilusProgressInfo *info)
+{
+    gboolean res;
+
+    G_LOCK (progress_info);
+
+    res = info->held;
 
     G_UNLOCK (progress_info);
 
-    g_free (status);
+    return res;
 }
 
+/* Asks the operation to pause at its next call to
+ * nautilus_progress_info_wait_while_held(), until released. */
 void
-nautilus_progress_info_set_status (NautilusProgressInfo *info,
-                                   const char           *status)
+nautilus_progress_info_hold (NautilusProgressInfo *info)
 {
     G_LOCK (progress_info);
 
-    if (g_strcmp0 (info->status, status) != 0 &&
-        !g_cancellable_is_cancelled (info->cancellable))
+    if (!info->held)
     {
-        set_status (info, status);
+        info->held = TRUE;
+
+        add_pending_signals (info, PENDING_CHANGED);
     }
 
     G_UNLOCK (progress_info);
 }
 
-static void
-set_details (NautilusProgressInfo *info,
-             const char           *details)
+void
+nautilus_progress_info_release (NautilusProgressInfo *info)
 {
-    g_free (info->details);
-    info->details = g_strdup (details);
+    G_LOCK (progress_info);
+
+    if (info->held)
+    {
+        info->held = FALSE;
+        g_cond_broadcast (&held_cond);
+
+        add_pending_signals (info, PENDING_CHANGED);
+    }
 
-    info->changed_at_idle = TRUE;
-    queue_idle (info, FALSE);
+    G_UNLOCK (progress_info);
 }
 
+/* Called by the operation's thread; blocks, with the operation shown as
+ * paused, for as long as it is held and not cancelled. */
 void
-nautilus_progress_info_take_details (NautilusProgressInfo *info,
-                                     char                 *details)
+nautilus_progress_info_wait_while_held (NautilusProgressInfo *info)
 {
     G_LOCK (progress_info);
 
-    if (g_strcmp0 (info->details, details) != 0 &&
-        !g_cancellable_is_cancelled (info->cancellable))
+    if (!info->held || g_cancellable_is_cancelled (info->cancellable))
     {
-        set_details (info, details);
+        G_UNLOCK (progress_info);
+        return;
     }
 
     G_UNLOCK (progress_info);
+    nautilus_progress_info_pause (info);
+    G_LOCK (progress_info);
 
-    g_free (details);
+    while (info->held && !g_cancellable_is_cancelled (info->cancellable))
+    {
+        g_cond_wait (&held_cond, &G_LOCK_NAME (progress_info));
+    }
+
+    G_UNLOCK (progress_info);
+    nautilus_progress_info_resume (info);
 }
 
 void
-nautilus_progress_info_set_details (NautilusProgressInfo *info,
-                                    const char           *details)
+nautilus_progress_info_start (NautilusProgressInfo *info)
 {
     G_LOCK (progress_info);
 
-    if (g_strcmp0 (info->details, details) != 0 &&
-        !g_cancellable_is_cancelled (info->cancellable))
+    if (!info->started)
     {
-        set_details (info, details);
+        info->started = TRUE;
+        g_timer_start (info->progress_timer);
+
+        add_pending_signals (info, PENDING_STARTED);
     }
 
     G_UNLOCK (progress_info);
 }
 
 void
-nautilus_progress_info_pulse_progress (NautilusProgressInfo *info)
+nautilus_progress_info_finish (NautilusProgressInfo *info)
 {
     G_LOCK (progress_info);
 
-    info->activity_mode = TRUE;
-    info->progress = 0.0;
-    info->progress_at_idle = TRUE;
-    queue_idle (info, FALSE);
+    if (!info->finished)
+    {
+        info->finished = TRUE;
+        g_timer_stop (info->progress_timer);
+
+        add_pending_signals (info, PENDING_FINISHED);
+    }
 
     G_UNLOCK (progress_info);
 }
 
+static void
+take_status (NautilusProgressInfo *info,
+             char                 *status)
+{
+    if (g_cancellable_is_cancelled (info->cancellable))
+    {
+        g_free (status);
+        return;
+    }
+
+    g_free (g_atomic_pointer_exchange (&info->pending_status, status));
+    add_pending_signals (info, PENDING_CHANGED);
+}
+
+void
+nautilus_progress_info_take_status (NautilusProgressInfo *info,
+                                    char                 *status)
+{
+    take_status (info, status);
+}
+
+void
+nautilus_progress_info_set_status (NautilusProgressInfo *info,
+                                   const char           *status)
+{
+    take_status (info, g_strdup (status));
+}
+
+static void
+take_details (NautilusProgressInfo *info,
+              char                 *details)
+{
+    if (g_cancellable_is_cancelled (info->cancellable))
+    {
+        g_free (details);
+        return;
+    }
+
+    g_free (g_atomic_pointer_exchange (&info->pending_details, details));
+    add_pending_signals (info, PENDING_CHANGED);
+}
+
+void
+nautilus_progress_info_take_details (NautilusProgressInfo *info,
+                                     char                 *details)
+{
+    take_details (info, details);
+}
+
+void
+nautilus_progress_info_set_details (NautilusProgressInfo *info,
+                                    const char           *details)
+{
+    take_details (info, g_strdup (details));
+}
+
+void
+nautilus_progress_info_pulse_progress (NautilusProgressInfo *info)
+{
+    g_atomic_int_set (&info->progress, PROGRESS_ACTIVITY_MODE);
+    add_pending_signals (info, PENDING_PROGRESS_CHANGED);
+}
+
 void
 nautilus_progress_info_set_progress (NautilusProgressInfo *info,
                                      double                current,
                                      double                total)
 {
     double current_percent;
+    gint progress;
+    gint old_progress;
 
     if (total <= 0)
     {
@@ -663,61 +742,42 @@ nautilus_progress_info_set_progress (NautilusProgressInfo *info,
         }
     }
 
-    G_LOCK (progress_info);
+    progress = (gint) (current_percent * PROGRESS_SCALE);
+    old_progress = g_atomic_int_get (&info->progress);
 
-    if ((info->activity_mode ||     /* emit on switch from activity mode */
-         fabs (current_percent - info->progress) > 0.005) &&    /* Emit on change of 0.5 percent */
+    if ((old_progress == PROGRESS_ACTIVITY_MODE ||     /* emit on switch from activity mode */
+         ABS (progress - old_progress) > PROGRESS_MIN_CHANGE) &&
         !g_cancellable_is_cancelled (info->cancellable))
     {
-        info->activity_mode = FALSE;
-        info->progress = current_percent;
-        info->progress_at_idle = TRUE;
-        queue_idle (info, FALSE);
+        g_atomic_int_set (&info->progress, progress);
+        add_pending_signals (info, PENDING_PROGRESS_CHANGED);
     }
-
-    G_UNLOCK (progress_info);
 }
 
 void
 nautilus_progress_info_set_remaining_time (NautilusProgressInfo *info,
                                            gdouble               time)
 {
-    G_LOCK (progress_info);
-    info->remaining_time = time;
-    G_UNLOCK (progress_info);
+    g_atomic_int_set (&info->remaining_time, (gint) time);
 }
 
 gdouble
 nautilus_progress_info_get_remaining_time (NautilusProgressInfo *info)
 {
-    gint remaining_time;
-
-    G_LOCK (progress_info);
-    remaining_time = info->remaining_time;
-    G_UNLOCK (progress_info);
-
-    return remaining_time;
+    return g_atomic_int_get (&info->remaining_time);
 }
 
 void
 nautilus_progress_info_set_elapsed_time (NautilusProgressInfo *info,
                                          gdouble               time)
 {
-    G_LOCK (progress_info);
-    info->elapsed_time = time;
-    G_UNLOCK (progress_info);
+    g_atomic_int_set (&info->elapsed_time, (gint) time);
 }
 
 gdouble
 nautilus_progress_info_get_elapsed_time (NautilusProgressInfo *info)
 {
-    gint elapsed_time;
-
-    G_LOCK (progress_info);
-    elapsed_time = info->elapsed_time;
-    G_UNLOCK (progress_info);
-
-    return elapsed_time;
+    return g_atomic_int_get (&info->elapsed_time);
 }
 
 gdouble
@@ -29,13 +29,16 @@
 G_DECLARE_FINAL_TYPE (NautilusProgressInfo, nautilus_progress_info, NAUTILUS, PROGRESS_INFO, GObject)
 
 /* Signals:
-   "changed" - status or details changed
+   "changed" - status, details, or the queued/paused state changed
    "progress-changed" - the percentage progress changed (or we pulsed if in activity_mode
    "started" - emited on job start
    "finished" - emitted when job is done
    
-   All signals are emitted from idles in main loop.
-   All methods are threadsafe.
+   All signals are emitted from the main loop, at most once per info every
+   100 ms, except for "started", "finished" and "cancelled".
+   All methods are threadsafe, except for getting the status and details,
+   which returns what was last published to the main loop. Updating status,
+   details, progress and times doesn't lock.
  */
 
 NautilusProgressInfo *nautilus_progress_info_new (void);
@@ -51,11 +54,20 @@ gboolean      nautilus_progress_info_get_is_started  (NautilusProgressInfo *info
 gboolean      nautilus_progress_info_get_is_finished (NautilusProgressInfo *info);
 gboolean      nautilus_progress_info_get_is_paused   (NautilusProgressInfo *info);
 gboolean      nautilus_progress_info_get_is_cancelled (NautilusProgressInfo *info);
+gboolean      nautilus_progress_info_get_is_queued   (NautilusProgressInfo *info);
+gboolean      nautilus_progress_info_get_is_held     (NautilusProgressInfo *info);
+gboolean      nautilus_progress_info_get_is_incomplete (NautilusProgressInfo *info);
 
 void          nautilus_progress_info_start           (NautilusProgressInfo *info);
 void          nautilus_progress_info_finish          (NautilusProgressInfo *info);
 void          nautilus_progress_info_pause           (NautilusProgressInfo *info);
 void          nautilus_progress_info_resume          (NautilusProgressInfo *info);
+void          nautilus_progress_info_set_queued      (NautilusProgressInfo *info,
+                                                      gboolean              queued);
+void          nautilus_progress_info_set_incomplete  (NautilusProgressInfo *info);
+void          nautilus_progress_info_hold            (NautilusProgressInfo *info);
+void          nautilus_progress_info_release         (NautilusProgressInfo *info);
+void          nautilus_progress_info_wait_while_held (NautilusProgressInfo *info);
 void          nautilus_progress_info_set_status      (NautilusProgressInfo *info,
 						      const char           *status);
 void          nautilus_progress_info_take_status     (NautilusProgressInfo *info,
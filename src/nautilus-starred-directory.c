@@ -27,7 +27,9 @@ struct _NautilusFavoriteDirectory
 {
     NautilusDirectory parent_slot;
 
-    GList *files;
+    /* The starred files, each holding a reference. Keyed by the file
+     * instances rather than their URIs, which change when they are moved. */
+    GHashTable *files;
 
     GList *monitor_list;
     GList *callback_list;
@@ -93,57 +95,61 @@ disconnect_and_unmonitor_file (NautilusFile              *file,
     }
 }
 
+static void
+connect_and_monitor_file (NautilusFile              *file,
+                          NautilusFavoriteDirectory *self)
+{
+    g_signal_connect (file, "changed", G_CALLBACK (file_changed), self);
+
+    for (GList *m = self->monitor_list; m != NULL; m = m->next)
+    {
+        FavoriteMonitor *monitor = m->data;
+
+        /* Add monitors */
+        nautilus_file_monitor_add (file, monitor, monitor->monitor_attributes);
+    }
+}
+
+static GList *
+get_file_list (NautilusFavoriteDirectory *self)
+{
+    GList *file_list = g_hash_table_get_keys (self->files);
+
+    g_list_foreach (file_list, (GFunc) nautilus_file_ref, NULL);
+
+    return file_list;
+}
+
+/* Only looks at the changed files, so that starring one file costs the same
+ * however many are starred already. */
 static void
 nautilus_starred_directory_update_files (NautilusFavoriteDirectory *self,
                                          GList                     *changed_files)
 {
     NautilusTagManager *tag_manager = nautilus_tag_manager_get ();
-    GList *monitor_list;
-    FavoriteMonitor *monitor;
-    g_autoptr (GHashTable) uri_table = NULL;
-    GList *next;
     g_autolist (NautilusFile) files_added = NULL;
     g_autolist (NautilusFile) files_removed = NULL;
 
-    uri_table = g_hash_table_new_full (g_str_hash,
-                                       g_str_equal,
-                                       (GDestroyNotify) g_free,
-                                       NULL);
-
-    for (GList *l = self->files; l != NULL; l = l->next)
-    {
-        g_hash_table_add (uri_table, nautilus_file_get_uri (NAUTILUS_FILE (l->data)));
-    }
-
-    for (GList *l = changed_files; l != NULL; l = next)
+    for (GList *l = changed_files; l != NULL; l = l->next)
     {
         NautilusFile *file = l->data;
         g_autofree char *uri = nautilus_file_get_uri (file);
+        gboolean is_listed = g_hash_table_contains (self->files, file);
+        gboolean is_starred = nautilus_tag_manager_file_is_starred (tag_manager, uri);
 
-        next = l->next;
-        if (g_hash_table_contains (uri_table, uri) &&
-            !nautilus_tag_manager_file_is_starred (tag_manager, uri))
+        if (is_listed && !is_starred)
         {
             disconnect_and_unmonitor_file (file, self);
-            nautilus_file_unref (file);
-            files_removed = g_list_prepend (files_removed, nautilus_file_ref (file));
-            self->files = g_list_remove (self->files, file);
+            /* The reference held by the set moves to the emitted list. */
+            g_hash_table_steal (self->files, file);
+            files_removed = g_list_prepend (files_removed, file);
         }
-        else if (!g_hash_table_contains (uri_table, uri) &&
-                 nautilus_tag_manager_file_is_starred (tag_manager, uri))
+        else if (!is_listed && is_starred)
         {
-            for (monitor_list = self->monitor_list; monitor_list; monitor_list = monitor_list->next)
-            {
-                monitor = monitor_list->data;
-
-                /* Add monitors */
-                nautilus_file_monitor_add (file, monitor, monitor->monitor_attributes);
-            }
-
-            g_signal_connect (file, "changed", G_CALLBACK (file_changed), self);
+            connect_and_monitor_file (file, self);
 
+            g_hash_table_add (self->files, nautilus_file_ref (file));
             files_added = g_list_prepend (files_added, nautilus_file_ref (file));
-            self->files = g_list_prepend (self->files, nautilus_file_ref (file));
         }
         else
         {
@@ -180,11 +186,9 @@ static gboolean
 real_contains_file (NautilusDirectory *directory,
                     NautilusFile      *file)
 {
-    g_autofree gchar *uri = NULL;
-
-    uri = nautilus_file_get_uri (file);
+    NautilusFavoriteDirectory *self = NAUTILUS_STARRED_DIRECTORY (directory);
 
-    return nautilus_tag_manager_file_is_starred (nautilus_tag_manager_get (), uri);
+    return g_hash_table_contains (self->files, file);
 }
 
 static gboolean
@@ -205,7 +209,7 @@ real_call_when_ready (NautilusDirectory         *directory,
 
     starred = NAUTILUS_STARRED_DIRECTORY (directory);
 
-    file_list = nautilus_file_list_copy (starred->files);
+    file_list = get_file_list (starred);
 
     callback (NAUTILUS_DIRECTORY (directory),
               file_list,
@@ -228,7 +232,7 @@ real_file_monitor_add (NautilusDirectory         *directory,
                        NautilusDirectoryCallback  callback,
                        gpointer                   callback_data)
 {
-    GList *list;
+    GHashTableIter iter;
     FavoriteMonitor *monitor;
     NautilusFavoriteDirectory *starred;
     NautilusFile *file;
@@ -244,13 +248,14 @@ real_file_monitor_add (NautilusDirectory         *directory,
 
     if (callback != NULL)
     {
-        (*callback)(directory, starred->files, callback_data);
+        g_autoptr (GList) file_list = g_hash_table_get_keys (starred->files);
+
+        (*callback)(directory, file_list, callback_data);
     }
 
-    for (list = starred->files; list != NULL; list = list->next)
+    g_hash_table_iter_init (&iter, starred->files);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
     {
-        file = list->data;
-
         /* Add monitors */
         nautilus_file_monitor_add (file, monitor, file_attributes);
     }
@@ -260,13 +265,12 @@ static void
 starred_monitor_destroy (FavoriteMonitor           *monitor,
                          NautilusFavoriteDirectory *starred)
 {
-    GList *l;
+    GHashTableIter iter;
     NautilusFile *file;
 
-    for (l = starred->files; l != NULL; l = l->next)
+    g_hash_table_iter_init (&iter, starred->files);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
     {
-        file = l->data;
-
         nautilus_file_monitor_remove (file, monitor);
     }
 
@@ -396,40 +400,38 @@ real_get_file_list (NautilusDirectory *directory)
 
     starred = NAUTILUS_STARRED_DIRECTORY (directory);
 
-    return nautilus_file_list_copy (starred->files);
+    return get_file_list (starred);
 }
 
 static void
 nautilus_starred_directory_set_files (NautilusFavoriteDirectory *self)
 {
     g_autolist (NautilusFile) starred_files = NULL;
-    GList *l;
-    GList *file_list;
-    FavoriteMonitor *monitor;
-    GList *monitor_list;
-
-    file_list = NULL;
 
     starred_files = nautilus_tag_manager_get_starred_files (nautilus_tag_manager_get ());
 
-    for (l = starred_files; l != NULL; l = l->next)
+    for (GList *l = starred_files; l != NULL; l = l->next)
     {
         NautilusFile *file = l->data;
 
-        g_signal_connect (file, "changed", G_CALLBACK (file_changed), self);
-
-        for (monitor_list = self->monitor_list; monitor_list; monitor_list = monitor_list->next)
+        if (g_hash_table_add (self->files, nautilus_file_ref (file)))
         {
-            monitor = monitor_list->data;
-
-            /* Add monitors */
-            nautilus_file_monitor_add (file, monitor, monitor->monitor_attributes);
+            connect_and_monitor_file (file, self);
         }
-
-        file_list = g_list_prepend (file_list, nautilus_file_ref (file));
     }
+}
 
-    self->files = file_list;
+static void
+disconnect_and_unmonitor_all_files (NautilusFavoriteDirectory *self)
+{
+    GHashTableIter iter;
+    NautilusFile *file;
+
+    g_hash_table_iter_init (&iter, self->files);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
+    {
+        disconnect_and_unmonitor_file (file, self);
+    }
 }
 
 static void
@@ -438,8 +440,8 @@ real_force_reload (NautilusDirectory *directory)
     NautilusFavoriteDirectory *self = NAUTILUS_STARRED_DIRECTORY (directory);
 
     /* Unset current file list */
-    g_list_foreach (self->files, (GFunc) disconnect_and_unmonitor_file, self);
-    g_clear_list (&self->files, g_object_unref);
+    disconnect_and_unmonitor_all_files (self);
+    g_hash_table_remove_all (self->files);
 
     /* Set a fresh file list  */
     nautilus_starred_directory_set_files (self);
@@ -456,7 +458,7 @@ nautilus_starred_directory_finalize (GObject *object)
                                           on_starred_files_changed,
                                           self);
 
-    nautilus_file_list_free (self->files);
+    g_hash_table_destroy (self->files);
 
     G_OBJECT_CLASS (nautilus_starred_directory_parent_class)->finalize (object);
 }
@@ -470,7 +472,7 @@ nautilus_starred_directory_dispose (GObject *object)
     starred = NAUTILUS_STARRED_DIRECTORY (object);
 
     /* Remove file connections */
-    g_list_foreach (starred->files, (GFunc) disconnect_and_unmonitor_file, starred);
+    disconnect_and_unmonitor_all_files (starred);
 
     /* Remove search monitors */
     if (starred->monitor_list)
@@ -524,6 +526,9 @@ nautilus_starred_directory_new (void)
 static void
 nautilus_starred_directory_init (NautilusFavoriteDirectory *self)
 {
+    self->files = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                         (GDestroyNotify) nautilus_file_unref, NULL);
+
     g_signal_connect (nautilus_tag_manager_get (),
                       "starred-changed",
                       (GCallback) on_starred_files_changed,
@@ -19,6 +19,7 @@
 #define G_LOG_DOMAIN "nautilus-tag-manager"
 
 #include "nautilus-tag-manager.h"
+#include "nautilus-directory-notify.h"
 #include "nautilus-file.h"
 #include "nautilus-file-undo-operations.h"
 #include "nautilus-file-undo-manager.h"
@@ -40,7 +41,11 @@ struct _NautilusTagManager
     TrackerSparqlStatement *query_starred_files;
     TrackerSparqlStatement *query_file_is_starred;
 
+    /* The starred URIs, each mapped to its iter in starred_file_uris_sorted.
+     * Keeping them sorted too puts all the URIs below a folder next to each
+     * other, so the ones affected by a move are found with a binary search. */
     GHashTable *starred_file_uris;
+    GSequence *starred_file_uris_sorted;
     GFile *home;
 
     GList *pending_changed_files;
@@ -88,6 +93,51 @@ static guint signals[LAST_SIGNAL];
 /* Limit to 10MB output from Tracker -- surely, nobody has over a million starred files. */
 #define TRACKER2_MAX_IMPORT_BYTES 10 * 1024 * 1024
 
+static int
+compare_uris (gconstpointer a,
+              gconstpointer b,
+              gpointer      user_data)
+{
+    return g_strcmp0 (a, b);
+}
+
+static gboolean
+starred_uris_add (NautilusTagManager *self,
+                  const gchar        *uri)
+{
+    gchar *key;
+    GSequenceIter *iter;
+
+    if (g_hash_table_contains (self->starred_file_uris, uri))
+    {
+        return FALSE;
+    }
+
+    key = g_strdup (uri);
+    iter = g_sequence_insert_sorted (self->starred_file_uris_sorted, key, compare_uris, NULL);
+    g_hash_table_insert (self->starred_file_uris, key, iter);
+
+    return TRUE;
+}
+
+static gboolean
+starred_uris_remove (NautilusTagManager *self,
+                     const gchar        *uri)
+{
+    GSequenceIter *iter;
+
+    iter = g_hash_table_lookup (self->starred_file_uris, uri);
+    if (iter == NULL)
+    {
+        return FALSE;
+    }
+
+    g_sequence_remove (iter);
+    g_hash_table_remove (self->starred_file_uris, uri);
+
+    return TRUE;
+}
+
 static gchar *
 tracker2_migration_stamp (void)
 {
@@ -242,7 +292,7 @@ on_get_starred_files_cursor_callback (GObject      *object,
 
     url = tracker_sparql_cursor_get_string (cursor, 0, NULL);
 
-    g_hash_table_add (self->starred_file_uris, g_strdup (url));
+    starred_uris_add (self, url);
 
     file = nautilus_file_get_by_uri (url);
 
@@ -488,7 +538,7 @@ on_tracker_notifier_events (TrackerNotifier *notifier,
         starred = tracker_sparql_cursor_get_boolean (cursor, 0);
         if (starred)
         {
-            gboolean inserted = g_hash_table_add (self->starred_file_uris, g_strdup (file_url));
+            gboolean inserted = starred_uris_add (self, file_url);
 
             if (inserted)
             {
@@ -498,7 +548,7 @@ on_tracker_notifier_events (TrackerNotifier *notifier,
         }
         else
         {
-            gboolean removed = g_hash_table_remove (self->starred_file_uris, file_url);
+            gboolean removed = starred_uris_remove (self, file_url);
 
             if (removed)
             {
@@ -542,6 +592,7 @@ nautilus_tag_manager_finalize (GObject *object)
     g_clear_object (&self->query_starred_files);
     g_clear_pointer (&self->pending_changed_files, nautilus_file_list_free);
 
+    g_sequence_free (self->starred_file_uris_sorted);
     g_hash_table_destroy (self->starred_file_uris);
     g_clear_object (&self->home);
 
@@ -680,8 +731,10 @@ nautilus_tag_manager_init (NautilusTagManager *self)
     self->starred_file_uris = g_hash_table_new_full (g_str_hash,
                                                      g_str_equal,
                                                      (GDestroyNotify) g_free,
-                                                     /* values are keys */
+                                                     /* values are iters */
                                                      NULL);
+    /* The strings are owned by the hash table. */
+    self->starred_file_uris_sorted = g_sequence_new (NULL);
     self->home = g_file_new_for_path (g_get_home_dir ());
 
     if (make_dummy_instance)
@@ -736,25 +789,176 @@ update_moved_uris_callback (GObject      *object,
     }
 }
 
+typedef struct
+{
+    const gchar *old_uri;     /* Owned by starred_file_uris */
+    gchar *current_uri;
+} PendingRename;
+
+/* The starred URIs moved by the moves of a batch processed so far, by the
+ * URI they had before the batch and, sorted, by the one they have now. */
+typedef struct
+{
+    GHashTable *by_old_uri;     /* old URI -> PendingRename */
+    GSequence *by_current_uri;     /* PendingRename */
+} PendingRenames;
+
+static void
+pending_rename_free (PendingRename *rename)
+{
+    g_free (rename->current_uri);
+    g_free (rename);
+}
+
+static int
+compare_renames (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+    const PendingRename *rename_a = a;
+    const PendingRename *rename_b = b;
+
+    return strcmp (rename_a->current_uri, rename_b->current_uri);
+}
+
+static void
+pending_renames_add (PendingRenames *renames,
+                     const gchar    *old_uri,
+                     gchar          *current_uri)
+{
+    PendingRename *rename = g_new0 (PendingRename, 1);
+
+    rename->old_uri = old_uri;
+    rename->current_uri = current_uri;
+    g_hash_table_insert (renames->by_old_uri, (gpointer) old_uri, rename);
+    g_sequence_insert_sorted (renames->by_current_uri, rename, compare_renames, NULL);
+}
+
+/* Takes the pending renames whose current URI is @src_uri or starts with
+ * @prefix out of the sorted sequence, as they are going to sort elsewhere. */
+static GList *
+take_renames_below (PendingRenames *renames,
+                    const gchar    *src_uri,
+                    const gchar    *prefix)
+{
+    PendingRename key = { 0 };
+    GSequenceIter *iter;
+    GList *taken = NULL;
+
+    /* The ones equal to @src_uri are right before where it would go. */
+    key.current_uri = (gchar *) src_uri;
+    iter = g_sequence_search (renames->by_current_uri, &key, compare_renames, NULL);
+    while (!g_sequence_iter_is_begin (iter))
+    {
+        GSequenceIter *prev = g_sequence_iter_prev (iter);
+        PendingRename *rename = g_sequence_get (prev);
+
+        if (!g_str_equal (rename->current_uri, src_uri))
+        {
+            break;
+        }
+
+        taken = g_list_prepend (taken, rename);
+        g_sequence_remove (prev);
+    }
+
+    /* The descendants all sort right after the prefix. */
+    key.current_uri = (gchar *) prefix;
+    iter = g_sequence_search (renames->by_current_uri, &key, compare_renames, NULL);
+    while (!g_sequence_iter_is_end (iter))
+    {
+        PendingRename *rename = g_sequence_get (iter);
+        GSequenceIter *next;
+
+        if (!g_str_has_prefix (rename->current_uri, prefix))
+        {
+            break;
+        }
+
+        next = g_sequence_iter_next (iter);
+        taken = g_list_prepend (taken, rename);
+        g_sequence_remove (iter);
+        iter = next;
+    }
+
+    return taken;
+}
+
+/* Adds the starred URIs that @src_uri or its descendants had before any of
+ * the moves processed so far, as well as the ones they got since, with
+ * their new location. */
+static void
+collect_moved_uris (NautilusTagManager *self,
+                    const gchar        *src_uri,
+                    const gchar        *dest_uri,
+                    PendingRenames     *renames)
+{
+    g_autofree gchar *prefix = NULL;
+    gsize src_len;
+    GSequenceIter *iter;
+    GList *taken;
+
+    src_len = strlen (src_uri);
+    prefix = g_str_has_suffix (src_uri, "/") ? g_strdup (src_uri) : g_strconcat (src_uri, "/", NULL);
+
+    /* Earlier moves in the same batch first, so chained moves are followed. */
+    taken = take_renames_below (renames, src_uri, prefix);
+    for (GList *l = taken; l != NULL; l = l->next)
+    {
+        PendingRename *rename = l->data;
+        gchar *current_uri = g_strconcat (dest_uri, rename->current_uri + src_len, NULL);
+
+        g_free (rename->current_uri);
+        rename->current_uri = current_uri;
+        g_sequence_insert_sorted (renames->by_current_uri, rename, compare_renames, NULL);
+    }
+    g_list_free (taken);
+
+    iter = g_hash_table_lookup (self->starred_file_uris, src_uri);
+    if (iter != NULL && !g_hash_table_contains (renames->by_old_uri, src_uri))
+    {
+        /* The moved file/folder is starred */
+        pending_renames_add (renames, g_sequence_get (iter), g_strdup (dest_uri));
+    }
+
+    /* The starred files/folders that are descendants of the moved/renamed
+     * directory all sort right after the prefix. */
+    for (iter = g_sequence_search (self->starred_file_uris_sorted, prefix, compare_uris, NULL);
+         !g_sequence_iter_is_end (iter);
+         iter = g_sequence_iter_next (iter))
+    {
+        gchar *starred_uri = g_sequence_get (iter);
+
+        if (!g_str_has_prefix (starred_uri, prefix))
+        {
+            break;
+        }
+
+        if (!g_hash_table_contains (renames->by_old_uri, starred_uri))
+        {
+            pending_renames_add (renames, starred_uri,
+                                 g_strconcat (dest_uri, starred_uri + src_len, NULL));
+        }
+    }
+}
+
 /**
- * nautilus_tag_manager_update_moved_uris:
+ * nautilus_tag_manager_update_moved_uris_list:
  * @self: The tag manager singleton
- * @src: The original location as a #GFile
- * @dest: The new location as a #GFile
+ * @moves: (element-type GFilePair): The moves, in the order they happened
  *
- * Checks whether the rename/move operation (@src to @dest) has modified
- * the URIs of any starred files, and updates the database accordingly.
+ * Checks whether the rename/move operations have modified the URIs of any
+ * starred files, and updates the database accordingly, in a single update.
  */
 void
-nautilus_tag_manager_update_moved_uris (NautilusTagManager *self,
-                                        GFile              *src,
-                                        GFile              *dest)
+nautilus_tag_manager_update_moved_uris_list (NautilusTagManager *self,
+                                             GList              *moves)
 {
-    GHashTableIter starred_iter;
-    gchar *starred_uri;
-    g_autoptr (GPtrArray) old_uris = NULL;
-    g_autoptr (GPtrArray) new_uris = NULL;
+    PendingRenames renames;
     g_autoptr (GString) query = NULL;
+    GHashTableIter iter;
+    gpointer old_uri;
+    PendingRename *rename;
 
     if (!self->database_ok)
     {
@@ -762,70 +966,61 @@ nautilus_tag_manager_update_moved_uris (NautilusTagManager *self,
         return;
     }
 
-    old_uris = g_ptr_array_new ();
-    new_uris = g_ptr_array_new_with_free_func (g_free);
-
-    g_hash_table_iter_init (&starred_iter, self->starred_file_uris);
-    while (g_hash_table_iter_next (&starred_iter, (gpointer *) &starred_uri, NULL))
+    if (g_hash_table_size (self->starred_file_uris) == 0)
     {
-        g_autoptr (GFile) starred_location = NULL;
-        g_autofree gchar *relative_path = NULL;
-
-        starred_location = g_file_new_for_uri (starred_uri);
+        return;
+    }
 
-        if (g_file_equal (starred_location, src))
-        {
-            /* The moved file/folder is starred */
-            g_ptr_array_add (old_uris, starred_uri);
-            g_ptr_array_add (new_uris, g_file_get_uri (dest));
-            continue;
-        }
+    renames.by_old_uri = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                (GDestroyNotify) pending_rename_free);
+    renames.by_current_uri = g_sequence_new (NULL);
 
-        relative_path = g_file_get_relative_path (src, starred_location);
-        if (relative_path != NULL)
-        {
-            /* The starred file/folder is descendant of the moved/renamed directory */
-            g_autoptr (GFile) new_location = NULL;
-
-            new_location = g_file_resolve_relative_path (dest, relative_path);
+    for (GList *l = moves; l != NULL; l = l->next)
+    {
+        GFilePair *pair = l->data;
+        g_autofree gchar *src_uri = g_file_get_uri (pair->from);
+        g_autofree gchar *dest_uri = g_file_get_uri (pair->to);
 
-            g_ptr_array_add (old_uris, starred_uri);
-            g_ptr_array_add (new_uris, g_file_get_uri (new_location));
-        }
+        collect_moved_uris (self, src_uri, dest_uri, &renames);
     }
 
-    if (new_uris->len == 0)
+    g_sequence_free (renames.by_current_uri);
+
+    if (g_hash_table_size (renames.by_old_uri) == 0)
     {
-        /* No starred files are affected by this move/rename */
+        /* No starred files are affected by these moves/renames */
+        g_hash_table_destroy (renames.by_old_uri);
         return;
     }
 
-    g_debug ("Updating moved URI for %i starred files", new_uris->len);
+    g_debug ("Updating moved URI for %i starred files", g_hash_table_size (renames.by_old_uri));
 
     query = g_string_new ("DELETE DATA {");
 
-    for (guint i = 0; i < old_uris->len; i++)
+    g_hash_table_iter_init (&iter, renames.by_old_uri);
+    while (g_hash_table_iter_next (&iter, &old_uri, NULL))
     {
-        gchar *old_uri = g_ptr_array_index (old_uris, i);
         g_string_append_printf (query,
                                 "    <%s> a nautilus:File ; "
                                 "        nautilus:starred true . ",
-                                old_uri);
+                                (gchar *) old_uri);
     }
 
     g_string_append (query, "} ; INSERT DATA {");
 
-    for (guint i = 0; i < new_uris->len; i++)
+    g_hash_table_iter_init (&iter, renames.by_old_uri);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &rename))
     {
-        gchar *new_uri = g_ptr_array_index (new_uris, i);
         g_string_append_printf (query,
                                 "    <%s> a nautilus:File ; "
                                 "        nautilus:starred true . ",
-                                new_uri);
+                                rename->current_uri);
     }
 
     g_string_append (query, "}");
 
+    g_hash_table_destroy (renames.by_old_uri);
+
     tracker_sparql_connection_update_async (self->db,
                                             query->str,
                                             self->cancellable,
@@ -833,6 +1028,26 @@ nautilus_tag_manager_update_moved_uris (NautilusTagManager *self,
                                             NULL);
 }
 
+/**
+ * nautilus_tag_manager_update_moved_uris:
+ * @self: The tag manager singleton
+ * @src: The original location as a #GFile
+ * @dest: The new location as a #GFile
+ *
+ * Checks whether the rename/move operation (@src to @dest) has modified
+ * the URIs of any starred files, and updates the database accordingly.
+ */
+void
+nautilus_tag_manager_update_moved_uris (NautilusTagManager *self,
+                                        GFile              *src,
+                                        GFile              *dest)
+{
+    GFilePair pair = { src, dest };
+    GList moves = { &pair, NULL, NULL };
+
+    nautilus_tag_manager_update_moved_uris_list (self, &moves);
+}
+
 static void
 process_tracker2_data_cb (GObject      *source_object,
                           GAsyncResult *res,
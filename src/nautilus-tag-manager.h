@@ -55,6 +55,8 @@ gboolean            nautilus_tag_manager_can_star_contents (NautilusTagManager *
 void                nautilus_tag_manager_update_moved_uris  (NautilusTagManager *tag_manager,
                                                              GFile              *src,
                                                              GFile              *dest);
+void                nautilus_tag_manager_update_moved_uris_list (NautilusTagManager *tag_manager,
+                                                                 GList              *moves);
 
 void                nautilus_tag_manager_maybe_migrate_tracker2_data (NautilusTagManager *self);
 
@@ -48,9 +48,19 @@
 #define THUMBNAIL_CREATION_DELAY_SECS 3
 
 /* This specific number of processors seems to work ok even on relatively slow
- * computers. However, this might not be the effective number of processors
- * used simultaneously because of main thread load and I/O bounds. */
-#define MAX_THUMBNAILING_THREADS ceil (g_get_num_processors () / 2);
+ * computers, so it is where the number of threads starts. It is then adjusted
+ * to whatever gets the most thumbnails done, see adjust_max_threads(). */
+#define INITIAL_THUMBNAILING_THREADS ceil (g_get_num_processors () / 2);
+
+/* How long throughput is measured for before adjusting the thread count */
+#define ADJUST_INTERVAL_USEC (2 * G_USEC_PER_SEC)
+/* Throughput differences below this are taken as noise */
+#define THROUGHPUT_TOLERANCE 0.05
+/* Above this share of CPU time spent waiting for I/O, more threads only add
+ * to the wait. */
+#define MAX_IO_WAIT_FRACTION 0.3
+/* Weight of the newest sample in the per-MIME-type latency average */
+#define LATENCY_SMOOTHING 0.2
 
 static gboolean thumbnail_starter_cb (gpointer data);
 
@@ -63,6 +73,14 @@ typedef struct
     time_t original_file_mtime;
     time_t updated_file_mtime;
 
+    /* Queue position, see compare_thumbnail_priority() */
+    gboolean visible;
+    guint64 request_stamp;
+    guint64 visible_stamp;
+    GSequenceIter *iter;
+
+    gint64 start_time;
+
     GCancellable *cancellable;
 } NautilusThumbnailInfo;
 
@@ -74,13 +92,16 @@ typedef struct
  *  idle handler is currently registered. */
 static guint thumbnail_thread_starter_id = 0;
 
-/* The list of NautilusThumbnailInfo structs containing information about the
- *  thumbnails we are making. */
-static GQueue thumbnails_to_make = G_QUEUE_INIT;
+/* The NautilusThumbnailInfo structs containing information about the
+ *  thumbnails we are making, in the order they are made. */
+static GSequence *thumbnails_to_make = NULL;
 
 /* Quickly check if uri is in thumbnails_to_make list */
 static GHashTable *thumbnails_to_make_hash = NULL;
 
+/* Source of the stamps keeping track of request recency. */
+static guint64 last_stamp = 0;
+
 /* The icons being currently thumbnailed. */
 static GHashTable *currently_thumbnailing_hash = NULL;
 
@@ -90,6 +111,22 @@ static guint running_threads = 0;
 /* The maximum number of threads allowed. */
 static guint max_threads = 0;
 
+/* Average generation time in seconds, per MIME type and overall. */
+static GHashTable *latency_per_mime_type = NULL;
+static gdouble average_latency = 0.0;
+
+/* Throughput measurement of the current and the previous interval. Each
+ * thumbnail made counts as the average latency of its MIME type relative to
+ * the overall one, so that intervals compare fairly when the mix of file
+ * types changes. */
+static gint64 interval_start_time = 0;
+static gdouble interval_work = 0.0;
+static gboolean interval_saturated = TRUE;
+static gdouble last_throughput = 0.0;
+static gint thread_step = 1;
+static guint64 last_cpu_total = 0;
+static guint64 last_cpu_iowait = 0;
+
 static gboolean
 get_file_mtime (const char *file_uri,
                 time_t     *mtime)
@@ -127,6 +164,47 @@ free_thumbnail_info (NautilusThumbnailInfo *info)
     g_free (info);
 }
 
+/* Visible files come first, those prioritized last at the front since that
+ * is how views order them. All the others are made in the order they were
+ * requested. */
+static gint
+compare_thumbnail_priority (gconstpointer a,
+                            gconstpointer b,
+                            gpointer      user_data)
+{
+    const NautilusThumbnailInfo *info_a = a;
+    const NautilusThumbnailInfo *info_b = b;
+
+    if (info_a->visible != info_b->visible)
+    {
+        return info_a->visible ? -1 : 1;
+    }
+
+    if (info_a->visible)
+    {
+        return (info_a->visible_stamp < info_b->visible_stamp) -
+               (info_a->visible_stamp > info_b->visible_stamp);
+    }
+
+    return (info_a->request_stamp > info_b->request_stamp) -
+           (info_a->request_stamp < info_b->request_stamp);
+}
+
+static void
+queue_thumbnail (NautilusThumbnailInfo *info)
+{
+    info->iter = g_sequence_insert_sorted (thumbnails_to_make, info,
+                                           compare_thumbnail_priority, NULL);
+    g_hash_table_insert (thumbnails_to_make_hash, info->image_uri, info->iter);
+}
+
+static void
+unqueue_thumbnail (NautilusThumbnailInfo *info)
+{
+    g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
+    g_sequence_remove (g_steal_pointer (&info->iter));
+}
+
 static GnomeDesktopThumbnailFactory *
 get_thumbnail_factory (void)
 {
@@ -168,7 +246,7 @@ get_thumbnail_factory (void)
 void
 nautilus_thumbnail_remove_from_queue (const char *file_uri)
 {
-    GList *node;
+    GSequenceIter *iter;
     NautilusThumbnailInfo *info;
 
     if (G_UNLIKELY (thumbnails_to_make_hash == NULL))
@@ -176,12 +254,12 @@ nautilus_thumbnail_remove_from_queue (const char *file_uri)
         return;
     }
 
-    node = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
-    if (node != NULL)
+    iter = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
+    if (iter != NULL)
     {
-        g_hash_table_remove (thumbnails_to_make_hash, file_uri);
-        free_thumbnail_info (node->data);
-        g_queue_delete_link (&thumbnails_to_make, node);
+        info = g_sequence_get (iter);
+        unqueue_thumbnail (info);
+        free_thumbnail_info (info);
         return;
     }
 
@@ -195,19 +273,46 @@ nautilus_thumbnail_remove_from_queue (const char *file_uri)
 void
 nautilus_thumbnail_prioritize (const char *file_uri)
 {
-    GList *node;
+    GSequenceIter *iter;
+    NautilusThumbnailInfo *info;
+
+    if (G_UNLIKELY (thumbnails_to_make_hash == NULL))
+    {
+        return;
+    }
+
+    iter = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
+
+    if (iter != NULL)
+    {
+        info = g_sequence_get (iter);
+        info->visible = TRUE;
+        info->visible_stamp = ++last_stamp;
+        g_sequence_sort_changed (iter, compare_thumbnail_priority, NULL);
+    }
+}
+
+void
+nautilus_thumbnail_deprioritize (const char *file_uri)
+{
+    GSequenceIter *iter;
+    NautilusThumbnailInfo *info;
 
     if (G_UNLIKELY (thumbnails_to_make_hash == NULL))
     {
         return;
     }
 
-    node = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
+    iter = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
 
-    if (node != NULL)
+    if (iter != NULL)
     {
-        g_queue_unlink (&thumbnails_to_make, node);
-        g_queue_push_head_link (&thumbnails_to_make, node);
+        info = g_sequence_get (iter);
+        if (info->visible)
+        {
+            info->visible = FALSE;
+            g_sequence_sort_changed (iter, compare_thumbnail_priority, NULL);
+        }
     }
 }
 
@@ -299,7 +404,7 @@ nautilus_create_thumbnail (NautilusFile *file)
     time_t file_mtime = 0;
     NautilusThumbnailInfo *info;
     NautilusThumbnailInfo *existing_info;
-    GList *existing, *node;
+    GSequenceIter *existing;
 
     nautilus_file_set_is_thumbnailing (file, TRUE);
 
@@ -326,6 +431,7 @@ nautilus_create_thumbnail (NautilusFile *file)
 
     if (G_UNLIKELY (thumbnails_to_make_hash == NULL))
     {
+        thumbnails_to_make = g_sequence_new (NULL);
         thumbnails_to_make_hash = g_hash_table_new (g_str_hash,
                                                     g_str_equal);
         currently_thumbnailing_hash = g_hash_table_new (g_str_hash,
@@ -342,11 +448,8 @@ nautilus_create_thumbnail (NautilusFile *file)
         /* Add the thumbnail to the list. */
         g_debug ("(Main Thread) Adding thumbnail: %s",
                  info->image_uri);
-        g_queue_push_tail (&thumbnails_to_make, info);
-        node = g_queue_peek_tail_link (&thumbnails_to_make);
-        g_hash_table_insert (thumbnails_to_make_hash,
-                             info->image_uri,
-                             node);
+        info->request_stamp = ++last_stamp;
+        queue_thumbnail (info);
 
         /* If we didn't schedule the thumbnail function to start on idle, do
          *  that now. We don't want to start it until all the other work is
@@ -364,13 +467,149 @@ nautilus_create_thumbnail (NautilusFile *file)
         /* The file in the queue might need a new original mtime */
         if (existing_info == NULL)
         {
-            existing_info = existing->data;
+            existing_info = g_sequence_get (existing);
         }
         existing_info->updated_file_mtime = info->original_file_mtime;
         free_thumbnail_info (info);
     }
 }
 
+static void
+record_thumbnail_latency (NautilusThumbnailInfo *info)
+{
+    const char *mime_type = info->mime_type != NULL ? info->mime_type : "";
+    gdouble latency;
+    gdouble *mime_type_latency;
+
+    latency = (g_get_monotonic_time () - info->start_time) / (gdouble) G_USEC_PER_SEC;
+
+    if (G_UNLIKELY (latency_per_mime_type == NULL))
+    {
+        latency_per_mime_type = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                       g_free, g_free);
+        average_latency = latency;
+    }
+
+    mime_type_latency = g_hash_table_lookup (latency_per_mime_type, mime_type);
+    if (mime_type_latency == NULL)
+    {
+        mime_type_latency = g_new (gdouble, 1);
+        *mime_type_latency = latency;
+        g_hash_table_insert (latency_per_mime_type, g_strdup (mime_type), mime_type_latency);
+    }
+    else
+    {
+        *mime_type_latency += LATENCY_SMOOTHING * (latency - *mime_type_latency);
+    }
+    average_latency += LATENCY_SMOOTHING * (latency - average_latency);
+
+    if (average_latency > 0.0)
+    {
+        interval_work += *mime_type_latency / average_latency;
+    }
+}
+
+static gboolean
+get_cpu_times (guint64 *total,
+               guint64 *iowait)
+{
+    g_autofree gchar *contents = NULL;
+    guint64 times[8] = { 0 };
+
+    /* user nice system idle iowait irq softirq steal */
+    if (!g_file_get_contents ("/proc/stat", &contents, NULL, NULL) ||
+        sscanf (contents, "cpu %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+                " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+                " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+                " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT,
+                &times[0], &times[1], &times[2], &times[3],
+                &times[4], &times[5], &times[6], &times[7]) < 5)
+    {
+        return FALSE;
+    }
+
+    *total = 0;
+    for (guint i = 0; i < G_N_ELEMENTS (times); i++)
+    {
+        *total += times[i];
+    }
+    *iowait = times[4];
+
+    return TRUE;
+}
+
+/* Hill-climbs the number of threads towards the most thumbnails made per
+ * second: it keeps changing in the same direction while that helps, turns
+ * around when it hurts, and goes down when it makes no difference or the
+ * system is waiting on I/O. */
+static void
+adjust_max_threads (void)
+{
+    gint64 now = g_get_monotonic_time ();
+    gdouble io_wait_fraction = 0.0;
+    gdouble throughput;
+    guint64 cpu_total;
+    guint64 cpu_iowait;
+
+    if (interval_start_time == 0)
+    {
+        interval_start_time = now;
+        get_cpu_times (&last_cpu_total, &last_cpu_iowait);
+        return;
+    }
+
+    if (now - interval_start_time < ADJUST_INTERVAL_USEC)
+    {
+        return;
+    }
+
+    if (get_cpu_times (&cpu_total, &cpu_iowait))
+    {
+        if (cpu_total > last_cpu_total)
+        {
+            io_wait_fraction = (gdouble) (cpu_iowait - last_cpu_iowait) /
+                               (cpu_total - last_cpu_total);
+        }
+        last_cpu_total = cpu_total;
+        last_cpu_iowait = cpu_iowait;
+    }
+
+    throughput = interval_work * G_USEC_PER_SEC / (now - interval_start_time);
+
+    /* Only a pool which had more work than threads tells whether it could
+     * use other threads. */
+    if (interval_saturated)
+    {
+        if (io_wait_fraction > MAX_IO_WAIT_FRACTION)
+        {
+            thread_step = -1;
+        }
+        else if (throughput < last_throughput * (1.0 - THROUGHPUT_TOLERANCE))
+        {
+            thread_step = -thread_step;
+        }
+        else if (throughput < last_throughput * (1.0 + THROUGHPUT_TOLERANCE))
+        {
+            thread_step = -1;
+        }
+
+        max_threads = CLAMP ((gint) max_threads + thread_step, 1,
+                             (gint) g_get_num_processors ());
+        last_throughput = throughput;
+
+        g_debug ("(Main Thread) Throughput %.2f, I/O wait %.0f%%, now up to %u threads",
+                 throughput, io_wait_fraction * 100, max_threads);
+    }
+    else
+    {
+        last_throughput = 0.0;
+    }
+
+    interval_start_time = now;
+    interval_work = 0.0;
+    interval_saturated = TRUE;
+}
+
 static void
 thumbnail_finalize (NautilusThumbnailInfo *info)
 {
@@ -389,18 +628,15 @@ thumbnail_finalize (NautilusThumbnailInfo *info)
     }
     else
     {
-        GList *node;
-
         info->original_file_mtime = info->updated_file_mtime;
 
-        g_queue_push_tail (&thumbnails_to_make, info);
-        node = g_queue_peek_tail_link (&thumbnails_to_make);
-        g_hash_table_insert (thumbnails_to_make_hash, info->image_uri, node);
+        queue_thumbnail (info);
     }
 
-    if (g_queue_is_empty (&thumbnails_to_make))
+    if (g_sequence_is_empty (thumbnails_to_make))
     {
         g_debug ("(Thumbnail Async Thread) Exiting");
+        interval_saturated = FALSE;
     }
     else if (thumbnail_thread_starter_id == 0)
     {
@@ -474,6 +710,8 @@ thumbnail_generated_cb (GObject      *source_object,
         return;
     }
 
+    record_thumbnail_latency (info);
+
     file = nautilus_file_get_by_uri (info->image_uri);
 
     if (pixbuf != NULL)
@@ -529,7 +767,7 @@ thumbnail_starter_cb (gpointer data)
     time_t current_time;
     guint backoff_time;
     guint backoff_time_min = THUMBNAIL_CREATION_DELAY_SECS + 1;
-    GList *node;
+    GSequenceIter *iter;
 
     g_debug ("(Main Thread) Creating thumbnails thread");
 
@@ -538,15 +776,19 @@ thumbnail_starter_cb (gpointer data)
 
     if (G_UNLIKELY (max_threads == 0))
     {
-        max_threads = MAX_THUMBNAILING_THREADS
+        max_threads = INITIAL_THUMBNAILING_THREADS
     }
 
-    /* We loop until the queue is empty, or we reach the thread limit. */
-    while (ignored_thumbnails < g_queue_get_length (&thumbnails_to_make) &&
+    adjust_max_threads ();
+
+    /* We go through the queue in order until its end, or we reach the
+     *  thread limit. */
+    iter = g_sequence_get_begin_iter (thumbnails_to_make);
+    while (!g_sequence_iter_is_end (iter) &&
            running_threads <= max_threads)
     {
-        info = g_queue_pop_head (&thumbnails_to_make);
-        g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
+        info = g_sequence_get (iter);
+        iter = g_sequence_iter_next (iter);
 
         current_orig_mtime = info->updated_file_mtime;
         time (&current_time);
@@ -563,13 +805,12 @@ thumbnail_starter_cb (gpointer data)
             backoff_time = THUMBNAIL_CREATION_DELAY_SECS - (current_time - current_orig_mtime);
             backoff_time_min = MIN (backoff_time, backoff_time_min);
 
-            g_queue_push_tail (&thumbnails_to_make, info);
-            node = g_queue_peek_tail_link (&thumbnails_to_make);
-            g_hash_table_insert (thumbnails_to_make_hash, info->image_uri, node);
             ignored_thumbnails += 1;
             continue;
         }
 
+        unqueue_thumbnail (info);
+
         /* Create the thumbnail. */
         g_debug ("(Thumbnail Thread) Creating thumbnail: %s",
                  info->image_uri);
@@ -577,6 +818,7 @@ thumbnail_starter_cb (gpointer data)
         running_threads += 1;
         g_hash_table_insert (currently_thumbnailing_hash, info->image_uri, info);
 
+        info->start_time = g_get_monotonic_time ();
         gnome_desktop_thumbnail_factory_generate_thumbnail_async (thumbnail_factory,
                                                                   info->image_uri,
                                                                   info->mime_type,
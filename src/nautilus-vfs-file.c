@@ -93,6 +93,35 @@ vfs_file_check_if_ready (NautilusFile           *file,
                                                        file_attributes);
 }
 
+/* Metadata writes are queued, coalesced per file and written out per
+ * directory on the next main loop iteration. The files are updated as
+ * soon as the write is queued, so they are only queried again if the
+ * write fails. Only one write per directory is in flight at a time, so
+ * that an older batch can't land after a newer one; writes queued in the
+ * meantime wait for it to finish. */
+static GHashTable *pending_metadata_writes = NULL; /* GFile *directory -> GHashTable (NautilusFile * -> GFileInfo *) */
+static GHashTable *metadata_writes_in_flight = NULL; /* GFile *directory */
+static guint flush_metadata_writes_id = 0;
+
+typedef struct
+{
+    NautilusFile *file;
+    GFile *location;
+    GFileInfo *info;
+    gboolean failed;
+} MetadataWrite;
+
+static void
+metadata_write_free (gpointer data)
+{
+    MetadataWrite *write = data;
+
+    nautilus_file_unref (write->file);
+    g_object_unref (write->location);
+    g_object_unref (write->info);
+    g_free (write);
+}
+
 static void
 set_metadata_get_info_callback (GObject      *source_object,
                                 GAsyncResult *res,
@@ -122,35 +151,211 @@ set_metadata_get_info_callback (GObject      *source_object,
 }
 
 static void
-set_metadata_callback (GObject      *source_object,
-                       GAsyncResult *result,
-                       gpointer      callback_data)
+write_metadata_thread_func (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+    GPtrArray *writes = task_data;
+
+    for (guint i = 0; i < writes->len; i++)
+    {
+        MetadataWrite *write = g_ptr_array_index (writes, i);
+
+        write->failed = !g_file_set_attributes_from_info (write->location,
+                                                          write->info,
+                                                          G_FILE_QUERY_INFO_NONE,
+                                                          NULL, NULL);
+    }
+}
+
+static void write_directory_metadata (GFile      *directory,
+                                      GHashTable *directory_writes);
+
+static void
+write_metadata_callback (GObject      *source_object,
+                         GAsyncResult *result,
+                         gpointer      callback_data)
 {
+    g_autoptr (GFile) directory = callback_data;
+    GPtrArray *writes = g_task_get_task_data (G_TASK (result));
+    GFile *waiting_directory;
+    GHashTable *waiting_writes;
+
+    for (guint i = 0; i < writes->len; i++)
+    {
+        MetadataWrite *write = g_ptr_array_index (writes, i);
+
+        if (write->failed)
+        {
+            /* The file was updated optimistically, so get back what
+             * it actually has. */
+            g_file_query_info_async (write->location,
+                                     NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
+                                     0,
+                                     G_PRIORITY_DEFAULT,
+                                     NULL,
+                                     set_metadata_get_info_callback,
+                                     nautilus_file_ref (write->file));
+        }
+    }
+
+    g_hash_table_remove (metadata_writes_in_flight, directory);
+
+    if (pending_metadata_writes != NULL &&
+        g_hash_table_steal_extended (pending_metadata_writes, directory,
+                                     (gpointer *) &waiting_directory,
+                                     (gpointer *) &waiting_writes))
+    {
+        write_directory_metadata (waiting_directory, waiting_writes);
+    }
+}
+
+/* Takes ownership of @directory and @directory_writes. */
+static void
+write_directory_metadata (GFile      *directory,
+                          GHashTable *directory_writes)
+{
+    g_autoptr (GTask) task = NULL;
+    GPtrArray *writes;
+    GHashTableIter iter;
     NautilusFile *file;
-    GError *error;
-    gboolean res;
+    GFileInfo *info;
 
-    file = callback_data;
+    writes = g_ptr_array_new_full (g_hash_table_size (directory_writes),
+                                   metadata_write_free);
 
-    error = NULL;
-    res = g_file_set_attributes_finish (G_FILE (source_object),
-                                        result,
-                                        NULL,
-                                        &error);
+    g_hash_table_iter_init (&iter, directory_writes);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, (gpointer *) &info))
+    {
+        MetadataWrite *write = g_new0 (MetadataWrite, 1);
+
+        write->file = nautilus_file_ref (file);
+        write->location = nautilus_file_get_location (file);
+        write->info = g_object_ref (info);
+        g_ptr_array_add (writes, write);
+    }
+    g_hash_table_unref (directory_writes);
 
-    if (res)
+    if (metadata_writes_in_flight == NULL)
     {
-        g_file_query_info_async (G_FILE (source_object),
-                                 NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
-                                 0,
-                                 G_PRIORITY_DEFAULT,
-                                 NULL,
-                                 set_metadata_get_info_callback, file);
+        metadata_writes_in_flight = g_hash_table_new_full (g_file_hash,
+                                                           (GEqualFunc) g_file_equal,
+                                                           g_object_unref,
+                                                           NULL);
+    }
+    g_hash_table_add (metadata_writes_in_flight, g_object_ref (directory));
+
+    task = g_task_new (NULL, NULL, write_metadata_callback, directory);
+    g_task_set_task_data (task, writes, (GDestroyNotify) g_ptr_array_unref);
+    g_task_run_in_thread (task, write_metadata_thread_func);
+}
+
+static gboolean
+flush_metadata_writes (gpointer user_data)
+{
+    GHashTableIter iter;
+    GFile *directory;
+    GHashTable *directory_writes;
+
+    flush_metadata_writes_id = 0;
+
+    g_hash_table_iter_init (&iter, pending_metadata_writes);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &directory, (gpointer *) &directory_writes))
+    {
+        if (metadata_writes_in_flight != NULL &&
+            g_hash_table_contains (metadata_writes_in_flight, directory))
+        {
+            /* Written once the write in flight is done */
+            continue;
+        }
+
+        g_hash_table_iter_steal (&iter);
+        write_directory_metadata (directory, directory_writes);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+copy_attributes (GFileInfo *source,
+                 GFileInfo *destination)
+{
+    g_auto (GStrv) attributes = g_file_info_list_attributes (source, NULL);
+
+    for (guint i = 0; attributes[i] != NULL; i++)
+    {
+        GFileAttributeType type;
+        gpointer value;
+
+        if (g_file_info_get_attribute_data (source, attributes[i], &type, &value, NULL))
+        {
+            g_file_info_set_attribute (destination, attributes[i], type, value);
+        }
+    }
+}
+
+static void
+queue_metadata_write (NautilusFile *file,
+                      GFileInfo    *info)
+{
+    g_autoptr (GFileInfo) new_metadata = g_file_info_new ();
+    g_autoptr (GFile) location = NULL;
+    g_autoptr (GFile) parent = NULL;
+    GHashTable *directory_writes;
+    GFileInfo *queued_info;
+
+    copy_attributes (info, new_metadata);
+    nautilus_file_add_metadata_to_info (file, new_metadata);
+    if (nautilus_file_update_metadata_from_info (file, new_metadata))
+    {
+        nautilus_file_changed (file);
+    }
+
+    if (g_strcmp0 (g_getenv ("RUNNING_TESTS"), "TRUE") == 0)
+    {
+        return;
+    }
+
+    location = nautilus_file_get_location (file);
+    parent = g_file_get_parent (location);
+    if (parent == NULL)
+    {
+        parent = g_object_ref (location);
+    }
+
+    if (pending_metadata_writes == NULL)
+    {
+        pending_metadata_writes = g_hash_table_new_full (g_file_hash,
+                                                         (GEqualFunc) g_file_equal,
+                                                         g_object_unref,
+                                                         (GDestroyNotify) g_hash_table_unref);
+    }
+
+    directory_writes = g_hash_table_lookup (pending_metadata_writes, parent);
+    if (directory_writes == NULL)
+    {
+        directory_writes = g_hash_table_new_full (NULL, NULL,
+                                                  (GDestroyNotify) nautilus_file_unref,
+                                                  g_object_unref);
+        g_hash_table_insert (pending_metadata_writes, g_steal_pointer (&parent), directory_writes);
+    }
+
+    queued_info = g_hash_table_lookup (directory_writes, file);
+    if (queued_info != NULL)
+    {
+        copy_attributes (info, queued_info);
     }
     else
     {
-        nautilus_file_unref (file);
-        g_error_free (error);
+        g_hash_table_insert (directory_writes, nautilus_file_ref (file), g_file_info_dup (info));
+    }
+
+    if (flush_metadata_writes_id == 0)
+    {
+        flush_metadata_writes_id = g_idle_add_full (G_PRIORITY_DEFAULT,
+                                                    flush_metadata_writes,
+                                                    NULL, NULL);
     }
 }
 
@@ -174,20 +379,7 @@ vfs_file_set_metadata (NautilusFile *file,
                                    NULL);
     }
 
-    if (g_strcmp0 (g_getenv ("RUNNING_TESTS"), "TRUE") == 0)
-    {
-        nautilus_file_update_metadata_from_info (file, info);
-        return;
-    }
-
-    g_autoptr (GFile) location = nautilus_file_get_location (file);
-    g_file_set_attributes_async (location,
-                                 info,
-                                 0,
-                                 G_PRIORITY_DEFAULT,
-                                 NULL,
-                                 set_metadata_callback,
-                                 nautilus_file_ref (file));
+    queue_metadata_write (file, info);
 }
 
 static void
@@ -207,20 +399,7 @@ vfs_file_set_metadata_as_list (NautilusFile  *file,
         g_file_info_set_attribute_stringv (info, gio_key, value);
     }
 
-    if (g_strcmp0 (g_getenv ("RUNNING_TESTS"), "TRUE") == 0)
-    {
-        nautilus_file_update_metadata_from_info (file, info);
-        return;
-    }
-
-    g_autoptr (GFile) location = nautilus_file_get_location (file);
-    g_file_set_attributes_async (location,
-                                 info,
-                                 0,
-                                 G_PRIORITY_DEFAULT,
-                                 NULL,
-                                 set_metadata_callback,
-                                 nautilus_file_ref (file));
+    queue_metadata_write (file, info);
 }
 
 static GDateTime *
@@ -3,6 +3,46 @@
 #include "nautilus-directory.h"
 #include "nautilus-global-preferences.h"
 
+enum
+{
+    SUMMARY_ENTRY_HOME = 1 << 0,
+    SUMMARY_ENTRY_IN_TRASH = 1 << 1,
+    SUMMARY_ENTRY_LOCAL = 1 << 2,
+    SUMMARY_ENTRY_INFO_READY = 1 << 3,
+    SUMMARY_ENTRY_CAN_DELETE = 1 << 4,
+    SUMMARY_ENTRY_CAN_TRASH = 1 << 5,
+    SUMMARY_ENTRY_CAN_RENAME = 1 << 6,
+    SUMMARY_ENTRY_DIRECTORY = 1 << 7,
+    SUMMARY_ENTRY_ARCHIVE = 1 << 8,
+    SUMMARY_ENTRY_LAUNCHABLE = 1 << 9,
+    SUMMARY_ENTRY_CAN_MOUNT = 1 << 10,
+    SUMMARY_ENTRY_CAN_UNMOUNT = 1 << 11,
+    SUMMARY_ENTRY_CAN_EJECT = 1 << 12,
+};
+
+/* What a selected item contributed to the selection summary, so that it can
+ * be taken out again without looking at the (possibly changed) file. */
+typedef struct
+{
+    const char *mime_type;
+    guint flags;
+} SummaryEntry;
+
+/* Positions of the items in one of the directory stores, so that removing
+ * items doesn't need a linear search for each. @items mirrors the store and
+ * is a balanced tree which knows the size of its subtrees, so the position
+ * of an item is found in logarithmic time, and stays right however the
+ * store is changed. */
+typedef struct
+{
+    GListStore *store;
+    GSequence *items; /* NautilusViewItem (unowned) */
+    GHashTable *iters; /* NautilusViewItem -> GSequenceIter */
+    gulong items_changed_id;
+} StoreIndex;
+
+static GQuark store_index_quark;
+
 struct _NautilusViewModel
 {
     GObject parent_instance;
@@ -10,6 +50,11 @@ struct _NautilusViewModel
     GHashTable *map_files_to_model;
     GHashTable *directory_reverse_map;
 
+    NautilusSelectionSummary summary;
+    /* NautilusViewItem (owned) -> SummaryEntry */
+    GHashTable *summary_entries;
+    gboolean summary_dirty;
+
     GtkTreeListModel *tree_model;
     GtkSortListModel *sort_model;
     GtkMultiSelection *selection_model;
@@ -47,6 +92,95 @@ get_child_row (NautilusViewModel *self,
     }
 }
 
+static void
+store_index_free (StoreIndex *index)
+{
+    /* The handler is already gone if the store is being finalized. */
+    if (g_signal_handler_is_connected (index->store, index->items_changed_id))
+    {
+        g_signal_handler_disconnect (index->store, index->items_changed_id);
+    }
+    g_hash_table_destroy (index->iters);
+    g_sequence_free (index->items);
+    g_free (index);
+}
+
+static void
+on_store_items_changed (GListModel *store,
+                        guint       position,
+                        guint       removed,
+                        guint       added,
+                        StoreIndex *index)
+{
+    GSequenceIter *iter = g_sequence_get_iter_at_pos (index->items, position);
+
+    for (guint i = 0; i < removed; i++)
+    {
+        GSequenceIter *next = g_sequence_iter_next (iter);
+
+        g_hash_table_remove (index->iters, g_sequence_get (iter));
+        g_sequence_remove (iter);
+        iter = next;
+    }
+
+    for (guint i = 0; i < added; i++)
+    {
+        g_autoptr (NautilusViewItem) item = g_list_model_get_item (store, position + i);
+
+        g_hash_table_insert (index->iters, item, g_sequence_insert_before (iter, item));
+    }
+}
+
+/* Built on first use, as most stores never have items removed one by one. */
+static StoreIndex *
+get_store_index (GListStore *store)
+{
+    StoreIndex *index;
+    guint n_items;
+
+    index = g_object_get_qdata (G_OBJECT (store), store_index_quark);
+    if (index == NULL)
+    {
+        index = g_new0 (StoreIndex, 1);
+        index->store = store;
+        index->items = g_sequence_new (NULL);
+        index->iters = g_hash_table_new (NULL, NULL);
+
+        n_items = g_list_model_get_n_items (G_LIST_MODEL (store));
+        for (guint i = 0; i < n_items; i++)
+        {
+            g_autoptr (NautilusViewItem) item = g_list_model_get_item (G_LIST_MODEL (store), i);
+
+            g_hash_table_insert (index->iters, item, g_sequence_append (index->items, item));
+        }
+
+        index->items_changed_id = g_signal_connect (store, "items-changed",
+                                                    G_CALLBACK (on_store_items_changed), index);
+        g_object_set_qdata_full (G_OBJECT (store), store_index_quark,
+                                 index, (GDestroyNotify) store_index_free);
+    }
+
+    return index;
+}
+
+static gboolean
+store_index_find (GListStore       *store,
+                  NautilusViewItem *item,
+                  guint            *position)
+{
+    StoreIndex *index = get_store_index (store);
+    GSequenceIter *iter = g_hash_table_lookup (index->iters, item);
+
+    if (iter == NULL)
+    {
+        return FALSE;
+    }
+
+    *position = g_sequence_iter_get_position (iter);
+
+    return TRUE;
+}
+
 static GType
 nautilus_view_model_get_item_type (GListModel *list)
 {
@@ -140,6 +274,212 @@ nautilus_view_model_set_selection (GtkSelectionModel *model,
     return res;
 }
 
+static void
+summary_count_flags (NautilusSelectionSummary *summary,
+                     guint                     flags,
+                     gint                      delta)
+{
+    summary->n_home += (flags & SUMMARY_ENTRY_HOME) ? delta : 0;
+    summary->n_in_trash += (flags & SUMMARY_ENTRY_IN_TRASH) ? delta : 0;
+    summary->n_local += (flags & SUMMARY_ENTRY_LOCAL) ? delta : 0;
+    summary->n_info_ready += (flags & SUMMARY_ENTRY_INFO_READY) ? delta : 0;
+    summary->n_can_delete += (flags & SUMMARY_ENTRY_CAN_DELETE) ? delta : 0;
+    summary->n_can_trash += (flags & SUMMARY_ENTRY_CAN_TRASH) ? delta : 0;
+    summary->n_can_rename += (flags & SUMMARY_ENTRY_CAN_RENAME) ? delta : 0;
+    summary->n_directories += (flags & SUMMARY_ENTRY_DIRECTORY) ? delta : 0;
+    summary->n_archives += (flags & SUMMARY_ENTRY_ARCHIVE) ? delta : 0;
+    summary->n_launchable += (flags & SUMMARY_ENTRY_LAUNCHABLE) ? delta : 0;
+    summary->n_can_mount += (flags & SUMMARY_ENTRY_CAN_MOUNT) ? delta : 0;
+    summary->n_can_unmount += (flags & SUMMARY_ENTRY_CAN_UNMOUNT) ? delta : 0;
+    summary->n_can_eject += (flags & SUMMARY_ENTRY_CAN_EJECT) ? delta : 0;
+}
+
+static void
+summary_add_item (NautilusViewModel *self,
+                  NautilusViewItem  *item)
+{
+    NautilusFile *file = nautilus_view_item_get_file (item);
+    SummaryEntry *entry = g_new0 (SummaryEntry, 1);
+    guint count;
+
+    entry->mime_type = g_intern_string (nautilus_file_get_mime_type (file));
+    if (nautilus_file_is_home (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_HOME;
+    }
+    if (nautilus_file_is_in_trash (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_IN_TRASH;
+    }
+    if (nautilus_file_has_local_path (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_LOCAL;
+    }
+    if (nautilus_file_check_if_ready (file, NAUTILUS_FILE_ATTRIBUTE_INFO))
+    {
+        entry->flags |= SUMMARY_ENTRY_INFO_READY;
+    }
+    if (nautilus_file_can_delete (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_CAN_DELETE;
+    }
+    if (nautilus_file_can_trash (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_CAN_TRASH;
+    }
+    if (nautilus_file_can_rename (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_CAN_RENAME;
+    }
+    if (nautilus_file_is_directory (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_DIRECTORY;
+    }
+    if (nautilus_file_is_archive (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_ARCHIVE;
+    }
+    if (nautilus_file_is_launchable (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_LAUNCHABLE;
+    }
+    if (nautilus_file_can_mount (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_CAN_MOUNT;
+    }
+    if (nautilus_file_can_eject (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_CAN_EJECT;
+    }
+    /* Unmount isn't offered next to Eject or Stop, like in the menus. */
+    if (nautilus_file_can_unmount (file) &&
+        !nautilus_file_can_eject (file) &&
+        !nautilus_file_can_stop (file))
+    {
+        entry->flags |= SUMMARY_ENTRY_CAN_UNMOUNT;
+    }
+
+    summary_count_flags (&self->summary, entry->flags, 1);
+
+    count = GPOINTER_TO_UINT (g_hash_table_lookup (self->summary.mime_types, entry->mime_type));
+    g_hash_table_insert (self->summary.mime_types, (gpointer) entry->mime_type, GUINT_TO_POINTER (count + 1));
+
+    self->summary.n_items++;
+    g_hash_table_insert (self->summary_entries, g_object_ref (item), entry);
+}
+
+static void
+summary_remove_item (NautilusViewModel *self,
+                     NautilusViewItem  *item)
+{
+    SummaryEntry *entry = g_hash_table_lookup (self->summary_entries, item);
+    guint count;
+
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    summary_count_flags (&self->summary, entry->flags, -1);
+
+    count = GPOINTER_TO_UINT (g_hash_table_lookup (self->summary.mime_types, entry->mime_type));
+    if (count <= 1)
+    {
+        g_hash_table_remove (self->summary.mime_types, entry->mime_type);
+    }
+    else
+    {
+        g_hash_table_insert (self->summary.mime_types, (gpointer) entry->mime_type, GUINT_TO_POINTER (count - 1));
+    }
+
+    self->summary.n_items--;
+    g_hash_table_remove (self->summary_entries, item);
+}
+
+static void
+summary_reset (NautilusViewModel *self)
+{
+    g_hash_table_remove_all (self->summary_entries);
+    g_hash_table_remove_all (self->summary.mime_types);
+    self->summary = (NautilusSelectionSummary) { .mime_types = self->summary.mime_types };
+}
+
+static NautilusViewItem *
+get_view_item (NautilusViewModel *self,
+               guint              position)
+{
+    g_autoptr (GtkTreeListRow) row = g_list_model_get_item (G_LIST_MODEL (self->sort_model), position);
+
+    return NAUTILUS_VIEW_ITEM (gtk_tree_list_row_get_item (row));
+}
+
+static void
+summary_rebuild (NautilusViewModel *self)
+{
+    g_autoptr (GtkBitset) selection = NULL;
+    GtkBitsetIter iter;
+    guint i;
+
+    summary_reset (self);
+
+    selection = gtk_selection_model_get_selection (GTK_SELECTION_MODEL (self->selection_model));
+    for (gboolean valid = gtk_bitset_iter_init_first (&iter, selection, &i);
+         valid;
+         valid = gtk_bitset_iter_next (&iter, &i))
+    {
+        g_autoptr (NautilusViewItem) item = get_view_item (self, i);
+
+        summary_add_item (self, item);
+    }
+
+    self->summary_dirty = FALSE;
+}
+
+static void
+on_selection_changed (NautilusViewModel *self,
+                      guint              position,
+                      guint              n_items)
+{
+    g_autoptr (GtkBitset) selected = NULL;
+
+    if (self->summary_dirty)
+    {
+        /* Will be rebuilt from scratch on the next query. */
+        return;
+    }
+
+    selected = gtk_selection_model_get_selection_in_range (GTK_SELECTION_MODEL (self->selection_model),
+                                                           position, n_items);
+    for (guint i = position; i < position + n_items; i++)
+    {
+        g_autoptr (NautilusViewItem) item = get_view_item (self, i);
+        gboolean was_selected = g_hash_table_contains (self->summary_entries, item);
+
+        if (gtk_bitset_contains (selected, i) && !was_selected)
+        {
+            summary_add_item (self, item);
+        }
+        else if (!gtk_bitset_contains (selected, i) && was_selected)
+        {
+            summary_remove_item (self, item);
+        }
+    }
+}
+
+static void
+on_sort_model_items_changed (NautilusViewModel *self,
+                             guint              position,
+                             guint              removed,
+                             guint              added)
+{
+    /* Removed items silently drop out of the selection, and resorting moves
+     * them around, so we can't keep track of ranges. Additions are always
+     * unselected, so they don't affect the summary. */
+    if (removed > 0)
+    {
+        self->summary_dirty = TRUE;
+    }
+}
 
 static void
 nautilus_view_model_selection_model_init (GtkSelectionModelInterface *iface)
@@ -173,6 +513,9 @@ dispose (GObject *object)
 
     if (self->selection_model != NULL)
     {
+        g_signal_handlers_disconnect_by_func (self->selection_model,
+                                              on_selection_changed,
+                                              self);
         g_signal_handlers_disconnect_by_func (self->selection_model,
                                               gtk_selection_model_selection_changed,
                                               self);
@@ -182,6 +525,9 @@ dispose (GObject *object)
 
     if (self->sort_model != NULL)
     {
+        g_signal_handlers_disconnect_by_func (self->sort_model,
+                                              on_sort_model_items_changed,
+                                              self);
         g_signal_handlers_disconnect_by_func (self->sort_model,
                                               g_list_model_items_changed,
                                               self);
@@ -206,6 +552,8 @@ finalize (GObject *object)
 
     g_hash_table_destroy (self->map_files_to_model);
     g_hash_table_destroy (self->directory_reverse_map);
+    g_hash_table_destroy (self->summary_entries);
+    g_hash_table_destroy (self->summary.mime_types);
 }
 
 static void
@@ -298,6 +646,15 @@ constructed (GObject *object)
 
     self->map_files_to_model = g_hash_table_new (NULL, NULL);
     self->directory_reverse_map = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+    self->summary_entries = g_hash_table_new_full (NULL, NULL, g_object_unref, g_free);
+    self->summary.mime_types = g_hash_table_new (NULL, NULL);
+
+    /* Keep the selection summary up to date before anyone else is told about
+     * changes, so that it can be queried from their handlers. */
+    g_signal_connect_swapped (self->sort_model, "items-changed",
+                              G_CALLBACK (on_sort_model_items_changed), self);
+    g_signal_connect_swapped (self->selection_model, "selection-changed",
+                              G_CALLBACK (on_selection_changed), self);
 
     g_signal_connect_swapped (self->sort_model, "items-changed",
                               G_CALLBACK (g_list_model_items_changed), self);
@@ -325,6 +682,8 @@ nautilus_view_model_class_init (NautilusViewModelClass *klass)
                              G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
 
     g_object_class_install_properties (object_class, N_PROPS, properties);
+
+    store_index_quark = g_quark_from_static_string ("nautilus-view-model-store-index");
 }
 
 static void
@@ -433,7 +792,7 @@ nautilus_view_model_remove_items (NautilusViewModel *self,
         NautilusFile *file = nautilus_view_item_get_file (item);
         guint i;
 
-        if (!g_list_store_find (dir_store, item, &i))
+        if (!store_index_find (dir_store, item, &i))
         {
             g_autofree char *uri = nautilus_file_get_uri (file);
 
@@ -449,6 +808,10 @@ nautilus_view_model_remove_items (NautilusViewModel *self,
         }
     }
 
+    if (gtk_bitset_is_empty (positions))
+    {
+        return;
+    }
     /* Remove contiguous item ranges to minimize ::items-changed emissions.
      * Remove starting from the end, not to impact the index */
     gtk_bitset_iter_init_last (&position_iter, positions, &new_start);
@@ -475,7 +838,11 @@ nautilus_view_model_remove_items (NautilusViewModel *self,
 void
 nautilus_view_model_remove_all_items (NautilusViewModel *self)
 {
-    g_list_store_remove_all (G_LIST_STORE (gtk_tree_list_model_get_model (self->tree_model)));
+    GListStore *root_store = G_LIST_STORE (gtk_tree_list_model_get_model (self->tree_model));
+
+    /* Cheaper to drop the index than to have it follow the removal */
+    g_object_set_qdata (G_OBJECT (root_store), store_index_quark, NULL);
+    g_list_store_remove_all (root_store);
     g_hash_table_remove_all (self->map_files_to_model);
     g_hash_table_remove_all (self->directory_reverse_map);
 }
@@ -614,6 +981,41 @@ nautilus_view_model_find (NautilusViewModel *self,
     return nautilus_view_model_find_ranged (self, item, 0, n_items - 1);
 }
 
+/**
+ * nautilus_view_model_get_selection_summary:
+ *
+ * Returns: (transfer none): aggregates over the currently selected items,
+ * kept up to date incrementally as the selection changes.
+ */
+const NautilusSelectionSummary *
+nautilus_view_model_get_selection_summary (NautilusViewModel *self)
+{
+    if (self->summary_dirty)
+    {
+        summary_rebuild (self);
+    }
+
+    return &self->summary;
+}
+
+/**
+ * nautilus_view_model_selection_summary_item_changed:
+ *
+ * @item: An item whose file has changed.
+ *
+ * Refresh what @item contributes to the selection summary, if it is selected.
+ */
+void
+nautilus_view_model_selection_summary_item_changed (NautilusViewModel *self,
+                                                    NautilusViewItem  *item)
+{
+    if (!self->summary_dirty && g_hash_table_contains (self->summary_entries, item))
+    {
+        summary_remove_item (self, item);
+        summary_add_item (self, item);
+    }
+}
+
 void
 nautilus_view_model_clear_subdirectory (NautilusViewModel *self,
                                         NautilusViewItem  *item)
@@ -8,6 +8,26 @@ G_BEGIN_DECLS
 
 #define NAUTILUS_TYPE_VIEW_MODEL (nautilus_view_model_get_type())
 
+typedef struct
+{
+    guint n_items;
+    guint n_home;
+    guint n_in_trash;
+    guint n_local;
+    guint n_info_ready;
+    guint n_can_delete;
+    guint n_can_trash;
+    guint n_can_rename;
+    guint n_directories;
+    guint n_archives;
+    guint n_launchable;
+    guint n_can_mount;
+    guint n_can_unmount;
+    guint n_can_eject;
+    /* Interned MIME type -> number of selected items of that type */
+    GHashTable *mime_types;
+} NautilusSelectionSummary;
+
 G_DECLARE_FINAL_TYPE (NautilusViewModel, nautilus_view_model, NAUTILUS, VIEW_MODEL, GObject)
 
 NautilusViewModel * nautilus_view_model_new (void);
@@ -36,6 +56,9 @@ guint nautilus_view_model_find_ranged (NautilusViewModel *self,
                                        NautilusViewItem  *item,
                                        guint              start,
                                        guint              end);
+const NautilusSelectionSummary * nautilus_view_model_get_selection_summary (NautilusViewModel *self);
+void nautilus_view_model_selection_summary_item_changed (NautilusViewModel *self,
+                                                         NautilusViewItem  *item);
 void nautilus_view_model_clear_subdirectory (NautilusViewModel *self,
                                              NautilusViewItem  *item);
 void nautilus_view_model_expand_as_a_tree (NautilusViewModel *self,
@@ -88,6 +88,49 @@ test_directory_call_when_ready (void)
     g_assert_null (directory->details->file_list);
 }
 
+static void
+got_files_one_at_a_time_callback (NautilusDirectory *directory,
+                                  GList             *files,
+                                  gpointer           callback_data)
+{
+    g_assert_cmpint (g_list_length (files), >, 10);
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        g_assert_true (nautilus_file_check_if_ready (l->data,
+                                                     NAUTILUS_FILE_ATTRIBUTE_INFO |
+                                                     NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT));
+    }
+
+    got_files_flag = TRUE;
+}
+
+/** Check that files waiting behind a single job slot all get their attributes */
+static void
+test_directory_call_when_ready_one_job (void)
+{
+    g_autoptr (NautilusDirectory) directory = nautilus_directory_get_by_uri ("file:///etc");
+
+    nautilus_directory_set_max_jobs_per_directory (REQUEST_FILE_INFO, 1);
+    nautilus_directory_set_max_jobs_per_directory (REQUEST_DIRECTORY_COUNT, 1);
+
+    got_files_flag = FALSE;
+    nautilus_directory_call_when_ready (directory,
+                                        NAUTILUS_FILE_ATTRIBUTE_INFO |
+                                        NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT,
+                                        TRUE,
+                                        got_files_one_at_a_time_callback, NULL);
+    for (guint i = 0; !got_files_flag && i < 100000; i++)
+    {
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+    g_assert_true (got_files_flag);
+
+    nautilus_directory_set_max_jobs_per_directory (REQUEST_FILE_INFO, 4);
+    nautilus_directory_set_max_jobs_per_directory (REQUEST_DIRECTORY_COUNT, 4);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -102,6 +145,8 @@ main (int   argc,
                      test_directory_hash_table_cleanup);
     g_test_add_func ("/directory-call-when-ready/1.0",
                      test_directory_call_when_ready);
+    g_test_add_func ("/directory-call-when-ready-one-job/1.0",
+                     test_directory_call_when_ready_one_job);
 
     return g_test_run ();
 }
@@ -41,6 +41,21 @@ test_file_metadata_str_set (void)
     g_assert_cmpstr (metadata, ==, "value");
 }
 
+static void
+test_file_metadata_set_keeps_other_keys (void)
+{
+    g_autoptr (NautilusFile) file = nautilus_file_get_by_uri (TEST_FILE);
+
+    nautilus_file_set_metadata (file, KEY_STR, "default", "value");
+    nautilus_file_set_boolean_metadata (file, KEY_BOOL, TRUE);
+    g_assert_cmpstr (nautilus_file_get_metadata (file, KEY_STR, "default"), ==, "value");
+    g_assert_true (nautilus_file_get_boolean_metadata (file, KEY_BOOL, FALSE));
+
+    nautilus_file_set_metadata (file, KEY_STR, NULL, NULL);
+    g_assert_cmpstr (nautilus_file_get_metadata (file, KEY_STR, "default"), ==, "default");
+    g_assert_true (nautilus_file_get_boolean_metadata (file, KEY_BOOL, FALSE));
+}
+
 static void
 test_file_metadata_str_get_null (void)
 {
@@ -66,6 +81,8 @@ main (int   argc,
                      test_file_metadata_str_set);
     g_test_add_func ("/file-metadata-str-set/null",
                      test_file_metadata_str_get_null);
+    g_test_add_func ("/file-metadata-set/keeps-other-keys",
+                     test_file_metadata_set_keeps_other_keys);
 
     return g_test_run ();
 }
@@ -0,0 +1,331 @@
+#include "test-utilities.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+
+/* compress_tree/
+ * compress_tree/compress_first_file
+ * compress_tree/compress_directory/
+ * compress_tree/compress_directory/compress_second_file
+ */
+static GFile *
+create_tree (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) directory = NULL;
+    g_autoptr (GFile) first_file = NULL;
+    g_autoptr (GFile) second_file = NULL;
+    GFile *tree;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    tree = g_file_get_child (root, "compress_tree");
+    g_assert_true (g_file_make_directory (tree, NULL, NULL));
+    directory = g_file_get_child (tree, "compress_directory");
+    g_assert_true (g_file_make_directory (directory, NULL, NULL));
+
+    first_file = create_file (tree, "compress_first_file", "first");
+    second_file = create_file (directory, "compress_second_file", "second");
+
+    return tree;
+}
+
+#define PERF_TREE_DIRECTORIES 8
+#define PERF_TREE_FILES 16
+#define PERF_TREE_FILE_SIZE (1024 * 1024)
+
+/* compress_perf_tree/compress_directory_N/compress_file_M, filled with text
+ * made up from a small vocabulary, so that it compresses about as well as
+ * source code does, rather than not at all or down to nothing. */
+static GFile *
+create_perf_tree (void)
+{
+    static const char * const words[] =
+    {
+        "static ", "void ", "return ", "if (", "NULL", ");\n", "g_autoptr ", "{\n",
+        "}\n", "    ", "gboolean ", "file", "directory", "_get_", "->", "GList *",
+    };
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GString) contents = g_string_new (NULL);
+    g_autoptr (GRand) rand = g_rand_new_with_seed (42);
+    GFile *tree;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    tree = g_file_get_child (root, "compress_perf_tree");
+    g_assert_true (g_file_make_directory (tree, NULL, NULL));
+
+    for (guint i = 0; i < PERF_TREE_DIRECTORIES; i++)
+    {
+        g_autofree gchar *directory_name = g_strdup_printf ("compress_directory_%u", i);
+        g_autoptr (GFile) directory = g_file_get_child (tree, directory_name);
+
+        g_assert_true (g_file_make_directory (directory, NULL, NULL));
+
+        for (guint j = 0; j < PERF_TREE_FILES; j++)
+        {
+            g_autofree gchar *file_name = g_strdup_printf ("compress_file_%u", j);
+            g_autoptr (GFile) file = g_file_get_child (directory, file_name);
+
+            g_string_truncate (contents, 0);
+            while (contents->len < PERF_TREE_FILE_SIZE)
+            {
+                g_string_append (contents,
+                                 words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+            }
+            g_string_truncate (contents, PERF_TREE_FILE_SIZE);
+
+            g_assert_true (g_file_replace_contents (file, contents->str, contents->len,
+                                                    NULL, FALSE, G_FILE_CREATE_NONE,
+                                                    NULL, NULL, NULL));
+        }
+    }
+
+    return tree;
+}
+
+/* Returns the path of each entry of @archive_file, without the trailing slash
+ * tar adds to directories, mapped to the contents of the regular files and to
+ * "" for the rest. */
+static GHashTable *
+read_archive (GFile *archive_file,
+              int    expected_filter)
+{
+    g_autofree gchar *path = g_file_get_path (archive_file);
+    GHashTable *entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    struct archive *reader;
+    struct archive_entry *entry;
+
+    reader = archive_read_new ();
+    archive_read_support_filter_all (reader);
+    archive_read_support_format_all (reader);
+    g_assert_cmpint (archive_read_open_filename (reader, path, 64 * 1024), ==, ARCHIVE_OK);
+
+    while (archive_read_next_header (reader, &entry) == ARCHIVE_OK)
+    {
+        g_autoptr (GString) contents = g_string_new (NULL);
+        g_autofree gchar *entry_path = g_strdup (archive_entry_pathname (entry));
+        gchar buffer[1024];
+        la_ssize_t size;
+
+        while ((size = archive_read_data (reader, buffer, sizeof (buffer))) > 0)
+        {
+            g_string_append_len (contents, buffer, size);
+        }
+        g_assert_cmpint (size, ==, 0);
+
+        if (g_str_has_suffix (entry_path, "/"))
+        {
+            entry_path[strlen (entry_path) - 1] = '\0';
+        }
+        g_hash_table_insert (entries,
+                             g_steal_pointer (&entry_path),
+                             g_string_free (g_steal_pointer (&contents), FALSE));
+    }
+
+    g_assert_cmpint (archive_filter_code (reader, 0), ==, expected_filter);
+
+    archive_read_free (reader);
+
+    return entries;
+}
+
+static void
+assert_entry (GHashTable  *entries,
+              const gchar *path,
+              const gchar *contents)
+{
+    g_assert_true (g_hash_table_contains (entries, path));
+    g_assert_cmpstr (g_hash_table_lookup (entries, path), ==, contents);
+}
+
+static void
+test_compress_tree (AutoarFilter  filter,
+                    const gchar  *extension,
+                    int           archive_filter)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) tree = NULL;
+    g_autoptr (GFile) output = NULL;
+    g_autolist (GFile) files = NULL;
+    g_autofree gchar *output_name = NULL;
+    g_autoptr (GHashTable) entries = NULL;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    tree = create_tree ();
+    files = g_list_prepend (files, g_object_ref (tree));
+
+    output_name = g_strconcat ("compress_archive", extension, NULL);
+    output = g_file_get_child (root, output_name);
+
+    g_assert_true (nautilus_file_operations_compress_sync (files, output,
+                                                           AUTOAR_FORMAT_TAR, filter));
+
+    entries = read_archive (output, archive_filter);
+    g_assert_cmpuint (g_hash_table_size (entries), ==, 4);
+    assert_entry (entries, "compress_tree", "");
+    assert_entry (entries, "compress_tree/compress_first_file", "first");
+    assert_entry (entries, "compress_tree/compress_directory", "");
+    assert_entry (entries, "compress_tree/compress_directory/compress_second_file", "second");
+
+    /* Compressing leaves the sources alone */
+    g_assert_true (g_file_query_exists (tree, NULL));
+
+    empty_directory_by_prefix (root, "compress");
+}
+
+static void
+test_compress_tar_zstd (void)
+{
+    test_compress_tree (NAUTILUS_COMPRESS_FILTER_ZSTD, ".tar.zst", ARCHIVE_FILTER_ZSTD);
+}
+
+static void
+test_compress_tar_xz (void)
+{
+    test_compress_tree (AUTOAR_FILTER_XZ, ".tar.xz", ARCHIVE_FILTER_XZ);
+}
+
+static void
+test_compress_tar_zstd_multiple_files (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) output = NULL;
+    g_autolist (GFile) files = NULL;
+    g_autoptr (GHashTable) entries = NULL;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    files = g_list_append (files, create_file (root, "compress_first_file", "first"));
+    files = g_list_append (files, create_file (root, "compress_second_file", "second"));
+    output = g_file_get_child (root, "compress_archive.tar.zst");
+
+    g_assert_true (nautilus_file_operations_compress_sync (files, output, AUTOAR_FORMAT_TAR,
+                                                           NAUTILUS_COMPRESS_FILTER_ZSTD));
+
+    entries = read_archive (output, ARCHIVE_FILTER_ZSTD);
+    g_assert_cmpuint (g_hash_table_size (entries), ==, 2);
+    assert_entry (entries, "compress_first_file", "first");
+    assert_entry (entries, "compress_second_file", "second");
+
+    empty_directory_by_prefix (root, "compress");
+}
+
+static void
+test_compress_tar_zstd_undo (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) tree = NULL;
+    g_autoptr (GFile) output = NULL;
+    g_autolist (GFile) files = NULL;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    tree = create_tree ();
+    files = g_list_prepend (files, g_object_ref (tree));
+    output = g_file_get_child (root, "compress_archive.tar.zst");
+
+    g_assert_true (nautilus_file_operations_compress_sync (files, output, AUTOAR_FORMAT_TAR,
+                                                           NAUTILUS_COMPRESS_FILTER_ZSTD));
+
+    test_operation_undo ();
+
+    g_assert_false (g_file_query_exists (output, NULL));
+    g_assert_true (g_file_query_exists (tree, NULL));
+
+    empty_directory_by_prefix (root, "compress");
+}
+
+/* Only large inputs are split between the threads the compressor is asked
+ * for, one per processor, so this is left to `-m perf` runs. */
+static void
+test_compress_perf (AutoarFilter  filter,
+                    const gchar  *extension,
+                    int           archive_filter)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) tree = NULL;
+    g_autoptr (GFile) output = NULL;
+    g_autolist (GFile) files = NULL;
+    g_autofree gchar *output_name = NULL;
+    g_autoptr (GHashTable) entries = NULL;
+    gint64 start_time;
+    gdouble seconds;
+    gdouble total_mib;
+
+    if (!g_test_perf ())
+    {
+        g_test_skip ("Only run in perf mode");
+        return;
+    }
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    tree = create_perf_tree ();
+    files = g_list_prepend (files, g_object_ref (tree));
+    output_name = g_strconcat ("compress_archive", extension, NULL);
+    output = g_file_get_child (root, output_name);
+
+    start_time = g_get_monotonic_time ();
+    g_assert_true (nautilus_file_operations_compress_sync (files, output,
+                                                           AUTOAR_FORMAT_TAR, filter));
+    seconds = (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC;
+
+    /* The tree itself, its directories and their files */
+    entries = read_archive (output, archive_filter);
+    g_assert_cmpuint (g_hash_table_size (entries), ==,
+                      1 + PERF_TREE_DIRECTORIES * (1 + PERF_TREE_FILES));
+
+    total_mib = PERF_TREE_DIRECTORIES * PERF_TREE_FILES * PERF_TREE_FILE_SIZE / (1024.0 * 1024.0);
+    g_test_maximized_result (total_mib / MAX (seconds, 0.001),
+                             "Compressed %.0f MiB into %s at %.1f MiB/s with %u threads",
+                             total_mib, extension, total_mib / MAX (seconds, 0.001),
+                             g_get_num_processors ());
+
+    empty_directory_by_prefix (root, "compress");
+}
+
+static void
+test_compress_tar_zstd_perf (void)
+{
+    test_compress_perf (NAUTILUS_COMPRESS_FILTER_ZSTD, ".tar.zst", ARCHIVE_FILTER_ZSTD);
+}
+
+static void
+test_compress_tar_xz_perf (void)
+{
+    test_compress_perf (AUTOAR_FILTER_XZ, ".tar.xz", ARCHIVE_FILTER_XZ);
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/test-compress-tar-zstd/1.0",
+                     test_compress_tar_zstd);
+    g_test_add_func ("/test-compress-tar-xz/1.0",
+                     test_compress_tar_xz);
+    g_test_add_func ("/test-compress-tar-zstd-multiple-files/1.0",
+                     test_compress_tar_zstd_multiple_files);
+    g_test_add_func ("/test-compress-tar-zstd-undo/1.0",
+                     test_compress_tar_zstd_undo);
+    g_test_add_func ("/test-compress-tar-zstd-perf/1.0",
+                     test_compress_tar_zstd_perf);
+    g_test_add_func ("/test-compress-tar-xz-perf/1.0",
+                     test_compress_tar_xz_perf);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (NautilusFileUndoManager) undo_manager = NULL;
+    int ret;
+
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+    nautilus_ensure_extension_points ();
+    undo_manager = nautilus_file_undo_manager_new ();
+
+    setup_test_suite ();
+
+    ret = g_test_run ();
+
+    test_clear_tmp_dir ();
+
+    return ret;
+}
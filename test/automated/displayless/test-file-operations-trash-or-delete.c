@@ -1,4 +1,5 @@
 #include "test-utilities.h"
+#include <src/nautilus-progress-info-manager.h>
 #include <src/nautilus-tag-manager.h>
 
 static void
@@ -437,6 +438,80 @@ test_delete_third_hierarchy (void)
     empty_directory_by_prefix (root, "trash_or_delete");
 }
 
+/* Returns the item the trash holds for @orig_path, if any. */
+static GFile *
+find_in_trash (const gchar *orig_path)
+{
+    g_autoptr (GFile) trash = g_file_new_for_uri ("trash:///");
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    GFileInfo *info;
+    GFile *child;
+
+    enumerator = g_file_enumerate_children (trash,
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                            G_FILE_ATTRIBUTE_TRASH_ORIG_PATH,
+                                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    if (enumerator == NULL)
+    {
+        return NULL;
+    }
+
+    while (g_file_enumerator_iterate (enumerator, &info, &child, NULL, NULL) && info != NULL)
+    {
+        const char *path = g_file_info_get_attribute_byte_string (info,
+                                                                  G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
+
+        if (g_strcmp0 (path, orig_path) == 0)
+        {
+            return g_object_ref (child);
+        }
+    }
+
+    return NULL;
+}
+
+static void
+test_delete_from_trash_confirmed (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFile) trashed = NULL;
+    g_autoptr (NautilusProgressInfoManager) progress_manager = NULL;
+    g_autofree gchar *path = NULL;
+    g_autolist (GFile) files = NULL;
+    NautilusProgressInfo *progress;
+
+    create_one_file ("trash_or_delete");
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    file = g_file_resolve_relative_path (root, "trash_or_delete_first_dir/trash_or_delete_first_dir_child");
+    path = g_file_get_path (file);
+
+    if (!g_file_trash (file, NULL, NULL) ||
+        (trashed = find_in_trash (path)) == NULL)
+    {
+        g_test_skip ("Files in the test directory can't be trashed");
+        empty_directory_by_prefix (root, "trash_or_delete");
+        return;
+    }
+    files = g_list_prepend (files, g_object_ref (trashed));
+
+    /* Deleting from the trash always asks for confirmation first */
+    nautilus_file_operations_set_dialog_answer_for_testing ("_Delete");
+    nautilus_file_operations_trash_or_delete_sync (files);
+    nautilus_file_operations_set_dialog_answer_for_testing (NULL);
+
+    g_assert_false (g_file_query_exists (trashed, NULL));
+
+    /* Confirming isn't failing, so the job has done all it was asked to. */
+    progress_manager = nautilus_progress_info_manager_dup_singleton ();
+    progress = nautilus_progress_info_manager_get_all_infos (progress_manager)->data;
+    g_assert_false (nautilus_progress_info_get_is_cancelled (progress));
+    g_assert_false (nautilus_progress_info_get_is_incomplete (progress));
+
+    empty_directory_by_prefix (root, "trash_or_delete");
+}
+
 static void
 setup_test_suite (void)
 {
@@ -468,6 +543,8 @@ setup_test_suite (void)
                      test_delete_first_hierarchy);
     g_test_add_func ("/test-delete-more-full-directories/1.6",
                      test_delete_third_hierarchy);
+    g_test_add_func ("/test-delete-from-trash-confirmed/1.0",
+                     test_delete_from_trash_confirmed);
 }
 
 int
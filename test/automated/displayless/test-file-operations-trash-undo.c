@@ -0,0 +1,240 @@
+#include "test-utilities.h"
+#include <src/nautilus-file-undo-operations.h>
+
+/* Undo looks trashed items up by name only in the home trash, which is only
+ * used for files on the same filesystem. */
+static gboolean
+home_trash_is_used (GFile *directory)
+{
+    g_autoptr (GFile) trash = g_file_new_for_uri ("trash:///");
+    g_autoptr (GFile) data_dir = g_file_new_for_path (g_get_user_data_dir ());
+    g_autoptr (GFileInfo) trash_info = NULL;
+    g_autoptr (GFileInfo) directory_info = NULL;
+    g_autoptr (GFileInfo) data_dir_info = NULL;
+
+    trash_info = g_file_query_info (trash, G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                    G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    directory_info = g_file_query_info (directory, G_FILE_ATTRIBUTE_UNIX_DEVICE,
+                                        G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    data_dir_info = g_file_query_info (data_dir, G_FILE_ATTRIBUTE_UNIX_DEVICE,
+                                       G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+    return trash_info != NULL && directory_info != NULL && data_dir_info != NULL &&
+           g_file_info_get_attribute_uint32 (directory_info, G_FILE_ATTRIBUTE_UNIX_DEVICE) ==
+           g_file_info_get_attribute_uint32 (data_dir_info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+}
+
+/* Deletes from the trash what this test put there, found by the location
+ * it was trashed from. */
+static void
+empty_trash_of (GFile *directory)
+{
+    g_autoptr (GFile) trash = g_file_new_for_uri ("trash:///");
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    g_autofree gchar *directory_path = g_file_get_path (directory);
+    GFileInfo *info;
+    GFile *child;
+
+    enumerator = g_file_enumerate_children (trash,
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                            G_FILE_ATTRIBUTE_TRASH_ORIG_PATH,
+                                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    g_assert_nonnull (enumerator);
+
+    while (g_file_enumerator_iterate (enumerator, &info, &child, NULL, NULL) && info != NULL)
+    {
+        const char *orig_path = g_file_info_get_attribute_byte_string (info,
+                                                                       G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
+
+        if (orig_path != NULL && g_str_has_prefix (orig_path, directory_path))
+        {
+            g_file_delete (child, NULL, NULL);
+        }
+    }
+}
+
+/* Trashes @file like the user would, and returns the undo info recorded. */
+static NautilusFileUndoInfoTrash *
+trash_file (GFile *file)
+{
+    g_autolist (GFile) files = NULL;
+    NautilusFileUndoInfo *undo_info;
+
+    files = g_list_prepend (files, g_object_ref (file));
+    nautilus_file_operations_trash_or_delete_sync (files);
+    g_assert_false (g_file_query_exists (file, NULL));
+
+    undo_info = nautilus_file_undo_manager_get_action ();
+    g_assert_nonnull (undo_info);
+    g_assert_cmpint (nautilus_file_undo_info_get_op_type (undo_info), ==,
+                     NAUTILUS_FILE_UNDO_OP_MOVE_TO_TRASH);
+
+    return g_object_ref (NAUTILUS_FILE_UNDO_INFO_TRASH (undo_info));
+}
+
+static void
+assert_contents (GFile       *file,
+                 const gchar *expected)
+{
+    g_autofree gchar *contents = NULL;
+
+    g_assert_true (g_file_load_contents (file, NULL, &contents, NULL, NULL, NULL));
+    g_assert_cmpstr (contents, ==, expected);
+}
+
+static void
+test_trash_undo_by_name (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) directory = NULL;
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (NautilusFileUndoInfoTrash) undo_info = NULL;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    if (!home_trash_is_used (root))
+    {
+        g_test_skip ("Files in the test directory are not put in the home trash");
+        return;
+    }
+
+    directory = g_file_get_child (root, "trash_undo_dir");
+    g_assert_true (g_file_make_directory (directory, NULL, NULL));
+
+    /* Unrelated items, which undoing must not have to look through */
+    for (guint i = 0; i < 10; i++)
+    {
+        g_autofree gchar *name = g_strdup_printf ("trash_undo_other_%u", i);
+        g_autoptr (GFile) other = create_file (directory, name, "");
+
+        g_assert_true (g_file_trash (other, NULL, NULL));
+    }
+
+    file = create_file (directory, "trash_undo_file.txt", "data");
+    undo_info = trash_file (file);
+
+    test_operation_undo ();
+
+    assert_contents (file, "data");
+    g_assert_cmpuint (nautilus_file_undo_info_trash_get_n_searched (undo_info), ==, 0);
+
+    empty_trash_of (directory);
+    empty_directory_by_prefix (root, "trash_undo");
+}
+
+static void
+test_trash_undo_same_name (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) directory = NULL;
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (NautilusFileUndoInfoTrash) undo_info = NULL;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    if (!home_trash_is_used (root))
+    {
+        g_test_skip ("Files in the test directory are not put in the home trash");
+        return;
+    }
+
+    directory = g_file_get_child (root, "trash_undo_dir");
+    g_assert_true (g_file_make_directory (directory, NULL, NULL));
+
+    /* Items from the same location, trashed in the same seconds, must
+     * neither be restored instead, nor keep the file from being restored
+     * by the name it got in the trash. */
+    for (guint i = 0; i < 3; i++)
+    {
+        g_autoptr (GFile) old = create_file (directory, "trash_undo_file.txt", "old");
+
+        g_assert_true (g_file_trash (old, NULL, NULL));
+    }
+
+    file = create_file (directory, "trash_undo_file.txt", "new");
+    undo_info = trash_file (file);
+
+    test_operation_undo ();
+
+    assert_contents (file, "new");
+    g_assert_cmpuint (nautilus_file_undo_info_trash_get_n_searched (undo_info), ==, 0);
+
+    empty_trash_of (directory);
+    empty_directory_by_prefix (root, "trash_undo");
+}
+
+static void
+test_trash_undo_name_taken (void)
+{
+    g_autoptr (GFile) root = NULL;
+    g_autoptr (GFile) directory = NULL;
+    g_autoptr (GFile) other_directory = NULL;
+    g_autoptr (GFile) file = NULL;
+    g_autoptr (GFile) other_file = NULL;
+    g_autoptr (GFile) trash_item = NULL;
+    g_autoptr (NautilusFileUndoInfoTrash) undo_info = NULL;
+
+    root = g_file_new_for_path (test_get_tmp_dir ());
+    if (!home_trash_is_used (root))
+    {
+        g_test_skip ("Files in the test directory are not put in the home trash");
+        return;
+    }
+
+    directory = g_file_get_child (root, "trash_undo_dir");
+    g_assert_true (g_file_make_directory (directory, NULL, NULL));
+    other_directory = g_file_get_child (root, "trash_undo_other_dir");
+    g_assert_true (g_file_make_directory (other_directory, NULL, NULL));
+
+    file = create_file (directory, "trash_undo_file", "ours");
+    undo_info = trash_file (file);
+
+    /* Restored by other means, and trashed again after an item of the same
+     * name from elsewhere took the name it first had in the trash. */
+    trash_item = g_file_new_for_uri ("trash:///trash_undo_file");
+    g_assert_true (g_file_move (trash_item, file, G_FILE_COPY_NOFOLLOW_SYMLINKS,
+                                NULL, NULL, NULL, NULL));
+    other_file = create_file (other_directory, "trash_undo_file", "other");
+    g_assert_true (g_file_trash (other_file, NULL, NULL));
+    g_assert_true (g_file_trash (file, NULL, NULL));
+
+    test_operation_undo ();
+
+    assert_contents (file, "ours");
+    g_assert_false (g_file_query_exists (other_file, NULL));
+    g_assert_cmpuint (nautilus_file_undo_info_trash_get_n_searched (undo_info), ==, 0);
+
+    empty_trash_of (directory);
+    empty_trash_of (other_directory);
+    empty_directory_by_prefix (root, "trash_undo");
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/test-trash-undo-by-name/1.0",
+                     test_trash_undo_by_name);
+    g_test_add_func ("/test-trash-undo-same-name/1.0",
+                     test_trash_undo_same_name);
+    g_test_add_func ("/test-trash-undo-name-taken/1.0",
+                     test_trash_undo_name_taken);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (NautilusFileUndoManager) undo_manager = NULL;
+    int ret;
+
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+    nautilus_ensure_extension_points ();
+    undo_manager = nautilus_file_undo_manager_new ();
+
+    setup_test_suite ();
+
+    ret = g_test_run ();
+
+    test_clear_tmp_dir ();
+
+    return ret;
+}
@@ -0,0 +1,220 @@
+#include "test-utilities.h"
+
+#include <src/nautilus-compact-file-list.h>
+
+static void
+test_compact_file_list_round_trip (void)
+{
+    g_autoptr (NautilusCompactFileList) list = nautilus_compact_file_list_new ();
+    g_autoptr (GFile) root = g_file_new_for_path (test_get_tmp_dir ());
+    g_autolist (GFile) files = NULL;
+    g_autolist (GFile) expanded = NULL;
+    guint i = 0;
+
+    files = g_list_append (files, g_file_resolve_relative_path (root, "undo_memory_a/first"));
+    files = g_list_append (files, g_file_resolve_relative_path (root, "undo_memory_b/second"));
+    files = g_list_append (files, g_file_resolve_relative_path (root, "undo_memory_a/thïrd with spaces"));
+    files = g_list_append (files, g_file_new_for_path ("/"));
+    files = g_list_append (files, g_object_ref (root));
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        nautilus_compact_file_list_append (list, l->data, 0100644 + i);
+        i++;
+    }
+
+    g_assert_cmpuint (nautilus_compact_file_list_get_length (list), ==, g_list_length (files));
+
+    i = 0;
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        g_autoptr (GFile) file = nautilus_compact_file_list_get_file (list, i);
+
+        g_assert_true (g_file_equal (file, l->data));
+        g_assert_cmpuint (nautilus_compact_file_list_get_value (list, i), ==, 0100644 + i);
+        i++;
+    }
+
+    expanded = nautilus_compact_file_list_expand (list);
+    g_assert_cmpuint (g_list_length (expanded), ==, g_list_length (files));
+    for (GList *l = files, *e = expanded; l != NULL; l = l->next, e = e->next)
+    {
+        g_assert_true (g_file_equal (e->data, l->data));
+    }
+}
+
+static void
+test_compact_file_list_empty (void)
+{
+    g_autoptr (NautilusCompactFileList) list = nautilus_compact_file_list_new ();
+
+    g_assert_cmpuint (nautilus_compact_file_list_get_length (list), ==, 0);
+    g_assert_null (nautilus_compact_file_list_expand (list));
+}
+
+static void
+test_compact_file_list_shares_parents (void)
+{
+    g_autoptr (NautilusCompactFileList) list = nautilus_compact_file_list_new ();
+    g_autoptr (GFile) root = g_file_new_for_path (test_get_tmp_dir ());
+    g_autoptr (GFile) first_parent = g_file_get_child (root, "undo_memory_a");
+    g_autoptr (GFile) second_parent = g_file_get_child (root, "undo_memory_b");
+
+    /* However many files are recorded, each parent is stored once, even when
+     * the files of several parents come interleaved. */
+    for (guint i = 0; i < 1000; i++)
+    {
+        g_autofree gchar *name = g_strdup_printf ("undo_memory_file_%u", i);
+        g_autoptr (GFile) file = g_file_get_child (first_parent, name);
+
+        nautilus_compact_file_list_append (list, file, i);
+    }
+    g_assert_cmpuint (nautilus_compact_file_list_get_length (list), ==, 1000);
+    g_assert_cmpuint (nautilus_compact_file_list_get_n_parents (list), ==, 1);
+
+    for (guint i = 0; i < 1000; i++)
+    {
+        g_autofree gchar *name = g_strdup_printf ("undo_memory_other_%u", i);
+        g_autoptr (GFile) file = g_file_get_child (i % 2 == 0 ? second_parent : first_parent,
+                                                   name);
+
+        nautilus_compact_file_list_append (list, file, i);
+    }
+    g_assert_cmpuint (nautilus_compact_file_list_get_length (list), ==, 2000);
+    g_assert_cmpuint (nautilus_compact_file_list_get_n_parents (list), ==, 2);
+}
+
+/* undo_memory_source/
+ * undo_memory_source/undo_memory_directory/
+ * undo_memory_source/undo_memory_directory/undo_memory_file_0..2
+ */
+static GFile *
+create_source_tree (GFile *root)
+{
+    g_autoptr (GFile) directory = NULL;
+    GFile *source = g_file_get_child (root, "undo_memory_source");
+
+    g_assert_true (g_file_make_directory (source, NULL, NULL));
+    directory = g_file_get_child (source, "undo_memory_directory");
+    g_assert_true (g_file_make_directory (directory, NULL, NULL));
+
+    for (guint i = 0; i < 3; i++)
+    {
+        g_autofree gchar *name = g_strdup_printf ("undo_memory_file_%u", i);
+        g_autoptr (GFile) file = g_file_get_child (directory, name);
+
+        g_assert_true (g_file_replace_contents (file, name, strlen (name), NULL, FALSE,
+                                                G_FILE_CREATE_NONE, NULL, NULL, NULL));
+    }
+
+    return source;
+}
+
+static void
+assert_tree_exists (GFile    *tree,
+                    gboolean  exists)
+{
+    g_autoptr (GFile) directory = g_file_get_child (tree, "undo_memory_directory");
+
+    g_assert_cmpint (g_file_query_exists (tree, NULL), ==, exists);
+    g_assert_cmpint (g_file_query_exists (directory, NULL), ==, exists);
+
+    for (guint i = 0; i < 3; i++)
+    {
+        g_autofree gchar *name = g_strdup_printf ("undo_memory_file_%u", i);
+        g_autoptr (GFile) file = g_file_get_child (directory, name);
+
+        g_assert_cmpint (g_file_query_exists (file, NULL), ==, exists);
+    }
+}
+
+static void
+test_copy_tree_undo (void)
+{
+    g_autoptr (GFile) root = g_file_new_for_path (test_get_tmp_dir ());
+    g_autoptr (GFile) source = NULL;
+    g_autoptr (GFile) destination = NULL;
+    g_autoptr (GFile) copy = NULL;
+    g_autolist (GFile) files = NULL;
+
+    source = create_source_tree (root);
+    destination = g_file_get_child (root, "undo_memory_destination");
+    g_assert_true (g_file_make_directory (destination, NULL, NULL));
+    copy = g_file_get_child (destination, "undo_memory_source");
+    files = g_list_prepend (files, g_object_ref (source));
+
+    nautilus_file_operations_copy_sync (files, destination);
+    assert_tree_exists (copy, TRUE);
+
+    /* Undoing deletes every copied file recorded in the compact list */
+    test_operation_undo ();
+
+    assert_tree_exists (copy, FALSE);
+    assert_tree_exists (source, TRUE);
+
+    empty_directory_by_prefix (root, "undo_memory");
+}
+
+static void
+test_move_tree_undo (void)
+{
+    g_autoptr (GFile) root = g_file_new_for_path (test_get_tmp_dir ());
+    g_autoptr (GFile) source = NULL;
+    g_autoptr (GFile) destination = NULL;
+    g_autoptr (GFile) moved = NULL;
+    g_autolist (GFile) files = NULL;
+
+    source = create_source_tree (root);
+    destination = g_file_get_child (root, "undo_memory_destination");
+    g_assert_true (g_file_make_directory (destination, NULL, NULL));
+    moved = g_file_get_child (destination, "undo_memory_source");
+    files = g_list_prepend (files, g_object_ref (source));
+
+    nautilus_file_operations_move_sync (files, destination);
+    assert_tree_exists (moved, TRUE);
+    assert_tree_exists (source, FALSE);
+
+    /* Undoing moves the files back to the origins recorded in the compact list */
+    test_operation_undo ();
+
+    assert_tree_exists (source, TRUE);
+    assert_tree_exists (moved, FALSE);
+
+    empty_directory_by_prefix (root, "undo_memory");
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/test-compact-file-list-round-trip/1.0",
+                     test_compact_file_list_round_trip);
+    g_test_add_func ("/test-compact-file-list-empty/1.0",
+                     test_compact_file_list_empty);
+    g_test_add_func ("/test-compact-file-list-shares-parents/1.0",
+                     test_compact_file_list_shares_parents);
+    g_test_add_func ("/test-copy-tree-undo/1.0",
+                     test_copy_tree_undo);
+    g_test_add_func ("/test-move-tree-undo/1.0",
+                     test_move_tree_undo);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (NautilusFileUndoManager) undo_manager = NULL;
+    int ret;
+
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+    nautilus_ensure_extension_points ();
+    undo_manager = nautilus_file_undo_manager_new ();
+
+    setup_test_suite ();
+
+    ret = g_test_run ();
+
+    test_clear_tmp_dir ();
+
+    return ret;
+}
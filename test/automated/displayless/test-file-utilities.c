@@ -206,6 +206,63 @@ test_multiple_files_different_large (void)
     g_assert_false (nautilus_file_selection_equal (first_selection, second_selection));
 }
 
+/* Tests that unique names skip over the ones already in the directory, and
+ * that names handed out by a snapshot aren't handed out again */
+static void
+test_generate_unique_file (void)
+{
+    g_autofree gchar *tmp_path = g_dir_make_tmp ("nautilus.XXXXXX", NULL);
+    g_autoptr (GFile) directory = g_file_new_for_path (tmp_path);
+    const char *existing[] = { "name", "name (2)", "name (3)", NULL };
+    g_autoptr (GFile) unique = NULL;
+    g_autoptr (GFile) other = NULL;
+    g_autofree gchar *unique_name = NULL;
+    g_autoptr (NautilusNameSnapshot) snapshot = NULL;
+
+    for (guint i = 0; existing[i] != NULL; i++)
+    {
+        g_autoptr (GFile) child = g_file_get_child (directory, existing[i]);
+        g_autoptr (GFileOutputStream) stream = g_file_create (child, G_FILE_CREATE_NONE, NULL, NULL);
+
+        g_assert_nonnull (stream);
+    }
+
+    unique = nautilus_generate_unique_file_in_directory (directory, "name");
+    unique_name = g_file_get_basename (unique);
+    g_assert_cmpstr (unique_name, ==, "name (4)");
+
+    g_clear_object (&unique);
+    unique = nautilus_generate_unique_file_in_directory (directory, "other");
+    g_clear_pointer (&unique_name, g_free);
+    unique_name = g_file_get_basename (unique);
+    g_assert_cmpstr (unique_name, ==, "other");
+
+    snapshot = nautilus_name_snapshot_new (directory, NULL);
+    g_assert_false (nautilus_name_snapshot_claim (snapshot, "name (2)"));
+    g_assert_true (nautilus_name_snapshot_claim (snapshot, "name (4)"));
+    g_assert_false (nautilus_name_snapshot_claim (snapshot, "name (4)"));
+
+    other = nautilus_name_snapshot_generate_unique_file (snapshot, "name");
+    g_clear_pointer (&unique_name, g_free);
+    unique_name = g_file_get_basename (other);
+    g_assert_cmpstr (unique_name, ==, "name (5)");
+
+    /* Suggestions aren't claimed, so the same one comes back */
+    g_clear_object (&other);
+    other = nautilus_name_snapshot_generate_unique_file (snapshot, "name");
+    g_clear_pointer (&unique_name, g_free);
+    unique_name = g_file_get_basename (other);
+    g_assert_cmpstr (unique_name, ==, "name (5)");
+
+    for (guint i = 0; existing[i] != NULL; i++)
+    {
+        g_autoptr (GFile) child = g_file_get_child (directory, existing[i]);
+
+        g_file_delete (child, NULL, NULL);
+    }
+    g_file_delete (directory, NULL, NULL);
+}
+
 static void
 setup_test_suite (void)
 {
@@ -225,6 +282,8 @@ setup_test_suite (void)
                      test_multiple_files_different_medium);
     g_test_add_func ("/file-selection-different-files/1.2",
                      test_multiple_files_different_large);
+    g_test_add_func ("/generate-unique-file/1.0",
+                     test_generate_unique_file);
 }
 
 int
@@ -0,0 +1,162 @@
+#include "test-utilities.h"
+
+#include <nautilus-extension.h>
+#include <src/nautilus-file.h>
+
+/* An info provider which leaves every update in progress, for the test to
+ * complete by hand. */
+#define TEST_TYPE_INFO_PROVIDER (test_info_provider_get_type ())
+G_DECLARE_FINAL_TYPE (TestInfoProvider, test_info_provider, TEST, INFO_PROVIDER, GObject)
+
+struct _TestInfoProvider
+{
+    GObject parent_instance;
+
+    GClosure *update_complete;
+    guint n_cancelled;
+};
+
+static void test_info_provider_iface_init (NautilusInfoProviderInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestInfoProvider, test_info_provider, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (NAUTILUS_TYPE_INFO_PROVIDER,
+                                                test_info_provider_iface_init))
+
+static NautilusOperationResult
+test_info_provider_update_file_info (NautilusInfoProvider     *provider,
+                                     NautilusFileInfo         *file,
+                                     GClosure                 *update_complete,
+                                     NautilusOperationHandle **handle)
+{
+    TestInfoProvider *self = TEST_INFO_PROVIDER (provider);
+
+    g_clear_pointer (&self->update_complete, g_closure_unref);
+    self->update_complete = g_closure_ref (update_complete);
+    *handle = (NautilusOperationHandle *) self;
+
+    return NAUTILUS_OPERATION_IN_PROGRESS;
+}
+
+static void
+test_info_provider_cancel_update (NautilusInfoProvider    *provider,
+                                  NautilusOperationHandle *handle)
+{
+    TestInfoProvider *self = TEST_INFO_PROVIDER (provider);
+
+    g_clear_pointer (&self->update_complete, g_closure_unref);
+    self->n_cancelled++;
+}
+
+static void
+test_info_provider_iface_init (NautilusInfoProviderInterface *iface)
+{
+    iface->update_file_info = test_info_provider_update_file_info;
+    iface->cancel_update = test_info_provider_cancel_update;
+}
+
+static void
+test_info_provider_finalize (GObject *object)
+{
+    TestInfoProvider *self = TEST_INFO_PROVIDER (object);
+
+    g_clear_pointer (&self->update_complete, g_closure_unref);
+
+    G_OBJECT_CLASS (test_info_provider_parent_class)->finalize (object);
+}
+
+static void
+test_info_provider_class_init (TestInfoProviderClass *klass)
+{
+    G_OBJECT_CLASS (klass)->finalize = test_info_provider_finalize;
+}
+
+static void
+test_info_provider_init (TestInfoProvider *self)
+{
+}
+
+static void
+count_file_done (NautilusInfoProvider    *provider,
+                 NautilusFileInfo        *file,
+                 NautilusOperationResult  result,
+                 gpointer                 user_data)
+{
+    guint *n_done = user_data;
+
+    (*n_done)++;
+}
+
+static void
+test_batch_cancel_in_progress (void)
+{
+    g_autoptr (TestInfoProvider) provider = g_object_new (TEST_TYPE_INFO_PROVIDER, NULL);
+    g_autoptr (GCancellable) cancellable = g_cancellable_new ();
+    g_autoptr (NautilusFile) file = nautilus_file_get_by_uri ("file:///");
+    g_autoptr (GList) files = g_list_prepend (NULL, file);
+    guint n_done = 0;
+
+    nautilus_info_provider_update_file_info_batch (NAUTILUS_INFO_PROVIDER (provider),
+                                                   files, cancellable,
+                                                   count_file_done, &n_done);
+    g_assert_nonnull (provider->update_complete);
+
+    g_cancellable_cancel (cancellable);
+    g_assert_cmpuint (provider->n_cancelled, ==, 1);
+
+    while (g_main_context_iteration (NULL, FALSE))
+    {
+    }
+    g_assert_cmpuint (n_done, ==, 0);
+}
+
+static void
+test_batch_cancel_after_complete (void)
+{
+    g_autoptr (TestInfoProvider) provider = g_object_new (TEST_TYPE_INFO_PROVIDER, NULL);
+    g_autoptr (GCancellable) cancellable = g_cancellable_new ();
+    g_autoptr (NautilusFile) file = nautilus_file_get_by_uri ("file:///");
+    g_autoptr (GList) files = g_list_prepend (NULL, file);
+    guint n_done = 0;
+
+    nautilus_info_provider_update_file_info_batch (NAUTILUS_INFO_PROVIDER (provider),
+                                                   files, cancellable,
+                                                   count_file_done, &n_done);
+    g_assert_nonnull (provider->update_complete);
+
+    /* Cancelling before the completion is reported back must not cancel the
+     * operation which is already over. */
+    nautilus_info_provider_update_complete_invoke (provider->update_complete,
+                                                   NAUTILUS_INFO_PROVIDER (provider),
+                                                   (NautilusOperationHandle *) provider,
+                                                   NAUTILUS_OPERATION_COMPLETE);
+    g_clear_pointer (&provider->update_complete, g_closure_unref);
+    g_cancellable_cancel (cancellable);
+    g_assert_cmpuint (provider->n_cancelled, ==, 0);
+
+    while (g_main_context_iteration (NULL, FALSE))
+    {
+    }
+    g_assert_cmpuint (n_done, ==, 0);
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/test-info-provider-batch-cancel-in-progress/1.0",
+                     test_batch_cancel_in_progress);
+    g_test_add_func ("/test-info-provider-batch-cancel-after-complete/1.0",
+                     test_batch_cancel_after_complete);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+    nautilus_ensure_extension_points ();
+
+    setup_test_suite ();
+
+    return g_test_run ();
+}
@@ -0,0 +1,728 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <extensions/media-columns/nautilus-media-header-parser.h>
+
+static gboolean
+parse_bytes (const char        *mime_type,
+             GByteArray        *bytes,
+             gsize              length,
+             NautilusMediaInfo *info)
+{
+    g_autofree char *path = NULL;
+    gboolean result;
+    int fd;
+
+    fd = g_file_open_tmp ("test-media-header-XXXXXX", &path, NULL);
+    g_assert_cmpint (fd, >=, 0);
+    g_assert_cmpint (write (fd, bytes->data, length), ==, (gssize) length);
+
+    result = nautilus_media_header_parse (fd, mime_type, info);
+
+    close (fd);
+    g_unlink (path);
+
+    return result;
+}
+
+static void
+append_be16 (GByteArray *bytes,
+             guint16     value)
+{
+    guint8 data[] = { value >> 8, value };
+
+    g_byte_array_append (bytes, data, sizeof (data));
+}
+
+static void
+append_be32 (GByteArray *bytes,
+             guint32     value)
+{
+    guint8 data[] = { value >> 24, value >> 16, value >> 8, value };
+
+    g_byte_array_append (bytes, data, sizeof (data));
+}
+
+static void
+append_be64 (GByteArray *bytes,
+             guint64     value)
+{
+    append_be32 (bytes, value >> 32);
+    append_be32 (bytes, value);
+}
+
+static void
+append_string (GByteArray *bytes,
+               const char *string)
+{
+    g_byte_array_append (bytes, (const guint8 *) string, strlen (string));
+}
+
+static void
+append_zeros (GByteArray *bytes,
+              guint       length)
+{
+    for (guint i = 0; i < length; i++)
+    {
+        g_byte_array_append (bytes, (const guint8 *) "", 1);
+    }
+}
+
+/* PNG */
+
+static GByteArray *
+create_png (guint32 width,
+            guint32 height)
+{
+    GByteArray *bytes = g_byte_array_new ();
+    static const guint8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    g_byte_array_append (bytes, signature, sizeof (signature));
+    append_be32 (bytes, 13);
+    append_string (bytes, "IHDR");
+    append_be32 (bytes, width);
+    append_be32 (bytes, height);
+    /* Depth, color type, compression, filter, interlace, then the CRC */
+    append_zeros (bytes, 5 + 4);
+
+    return bytes;
+}
+
+static void
+test_png (void)
+{
+    g_autoptr (GByteArray) bytes = create_png (640, 480);
+    NautilusMediaInfo info;
+
+    g_assert_true (parse_bytes ("image/png", bytes, bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 640);
+    g_assert_cmpuint (info.height, ==, 480);
+    g_assert_cmpuint (info.duration_ms, ==, 0);
+}
+
+static void
+test_png_truncated (void)
+{
+    g_autoptr (GByteArray) bytes = create_png (640, 480);
+    NautilusMediaInfo info;
+
+    g_assert_false (parse_bytes ("image/png", bytes, 20, &info));
+    g_assert_cmpuint (info.width, ==, 0);
+    g_assert_cmpuint (info.height, ==, 0);
+}
+
+static void
+test_png_malformed (void)
+{
+    g_autoptr (GByteArray) bytes = create_png (640, 480);
+    NautilusMediaInfo info;
+
+    /* The first chunk must be IHDR. */
+    memcpy (bytes->data + 12, "IDAT", 4);
+
+    g_assert_false (parse_bytes ("image/png", bytes, bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 0);
+}
+
+/* JPEG */
+
+static void
+append_jpeg_app0 (GByteArray *bytes)
+{
+    append_be16 (bytes, 0xffe0);
+    append_be16 (bytes, 16);
+    append_string (bytes, "JFIF");
+    append_zeros (bytes, 10);
+}
+
+static void
+append_jpeg_exif (GByteArray *bytes,
+                  guint16     orientation)
+{
+    static const guint8 tiff[] =
+    {
+        'I', 'I', 0x2a, 0x00, 0x08, 0x00, 0x00, 0x00,
+        /* One entry: orientation, a single SHORT */
+        0x01, 0x00,
+        0x12, 0x01, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00,
+    };
+
+    append_be16 (bytes, 0xffe1);
+    append_be16 (bytes, 2 + 6 + sizeof (tiff) + 4 + 4);
+    g_byte_array_append (bytes, (const guint8 *) "Exif\0\0", 6);
+    g_byte_array_append (bytes, tiff, sizeof (tiff));
+    g_byte_array_append (bytes, (const guint8[]) { orientation, orientation >> 8, 0, 0 }, 4);
+    /* No next directory */
+    append_zeros (bytes, 4);
+}
+
+static void
+append_jpeg_frame (GByteArray *bytes,
+                   guint16     width,
+                   guint16     height)
+{
+    /* Baseline frame header with one component */
+    append_be16 (bytes, 0xffc0);
+    append_be16 (bytes, 11);
+    g_byte_array_append (bytes, (const guint8 *) "\x08", 1);
+    append_be16 (bytes, height);
+    append_be16 (bytes, width);
+    g_byte_array_append (bytes, (const guint8 *) "\x01\x01\x11\x00", 4);
+}
+
+static void
+test_jpeg (void)
+{
+    g_autoptr (GByteArray) bytes = g_byte_array_new ();
+    NautilusMediaInfo info;
+
+    append_be16 (bytes, 0xffd8);
+    append_jpeg_app0 (bytes);
+    /* A DHT segment, which shares its range of markers with frame headers */
+    append_be16 (bytes, 0xffc4);
+    append_be16 (bytes, 4);
+    append_zeros (bytes, 2);
+    append_jpeg_frame (bytes, 1024, 768);
+
+    g_assert_true (parse_bytes ("image/jpeg", bytes, bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 1024);
+    g_assert_cmpuint (info.height, ==, 768);
+}
+
+static void
+test_jpeg_exif_orientation (void)
+{
+    g_autoptr (GByteArray) rotated = g_byte_array_new ();
+    g_autoptr (GByteArray) flipped = g_byte_array_new ();
+    NautilusMediaInfo info;
+
+    /* Rotated by a quarter turn */
+    append_be16 (rotated, 0xffd8);
+    append_jpeg_exif (rotated, 6);
+    append_jpeg_frame (rotated, 4000, 3000);
+
+    g_assert_true (parse_bytes ("image/jpeg", rotated, rotated->len, &info));
+    g_assert_cmpuint (info.width, ==, 3000);
+    g_assert_cmpuint (info.height, ==, 4000);
+
+    /* Upside down */
+    append_be16 (flipped, 0xffd8);
+    append_jpeg_exif (flipped, 3);
+    append_jpeg_frame (flipped, 4000, 3000);
+
+    g_assert_true (parse_bytes ("image/jpeg", flipped, flipped->len, &info));
+    g_assert_cmpuint (info.width, ==, 4000);
+    g_assert_cmpuint (info.height, ==, 3000);
+}
+
+static void
+test_jpeg_malformed (void)
+{
+    g_autoptr (GByteArray) oversized = g_byte_array_new ();
+    g_autoptr (GByteArray) bad_exif = g_byte_array_new ();
+    g_autoptr (GByteArray) not_jpeg = g_byte_array_new ();
+    NautilusMediaInfo info;
+
+    /* A segment claiming to run past the end of the file */
+    append_be16 (oversized, 0xffd8);
+    append_be16 (oversized, 0xffe0);
+    append_be16 (oversized, 0xffff);
+    append_zeros (oversized, 32);
+
+    g_assert_false (parse_bytes ("image/jpeg", oversized, oversized->len, &info));
+    g_assert_cmpuint (info.width, ==, 0);
+
+    /* Exif data pointing its directory out of its segment is ignored. */
+    append_be16 (bad_exif, 0xffd8);
+    append_jpeg_exif (bad_exif, 6);
+    bad_exif->data[2 + 4 + 6 + 4] = 0xff;
+    append_jpeg_frame (bad_exif, 4000, 3000);
+
+    g_assert_true (parse_bytes ("image/jpeg", bad_exif, bad_exif->len, &info));
+    g_assert_cmpuint (info.width, ==, 4000);
+    g_assert_cmpuint (info.height, ==, 3000);
+
+    append_be16 (not_jpeg, 0xffd9);
+    append_jpeg_frame (not_jpeg, 4000, 3000);
+
+    g_assert_false (parse_bytes ("image/jpeg", not_jpeg, not_jpeg->len, &info));
+}
+
+static void
+test_jpeg_truncated (void)
+{
+    g_autoptr (GByteArray) bytes = g_byte_array_new ();
+    NautilusMediaInfo info;
+
+    append_be16 (bytes, 0xffd8);
+    append_jpeg_app0 (bytes);
+    append_jpeg_frame (bytes, 1024, 768);
+
+    /* Cut in the frame header, before the size */
+    g_assert_false (parse_bytes ("image/jpeg", bytes, bytes->len - 8, &info));
+    g_assert_cmpuint (info.width, ==, 0);
+}
+
+/* WebP */
+
+static GByteArray *
+create_webp (const char *format)
+{
+    GByteArray *bytes = g_byte_array_new ();
+
+    append_string (bytes, "RIFF");
+    append_zeros (bytes, 4);
+    append_string (bytes, "WEBP");
+    append_string (bytes, format);
+    append_zeros (bytes, 4);
+
+    return bytes;
+}
+
+static void
+test_webp (void)
+{
+    g_autoptr (GByteArray) extended = create_webp ("VP8X");
+    g_autoptr (GByteArray) lossless = create_webp ("VP8L");
+    g_autoptr (GByteArray) lossy = create_webp ("VP8 ");
+    guint32 bits;
+    NautilusMediaInfo info;
+
+    /* Flags, then the canvas size minus one, in 24 bits each */
+    append_zeros (extended, 4);
+    g_byte_array_append (extended, (const guint8[]) { 0x7f, 0x07, 0x00, 0x37, 0x04, 0x00 }, 6);
+
+    g_assert_true (parse_bytes ("image/webp", extended, extended->len, &info));
+    g_assert_cmpuint (info.width, ==, 1920);
+    g_assert_cmpuint (info.height, ==, 1080);
+
+    /* A signature byte, then the size minus one, in 14 bits each */
+    bits = (300 - 1) | (200 - 1) << 14;
+    g_byte_array_append (lossless, (const guint8[]) { 0x2f, bits, bits >> 8, bits >> 16, bits >> 24 }, 5);
+    append_zeros (lossless, 5);
+
+    g_assert_true (parse_bytes ("image/webp", lossless, lossless->len, &info));
+    g_assert_cmpuint (info.width, ==, 300);
+    g_assert_cmpuint (info.height, ==, 200);
+
+    /* A frame tag, the key frame start code, then the size in 14 bits each */
+    append_zeros (lossy, 3);
+    g_byte_array_append (lossy, (const guint8[]) { 0x9d, 0x01, 0x2a, 0x80, 0x02, 0xe0, 0x01 }, 7);
+
+    g_assert_true (parse_bytes ("image/webp", lossy, lossy->len, &info));
+    g_assert_cmpuint (info.width, ==, 640);
+    g_assert_cmpuint (info.height, ==, 480);
+}
+
+static void
+test_webp_malformed (void)
+{
+    g_autoptr (GByteArray) truncated = create_webp ("VP8X");
+    g_autoptr (GByteArray) lossy = create_webp ("VP8 ");
+    g_autoptr (GByteArray) unknown = create_webp ("ALPH");
+    NautilusMediaInfo info;
+
+    append_zeros (truncated, 4);
+
+    g_assert_false (parse_bytes ("image/webp", truncated, truncated->len, &info));
+
+    /* Not a key frame */
+    append_zeros (lossy, 10);
+
+    g_assert_false (parse_bytes ("image/webp", lossy, lossy->len, &info));
+
+    append_zeros (unknown, 10);
+
+    g_assert_false (parse_bytes ("image/webp", unknown, unknown->len, &info));
+}
+
+/* MP4 */
+
+static void
+append_box (GByteArray *bytes,
+            const char *type,
+            GByteArray *payload)
+{
+    append_be32 (bytes, 8 + payload->len);
+    append_string (bytes, type);
+    g_byte_array_append (bytes, payload->data, payload->len);
+}
+
+static GByteArray *
+create_mvhd (guint8  version,
+             guint32 timescale,
+             guint64 duration)
+{
+    GByteArray *mvhd = g_byte_array_new ();
+
+    g_byte_array_append (mvhd, (const guint8[]) { version, 0, 0, 0 }, 4);
+    if (version == 1)
+    {
+        append_zeros (mvhd, 16);
+        append_be32 (mvhd, timescale);
+        append_be64 (mvhd, duration);
+    }
+    else
+    {
+        append_zeros (mvhd, 8);
+        append_be32 (mvhd, timescale);
+        append_be32 (mvhd, duration);
+    }
+    /* Rate, volume, reserved, matrix, predefined and next track ID */
+    append_zeros (mvhd, 80);
+
+    return mvhd;
+}
+
+static GByteArray *
+create_trak (guint32 width,
+             guint32 height)
+{
+    g_autoptr (GByteArray) tkhd = g_byte_array_new ();
+    GByteArray *trak = g_byte_array_new ();
+
+    /* Version 0: times, track ID, reserved, duration, reserved, layer,
+     * group, volume, reserved and the matrix, then the size in 16.16. */
+    append_zeros (tkhd, 76);
+    append_be32 (tkhd, width << 16);
+    append_be32 (tkhd, height << 16);
+
+    append_box (trak, "tkhd", tkhd);
+
+    return trak;
+}
+
+static GByteArray *
+create_mp4 (GByteArray *mvhd,
+            GByteArray *trak)
+{
+    g_autoptr (GByteArray) ftyp = g_byte_array_new ();
+    g_autoptr (GByteArray) mdat = g_byte_array_new ();
+    g_autoptr (GByteArray) moov = g_byte_array_new ();
+    GByteArray *bytes = g_byte_array_new ();
+
+    append_string (ftyp, "isom");
+    append_zeros (ftyp, 4);
+    append_zeros (mdat, 64);
+
+    append_box (moov, "mvhd", mvhd);
+    if (trak != NULL)
+    {
+        append_box (moov, "trak", trak);
+    }
+
+    append_box (bytes, "ftyp", ftyp);
+    /* Media data before the movie box, as recorders usually write it */
+    append_box (bytes, "mdat", mdat);
+    append_box (bytes, "moov", moov);
+
+    return bytes;
+}
+
+static void
+test_mp4 (void)
+{
+    g_autoptr (GByteArray) mvhd = create_mvhd (0, 1000, 90500);
+    g_autoptr (GByteArray) trak = create_trak (1920, 1080);
+    g_autoptr (GByteArray) bytes = create_mp4 (mvhd, trak);
+    NautilusMediaInfo info;
+
+    g_assert_true (parse_bytes ("video/mp4", bytes, bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 1920);
+    g_assert_cmpuint (info.height, ==, 1080);
+    g_assert_cmpuint (info.duration_ms, ==, 90500);
+}
+
+static void
+test_mp4_long_duration (void)
+{
+    g_autoptr (GByteArray) long_mvhd = create_mvhd (1, 48000, 48000ULL * 7200 + 24000);
+    g_autoptr (GByteArray) long_bytes = create_mp4 (long_mvhd, NULL);
+    g_autoptr (GByteArray) huge_mvhd = create_mvhd (1, 1, G_MAXUINT64 / 10);
+    g_autoptr (GByteArray) trak = create_trak (640, 480);
+    g_autoptr (GByteArray) huge_bytes = create_mp4 (huge_mvhd, trak);
+    NautilusMediaInfo info;
+
+    g_assert_true (parse_bytes ("video/mp4", long_bytes, long_bytes->len, &info));
+    g_assert_cmpuint (info.duration_ms, ==, 7200500);
+
+    /* Too long to be counted in milliseconds; it must not wrap around. */
+    g_assert_true (parse_bytes ("video/mp4", huge_bytes, huge_bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 640);
+    g_assert_cmpuint (info.duration_ms, ==, 0);
+}
+
+static void
+test_mp4_truncated (void)
+{
+    g_autoptr (GByteArray) mvhd = create_mvhd (0, 1000, 90500);
+    g_autoptr (GByteArray) trak = create_trak (1920, 1080);
+    g_autoptr (GByteArray) bytes = create_mp4 (mvhd, trak);
+    NautilusMediaInfo info;
+
+    /* The movie box now claims to be larger than the file. */
+    g_assert_false (parse_bytes ("video/mp4", bytes, bytes->len - 4, &info));
+    g_assert_cmpuint (info.width, ==, 0);
+    g_assert_cmpuint (info.duration_ms, ==, 0);
+}
+
+static void
+test_mp4_malformed (void)
+{
+    g_autoptr (GByteArray) mvhd = create_mvhd (0, 1000, 90500);
+    g_autoptr (GByteArray) short_box = g_byte_array_new ();
+    g_autoptr (GByteArray) oversized_box = g_byte_array_new ();
+    g_autoptr (GByteArray) nested = g_byte_array_new ();
+    g_autoptr (GByteArray) nested_bytes = NULL;
+    NautilusMediaInfo info;
+
+    /* A size smaller than the box header */
+    append_be32 (short_box, 4);
+    append_string (short_box, "moov");
+    append_box (short_box, "mvhd", mvhd);
+
+    g_assert_false (parse_bytes ("video/mp4", short_box, short_box->len, &info));
+
+    /* A child larger than its parent */
+    append_be32 (oversized_box, 8 + 8 + mvhd->len);
+    append_string (oversized_box, "moov");
+    append_be32 (oversized_box, 8 + mvhd->len + 100);
+    append_string (oversized_box, "mvhd");
+    g_byte_array_append (oversized_box, mvhd->data, mvhd->len);
+    append_zeros (oversized_box, 200);
+
+    g_assert_false (parse_bytes ("video/mp4", oversized_box, oversized_box->len, &info));
+    g_assert_cmpuint (info.duration_ms, ==, 0);
+
+    /* Tracks nested deeper than any real file, which are not followed */
+    for (guint i = 0; i < 32; i++)
+    {
+        g_autoptr (GByteArray) parent = g_byte_array_new ();
+
+        append_box (parent, "trak", nested);
+        g_byte_array_set_size (nested, 0);
+        g_byte_array_append (nested, parent->data, parent->len);
+    }
+    nested_bytes = create_mp4 (mvhd, nested);
+
+    g_assert_true (parse_bytes ("video/mp4", nested_bytes, nested_bytes->len, &info));
+    g_assert_cmpuint (info.duration_ms, ==, 90500);
+    g_assert_cmpuint (info.width, ==, 0);
+}
+
+/* Matroska */
+
+#define EBML_UNKNOWN_SIZE_BYTES "\x01\xff\xff\xff\xff\xff\xff\xff"
+
+/* IDs keep their length marker, so their length is that of their value. */
+static void
+append_ebml_id (GByteArray *bytes,
+                guint32     id)
+{
+    int shift = 24;
+
+    while (shift > 0 && id >> shift == 0)
+    {
+        shift -= 8;
+    }
+
+    for (; shift >= 0; shift -= 8)
+    {
+        g_byte_array_append (bytes, (const guint8[]) { id >> shift }, 1);
+    }
+}
+
+static void
+append_ebml_element (GByteArray   *bytes,
+                     guint32       id,
+                     const guint8 *data,
+                     gsize         length)
+{
+    append_ebml_id (bytes, id);
+    if (length < 127)
+    {
+        g_byte_array_append (bytes, (const guint8[]) { 0x80 | length }, 1);
+    }
+    else
+    {
+        g_byte_array_append (bytes, (const guint8 *) "\x01", 1);
+        for (int shift = 48; shift >= 0; shift -= 8)
+        {
+            g_byte_array_append (bytes, (const guint8[]) { length >> shift }, 1);
+        }
+    }
+    g_byte_array_append (bytes, data, length);
+}
+
+static void
+append_ebml_uint (GByteArray *bytes,
+                  guint32     id,
+                  guint32     value)
+{
+    guint8 data[] = { value >> 24, value >> 16, value >> 8, value };
+
+    append_ebml_element (bytes, id, data, sizeof (data));
+}
+
+static void
+append_ebml_float (GByteArray *bytes,
+                   guint32     id,
+                   double      value)
+{
+    union { double d; guint64 i; } u = { value };
+    g_autoptr (GByteArray) data = g_byte_array_new ();
+
+    append_be64 (data, u.i);
+    append_ebml_element (bytes, id, data->data, data->len);
+}
+
+static GByteArray *
+create_matroska (double duration)
+{
+    g_autoptr (GByteArray) header = g_byte_array_new ();
+    g_autoptr (GByteArray) info = g_byte_array_new ();
+    g_autoptr (GByteArray) video = g_byte_array_new ();
+    g_autoptr (GByteArray) track = g_byte_array_new ();
+    g_autoptr (GByteArray) tracks = g_byte_array_new ();
+    GByteArray *bytes = g_byte_array_new ();
+
+    /* DocType */
+    append_ebml_element (header, 0x4282, (const guint8 *) "webm", 4);
+
+    append_ebml_uint (info, 0x2ad7b1, 1000000);
+    append_ebml_float (info, 0x4489, duration);
+
+    append_ebml_uint (video, 0xb0, 1280);
+    append_ebml_uint (video, 0xba, 720);
+    append_ebml_element (track, 0xe0, video->data, video->len);
+    append_ebml_element (tracks, 0xae, track->data, track->len);
+
+    append_ebml_element (bytes, 0x1a45dfa3, header->data, header->len);
+    /* Segments of live recordings have an unknown size. */
+    append_ebml_id (bytes, 0x18538067);
+    g_byte_array_append (bytes, (const guint8 *) EBML_UNKNOWN_SIZE_BYTES, 8);
+    append_ebml_element (bytes, 0x1549a966, info->data, info->len);
+    append_ebml_element (bytes, 0x1654ae6b, tracks->data, tracks->len);
+
+    return bytes;
+}
+
+static void
+test_matroska (void)
+{
+    g_autoptr (GByteArray) bytes = create_matroska (90500.0);
+    NautilusMediaInfo info;
+
+    g_assert_true (parse_bytes ("video/webm", bytes, bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 1280);
+    g_assert_cmpuint (info.height, ==, 720);
+    g_assert_cmpuint (info.duration_ms, ==, 90500);
+}
+
+static void
+test_matroska_huge_duration (void)
+{
+    g_autoptr (GByteArray) bytes = create_matroska (1e300);
+    NautilusMediaInfo info;
+
+    g_assert_true (parse_bytes ("video/x-matroska", bytes, bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 1280);
+    g_assert_cmpuint (info.duration_ms, ==, 0);
+}
+
+static void
+test_matroska_truncated (void)
+{
+    g_autoptr (GByteArray) bytes = create_matroska (90500.0);
+    NautilusMediaInfo info;
+
+    /* Cut in the tracks, whose size now goes past the end: what is there
+     * is still read. */
+    g_assert_true (parse_bytes ("video/webm", bytes, bytes->len - 6, &info));
+    g_assert_cmpuint (info.width, ==, 1280);
+    g_assert_cmpuint (info.height, ==, 0);
+    g_assert_cmpuint (info.duration_ms, ==, 90500);
+
+    g_assert_false (parse_bytes ("video/webm", bytes, 3, &info));
+}
+
+static void
+test_matroska_malformed (void)
+{
+    g_autoptr (GByteArray) bytes = create_matroska (90500.0);
+    g_autoptr (GByteArray) not_matroska = create_png (640, 480);
+    NautilusMediaInfo info;
+    guint i = 0;
+
+    /* A size of zero length, which no valid variable length integer has */
+    while (memcmp (bytes->data + i, EBML_UNKNOWN_SIZE_BYTES, 8) != 0)
+    {
+        i++;
+    }
+    bytes->data[i] = 0;
+
+    g_assert_false (parse_bytes ("video/webm", bytes, bytes->len, &info));
+    g_assert_cmpuint (info.width, ==, 0);
+
+    g_assert_false (parse_bytes ("video/webm", not_matroska, not_matroska->len, &info));
+}
+
+static void
+test_unsupported (void)
+{
+    g_autoptr (GByteArray) bytes = create_png (640, 480);
+    NautilusMediaInfo info;
+
+    g_assert_false (nautilus_media_header_is_supported ("image/gif"));
+    g_assert_false (nautilus_media_header_is_supported (NULL));
+    g_assert_false (parse_bytes ("image/gif", bytes, bytes->len, &info));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+
+    g_test_add_func ("/media-header-parser/png",
+                     test_png);
+    g_test_add_func ("/media-header-parser/png-truncated",
+                     test_png_truncated);
+    g_test_add_func ("/media-header-parser/png-malformed",
+                     test_png_malformed);
+    g_test_add_func ("/media-header-parser/jpeg",
+                     test_jpeg);
+    g_test_add_func ("/media-header-parser/jpeg-exif-orientation",
+                     test_jpeg_exif_orientation);
+    g_test_add_func ("/media-header-parser/jpeg-truncated",
+                     test_jpeg_truncated);
+    g_test_add_func ("/media-header-parser/jpeg-malformed",
+                     test_jpeg_malformed);
+    g_test_add_func ("/media-header-parser/webp",
+                     test_webp);
+    g_test_add_func ("/media-header-parser/webp-malformed",
+                     test_webp_malformed);
+    g_test_add_func ("/media-header-parser/mp4",
+                     test_mp4);
+    g_test_add_func ("/media-header-parser/mp4-long-duration",
+                     test_mp4_long_duration);
+    g_test_add_func ("/media-header-parser/mp4-truncated",
+                     test_mp4_truncated);
+    g_test_add_func ("/media-header-parser/mp4-malformed",
+                     test_mp4_malformed);
+    g_test_add_func ("/media-header-parser/matroska",
+                     test_matroska);
+    g_test_add_func ("/media-header-parser/matroska-huge-duration",
+                     test_matroska_huge_duration);
+    g_test_add_func ("/media-header-parser/matroska-truncated",
+                     test_matroska_truncated);
+    g_test_add_func ("/media-header-parser/matroska-malformed",
+                     test_matroska_malformed);
+    g_test_add_func ("/media-header-parser/unsupported",
+                     test_unsupported);
+
+    return g_test_run ();
+}
@@ -190,6 +190,20 @@ test_operation_undo_redo (void)
                                  handler_id);
 }
 
+/* Creates the file @name in @directory, holding @contents, and returns it. */
+GFile *
+create_file (GFile       *directory,
+             const gchar *name,
+             const gchar *contents)
+{
+    GFile *file = g_file_get_child (directory, name);
+
+    g_assert_true (g_file_replace_contents (file, contents, strlen (contents), NULL, FALSE,
+                                            G_FILE_CREATE_NONE, NULL, NULL, NULL));
+
+    return file;
+}
+
 /* Creates the following hierarchy:
  * /tmp/`prefix`_first_dir/`prefix`_first_dir_child
  * /tmp/`prefix`_second_dir/
@@ -24,6 +24,9 @@ void quit_loop_callback (NautilusFileUndoManager *undo_manager,
 void test_operation_undo_redo (void);
 void test_operation_undo (void);
 
+GFile *create_file (GFile       *directory,
+                    const gchar *name,
+                    const gchar *contents);
 void create_one_file (gchar *prefix);
 void create_one_empty_directory (gchar *prefix);
 